@@ -0,0 +1,88 @@
+/* Gstreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * SECTION:gstcodecparserutils
+ * @short_description: Helpers shared by the bitstream parsing libraries
+ *
+ * <refsect2>
+ * <para>
+ * Provides the start code scanning used by the h264, mpeg video, mpeg4 and
+ * vc1 bitstream parsers.
+ * </para>
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "gstcodecparserutils.h"
+
+#include <string.h>
+
+/**
+ * gst_codec_parser_scan_start_code:
+ * @data: The data to scan
+ * @size: The size of @data
+ *
+ * Looks for the first 0x000001 start code prefix in @data that is followed
+ * by at least one byte, the same way as
+ * gst_byte_reader_masked_scan_uint32() with a 0xffffff00 mask and a
+ * 0x00000100 pattern would.
+ *
+ * The zero bytes are searched with memchr(), which the C libraries
+ * implement with vector instructions, and only the positions of zero bytes
+ * are checked for a start code. Coded video data has few zero bytes, so
+ * most of @data is skipped at the speed of memchr().
+ *
+ * Returns: the offset of the start code prefix in @data, or -1 if there is
+ * none.
+ */
+gint
+gst_codec_parser_scan_start_code (const guint8 * data, guint size)
+{
+  const guint8 *p, *end;
+
+  g_return_val_if_fail (data != NULL || size == 0, -1);
+
+  if (G_UNLIKELY (size < 4))
+    return -1;
+
+  /* last position where a start code followed by a byte can begin */
+  end = data + size - 3;
+
+  for (p = data; p < end;) {
+    p = memchr (p, 0, end - p);
+    if (p == NULL)
+      break;
+
+    if (p[1] != 0) {
+      /* no start code can begin on the non-zero byte either */
+      p += 2;
+    } else if (p[2] == 1) {
+      return p - data;
+    } else if (p[2] == 0) {
+      p++;
+    } else {
+      p += 3;
+    }
+  }
+
+  return -1;
+}
@@ -85,6 +85,8 @@
 #endif
 
 #include "gsth264parser.h"
+#include "gstcodecparserutils.h"
+#include "nalutils.h"
 
 #include <gst/base/gstbytereader.h>
 #include <gst/base/gstbitreader.h>
@@ -136,289 +138,6 @@ static const guint8 zigzag_4x4[16] = {
   7, 11, 14, 15,
 };
 
-/* Compute Ceil(Log2(v)) */
-/* Derived from branchless code for integer log2(v) from:
-   <http://graphics.stanford.edu/~seander/bithacks.html#IntegerLog> */
-static guint
-ceil_log2 (guint32 v)
-{
-  guint r, shift;
-
-  v--;
-  r = (v > 0xFFFF) << 4;
-  v >>= r;
-  shift = (v > 0xFF) << 3;
-  v >>= shift;
-  r |= shift;
-  shift = (v > 0xF) << 2;
-  v >>= shift;
-  r |= shift;
-  shift = (v > 0x3) << 1;
-  v >>= shift;
-  r |= shift;
-  r |= (v >> 1);
-  return r + 1;
-}
-
-/****** Nal parser ******/
-
-typedef struct
-{
-  const guint8 *data;
-  guint size;
-
-  guint n_epb;                  /* Number of emulation prevention bytes */
-  guint byte;                   /* Byte position */
-  guint bits_in_cache;          /* bitpos in the cache of next bit */
-  guint8 first_byte;
-  guint64 cache;                /* cached bytes */
-} NalReader;
-
-static void
-nal_reader_init (NalReader * nr, const guint8 * data, guint size)
-{
-  nr->data = data;
-  nr->size = size;
-  nr->n_epb = 0;
-
-  nr->byte = 0;
-  nr->bits_in_cache = 0;
-  /* fill with something other than 0 to detect emulation prevention bytes */
-  nr->first_byte = 0xff;
-  nr->cache = 0xff;
-}
-
-static inline gboolean
-nal_reader_read (NalReader * nr, guint nbits)
-{
-  if (G_UNLIKELY (nr->byte * 8 + (nbits - nr->bits_in_cache) > nr->size * 8)) {
-    GST_DEBUG ("Can not read %u bits, bits in cache %u, Byte * 8 %u, size in "
-        "bits %u", nbits, nr->bits_in_cache, nr->byte * 8, nr->size * 8);
-    return FALSE;
-  }
-
-  while (nr->bits_in_cache < nbits) {
-    guint8 byte;
-    gboolean check_three_byte;
-
-    check_three_byte = TRUE;
-  next_byte:
-    if (G_UNLIKELY (nr->byte >= nr->size))
-      return FALSE;
-
-    byte = nr->data[nr->byte++];
-
-    /* check if the byte is a emulation_prevention_three_byte */
-    if (check_three_byte && byte == 0x03 && nr->first_byte == 0x00 &&
-        ((nr->cache & 0xff) == 0)) {
-      /* next byte goes unconditionally to the cache, even if it's 0x03 */
-      check_three_byte = FALSE;
-      nr->n_epb++;
-      goto next_byte;
-    }
-    nr->cache = (nr->cache << 8) | nr->first_byte;
-    nr->first_byte = byte;
-    nr->bits_in_cache += 8;
-  }
-
-  return TRUE;
-}
-
-static inline gboolean
-nal_reader_skip (NalReader * nr, guint nbits)
-{
-  if (G_UNLIKELY (!nal_reader_read (nr, nbits)))
-    return FALSE;
-
-  nr->bits_in_cache -= nbits;
-
-  return TRUE;
-}
-
-static inline gboolean
-nal_reader_skip_to_byte (NalReader * nr)
-{
-  if (nr->bits_in_cache == 0) {
-    if (G_LIKELY ((nr->size - nr->byte) > 0))
-      nr->byte++;
-    else
-      return FALSE;
-  }
-
-  nr->bits_in_cache = 0;
-
-  return TRUE;
-}
-
-static inline guint
-nal_reader_get_pos (const NalReader * nr)
-{
-  return nr->byte * 8 - nr->bits_in_cache;
-}
-
-static inline guint
-nal_reader_get_remaining (const NalReader * nr)
-{
-  return (nr->size - nr->byte) * 8 + nr->bits_in_cache;
-}
-
-static inline guint
-nal_reader_get_epb_count (const NalReader * nr)
-{
-  return nr->n_epb;
-}
-
-#define GST_NAL_READER_READ_BITS(bits) \
-static gboolean \
-nal_reader_get_bits_uint##bits (NalReader *nr, guint##bits *val, guint nbits) \
-{ \
-  guint shift; \
-  \
-  if (!nal_reader_read (nr, nbits)) \
-    return FALSE; \
-  \
-  /* bring the required bits down and truncate */ \
-  shift = nr->bits_in_cache - nbits; \
-  *val = nr->first_byte >> shift; \
-  \
-  *val |= nr->cache << (8 - shift); \
-  /* mask out required bits */ \
-  if (nbits < bits) \
-    *val &= ((guint##bits)1 << nbits) - 1; \
-  \
-  nr->bits_in_cache = shift; \
-  \
-  return TRUE; \
-} \
-
-GST_NAL_READER_READ_BITS (8);
-GST_NAL_READER_READ_BITS (16);
-GST_NAL_READER_READ_BITS (32);
-
-#define GST_NAL_READER_PEAK_BITS(bits) \
-static gboolean \
-nal_reader_peek_bits_uint##bits (const NalReader *nr, guint##bits *val, guint nbits) \
-{ \
-  NalReader tmp; \
-  \
-  tmp = *nr; \
-  return nal_reader_get_bits_uint##bits (&tmp, val, nbits); \
-}
-
-GST_NAL_READER_PEAK_BITS (8);
-
-static gboolean
-nal_reader_get_ue (NalReader * nr, guint32 * val)
-{
-  guint i = 0;
-  guint8 bit;
-  guint32 value;
-
-  if (G_UNLIKELY (!nal_reader_get_bits_uint8 (nr, &bit, 1))) {
-
-    return FALSE;
-  }
-
-  while (bit == 0) {
-    i++;
-    if G_UNLIKELY
-      ((!nal_reader_get_bits_uint8 (nr, &bit, 1)))
-          return FALSE;
-  }
-
-  if (G_UNLIKELY (i > 32))
-    return FALSE;
-
-  if (G_UNLIKELY (!nal_reader_get_bits_uint32 (nr, &value, i)))
-    return FALSE;
-
-  *val = (1 << i) - 1 + value;
-
-  return TRUE;
-}
-
-static inline gboolean
-nal_reader_get_se (NalReader * nr, gint32 * val)
-{
-  guint32 value;
-
-  if (G_UNLIKELY (!nal_reader_get_ue (nr, &value)))
-    return FALSE;
-
-  if (value % 2)
-    *val = (value / 2) + 1;
-  else
-    *val = -(value / 2);
-
-  return TRUE;
-}
-
-#define CHECK_ALLOWED(val, min, max) { \
-  if (val < min || val > max) { \
-    GST_WARNING ("value not in allowed range. value: %d, range %d-%d", \
-                     val, min, max); \
-    goto error; \
-  } \
-}
-
-#define READ_UINT8(nr, val, nbits) { \
-  if (!nal_reader_get_bits_uint8 (nr, &val, nbits)) { \
-    GST_WARNING ("failed to read uint8, nbits: %d", nbits); \
-    goto error; \
-  } \
-}
-
-#define READ_UINT16(nr, val, nbits) { \
-  if (!nal_reader_get_bits_uint16 (nr, &val, nbits)) { \
-  GST_WARNING ("failed to read uint16, nbits: %d", nbits); \
-    goto error; \
-  } \
-}
-
-#define READ_UINT32(nr, val, nbits) { \
-  if (!nal_reader_get_bits_uint32 (nr, &val, nbits)) { \
-  GST_WARNING ("failed to read uint32, nbits: %d", nbits); \
-    goto error; \
-  } \
-}
-
-#define READ_UINT64(nr, val, nbits) { \
-  if (!nal_reader_get_bits_uint64 (nr, &val, nbits)) { \
-    GST_WARNING ("failed to read uint32, nbits: %d", nbits); \
-    goto error; \
-  } \
-}
-
-#define READ_UE(nr, val) { \
-  if (!nal_reader_get_ue (nr, &val)) { \
-    GST_WARNING ("failed to read UE"); \
-    goto error; \
-  } \
-}
-
-#define READ_UE_ALLOWED(nr, val, min, max) { \
-  guint32 tmp; \
-  READ_UE (nr, tmp); \
-  CHECK_ALLOWED (tmp, min, max); \
-  val = tmp; \
-}
-
-#define READ_SE(nr, val) { \
-  if (!nal_reader_get_se (nr, &val)) { \
-    GST_WARNING ("failed to read SE"); \
-    goto error; \
-  } \
-}
-
-#define READ_SE_ALLOWED(nr, val, min, max) { \
-  gint32 tmp; \
-  READ_SE (nr, tmp); \
-  CHECK_ALLOWED (tmp, min, max); \
-  val = tmp; \
-}
-
-/***********  end of nal parser ***************/
-
 /*****  Utils ****/
 #define EXTENDED_SAR 255
 
@@ -460,49 +179,6 @@ set_nalu_datas (GstH264NalUnit * nalu)
   GST_DEBUG ("Nal type %u, ref_idc %u", nalu->type, nalu->ref_idc);
 }
 
-static inline gint
-scan_for_start_codes (const guint8 * data, guint size)
-{
-  GstByteReader br;
-  gst_byte_reader_init (&br, data, size);
-
-  /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
-  return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
-      0, size);
-}
-
-static gboolean
-gst_h264_parser_more_data (NalReader * nr)
-{
-  guint remaining;
-
-  remaining = nal_reader_get_remaining (nr);
-  if (remaining == 0)
-    return FALSE;
-
-  if (remaining <= 8) {
-    guint8 rbsp_stop_one_bit;
-
-    if (!nal_reader_peek_bits_uint8 (nr, &rbsp_stop_one_bit, 1))
-      return FALSE;
-
-    if (rbsp_stop_one_bit == 1) {
-      guint8 zero_bits;
-
-      if (remaining == 1)
-        return FALSE;
-
-      if (!nal_reader_peek_bits_uint8 (nr, &zero_bits, remaining))
-        return FALSE;
-
-      if ((zero_bits - (1 << (remaining - 1))) == 0)
-        return FALSE;
-    }
-  }
-
-  return TRUE;
-}
-
 /****** Parsing functions *****/
 
 static gboolean
@@ -1188,7 +864,8 @@ gst_h264_parser_identify_nalu_unchecked (GstH264NalParser * nalparser,
     return GST_H264_PARSER_ERROR;
   }
 
-  off1 = scan_for_start_codes (data + offset, size - offset);
+  /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
+  off1 = gst_codec_parser_scan_start_code (data + offset, size - offset);
 
   if (off1 < 0) {
     GST_DEBUG ("No start code prefix in this buffer");
@@ -1251,7 +928,8 @@ gst_h264_parser_identify_nalu (GstH264NalParser * nalparser,
   if (res != GST_H264_PARSER_OK || nalu->size == 0)
     goto beach;
 
-  off2 = scan_for_start_codes (data + nalu->offset, size - nalu->offset);
+  off2 = gst_codec_parser_scan_start_code (data + nalu->offset,
+      size - nalu->offset);
   if (off2 < 0) {
     GST_DEBUG ("Nal start %d, No end found", nalu->offset);
 
@@ -1652,7 +1330,7 @@ gst_h264_parse_pps (GstH264NalParser * nalparser, GstH264NalUnit * nalu,
   READ_UINT8 (&nr, pps->constrained_intra_pred_flag, 1);
   READ_UINT8 (&nr, pps->redundant_pic_cnt_present_flag, 1);
 
-  if (!gst_h264_parser_more_data (&nr))
+  if (!nal_reader_has_more_data (&nr))
     goto done;
 
   READ_UINT8 (&nr, pps->transform_8x8_mode_flag, 1);
@@ -1958,3 +1636,398 @@ error:
   GST_WARNING ("error parsing \"Sei message\"");
   return GST_H264_PARSER_ERROR;
 }
+
+/******** Picture order count and DPB model *************/
+
+/* Table A-1, MaxDpbMbs per level_idc */
+static const struct
+{
+  guint8 level_idc;
+  guint32 max_dpb_mbs;
+} max_dpb_mbs_table[] = {
+  {9, 396}, {10, 396}, {11, 900}, {12, 2376}, {13, 2376}, {20, 2376},
+  {21, 4752}, {22, 8100}, {30, 8100}, {31, 18000}, {32, 20480},
+  {40, 32768}, {41, 32768}, {42, 34816}, {50, 110400}, {51, 184320},
+  {52, 184320}
+};
+
+static gboolean
+slice_has_mmco5 (GstH264NalUnit * nalu, GstH264SliceHdr * slice)
+{
+  GstH264DecRefPicMarking *marking = &slice->dec_ref_pic_marking;
+  guint i;
+
+  if (nalu->ref_idc == 0 || nalu->idr_pic_flag ||
+      !marking->adaptive_ref_pic_marking_mode_flag)
+    return FALSE;
+
+  for (i = 0; i < MIN (marking->n_ref_pic_marking, 10); i++) {
+    if (marking->ref_pic_marking[i].memory_management_control_operation == 5)
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Computes FrameNumOffset, see 8-6 and 8-11 */
+static gint32
+poc_state_get_frame_num_offset (GstH264POCState * state,
+    GstH264NalUnit * nalu, GstH264SliceHdr * slice, GstH264SPS * sps)
+{
+  gint32 prev_frame_num_offset;
+
+  if (nalu->idr_pic_flag)
+    return 0;
+
+  prev_frame_num_offset = state->prev_mmco5 ? 0 : state->prev_frame_num_offset;
+  if (state->prev_frame_num > slice->frame_num)
+    return prev_frame_num_offset + sps->max_frame_num;
+
+  return prev_frame_num_offset;
+}
+
+/**
+ * gst_h264_poc_state_init:
+ * @state: the #GstH264POCState to initialize
+ *
+ * Initializes @state, the first picture given to
+ * gst_h264_poc_state_compute() afterwards should be an IDR picture.
+ */
+void
+gst_h264_poc_state_init (GstH264POCState * state)
+{
+  memset (state, 0, sizeof (*state));
+}
+
+/**
+ * gst_h264_poc_state_compute:
+ * @state: a #GstH264POCState
+ * @nalu: The #GstH264NalUnit of the first slice of the picture
+ * @slice: The #GstH264SliceHdr of the first slice of the picture, parsed
+ *  with its dec_ref_pic_marking
+ * @poc: (out): the picture order count of the picture
+ *
+ * Computes the picture order count of a picture as described in 8.2.1,
+ * for the 3 picture order count types, and updates @state for the next
+ * picture. This has to be called for every picture, in decoding order.
+ *
+ * For a frame, @poc is the minimum of TopFieldOrderCnt and
+ * BottomFieldOrderCnt. When the picture has a
+ * memory_management_control_operation equal to 5, @poc is the value after
+ * the reset of the picture order counts, so that it compares with the
+ * ones of the following pictures.
+ *
+ * Returns: a #GstH264ParserResult
+ */
+GstH264ParserResult
+gst_h264_poc_state_compute (GstH264POCState * state, GstH264NalUnit * nalu,
+    GstH264SliceHdr * slice, gint32 * poc)
+{
+  GstH264SPS *sps;
+  gint32 top = 0, bottom = 0, frame_num_offset = 0;
+  gboolean bottom_field;
+
+  g_return_val_if_fail (state != NULL, GST_H264_PARSER_ERROR);
+  g_return_val_if_fail (slice != NULL, GST_H264_PARSER_ERROR);
+  g_return_val_if_fail (poc != NULL, GST_H264_PARSER_ERROR);
+
+  if (!slice->pps || !(sps = slice->pps->sequence)) {
+    GST_WARNING ("no sequence parameter set to compute the POC");
+    return GST_H264_PARSER_BROKEN_LINK;
+  }
+
+  bottom_field = slice->field_pic_flag && slice->bottom_field_flag;
+  state->mmco5 = slice_has_mmco5 (nalu, slice);
+
+  switch (sps->pic_order_cnt_type) {
+    case 0:
+    {
+      gint32 prev_msb, prev_lsb, msb, lsb, max_lsb;
+
+      if (nalu->idr_pic_flag) {
+        prev_msb = prev_lsb = 0;
+      } else {
+        prev_msb = state->prev_pic_order_cnt_msb;
+        prev_lsb = state->prev_pic_order_cnt_lsb;
+      }
+
+      /* 8-3 */
+      max_lsb = 1 << (sps->log2_max_pic_order_cnt_lsb_minus4 + 4);
+      lsb = slice->pic_order_cnt_lsb;
+      if (lsb < prev_lsb && prev_lsb - lsb >= max_lsb / 2)
+        msb = prev_msb + max_lsb;
+      else if (lsb > prev_lsb && lsb - prev_lsb > max_lsb / 2)
+        msb = prev_msb - max_lsb;
+      else
+        msb = prev_msb;
+
+      /* 8-4, 8-5 */
+      if (!slice->field_pic_flag) {
+        top = msb + lsb;
+        bottom = top + slice->delta_pic_order_cnt_bottom;
+      } else if (!bottom_field) {
+        top = msb + lsb;
+      } else {
+        bottom = msb + lsb;
+      }
+
+      /* only reference pictures are used as prediction */
+      if (nalu->ref_idc != 0) {
+        state->prev_pic_order_cnt_msb = msb;
+        state->prev_pic_order_cnt_lsb = lsb;
+      }
+      break;
+    }
+    case 1:
+    {
+      gint32 abs_frame_num = 0, expected_poc = 0;
+      gint n = sps->num_ref_frames_in_pic_order_cnt_cycle;
+
+      frame_num_offset =
+          poc_state_get_frame_num_offset (state, nalu, slice, sps);
+
+      /* 8-7 */
+      if (n != 0)
+        abs_frame_num = frame_num_offset + slice->frame_num;
+      if (nalu->ref_idc == 0 && abs_frame_num > 0)
+        abs_frame_num--;
+
+      /* 8-8, 8-9 */
+      if (abs_frame_num > 0) {
+        gint32 expected_delta_per_cycle = 0;
+        gint cycle_cnt, frame_num_in_cycle, i;
+
+        cycle_cnt = (abs_frame_num - 1) / n;
+        frame_num_in_cycle = (abs_frame_num - 1) % n;
+
+        for (i = 0; i < n; i++)
+          expected_delta_per_cycle += sps->offset_for_ref_frame[i];
+
+        expected_poc = cycle_cnt * expected_delta_per_cycle;
+        for (i = 0; i <= frame_num_in_cycle; i++)
+          expected_poc += sps->offset_for_ref_frame[i];
+      }
+      if (nalu->ref_idc == 0)
+        expected_poc += sps->offset_for_non_ref_pic;
+
+      /* 8-10 */
+      if (!slice->field_pic_flag) {
+        top = expected_poc + slice->delta_pic_order_cnt[0];
+        bottom = top + sps->offset_for_top_to_bottom_field +
+            slice->delta_pic_order_cnt[1];
+      } else if (!bottom_field) {
+        top = expected_poc + slice->delta_pic_order_cnt[0];
+      } else {
+        bottom = expected_poc + sps->offset_for_top_to_bottom_field +
+            slice->delta_pic_order_cnt[0];
+      }
+      break;
+    }
+    case 2:
+    {
+      gint32 temp_poc;
+
+      frame_num_offset =
+          poc_state_get_frame_num_offset (state, nalu, slice, sps);
+
+      /* 8-12 */
+      if (nalu->idr_pic_flag)
+        temp_poc = 0;
+      else if (nalu->ref_idc == 0)
+        temp_poc = 2 * (frame_num_offset + slice->frame_num) - 1;
+      else
+        temp_poc = 2 * (frame_num_offset + slice->frame_num);
+
+      /* 8-13 */
+      top = bottom = temp_poc;
+      break;
+    }
+    default:
+      GST_WARNING ("unsupported pic_order_cnt_type %u",
+          sps->pic_order_cnt_type);
+      return GST_H264_PARSER_ERROR;
+  }
+
+  /* 8-1 */
+  if (!slice->field_pic_flag)
+    *poc = MIN (top, bottom);
+  else if (!bottom_field)
+    *poc = top;
+  else
+    *poc = bottom;
+
+  if (state->mmco5) {
+    /* the picture order counts are reset relative to this picture, see
+     * 8.2.1: TopFieldOrderCnt is used as prevPicOrderCntLsb, after the
+     * reset */
+    state->prev_pic_order_cnt_msb = 0;
+    state->prev_pic_order_cnt_lsb = bottom_field ? 0 : top - *poc;
+    *poc = 0;
+  }
+
+  state->prev_frame_num_offset = frame_num_offset;
+  state->prev_frame_num = state->mmco5 ? 0 : slice->frame_num;
+  state->prev_mmco5 = state->mmco5;
+
+  GST_LOG ("picture order count %d", *poc);
+
+  return GST_H264_PARSER_OK;
+}
+
+/**
+ * gst_h264_dpb_model_init:
+ * @dpb: the #GstH264DpbModel to initialize
+ * @sps: the active #GstH264SPS
+ *
+ * Initializes an empty @dpb for the coded video sequences of @sps.
+ *
+ * The number of pictures held for reordering is max_num_reorder_frames
+ * when the VUI has bitstream restrictions. Otherwise it is inferred as in
+ * E.2.1: 0 for the intra profiles and the pic_order_cnt_type 2 streams,
+ * where the output order is the decoding order, or MaxDpbFrames.
+ */
+void
+gst_h264_dpb_model_init (GstH264DpbModel * dpb, GstH264SPS * sps)
+{
+  guint max_num_reorder_frames = GST_H264_MAX_DPB_FRAMES;
+
+  g_return_if_fail (dpb != NULL);
+
+  memset (dpb, 0, sizeof (*dpb));
+
+  if (sps->pic_order_cnt_type == 2) {
+    max_num_reorder_frames = 0;
+  } else if (sps->vui_parameters_present_flag &&
+      sps->vui_parameters.bitstream_restriction_flag) {
+    max_num_reorder_frames = MIN (sps->vui_parameters.num_reorder_frames,
+        GST_H264_MAX_DPB_FRAMES);
+  } else if (sps->profile_idc == 44 || (sps->constraint_set3_flag &&
+          (sps->profile_idc == 100 || sps->profile_idc == 110 ||
+              sps->profile_idc == 122 || sps->profile_idc == 244))) {
+    max_num_reorder_frames = 0;
+  } else {
+    guint frame_size_in_mbs, max_dpb_mbs = 0, i;
+
+    frame_size_in_mbs = (sps->pic_width_in_mbs_minus1 + 1) *
+        (sps->pic_height_in_map_units_minus1 + 1) *
+        (2 - sps->frame_mbs_only_flag);
+
+    /* level 1b of the baseline, main and extended profiles */
+    if (sps->level_idc == 11 && sps->constraint_set3_flag &&
+        (sps->profile_idc == 66 || sps->profile_idc == 77 ||
+            sps->profile_idc == 88)) {
+      max_dpb_mbs = 396;
+    } else {
+      for (i = 0; i < G_N_ELEMENTS (max_dpb_mbs_table); i++) {
+        if (max_dpb_mbs_table[i].level_idc == sps->level_idc) {
+          max_dpb_mbs = max_dpb_mbs_table[i].max_dpb_mbs;
+          break;
+        }
+      }
+    }
+
+    if (max_dpb_mbs && frame_size_in_mbs)
+      max_num_reorder_frames = MIN (max_dpb_mbs / frame_size_in_mbs,
+          GST_H264_MAX_DPB_FRAMES);
+  }
+
+  dpb->max_num_reorder_frames = max_num_reorder_frames;
+  GST_DEBUG ("max_num_reorder_frames %u", max_num_reorder_frames);
+}
+
+/**
+ * gst_h264_dpb_model_add:
+ * @dpb: a #GstH264DpbModel
+ * @poc: the picture order count of the picture
+ * @idr: %TRUE if the picture starts a new coded video sequence, i.e. it is
+ *  an IDR picture or has a memory_management_control_operation equal to 5
+ *
+ * Adds a picture to @dpb, in decoding order. When @idr is %TRUE, the
+ * pictures of the previous sequence are dropped, so they should have been
+ * output with gst_h264_dpb_model_bump() before.
+ *
+ * Returns: %FALSE if the picture comes too late: a picture following it in
+ * display order was already output. The number of pictures held for
+ * reordering is increased in that case.
+ */
+gboolean
+gst_h264_dpb_model_add (GstH264DpbModel * dpb, gint32 poc, gboolean idr)
+{
+  gboolean ret = TRUE;
+
+  g_return_val_if_fail (dpb != NULL, FALSE);
+
+  if (idr) {
+    dpb->n_pictures = 0;
+    dpb->have_output = FALSE;
+  } else if (dpb->have_output && poc < dpb->last_output_poc) {
+    GST_DEBUG ("picture %d is late, last output %d", poc,
+        dpb->last_output_poc);
+    if (dpb->max_num_reorder_frames < GST_H264_MAX_DPB_FRAMES)
+      dpb->max_num_reorder_frames++;
+    ret = FALSE;
+  }
+
+  /* the caller did not bump, drop the first picture in display order */
+  if (dpb->n_pictures == G_N_ELEMENTS (dpb->poc))
+    gst_h264_dpb_model_bump (dpb, TRUE, NULL);
+
+  dpb->poc[dpb->n_pictures++] = poc;
+
+  return ret;
+}
+
+/**
+ * gst_h264_dpb_model_bump:
+ * @dpb: a #GstH264DpbModel
+ * @drain: %TRUE to output a picture even if @dpb is not full, e.g. at the
+ *  end of a coded video sequence
+ * @poc: (out) (allow-none): the picture order count of the output picture
+ *
+ * Outputs the picture of @dpb with the smallest picture order count if it
+ * holds more pictures than max_num_reorder_frames, or if @drain is %TRUE.
+ * This should be called after each gst_h264_dpb_model_add() until it
+ * returns %FALSE.
+ *
+ * Returns: %TRUE if a picture was output
+ */
+gboolean
+gst_h264_dpb_model_bump (GstH264DpbModel * dpb, gboolean drain, gint32 * poc)
+{
+  guint i, min = 0;
+
+  g_return_val_if_fail (dpb != NULL, FALSE);
+
+  if (dpb->n_pictures == 0 ||
+      (!drain && dpb->n_pictures <= dpb->max_num_reorder_frames))
+    return FALSE;
+
+  for (i = 1; i < dpb->n_pictures; i++) {
+    if (dpb->poc[i] < dpb->poc[min])
+      min = i;
+  }
+
+  dpb->last_output_poc = dpb->poc[min];
+  dpb->have_output = TRUE;
+  dpb->poc[min] = dpb->poc[--dpb->n_pictures];
+
+  if (poc)
+    *poc = dpb->last_output_poc;
+
+  return TRUE;
+}
+
+/**
+ * gst_h264_dpb_model_get_max_num_reorder_frames:
+ * @dpb: a #GstH264DpbModel
+ *
+ * Returns: the number of pictures @dpb holds for reordering, the one of the
+ * SPS or a bigger one if the stream needed it.
+ */
+guint
+gst_h264_dpb_model_get_max_num_reorder_frames (GstH264DpbModel * dpb)
+{
+  g_return_val_if_fail (dpb != NULL, 0);
+
+  return dpb->max_num_reorder_frames;
+}
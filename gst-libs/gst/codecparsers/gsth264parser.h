@@ -41,6 +41,7 @@ G_BEGIN_DECLS
 
 #define GST_H264_MAX_SPS_COUNT   32
 #define GST_H264_MAX_PPS_COUNT   256
+#define GST_H264_MAX_DPB_FRAMES  16
 
 #define GST_H264_IS_P_SLICE(slice)  (((slice)->type % 5) == GST_H264_P_SLICE)
 #define GST_H264_IS_B_SLICE(slice)  (((slice)->type % 5) == GST_H264_B_SLICE)
@@ -188,6 +189,9 @@ typedef struct _GstH264PicTiming              GstH264PicTiming;
 typedef struct _GstH264BufferingPeriod        GstH264BufferingPeriod;
 typedef struct _GstH264SEIMessage             GstH264SEIMessage;
 
+typedef struct _GstH264POCState               GstH264POCState;
+typedef struct _GstH264DpbModel               GstH264DpbModel;
+
 /**
  * GstH264NalUnit:
  * @ref_idc: not equal to 0 specifies that the content of the NAL unit contains a sequence
@@ -663,6 +667,44 @@ struct _GstH264SEIMessage
   };
 };
 
+/**
+ * GstH264POCState:
+ * @mmco5: %TRUE if the last picture passed to gst_h264_poc_state_compute()
+ *  had a memory_management_control_operation equal to 5
+ *
+ * The state needed to compute the picture order count of the pictures of
+ * a coded video sequence, in decoding order.
+ */
+struct _GstH264POCState
+{
+  gboolean mmco5;
+
+  /*< private >*/
+  gint32 prev_pic_order_cnt_msb;
+  gint32 prev_pic_order_cnt_lsb;
+  gint32 prev_frame_num_offset;
+  guint16 prev_frame_num;
+  gboolean prev_mmco5;
+};
+
+/**
+ * GstH264DpbModel:
+ *
+ * A model of the output of the decoded picture buffer, following the
+ * bumping process of C.4.5.3 without decoding anything. Pictures are
+ * added in decoding order with their picture order count and are output
+ * in display order.
+ */
+struct _GstH264DpbModel
+{
+  /*< private >*/
+  guint max_num_reorder_frames;
+  guint n_pictures;
+  gint32 poc[GST_H264_MAX_DPB_FRAMES + 1];
+  gboolean have_output;
+  gint32 last_output_poc;
+};
+
 /**
  * GstH264NalParser:
  *
@@ -715,5 +757,20 @@ GstH264ParserResult gst_h264_parse_sps                (GstH264NalUnit *nalu,
 GstH264ParserResult gst_h264_parse_pps                (GstH264NalParser *nalparser,
                                                        GstH264NalUnit *nalu, GstH264PPS *pps);
 
+void gst_h264_poc_state_init                          (GstH264POCState *state);
+
+GstH264ParserResult gst_h264_poc_state_compute        (GstH264POCState *state, GstH264NalUnit *nalu,
+                                                       GstH264SliceHdr *slice, gint32 *poc);
+
+void gst_h264_dpb_model_init                          (GstH264DpbModel *dpb, GstH264SPS *sps);
+
+gboolean gst_h264_dpb_model_add                       (GstH264DpbModel *dpb, gint32 poc,
+                                                       gboolean idr);
+
+gboolean gst_h264_dpb_model_bump                      (GstH264DpbModel *dpb, gboolean drain,
+                                                       gint32 *poc);
+
+guint gst_h264_dpb_model_get_max_num_reorder_frames   (GstH264DpbModel *dpb);
+
 G_END_DECLS
 #endif
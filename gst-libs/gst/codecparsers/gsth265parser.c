@@ -0,0 +1,2149 @@
+/* Gstreamer
+ * Copyright (C) <2011> Intel Corporation
+ * Copyright (C) <2011> Collabora Ltd.
+ * Copyright (C) <2011> Thibault Saunier <thibault.saunier@collabora.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * SECTION:gsth265parser
+ * @short_description: Convenience library for h265 video
+ * bitstream parsing.
+ *
+ * It offers you bitstream parsing in HEVC mode or not. To identify Nals in a bitstream and
+ * parse its headers, you should call:
+ * <itemizedlist>
+ *   <listitem>
+ *      #gst_h265_parser_identify_nalu to identify the following nalu in not HEVC bitstreams
+ *   </listitem>
+ *   <listitem>
+ *      #gst_h265_parser_identify_nalu_hevc to identify the nalu in HEVC bitstreams
+ *   </listitem>
+ * </itemizedlist>
+ *
+ * Then, depending on the #GstH265NalUnitType of the newly parsed #GstH265NalUnit, you should
+ * call the differents functions to parse the structure:
+ * <itemizedlist>
+ *   <listitem>
+ *      From #GST_H265_NAL_SLICE_TRAIL_N to #GST_H265_NAL_SLICE_CRA_NUT: #gst_h265_parser_parse_slice_hdr
+ *   </listitem>
+ *   <listitem>
+ *      #GST_H265_NAL_PREFIX_SEI and #GST_H265_NAL_SUFFIX_SEI: #gst_h265_parser_parse_sei
+ *   </listitem>
+ *   <listitem>
+ *      #GST_H265_NAL_VPS: #gst_h265_parser_parse_vps
+ *   </listitem>
+ *   <listitem>
+ *      #GST_H265_NAL_SPS: #gst_h265_parser_parse_sps
+ *   </listitem>
+ *   <listitem>
+ *      #GST_H265_NAL_PPS: #gst_h265_parser_parse_pps
+ *   </listitem>
+ *   <listitem>
+ *      Any other: #gst_h265_parser_parse_nal
+ *   </listitem>
+ * </itemizedlist>
+ *
+ * Note: You should always call gst_h265_parser_parse_nal if you don't actually need
+ * #GstH265NalUnitType to be parsed for your personnal use, in order to guarantee that the
+ * #GstH265Parser is always up to date.
+ *
+ * The RBSP of the nal units is read with the same reader as the h264 parser
+ * uses, which skips the emulation prevention bytes without checking every
+ * byte.
+ *
+ * For more details about the structures, look at the ITU-T H.265 and ISO/IEC 23008-2
+ * specifications, you can download them from:
+ *
+ * <itemizedlist>
+ *   <listitem>
+ *     ITU-T H.265: http://www.itu.int/rec/T-REC-H.265
+ *   </listitem>
+ *   <listitem>
+ *     ISO/IEC 23008-2: http://www.iso.org/iso/home/store/catalogue_tc/catalogue_detail.htm?csnumber=35424
+ *   </listitem>
+ * </itemizedlist>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "gsth265parser.h"
+#include "gstcodecparserutils.h"
+#include "nalutils.h"
+
+#include <gst/base/gstbitreader.h>
+#include <string.h>
+
+GST_DEBUG_CATEGORY (h265_parser_debug);
+#define GST_CAT_DEFAULT h265_parser_debug
+
+/**** Default scaling_lists according to Table 7-5 and 7-6, in the
+ * up-right diagonal scan order they are coded in *****/
+static const guint8 default_scaling_list_intra[64] = {
+  16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 16, 17, 16, 17, 18, 17, 18, 18,
+  17, 18, 21, 19, 20, 21, 20, 19, 21, 24, 22, 22, 24, 24, 22, 22, 24, 25, 25,
+  27, 30, 27, 25, 25, 29, 31, 35, 35, 31, 29, 36, 41, 44, 41, 36, 47, 54, 54,
+  47, 65, 70, 65, 88, 88, 115
+};
+
+static const guint8 default_scaling_list_inter[64] = {
+  16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 17, 17, 17, 17, 18, 18, 18, 18,
+  18, 18, 20, 20, 20, 20, 20, 20, 20, 24, 24, 24, 24, 24, 24, 24, 24, 25, 25,
+  25, 25, 25, 25, 25, 28, 28, 28, 28, 28, 28, 33, 33, 33, 33, 33, 41, 41, 41,
+  41, 54, 54, 54, 71, 71, 91
+};
+
+/*****  Utils ****/
+#define EXTENDED_SAR 255
+
+static GstH265VPS *
+gst_h265_parser_get_vps (GstH265Parser * parser, guint8 vps_id)
+{
+  GstH265VPS *vps;
+
+  vps = &parser->vps[vps_id];
+
+  if (vps->valid)
+    return vps;
+
+  return NULL;
+}
+
+static GstH265SPS *
+gst_h265_parser_get_sps (GstH265Parser * parser, guint8 sps_id)
+{
+  GstH265SPS *sps;
+
+  sps = &parser->sps[sps_id];
+
+  if (sps->valid)
+    return sps;
+
+  return NULL;
+}
+
+static GstH265PPS *
+gst_h265_parser_get_pps (GstH265Parser * parser, guint8 pps_id)
+{
+  GstH265PPS *pps;
+
+  pps = &parser->pps[pps_id];
+
+  if (pps->valid)
+    return pps;
+
+  return NULL;
+}
+
+/* Parses the 2 bytes nal_unit_header(), returns %FALSE if the
+ * forbidden_zero_bit is set */
+static inline gboolean
+set_nalu_datas (GstH265NalUnit * nalu)
+{
+  guint8 *data = nalu->data + nalu->offset;
+
+  if (data[0] & 0x80)
+    return FALSE;
+
+  nalu->type = (data[0] & 0x7e) >> 1;
+  nalu->layer_id = ((data[0] & 0x01) << 5) | (data[1] >> 3);
+  nalu->temporal_id_plus1 = data[1] & 0x07;
+  nalu->header_bytes = 2;
+
+  GST_DEBUG ("Nal type %u, layer id %u, temporal id plus 1 %u", nalu->type,
+      nalu->layer_id, nalu->temporal_id_plus1);
+
+  return TRUE;
+}
+
+/****** Parsing functions *****/
+
+static gboolean
+gst_h265_parse_profile_tier_level (GstH265ProfileTierLevel * ptl,
+    NalReader * nr, guint8 max_sub_layers_minus1)
+{
+  guint i, j;
+
+  GST_DEBUG ("parsing \"ProfileTierLevel parameters\"");
+
+  memset (ptl, 0, sizeof (*ptl));
+
+  READ_UINT8 (nr, ptl->profile_space, 2);
+  READ_UINT8 (nr, ptl->tier_flag, 1);
+  READ_UINT8 (nr, ptl->profile_idc, 5);
+
+  for (j = 0; j < 32; j++)
+    READ_UINT8 (nr, ptl->profile_compatibility_flag[j], 1);
+
+  READ_UINT8 (nr, ptl->progressive_source_flag, 1);
+  READ_UINT8 (nr, ptl->interlaced_source_flag, 1);
+  READ_UINT8 (nr, ptl->non_packed_constraint_flag, 1);
+  READ_UINT8 (nr, ptl->frame_only_constraint_flag, 1);
+
+  /* skip general_reserved_zero_44bits */
+  if (!nal_reader_skip (nr, 32) || !nal_reader_skip (nr, 12))
+    goto error;
+
+  READ_UINT8 (nr, ptl->level_idc, 8);
+
+  for (i = 0; i < max_sub_layers_minus1; i++) {
+    READ_UINT8 (nr, ptl->sub_layer_profile_present_flag[i], 1);
+    READ_UINT8 (nr, ptl->sub_layer_level_present_flag[i], 1);
+  }
+
+  /* skip reserved_zero_2bits */
+  if (max_sub_layers_minus1 > 0) {
+    for (i = max_sub_layers_minus1; i < 8; i++)
+      if (!nal_reader_skip (nr, 2))
+        goto error;
+  }
+
+  for (i = 0; i < max_sub_layers_minus1; i++) {
+    if (ptl->sub_layer_profile_present_flag[i]) {
+      READ_UINT8 (nr, ptl->sub_layer_profile_space[i], 2);
+      READ_UINT8 (nr, ptl->sub_layer_tier_flag[i], 1);
+      READ_UINT8 (nr, ptl->sub_layer_profile_idc[i], 5);
+
+      /* skip the compatibility, source and constraint flags and the
+       * reserved bits */
+      if (!nal_reader_skip (nr, 32) || !nal_reader_skip (nr, 32) ||
+          !nal_reader_skip (nr, 16))
+        goto error;
+    }
+
+    if (ptl->sub_layer_level_present_flag[i])
+      READ_UINT8 (nr, ptl->sub_layer_level_idc[i], 8);
+  }
+
+  return TRUE;
+
+error:
+  GST_WARNING ("error parsing \"ProfileTierLevel Parameters\"");
+  return FALSE;
+}
+
+static gboolean
+gst_h265_parse_sub_layer_hrd_parameters (GstH265SubLayerHRDParams * sub_hrd,
+    NalReader * nr, guint8 cpb_cnt_minus1,
+    guint8 sub_pic_hrd_params_present_flag)
+{
+  guint i;
+
+  GST_DEBUG ("parsing \"SubLayer HRD Parameters\"");
+
+  for (i = 0; i <= cpb_cnt_minus1; i++) {
+    READ_UE_ALLOWED (nr, sub_hrd->bit_rate_value_minus1[i], 0, G_MAXUINT32 - 1);
+    READ_UE_ALLOWED (nr, sub_hrd->cpb_size_value_minus1[i], 0, G_MAXUINT32 - 1);
+
+    if (sub_pic_hrd_params_present_flag) {
+      READ_UE_ALLOWED (nr, sub_hrd->cpb_size_du_value_minus1[i], 0,
+          G_MAXUINT32 - 1);
+      READ_UE_ALLOWED (nr, sub_hrd->bit_rate_du_value_minus1[i], 0,
+          G_MAXUINT32 - 1);
+    }
+
+    READ_UINT8 (nr, sub_hrd->cbr_flag[i], 1);
+  }
+
+  return TRUE;
+
+error:
+  GST_WARNING ("error parsing \"SubLayer HRD Parameters \"");
+  return FALSE;
+}
+
+static gboolean
+gst_h265_parse_hrd_parameters (GstH265HRDParams * hrd, NalReader * nr,
+    guint8 common_inf_present_flag, guint8 max_sub_layers_minus1)
+{
+  guint i;
+
+  GST_DEBUG ("parsing \"HRD Parameters\"");
+
+  /* set default values for fields that might not be present in the bitstream
+     and have valid defaults */
+  if (common_inf_present_flag) {
+    hrd->nal_hrd_parameters_present_flag = 0;
+    hrd->vcl_hrd_parameters_present_flag = 0;
+    hrd->sub_pic_hrd_params_present_flag = 0;
+    hrd->initial_cpb_removal_delay_length_minus1 = 23;
+    hrd->au_cpb_removal_delay_length_minus1 = 23;
+    hrd->dpb_output_delay_length_minus1 = 23;
+
+    READ_UINT8 (nr, hrd->nal_hrd_parameters_present_flag, 1);
+    READ_UINT8 (nr, hrd->vcl_hrd_parameters_present_flag, 1);
+
+    if (hrd->nal_hrd_parameters_present_flag
+        || hrd->vcl_hrd_parameters_present_flag) {
+
+      READ_UINT8 (nr, hrd->sub_pic_hrd_params_present_flag, 1);
+
+      if (hrd->sub_pic_hrd_params_present_flag) {
+        READ_UINT8 (nr, hrd->tick_divisor_minus2, 8);
+        READ_UINT8 (nr, hrd->du_cpb_removal_delay_increment_length_minus1, 5);
+        READ_UINT8 (nr, hrd->sub_pic_cpb_params_in_pic_timing_sei_flag, 1);
+        READ_UINT8 (nr, hrd->dpb_output_delay_du_length_minus1, 5);
+      }
+
+      READ_UINT8 (nr, hrd->bit_rate_scale, 4);
+      READ_UINT8 (nr, hrd->cpb_size_scale, 4);
+
+      if (hrd->sub_pic_hrd_params_present_flag)
+        READ_UINT8 (nr, hrd->cpb_size_du_scale, 4);
+
+      READ_UINT8 (nr, hrd->initial_cpb_removal_delay_length_minus1, 5);
+      READ_UINT8 (nr, hrd->au_cpb_removal_delay_length_minus1, 5);
+      READ_UINT8 (nr, hrd->dpb_output_delay_length_minus1, 5);
+    }
+  }
+
+  for (i = 0; i <= max_sub_layers_minus1; i++) {
+    READ_UINT8 (nr, hrd->fixed_pic_rate_general_flag[i], 1);
+
+    hrd->fixed_pic_rate_within_cvs_flag[i] = 1;
+    if (!hrd->fixed_pic_rate_general_flag[i])
+      READ_UINT8 (nr, hrd->fixed_pic_rate_within_cvs_flag[i], 1);
+
+    hrd->low_delay_hrd_flag[i] = 0;
+    if (hrd->fixed_pic_rate_within_cvs_flag[i]) {
+      READ_UE_ALLOWED (nr, hrd->elemental_duration_in_tc_minus1[i], 0, 2047);
+    } else {
+      READ_UINT8 (nr, hrd->low_delay_hrd_flag[i], 1);
+    }
+
+    hrd->cpb_cnt_minus1[i] = 0;
+    if (!hrd->low_delay_hrd_flag[i])
+      READ_UE_ALLOWED (nr, hrd->cpb_cnt_minus1[i], 0, 31);
+
+    if (hrd->nal_hrd_parameters_present_flag)
+      if (!gst_h265_parse_sub_layer_hrd_parameters (&hrd->sublayer_hrd_params
+              [i], nr, hrd->cpb_cnt_minus1[i],
+              hrd->sub_pic_hrd_params_present_flag))
+        goto error;
+
+    if (hrd->vcl_hrd_parameters_present_flag) {
+      GstH265SubLayerHRDParams vcl_params, *sub_hrd;
+
+      /* the vcl parameters are only kept when there are no nal ones */
+      sub_hrd = hrd->nal_hrd_parameters_present_flag ? &vcl_params :
+          &hrd->sublayer_hrd_params[i];
+      if (!gst_h265_parse_sub_layer_hrd_parameters (sub_hrd, nr,
+              hrd->cpb_cnt_minus1[i], hrd->sub_pic_hrd_params_present_flag))
+        goto error;
+    }
+  }
+
+  return TRUE;
+
+error:
+  GST_WARNING ("error parsing \"HRD Parameters\"");
+  return FALSE;
+}
+
+static gboolean
+gst_h265_parse_vui_parameters (GstH265SPS * sps, NalReader * nr)
+{
+  GstH265VUIParams *vui = &sps->vui_params;
+
+  GST_DEBUG ("parsing \"VUI Parameters\"");
+
+  /* set default values for fields that might not be present in the bitstream
+     and have valid defaults */
+  vui->aspect_ratio_idc = 0;
+  vui->video_format = 5;
+  vui->video_full_range_flag = 0;
+  vui->colour_primaries = 2;
+  vui->transfer_characteristics = 2;
+  vui->matrix_coefficients = 2;
+  vui->chroma_sample_loc_type_top_field = 0;
+  vui->chroma_sample_loc_type_bottom_field = 0;
+  vui->motion_vectors_over_pic_boundaries_flag = 1;
+  vui->max_bytes_per_pic_denom = 2;
+  vui->max_bits_per_min_cu_denom = 1;
+  vui->log2_max_mv_length_horizontal = 15;
+  vui->log2_max_mv_length_vertical = 15;
+
+  READ_UINT8 (nr, vui->aspect_ratio_info_present_flag, 1);
+  if (vui->aspect_ratio_info_present_flag) {
+    READ_UINT8 (nr, vui->aspect_ratio_idc, 8);
+    if (vui->aspect_ratio_idc == EXTENDED_SAR) {
+      READ_UINT16 (nr, vui->sar_width, 16);
+      READ_UINT16 (nr, vui->sar_height, 16);
+    }
+  }
+
+  READ_UINT8 (nr, vui->overscan_info_present_flag, 1);
+  if (vui->overscan_info_present_flag)
+    READ_UINT8 (nr, vui->overscan_appropriate_flag, 1);
+
+  READ_UINT8 (nr, vui->video_signal_type_present_flag, 1);
+  if (vui->video_signal_type_present_flag) {
+    READ_UINT8 (nr, vui->video_format, 3);
+    READ_UINT8 (nr, vui->video_full_range_flag, 1);
+    READ_UINT8 (nr, vui->colour_description_present_flag, 1);
+    if (vui->colour_description_present_flag) {
+      READ_UINT8 (nr, vui->colour_primaries, 8);
+      READ_UINT8 (nr, vui->transfer_characteristics, 8);
+      READ_UINT8 (nr, vui->matrix_coefficients, 8);
+    }
+  }
+
+  READ_UINT8 (nr, vui->chroma_loc_info_present_flag, 1);
+  if (vui->chroma_loc_info_present_flag) {
+    READ_UE_ALLOWED (nr, vui->chroma_sample_loc_type_top_field, 0, 5);
+    READ_UE_ALLOWED (nr, vui->chroma_sample_loc_type_bottom_field, 0, 5);
+  }
+
+  READ_UINT8 (nr, vui->neutral_chroma_indication_flag, 1);
+  READ_UINT8 (nr, vui->field_seq_flag, 1);
+  READ_UINT8 (nr, vui->frame_field_info_present_flag, 1);
+
+  READ_UINT8 (nr, vui->default_display_window_flag, 1);
+  if (vui->default_display_window_flag) {
+    READ_UE (nr, vui->def_disp_win_left_offset);
+    READ_UE (nr, vui->def_disp_win_right_offset);
+    READ_UE (nr, vui->def_disp_win_top_offset);
+    READ_UE (nr, vui->def_disp_win_bottom_offset);
+  }
+
+  READ_UINT8 (nr, vui->timing_info_present_flag, 1);
+  if (vui->timing_info_present_flag) {
+    READ_UINT32 (nr, vui->num_units_in_tick, 32);
+    if (vui->num_units_in_tick == 0)
+      GST_WARNING ("num_units_in_tick = 0 detected in stream "
+          "(incompliant to H.265 E.3.1).");
+
+    READ_UINT32 (nr, vui->time_scale, 32);
+    if (vui->time_scale == 0)
+      GST_WARNING ("time_scale = 0 detected in stream "
+          "(incompliant to H.265 E.3.1).");
+
+    READ_UINT8 (nr, vui->poc_proportional_to_timing_flag, 1);
+    if (vui->poc_proportional_to_timing_flag)
+      READ_UE_ALLOWED (nr, vui->num_ticks_poc_diff_one_minus1, 0,
+          G_MAXUINT32 - 1);
+
+    READ_UINT8 (nr, vui->hrd_parameters_present_flag, 1);
+    if (vui->hrd_parameters_present_flag)
+      if (!gst_h265_parse_hrd_parameters (&vui->hrd_params, nr, 1,
+              sps->max_sub_layers_minus1))
+        goto error;
+  }
+
+  READ_UINT8 (nr, vui->bitstream_restriction_flag, 1);
+  if (vui->bitstream_restriction_flag) {
+    READ_UINT8 (nr, vui->tiles_fixed_structure_flag, 1);
+    READ_UINT8 (nr, vui->motion_vectors_over_pic_boundaries_flag, 1);
+    READ_UINT8 (nr, vui->restricted_ref_pic_lists_flag, 1);
+    READ_UE_ALLOWED (nr, vui->min_spatial_segmentation_idc, 0, 4096);
+    READ_UE_ALLOWED (nr, vui->max_bytes_per_pic_denom, 0, 16);
+    READ_UE_ALLOWED (nr, vui->max_bits_per_min_cu_denom, 0, 16);
+    READ_UE_ALLOWED (nr, vui->log2_max_mv_length_horizontal, 0, 16);
+    READ_UE_ALLOWED (nr, vui->log2_max_mv_length_vertical, 0, 15);
+  }
+
+  return TRUE;
+
+error:
+  GST_WARNING ("error parsing \"VUI Parameters\"");
+  return FALSE;
+}
+
+/* Gives the list of the scaling_list() at @size_id, @matrix_id. The 32x32
+ * lists only exist for the matrix ids 0 and 3, which are stored at the
+ * indices 0 and 1 */
+static guint8 *
+get_scaling_list (GstH265ScalingList * sl, guint8 size_id, guint8 matrix_id,
+    gint16 ** dc_coef_minus8)
+{
+  *dc_coef_minus8 = NULL;
+
+  switch (size_id) {
+    case 0:
+      return sl->scaling_lists_4x4[matrix_id];
+    case 1:
+      return sl->scaling_lists_8x8[matrix_id];
+    case 2:
+      *dc_coef_minus8 = &sl->scaling_list_dc_coef_minus8_16x16[matrix_id];
+      return sl->scaling_lists_16x16[matrix_id];
+    default:
+      *dc_coef_minus8 = &sl->scaling_list_dc_coef_minus8_32x32[matrix_id];
+      return sl->scaling_lists_32x32[matrix_id];
+  }
+}
+
+static void
+set_flat_scaling_lists (GstH265ScalingList * sl)
+{
+  guint i;
+
+  memset (sl->scaling_lists_4x4, 16, sizeof (sl->scaling_lists_4x4));
+  memset (sl->scaling_lists_8x8, 16, sizeof (sl->scaling_lists_8x8));
+  memset (sl->scaling_lists_16x16, 16, sizeof (sl->scaling_lists_16x16));
+  memset (sl->scaling_lists_32x32, 16, sizeof (sl->scaling_lists_32x32));
+
+  for (i = 0; i < 6; i++)
+    sl->scaling_list_dc_coef_minus8_16x16[i] = 8;
+  for (i = 0; i < 2; i++)
+    sl->scaling_list_dc_coef_minus8_32x32[i] = 8;
+}
+
+/* Sets the list at @size_id, @matrix_id to the default of Table 7-6 */
+static void
+set_default_scaling_list (GstH265ScalingList * sl, guint8 size_id,
+    guint8 matrix_id)
+{
+  gint16 *dc_coef_minus8;
+  guint8 *list;
+  gboolean intra;
+
+  list = get_scaling_list (sl, size_id, matrix_id, &dc_coef_minus8);
+  if (size_id == 0) {
+    memset (list, 16, 16);
+    return;
+  }
+
+  intra = (size_id == 3) ? matrix_id == 0 : matrix_id < 3;
+  memcpy (list, intra ? default_scaling_list_intra :
+      default_scaling_list_inter, 64);
+  if (dc_coef_minus8)
+    *dc_coef_minus8 = 8;
+}
+
+static void
+set_default_scaling_lists (GstH265ScalingList * sl)
+{
+  guint8 size_id, matrix_id;
+
+  for (size_id = 0; size_id < 4; size_id++)
+    for (matrix_id = 0; matrix_id < (size_id == 3 ? 2 : 6); matrix_id++)
+      set_default_scaling_list (sl, size_id, matrix_id);
+}
+
+static gboolean
+gst_h265_parser_parse_scaling_lists (NalReader * nr, GstH265ScalingList * sl)
+{
+  guint8 size_id, matrix_id;
+
+  GST_DEBUG ("parsing scaling lists");
+
+  for (size_id = 0; size_id < 4; size_id++) {
+    for (matrix_id = 0; matrix_id < (size_id == 3 ? 2 : 6); matrix_id++) {
+      guint8 scaling_list_pred_mode_flag;
+      gint16 *dc_coef_minus8;
+      guint8 *list;
+
+      list = get_scaling_list (sl, size_id, matrix_id, &dc_coef_minus8);
+
+      READ_UINT8 (nr, scaling_list_pred_mode_flag, 1);
+      if (!scaling_list_pred_mode_flag) {
+        guint8 scaling_list_pred_matrix_id_delta;
+
+        READ_UE_ALLOWED (nr, scaling_list_pred_matrix_id_delta, 0, matrix_id);
+
+        if (scaling_list_pred_matrix_id_delta == 0) {
+          set_default_scaling_list (sl, size_id, matrix_id);
+        } else {
+          gint16 *ref_dc_coef_minus8;
+          guint8 *ref_list;
+
+          ref_list = get_scaling_list (sl, size_id,
+              matrix_id - scaling_list_pred_matrix_id_delta,
+              &ref_dc_coef_minus8);
+          memcpy (list, ref_list, size_id == 0 ? 16 : 64);
+          if (dc_coef_minus8)
+            *dc_coef_minus8 = *ref_dc_coef_minus8;
+        }
+      } else {
+        guint8 next_coef = 8;
+        guint i, coef_num;
+
+        coef_num = MIN (64, 1 << (4 + (size_id << 1)));
+
+        if (dc_coef_minus8) {
+          READ_SE_ALLOWED (nr, *dc_coef_minus8, -7, 247);
+          next_coef = *dc_coef_minus8 + 8;
+        }
+
+        for (i = 0; i < coef_num; i++) {
+          gint8 scaling_list_delta_coef;
+
+          READ_SE_ALLOWED (nr, scaling_list_delta_coef, -128, 127);
+          /* (next_coef + delta + 256) % 256 */
+          next_coef += scaling_list_delta_coef;
+          list[i] = next_coef;
+        }
+      }
+    }
+  }
+
+  return TRUE;
+
+error:
+  GST_WARNING ("error parsing scaling lists");
+  return FALSE;
+}
+
+static gboolean
+gst_h265_parser_parse_short_term_ref_pic_set (GstH265ShortTermRefPicSet *
+    rps, NalReader * nr, guint8 idx, GstH265SPS * sps)
+{
+  gint i, j;
+
+  GST_DEBUG ("parsing \"ShortTermRefPicSetParameter\"");
+
+  /* set default values for fields that might not be present in the bitstream
+     and have valid defaults */
+  rps->inter_ref_pic_set_prediction_flag = 0;
+  rps->delta_idx_minus1 = 0;
+  rps->delta_rps_sign = 0;
+  rps->abs_delta_rps_minus1 = 0;
+
+  if (idx != 0)
+    READ_UINT8 (nr, rps->inter_ref_pic_set_prediction_flag, 1);
+
+  if (rps->inter_ref_pic_set_prediction_flag) {
+    GstH265ShortTermRefPicSet *ref;
+    guint8 used_by_curr_pic_flag[17];
+    guint8 use_delta_flag[17];
+    gint32 delta_rps, dpoc;
+
+    /* delta_idx_minus1 is only coded in slice headers */
+    if (idx == sps->num_short_term_ref_pic_sets)
+      READ_UE_ALLOWED (nr, rps->delta_idx_minus1, 0, idx - 1);
+
+    ref = &sps->short_term_ref_pic_set[idx - (rps->delta_idx_minus1 + 1)];
+
+    READ_UINT8 (nr, rps->delta_rps_sign, 1);
+    READ_UE_ALLOWED (nr, rps->abs_delta_rps_minus1, 0, 32767);
+
+    delta_rps = (1 - 2 * rps->delta_rps_sign) * (rps->abs_delta_rps_minus1 + 1);
+
+    for (j = 0; j <= ref->NumDeltaPocs; j++) {
+      READ_UINT8 (nr, used_by_curr_pic_flag[j], 1);
+      use_delta_flag[j] = 1;
+      if (!used_by_curr_pic_flag[j])
+        READ_UINT8 (nr, use_delta_flag[j], 1);
+    }
+
+    /* 7-61: the negative pictures */
+    i = 0;
+    for (j = ref->NumPositivePics - 1; j >= 0; j--) {
+      dpoc = ref->DeltaPocS1[j] + delta_rps;
+      if (dpoc < 0 && use_delta_flag[ref->NumNegativePics + j]) {
+        if (i >= 16)
+          goto error;
+        rps->DeltaPocS0[i] = dpoc;
+        rps->UsedByCurrPicS0[i++] =
+            used_by_curr_pic_flag[ref->NumNegativePics + j];
+      }
+    }
+    if (delta_rps < 0 && use_delta_flag[ref->NumDeltaPocs]) {
+      if (i >= 16)
+        goto error;
+      rps->DeltaPocS0[i] = delta_rps;
+      rps->UsedByCurrPicS0[i++] = used_by_curr_pic_flag[ref->NumDeltaPocs];
+    }
+    for (j = 0; j < ref->NumNegativePics; j++) {
+      dpoc = ref->DeltaPocS0[j] + delta_rps;
+      if (dpoc < 0 && use_delta_flag[j]) {
+        if (i >= 16)
+          goto error;
+        rps->DeltaPocS0[i] = dpoc;
+        rps->UsedByCurrPicS0[i++] = used_by_curr_pic_flag[j];
+      }
+    }
+    rps->NumNegativePics = i;
+
+    /* 7-62: the positive pictures */
+    i = 0;
+    for (j = ref->NumNegativePics - 1; j >= 0; j--) {
+      dpoc = ref->DeltaPocS0[j] + delta_rps;
+      if (dpoc > 0 && use_delta_flag[j]) {
+        if (i >= 16)
+          goto error;
+        rps->DeltaPocS1[i] = dpoc;
+        rps->UsedByCurrPicS1[i++] = used_by_curr_pic_flag[j];
+      }
+    }
+    if (delta_rps > 0 && use_delta_flag[ref->NumDeltaPocs]) {
+      if (i >= 16)
+        goto error;
+      rps->DeltaPocS1[i] = delta_rps;
+      rps->UsedByCurrPicS1[i++] = used_by_curr_pic_flag[ref->NumDeltaPocs];
+    }
+    for (j = 0; j < ref->NumPositivePics; j++) {
+      dpoc = ref->DeltaPocS1[j] + delta_rps;
+      if (dpoc > 0 && use_delta_flag[ref->NumNegativePics + j]) {
+        if (i >= 16)
+          goto error;
+        rps->DeltaPocS1[i] = dpoc;
+        rps->UsedByCurrPicS1[i++] =
+            used_by_curr_pic_flag[ref->NumNegativePics + j];
+      }
+    }
+    rps->NumPositivePics = i;
+  } else {
+    guint32 delta_poc_minus1;
+
+    READ_UE_ALLOWED (nr, rps->NumNegativePics, 0, 16);
+    READ_UE_ALLOWED (nr, rps->NumPositivePics, 0, 16 - rps->NumNegativePics);
+
+    for (i = 0; i < rps->NumNegativePics; i++) {
+      READ_UE_ALLOWED (nr, delta_poc_minus1, 0, 32767);
+      rps->DeltaPocS0[i] = (i == 0 ? 0 : rps->DeltaPocS0[i - 1]) -
+          (gint32) (delta_poc_minus1 + 1);
+      READ_UINT8 (nr, rps->UsedByCurrPicS0[i], 1);
+    }
+
+    for (i = 0; i < rps->NumPositivePics; i++) {
+      READ_UE_ALLOWED (nr, delta_poc_minus1, 0, 32767);
+      rps->DeltaPocS1[i] = (i == 0 ? 0 : rps->DeltaPocS1[i - 1]) +
+          (gint32) (delta_poc_minus1 + 1);
+      READ_UINT8 (nr, rps->UsedByCurrPicS1[i], 1);
+    }
+  }
+
+  if (rps->NumNegativePics + rps->NumPositivePics > 16)
+    goto error;
+  rps->NumDeltaPocs = rps->NumNegativePics + rps->NumPositivePics;
+
+  return TRUE;
+
+error:
+  GST_WARNING ("error parsing \"ShortTermRefPicSet Parameters\"");
+  return FALSE;
+}
+
+static gboolean
+gst_h265_slice_parse_pred_weight_table (GstH265SliceHdr * slice,
+    NalReader * nr)
+{
+  GstH265PredWeightTable *p = &slice->pred_weight_table;
+  const GstH265SPS *sps = slice->pps->sps;
+  gint i, j;
+
+  GST_DEBUG ("parsing \"Prediction weight table\"");
+
+  memset (p, 0, sizeof (*p));
+
+  READ_UE_ALLOWED (nr, p->luma_log2_weight_denom, 0, 7);
+  if (sps->chroma_array_type != 0)
+    READ_SE_ALLOWED (nr, p->delta_chroma_log2_weight_denom,
+        -p->luma_log2_weight_denom, 7 - p->luma_log2_weight_denom);
+
+  for (i = 0; i <= slice->num_ref_idx_l0_active_minus1; i++)
+    READ_UINT8 (nr, p->luma_weight_l0_flag[i], 1);
+  if (sps->chroma_array_type != 0)
+    for (i = 0; i <= slice->num_ref_idx_l0_active_minus1; i++)
+      READ_UINT8 (nr, p->chroma_weight_l0_flag[i], 1);
+
+  for (i = 0; i <= slice->num_ref_idx_l0_active_minus1; i++) {
+    if (p->luma_weight_l0_flag[i]) {
+      READ_SE_ALLOWED (nr, p->delta_luma_weight_l0[i], -128, 127);
+      READ_SE_ALLOWED (nr, p->luma_offset_l0[i], -128, 127);
+    }
+    if (p->chroma_weight_l0_flag[i]) {
+      for (j = 0; j < 2; j++) {
+        READ_SE_ALLOWED (nr, p->delta_chroma_weight_l0[i][j], -128, 127);
+        READ_SE_ALLOWED (nr, p->delta_chroma_offset_l0[i][j], -512, 511);
+      }
+    }
+  }
+
+  if (GST_H265_IS_B_SLICE (slice)) {
+    for (i = 0; i <= slice->num_ref_idx_l1_active_minus1; i++)
+      READ_UINT8 (nr, p->luma_weight_l1_flag[i], 1);
+    if (sps->chroma_array_type != 0)
+      for (i = 0; i <= slice->num_ref_idx_l1_active_minus1; i++)
+        READ_UINT8 (nr, p->chroma_weight_l1_flag[i], 1);
+
+    for (i = 0; i <= slice->num_ref_idx_l1_active_minus1; i++) {
+      if (p->luma_weight_l1_flag[i]) {
+        READ_SE_ALLOWED (nr, p->delta_luma_weight_l1[i], -128, 127);
+        READ_SE_ALLOWED (nr, p->luma_offset_l1[i], -128, 127);
+      }
+      if (p->chroma_weight_l1_flag[i]) {
+        for (j = 0; j < 2; j++) {
+          READ_SE_ALLOWED (nr, p->delta_chroma_weight_l1[i][j], -128, 127);
+          READ_SE_ALLOWED (nr, p->delta_chroma_offset_l1[i][j], -512, 511);
+        }
+      }
+    }
+  }
+
+  return TRUE;
+
+error:
+  GST_WARNING ("error parsing \"Prediction weight table\"");
+  return FALSE;
+}
+
+static GstH265ParserResult
+gst_h265_parser_parse_buffering_period (GstH265Parser * parser,
+    GstH265BufferingPeriod * per, NalReader * nr)
+{
+  GstH265SPS *sps;
+  guint8 sps_id;
+  guint i, n;
+
+  GST_DEBUG ("parsing \"Buffering period\"");
+
+  READ_UE_ALLOWED (nr, sps_id, 0, GST_H265_MAX_SPS_COUNT - 1);
+  sps = gst_h265_parser_get_sps (parser, sps_id);
+  if (!sps) {
+    GST_WARNING ("couldn't find associated sequence parameter set with id: %d",
+        sps_id);
+    return GST_H265_PARSER_BROKEN_LINK;
+  }
+  per->sps = sps;
+
+  if (sps->vui_parameters_present_flag &&
+      sps->vui_params.hrd_parameters_present_flag) {
+    GstH265HRDParams *hrd = &sps->vui_params.hrd_params;
+
+    per->irap_cpb_params_present_flag = 0;
+    if (!hrd->sub_pic_hrd_params_present_flag)
+      READ_UINT8 (nr, per->irap_cpb_params_present_flag, 1);
+
+    if (per->irap_cpb_params_present_flag) {
+      READ_UINT32 (nr, per->cpb_delay_offset,
+          hrd->au_cpb_removal_delay_length_minus1 + 1);
+      READ_UINT32 (nr, per->dpb_delay_offset,
+          hrd->dpb_output_delay_length_minus1 + 1);
+    }
+
+    READ_UINT8 (nr, per->concatenation_flag, 1);
+    READ_UINT32 (nr, per->au_cpb_removal_delay_delta_minus1,
+        hrd->au_cpb_removal_delay_length_minus1 + 1);
+
+    n = hrd->initial_cpb_removal_delay_length_minus1 + 1;
+
+    if (hrd->nal_hrd_parameters_present_flag) {
+      for (i = 0; i <= hrd->cpb_cnt_minus1[0]; i++) {
+        READ_UINT32 (nr, per->nal_initial_cpb_removal_delay[i], n);
+        READ_UINT32 (nr, per->nal_initial_cpb_removal_offset[i], n);
+        if (hrd->sub_pic_hrd_params_present_flag
+            || per->irap_cpb_params_present_flag) {
+          READ_UINT32 (nr, per->nal_initial_alt_cpb_removal_delay[i], n);
+          READ_UINT32 (nr, per->nal_initial_alt_cpb_removal_offset[i], n);
+        }
+      }
+    }
+
+    if (hrd->vcl_hrd_parameters_present_flag) {
+      for (i = 0; i <= hrd->cpb_cnt_minus1[0]; i++) {
+        READ_UINT32 (nr, per->vcl_initial_cpb_removal_delay[i], n);
+        READ_UINT32 (nr, per->vcl_initial_cpb_removal_offset[i], n);
+        if (hrd->sub_pic_hrd_params_present_flag
+            || per->irap_cpb_params_present_flag) {
+          READ_UINT32 (nr, per->vcl_initial_alt_cpb_removal_delay[i], n);
+          READ_UINT32 (nr, per->vcl_initial_alt_cpb_removal_offset[i], n);
+        }
+      }
+    }
+  }
+
+  return GST_H265_PARSER_OK;
+
+error:
+  GST_WARNING ("error parsing \"Buffering period\"");
+  return GST_H265_PARSER_ERROR;
+}
+
+static GstH265ParserResult
+gst_h265_parser_parse_pic_timing (GstH265Parser * parser,
+    GstH265PicTiming * tim, NalReader * nr)
+{
+  GstH265VUIParams *vui;
+
+  GST_DEBUG ("parsing \"Picture timing\"");
+  if (!parser->last_sps || !parser->last_sps->valid) {
+    GST_WARNING ("didn't get the associated sequence paramater set for the "
+        "current access unit");
+    goto error;
+  }
+
+  if (!parser->last_sps->vui_parameters_present_flag)
+    return GST_H265_PARSER_OK;
+
+  vui = &parser->last_sps->vui_params;
+
+  if (vui->frame_field_info_present_flag) {
+    READ_UINT8 (nr, tim->pic_struct, 4);
+    CHECK_ALLOWED ((gint8) tim->pic_struct, 0, 12);
+    READ_UINT8 (nr, tim->source_scan_type, 2);
+    READ_UINT8 (nr, tim->duplicate_flag, 1);
+  }
+
+  if (vui->hrd_parameters_present_flag &&
+      (vui->hrd_params.nal_hrd_parameters_present_flag ||
+          vui->hrd_params.vcl_hrd_parameters_present_flag)) {
+    GstH265HRDParams *hrd = &vui->hrd_params;
+
+    READ_UINT32 (nr, tim->au_cpb_removal_delay_minus1,
+        hrd->au_cpb_removal_delay_length_minus1 + 1);
+    READ_UINT32 (nr, tim->pic_dpb_output_delay,
+        hrd->dpb_output_delay_length_minus1 + 1);
+
+    if (hrd->sub_pic_hrd_params_present_flag)
+      READ_UINT32 (nr, tim->pic_dpb_output_du_delay,
+          hrd->dpb_output_delay_du_length_minus1 + 1);
+
+    /* FIXME: the decoding units information is not parsed */
+  }
+
+  return GST_H265_PARSER_OK;
+
+error:
+  GST_WARNING ("error parsing \"Picture timing\"");
+  return GST_H265_PARSER_ERROR;
+}
+
+static GstH265ParserResult
+gst_h265_parser_parse_recovery_point (GstH265Parser * parser,
+    GstH265RecoveryPoint * rp, NalReader * nr)
+{
+  GST_DEBUG ("parsing \"Recovery point\"");
+
+  READ_SE (nr, rp->recovery_poc_cnt);
+  READ_UINT8 (nr, rp->exact_match_flag, 1);
+  READ_UINT8 (nr, rp->broken_link_flag, 1);
+
+  return GST_H265_PARSER_OK;
+
+error:
+  GST_WARNING ("error parsing \"Recovery point\"");
+  return GST_H265_PARSER_ERROR;
+}
+
+/******** API *************/
+
+/**
+ * gst_h265_parser_new:
+ *
+ * Creates a new #GstH265Parser. It should be freed with
+ * gst_h265_parser_free after use.
+ *
+ * Returns: a new #GstH265Parser
+ */
+GstH265Parser *
+gst_h265_parser_new (void)
+{
+  GstH265Parser *parser;
+
+  parser = g_slice_new0 (GstH265Parser);
+  GST_DEBUG_CATEGORY_INIT (h265_parser_debug, "codecparsers_h265", 0,
+      "h265 parser library");
+
+  return parser;
+}
+
+/**
+ * gst_h265_parser_free:
+ * @parser: the #GstH265Parser to free
+ *
+ * Frees @parser and sets it to %NULL
+ */
+void
+gst_h265_parser_free (GstH265Parser * parser)
+{
+  g_slice_free (GstH265Parser, parser);
+
+  parser = NULL;
+}
+
+/**
+ * gst_h265_parser_identify_nalu_unchecked:
+ * @parser: a #GstH265Parser
+ * @data: The data to parse
+ * @offset: the offset from which to parse @data
+ * @size: the size of @data
+ * @nalu: The #GstH265NalUnit where to store parsed nal headers
+ *
+ * Parses @data and fills @nalu from the next nalu data from @data.
+ *
+ * This differs from @gst_h265_parser_identify_nalu in that it doesn't
+ * check whether the packet is complete or not.
+ *
+ * Note: Only use this function if you already know the provided @data
+ * is a complete NALU, else use @gst_h265_parser_identify_nalu.
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parser_identify_nalu_unchecked (GstH265Parser * parser,
+    const guint8 * data, guint offset, gsize size, GstH265NalUnit * nalu)
+{
+  gint off1;
+
+  if (size < offset + 4) {
+    GST_DEBUG ("Can't parse, buffer has too small size %" G_GSIZE_FORMAT
+        ", offset %u", size, offset);
+    return GST_H265_PARSER_ERROR;
+  }
+
+  off1 = gst_codec_parser_scan_start_code (data + offset, size - offset);
+
+  if (off1 < 0) {
+    GST_DEBUG ("No start code prefix in this buffer");
+    return GST_H265_PARSER_NO_NAL;
+  }
+
+  /* the 2 bytes of the nal unit header have to follow the start code */
+  if (offset + off1 + 3 + 2 > size) {
+    GST_DEBUG ("Missing data to identify nal unit");
+
+    return GST_H265_PARSER_ERROR;
+  }
+
+  nalu->sc_offset = offset + off1;
+
+  /* sc might have 2 or 3 0-bytes */
+  if (nalu->sc_offset > 0 && data[nalu->sc_offset - 1] == 00)
+    nalu->sc_offset--;
+
+  nalu->offset = offset + off1 + 3;
+  nalu->data = (guint8 *) data;
+  nalu->size = size - nalu->offset;
+
+  if (!set_nalu_datas (nalu)) {
+    GST_DEBUG ("forbidden_zero_bit is set, not a nal unit");
+    nalu->valid = FALSE;
+    nalu->size = 0;
+    return GST_H265_PARSER_BROKEN_DATA;
+  }
+
+  nalu->valid = TRUE;
+
+  if (nalu->type == GST_H265_NAL_EOS || nalu->type == GST_H265_NAL_EOB) {
+    GST_DEBUG ("end-of-seq or end-of-stream nal found");
+    nalu->size = 2;
+    return GST_H265_PARSER_OK;
+  }
+
+  return GST_H265_PARSER_OK;
+}
+
+/**
+ * gst_h265_parser_identify_nalu:
+ * @parser: a #GstH265Parser
+ * @data: The data to parse
+ * @offset: the offset from which to parse @data
+ * @size: the size of @data
+ * @nalu: The #GstH265NalUnit where to store parsed nal headers
+ *
+ * Parses @data and fills @nalu from the next nalu data from @data
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parser_identify_nalu (GstH265Parser * parser,
+    const guint8 * data, guint offset, gsize size, GstH265NalUnit * nalu)
+{
+  GstH265ParserResult res;
+  gint off2;
+
+  res =
+      gst_h265_parser_identify_nalu_unchecked (parser, data, offset, size,
+      nalu);
+
+  if (res != GST_H265_PARSER_OK)
+    goto beach;
+
+  /* The end of sequence and end of bitstream nal units are only made of
+   * their header and end an access unit, there is no need to wait for the
+   * next start code */
+  if (nalu->type == GST_H265_NAL_EOS || nalu->type == GST_H265_NAL_EOB)
+    goto beach;
+
+  off2 = gst_codec_parser_scan_start_code (data + nalu->offset,
+      size - nalu->offset);
+  if (off2 < 0) {
+    GST_DEBUG ("Nal start %d, No end found", nalu->offset);
+
+    return GST_H265_PARSER_NO_NAL_END;
+  }
+
+  if (off2 > 0 && data[nalu->offset + off2 - 1] == 00)
+    off2--;
+
+  nalu->size = off2;
+  if (nalu->size < 3)
+    return GST_H265_PARSER_BROKEN_DATA;
+
+  GST_DEBUG ("Complete nal found. Off: %d, Size: %d", nalu->offset, nalu->size);
+
+beach:
+  return res;
+}
+
+/**
+ * gst_h265_parser_identify_nalu_hevc:
+ * @parser: a #GstH265Parser
+ * @data: The data to parse, must be the beging of the Nal unit
+ * @offset: the offset from which to parse @data
+ * @size: the size of @data
+ * @nal_length_size: the size in bytes of the HEVC nal length prefix.
+ * @nalu: The #GstH265NalUnit where to store parsed nal headers
+ *
+ * Parses @data and sets @nalu.
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parser_identify_nalu_hevc (GstH265Parser * parser,
+    const guint8 * data, guint offset, gsize size, guint8 nal_length_size,
+    GstH265NalUnit * nalu)
+{
+  GstBitReader br;
+
+  if (nal_length_size < 1 || nal_length_size > 4) {
+    GST_DEBUG ("invalid nal length size %u", nal_length_size);
+    return GST_H265_PARSER_ERROR;
+  }
+
+  if (size < offset + nal_length_size) {
+    GST_DEBUG ("Can't parse, buffer has too small size %" G_GSIZE_FORMAT
+        ", offset %u", size, offset);
+    return GST_H265_PARSER_ERROR;
+  }
+
+  size = size - offset;
+  gst_bit_reader_init (&br, data + offset, size);
+
+  nalu->size = gst_bit_reader_get_bits_uint32_unchecked (&br,
+      nal_length_size * 8);
+  nalu->sc_offset = offset;
+  nalu->offset = offset + nal_length_size;
+  nalu->valid = FALSE;
+
+  if (size < (gsize) nalu->size + nal_length_size) {
+    nalu->size = 0;
+
+    return GST_H265_PARSER_NO_NAL_END;
+  }
+
+  if (nalu->size < 2)
+    return GST_H265_PARSER_BROKEN_DATA;
+
+  nalu->data = (guint8 *) data;
+
+  if (!set_nalu_datas (nalu)) {
+    GST_DEBUG ("forbidden_zero_bit is set, not a nal unit");
+    return GST_H265_PARSER_BROKEN_DATA;
+  }
+
+  nalu->valid = TRUE;
+
+  return GST_H265_PARSER_OK;
+}
+
+/**
+ * gst_h265_parser_parse_nal:
+ * @parser: a #GstH265Parser
+ * @nalu: The #GstH265NalUnit to parse
+ *
+ * This function should be called in the case one doesn't need to
+ * parse a specific structure. It is necessary to do so to make
+ * sure @parser is up to date.
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parser_parse_nal (GstH265Parser * parser, GstH265NalUnit * nalu)
+{
+  GstH265VPS vps;
+  GstH265SPS sps;
+  GstH265PPS pps;
+
+  switch (nalu->type) {
+    case GST_H265_NAL_VPS:
+      return gst_h265_parser_parse_vps (parser, nalu, &vps);
+    case GST_H265_NAL_SPS:
+      return gst_h265_parser_parse_sps (parser, nalu, &sps, FALSE);
+    case GST_H265_NAL_PPS:
+      return gst_h265_parser_parse_pps (parser, nalu, &pps);
+  }
+
+  return GST_H265_PARSER_OK;
+}
+
+/**
+ * gst_h265_parser_parse_vps:
+ * @parser: a #GstH265Parser
+ * @nalu: The #GST_H265_NAL_VPS #GstH265NalUnit to parse
+ * @vps: The #GstH265VPS to fill.
+ *
+ * Parses @data, and fills the @vps structure.
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parser_parse_vps (GstH265Parser * parser, GstH265NalUnit * nalu,
+    GstH265VPS * vps)
+{
+  GstH265ParserResult res = gst_h265_parse_vps (nalu, vps);
+
+  if (res == GST_H265_PARSER_OK) {
+    GST_DEBUG ("adding video parameter set with id: %d to array", vps->id);
+
+    parser->vps[vps->id] = *vps;
+    parser->last_vps = &parser->vps[vps->id];
+  }
+
+  return res;
+}
+
+/**
+ * gst_h265_parse_vps:
+ * @nalu: The #GST_H265_NAL_VPS #GstH265NalUnit to parse
+ * @vps: The #GstH265VPS to fill.
+ *
+ * Parses @data, and fills the @vps structure.
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parse_vps (GstH265NalUnit * nalu, GstH265VPS * vps)
+{
+  NalReader nr;
+  guint i, j;
+
+  GST_DEBUG ("parsing VPS");
+
+  nal_reader_init (&nr, nalu->data + nalu->offset + nalu->header_bytes,
+      nalu->size - nalu->header_bytes);
+
+  memset (vps, 0, sizeof (*vps));
+
+  READ_UINT8 (&nr, vps->id, 4);
+
+  /* skip vps_reserved_three_2bits */
+  if (!nal_reader_skip (&nr, 2))
+    goto error;
+
+  READ_UINT8 (&nr, vps->max_layers_minus1, 6);
+  READ_UINT8 (&nr, vps->max_sub_layers_minus1, 3);
+  CHECK_ALLOWED (vps->max_sub_layers_minus1, 0, 6);
+  READ_UINT8 (&nr, vps->temporal_id_nesting_flag, 1);
+
+  /* skip vps_reserved_0xffff_16bits */
+  if (!nal_reader_skip (&nr, 16))
+    goto error;
+
+  if (!gst_h265_parse_profile_tier_level (&vps->profile_tier_level, &nr,
+          vps->max_sub_layers_minus1))
+    goto error;
+
+  READ_UINT8 (&nr, vps->sub_layer_ordering_info_present_flag, 1);
+
+  for (i = (vps->sub_layer_ordering_info_present_flag ? 0 :
+          vps->max_sub_layers_minus1); i <= vps->max_sub_layers_minus1; i++) {
+    READ_UE_ALLOWED (&nr, vps->max_dec_pic_buffering_minus1[i], 0, 15);
+    READ_UE_ALLOWED (&nr, vps->max_num_reorder_pics[i], 0,
+        vps->max_dec_pic_buffering_minus1[i]);
+    READ_UE_ALLOWED (&nr, vps->max_latency_increase_plus1[i], 0,
+        G_MAXUINT32 - 1);
+  }
+  /* the values of the highest sub layer apply to all of them */
+  if (!vps->sub_layer_ordering_info_present_flag) {
+    for (i = 0; i < vps->max_sub_layers_minus1; i++) {
+      vps->max_dec_pic_buffering_minus1[i] =
+          vps->max_dec_pic_buffering_minus1[vps->max_sub_layers_minus1];
+      vps->max_num_reorder_pics[i] =
+          vps->max_num_reorder_pics[vps->max_sub_layers_minus1];
+      vps->max_latency_increase_plus1[i] =
+          vps->max_latency_increase_plus1[vps->max_sub_layers_minus1];
+    }
+  }
+
+  READ_UINT8 (&nr, vps->max_layer_id, 6);
+  READ_UE_ALLOWED (&nr, vps->num_layer_sets_minus1, 0, 1023);
+
+  /* skip the layer_id_included_flag */
+  for (i = 1; i <= vps->num_layer_sets_minus1; i++)
+    for (j = 0; j <= vps->max_layer_id; j++)
+      if (!nal_reader_skip (&nr, 1))
+        goto error;
+
+  READ_UINT8 (&nr, vps->timing_info_present_flag, 1);
+  if (vps->timing_info_present_flag) {
+    READ_UINT32 (&nr, vps->num_units_in_tick, 32);
+    READ_UINT32 (&nr, vps->time_scale, 32);
+    READ_UINT8 (&nr, vps->poc_proportional_to_timing_flag, 1);
+
+    if (vps->poc_proportional_to_timing_flag)
+      READ_UE_ALLOWED (&nr, vps->num_ticks_poc_diff_one_minus1, 0,
+          G_MAXUINT32 - 1);
+
+    READ_UE_ALLOWED (&nr, vps->num_hrd_parameters, 0,
+        vps->num_layer_sets_minus1 + 1);
+
+    for (i = 0; i < vps->num_hrd_parameters; i++) {
+      READ_UE_ALLOWED (&nr, vps->hrd_layer_set_idx, 0,
+          vps->num_layer_sets_minus1);
+
+      vps->cprms_present_flag = 1;
+      if (i > 0)
+        READ_UINT8 (&nr, vps->cprms_present_flag, 1);
+
+      /* the common information is the one of the previous hrd_parameters()
+       * when it is not present, so they are all parsed into the same
+       * structure */
+      if (!gst_h265_parse_hrd_parameters (&vps->hrd_params, &nr,
+              vps->cprms_present_flag, vps->max_sub_layers_minus1))
+        goto error;
+    }
+  }
+
+  READ_UINT8 (&nr, vps->vps_extension, 1);
+
+  vps->valid = TRUE;
+
+  return GST_H265_PARSER_OK;
+
+error:
+  GST_WARNING ("error parsing \"Video parameter set\"");
+  vps->valid = FALSE;
+  return GST_H265_PARSER_ERROR;
+}
+
+/**
+ * gst_h265_parser_parse_sps:
+ * @parser: a #GstH265Parser
+ * @nalu: The #GST_H265_NAL_SPS #GstH265NalUnit to parse
+ * @sps: The #GstH265SPS to fill.
+ * @parse_vui_params: Whether to parse the vui_params or not
+ *
+ * Parses @data, and fills the @sps structure.
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parser_parse_sps (GstH265Parser * parser, GstH265NalUnit * nalu,
+    GstH265SPS * sps, gboolean parse_vui_params)
+{
+  GstH265ParserResult res =
+      gst_h265_parse_sps (parser, nalu, sps, parse_vui_params);
+
+  if (res == GST_H265_PARSER_OK) {
+    GST_DEBUG ("adding sequence parameter set with id: %d to array", sps->id);
+
+    parser->sps[sps->id] = *sps;
+    parser->last_sps = &parser->sps[sps->id];
+  }
+
+  return res;
+}
+
+/**
+ * gst_h265_parse_sps:
+ * @parser: The #GstH265Parser
+ * @nalu: The #GST_H265_NAL_SPS #GstH265NalUnit to parse
+ * @sps: The #GstH265SPS to fill.
+ * @parse_vui_params: Whether to parse the vui_params or not
+ *
+ * Parses @data, and fills the @sps structure. The #GstH265VPS the SPS
+ * refers to is looked up in @parser, the SPS is still parsed when it is
+ * missing.
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parse_sps (GstH265Parser * parser, GstH265NalUnit * nalu,
+    GstH265SPS * sps, gboolean parse_vui_params)
+{
+  NalReader nr;
+  guint i;
+  gint64 width, height;
+  const guint subwc[] = { 1, 2, 2, 1 };
+  const guint subhc[] = { 1, 2, 1, 1 };
+  GstH265VUIParams *vui = NULL;
+
+  GST_DEBUG ("parsing SPS");
+
+  nal_reader_init (&nr, nalu->data + nalu->offset + nalu->header_bytes,
+      nalu->size - nalu->header_bytes);
+
+  memset (sps, 0, sizeof (*sps));
+
+  READ_UINT8 (&nr, sps->vps_id, 4);
+  sps->vps = gst_h265_parser_get_vps (parser, sps->vps_id);
+  if (!sps->vps)
+    GST_DEBUG ("couldn't find associated video parameter set with id: %d",
+        sps->vps_id);
+
+  READ_UINT8 (&nr, sps->max_sub_layers_minus1, 3);
+  CHECK_ALLOWED (sps->max_sub_layers_minus1, 0, 6);
+  READ_UINT8 (&nr, sps->temporal_id_nesting_flag, 1);
+
+  if (!gst_h265_parse_profile_tier_level (&sps->profile_tier_level, &nr,
+          sps->max_sub_layers_minus1))
+    goto error;
+
+  READ_UE_ALLOWED (&nr, sps->id, 0, GST_H265_MAX_SPS_COUNT - 1);
+
+  READ_UE_ALLOWED (&nr, sps->chroma_format_idc, 0, 3);
+  if (sps->chroma_format_idc == 3)
+    READ_UINT8 (&nr, sps->separate_colour_plane_flag, 1);
+
+  READ_UE_ALLOWED (&nr, sps->pic_width_in_luma_samples, 1, 16888);
+  READ_UE_ALLOWED (&nr, sps->pic_height_in_luma_samples, 1, 16888);
+
+  READ_UINT8 (&nr, sps->conformance_window_flag, 1);
+  if (sps->conformance_window_flag) {
+    READ_UE (&nr, sps->conf_win_left_offset);
+    READ_UE (&nr, sps->conf_win_right_offset);
+    READ_UE (&nr, sps->conf_win_top_offset);
+    READ_UE (&nr, sps->conf_win_bottom_offset);
+  }
+
+  READ_UE_ALLOWED (&nr, sps->bit_depth_luma_minus8, 0, 6);
+  READ_UE_ALLOWED (&nr, sps->bit_depth_chroma_minus8, 0, 6);
+  READ_UE_ALLOWED (&nr, sps->log2_max_pic_order_cnt_lsb_minus4, 0, 12);
+
+  READ_UINT8 (&nr, sps->sub_layer_ordering_info_present_flag, 1);
+  for (i = (sps->sub_layer_ordering_info_present_flag ? 0 :
+          sps->max_sub_layers_minus1); i <= sps->max_sub_layers_minus1; i++) {
+    READ_UE_ALLOWED (&nr, sps->max_dec_pic_buffering_minus1[i], 0, 15);
+    READ_UE_ALLOWED (&nr, sps->max_num_reorder_pics[i], 0,
+        sps->max_dec_pic_buffering_minus1[i]);
+    READ_UE_ALLOWED (&nr, sps->max_latency_increase_plus1[i], 0,
+        G_MAXUINT32 - 1);
+  }
+  /* the values of the highest sub layer apply to all of them */
+  if (!sps->sub_layer_ordering_info_present_flag) {
+    for (i = 0; i < sps->max_sub_layers_minus1; i++) {
+      sps->max_dec_pic_buffering_minus1[i] =
+          sps->max_dec_pic_buffering_minus1[sps->max_sub_layers_minus1];
+      sps->max_num_reorder_pics[i] =
+          sps->max_num_reorder_pics[sps->max_sub_layers_minus1];
+      sps->max_latency_increase_plus1[i] =
+          sps->max_latency_increase_plus1[sps->max_sub_layers_minus1];
+    }
+  }
+
+  /* The coding and transform blocks are at most 64x64 and 32x32 */
+  READ_UE_ALLOWED (&nr, sps->log2_min_luma_coding_block_size_minus3, 0, 3);
+  READ_UE_ALLOWED (&nr, sps->log2_diff_max_min_luma_coding_block_size, 0,
+      3 - sps->log2_min_luma_coding_block_size_minus3);
+  READ_UE_ALLOWED (&nr, sps->log2_min_transform_block_size_minus2, 0, 3);
+  READ_UE_ALLOWED (&nr, sps->log2_diff_max_min_transform_block_size, 0,
+      3 - sps->log2_min_transform_block_size_minus2);
+  READ_UE_ALLOWED (&nr, sps->max_transform_hierarchy_depth_inter, 0, 4);
+  READ_UE_ALLOWED (&nr, sps->max_transform_hierarchy_depth_intra, 0, 4);
+
+  set_flat_scaling_lists (&sps->scaling_list);
+  READ_UINT8 (&nr, sps->scaling_list_enabled_flag, 1);
+  if (sps->scaling_list_enabled_flag) {
+    READ_UINT8 (&nr, sps->scaling_list_data_present_flag, 1);
+
+    if (sps->scaling_list_data_present_flag) {
+      if (!gst_h265_parser_parse_scaling_lists (&nr, &sps->scaling_list))
+        goto error;
+    } else {
+      set_default_scaling_lists (&sps->scaling_list);
+    }
+  }
+
+  READ_UINT8 (&nr, sps->amp_enabled_flag, 1);
+  READ_UINT8 (&nr, sps->sample_adaptive_offset_enabled_flag, 1);
+  READ_UINT8 (&nr, sps->pcm_enabled_flag, 1);
+
+  if (sps->pcm_enabled_flag) {
+    READ_UINT8 (&nr, sps->pcm_sample_bit_depth_luma_minus1, 4);
+    READ_UINT8 (&nr, sps->pcm_sample_bit_depth_chroma_minus1, 4);
+    READ_UE_ALLOWED (&nr, sps->log2_min_pcm_luma_coding_block_size_minus3, 0,
+        2);
+    READ_UE_ALLOWED (&nr, sps->log2_diff_max_min_pcm_luma_coding_block_size,
+        0, 2);
+    READ_UINT8 (&nr, sps->pcm_loop_filter_disabled_flag, 1);
+  }
+
+  READ_UE_ALLOWED (&nr, sps->num_short_term_ref_pic_sets, 0, 64);
+  for (i = 0; i < sps->num_short_term_ref_pic_sets; i++)
+    if (!gst_h265_parser_parse_short_term_ref_pic_set
+        (&sps->short_term_ref_pic_set[i], &nr, i, sps))
+      goto error;
+
+  READ_UINT8 (&nr, sps->long_term_ref_pics_present_flag, 1);
+  if (sps->long_term_ref_pics_present_flag) {
+    READ_UE_ALLOWED (&nr, sps->num_long_term_ref_pics_sps, 0, 32);
+    for (i = 0; i < sps->num_long_term_ref_pics_sps; i++) {
+      READ_UINT16 (&nr, sps->lt_ref_pic_poc_lsb_sps[i],
+          sps->log2_max_pic_order_cnt_lsb_minus4 + 4);
+      READ_UINT8 (&nr, sps->used_by_curr_pic_lt_sps_flag[i], 1);
+    }
+  }
+
+  READ_UINT8 (&nr, sps->temporal_mvp_enabled_flag, 1);
+  READ_UINT8 (&nr, sps->strong_intra_smoothing_enabled_flag, 1);
+  READ_UINT8 (&nr, sps->vui_parameters_present_flag, 1);
+
+  if (sps->vui_parameters_present_flag && parse_vui_params) {
+    if (!gst_h265_parse_vui_parameters (sps, &nr))
+      goto error;
+    vui = &sps->vui_params;
+  }
+
+  /* the extension flag can only be reached when the VUI is parsed */
+  if (!sps->vui_parameters_present_flag || vui)
+    READ_UINT8 (&nr, sps->sps_extension_flag, 1);
+
+  /* calculate ChromaArrayType */
+  if (sps->separate_colour_plane_flag)
+    sps->chroma_array_type = 0;
+  else
+    sps->chroma_array_type = sps->chroma_format_idc;
+
+  sps->width = sps->pic_width_in_luma_samples;
+  sps->height = sps->pic_height_in_luma_samples;
+
+  width = sps->width;
+  height = sps->height;
+  sps->crop_rect_x = 0;
+  sps->crop_rect_y = 0;
+  if (sps->conformance_window_flag) {
+    width -= ((gint64) sps->conf_win_left_offset +
+        sps->conf_win_right_offset) * subwc[sps->chroma_array_type];
+    height -= ((gint64) sps->conf_win_top_offset +
+        sps->conf_win_bottom_offset) * subhc[sps->chroma_array_type];
+    if (width <= 0 || height <= 0) {
+      GST_WARNING ("invalid conformance window in SPS");
+      goto error;
+    }
+    sps->crop_rect_x = sps->conf_win_left_offset *
+        subwc[sps->chroma_array_type];
+    sps->crop_rect_y = sps->conf_win_top_offset *
+        subhc[sps->chroma_array_type];
+  }
+  sps->crop_rect_width = width;
+  sps->crop_rect_height = height;
+  GST_LOG ("width=%d, height=%d, cropped to %dx%d at %d,%d", sps->width,
+      sps->height, sps->crop_rect_width, sps->crop_rect_height,
+      sps->crop_rect_x, sps->crop_rect_y);
+
+  sps->fps_num = 0;
+  sps->fps_den = 1;
+
+  if (vui && vui->timing_info_present_flag) {
+    /* derive the framerate of progressive streams, each picture is then a
+     * frame */
+    /* FIXME handle field streams */
+    if (!vui->field_seq_flag && !vui->frame_field_info_present_flag &&
+        vui->num_units_in_tick > 0 && vui->time_scale > 0) {
+      sps->fps_num = vui->time_scale;
+      sps->fps_den = vui->num_units_in_tick;
+      GST_LOG ("framerate %d/%d", sps->fps_num, sps->fps_den);
+    }
+  } else {
+    GST_LOG ("No VUI, unknown framerate");
+  }
+
+  sps->valid = TRUE;
+
+  return GST_H265_PARSER_OK;
+
+error:
+  GST_WARNING ("error parsing \"Sequence parameter set\"");
+  sps->valid = FALSE;
+  return GST_H265_PARSER_ERROR;
+}
+
+/**
+ * gst_h265_parse_pps:
+ * @parser: a #GstH265Parser
+ * @nalu: The #GST_H265_NAL_PPS #GstH265NalUnit to parse
+ * @pps: The #GstH265PPS to fill.
+ *
+ * Parses @data, and fills the @pps structure.
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parse_pps (GstH265Parser * parser, GstH265NalUnit * nalu,
+    GstH265PPS * pps)
+{
+  NalReader nr;
+  GstH265SPS *sps;
+  gint sps_id;
+  gint qp_bd_offset;
+  guint32 ctb_log2_size_y, ctb_size_y;
+  guint i;
+
+  GST_DEBUG ("parsing PPS");
+
+  nal_reader_init (&nr, nalu->data + nalu->offset + nalu->header_bytes,
+      nalu->size - nalu->header_bytes);
+
+  READ_UE_ALLOWED (&nr, pps->id, 0, GST_H265_MAX_PPS_COUNT - 1);
+  READ_UE_ALLOWED (&nr, sps_id, 0, GST_H265_MAX_SPS_COUNT - 1);
+
+  sps = gst_h265_parser_get_sps (parser, sps_id);
+  if (!sps) {
+    GST_WARNING ("couldn't find associated sequence parameter set with id: %d",
+        sps_id);
+    return GST_H265_PARSER_BROKEN_LINK;
+  }
+  pps->sps = sps;
+  qp_bd_offset = 6 * sps->bit_depth_luma_minus8;
+
+  ctb_log2_size_y = sps->log2_min_luma_coding_block_size_minus3 + 3 +
+      sps->log2_diff_max_min_luma_coding_block_size;
+  ctb_size_y = 1 << ctb_log2_size_y;
+  pps->PicWidthInCtbsY =
+      (sps->pic_width_in_luma_samples + ctb_size_y - 1) / ctb_size_y;
+  pps->PicHeightInCtbsY =
+      (sps->pic_height_in_luma_samples + ctb_size_y - 1) / ctb_size_y;
+
+  /* set default values for fields that might not be present in the bitstream
+     and have valid defaults */
+  pps->diff_cu_qp_delta_depth = 0;
+  pps->num_tile_columns_minus1 = 0;
+  pps->num_tile_rows_minus1 = 0;
+  pps->uniform_spacing_flag = 1;
+  pps->loop_filter_across_tiles_enabled_flag = 1;
+  pps->deblocking_filter_override_enabled_flag = 0;
+  pps->deblocking_filter_disabled_flag = 0;
+  pps->beta_offset_div2 = 0;
+  pps->tc_offset_div2 = 0;
+
+  READ_UINT8 (&nr, pps->dependent_slice_segments_enabled_flag, 1);
+  READ_UINT8 (&nr, pps->output_flag_present_flag, 1);
+  READ_UINT8 (&nr, pps->num_extra_slice_header_bits, 3);
+  READ_UINT8 (&nr, pps->sign_data_hiding_enabled_flag, 1);
+  READ_UINT8 (&nr, pps->cabac_init_present_flag, 1);
+
+  READ_UE_ALLOWED (&nr, pps->num_ref_idx_l0_default_active_minus1, 0, 14);
+  READ_UE_ALLOWED (&nr, pps->num_ref_idx_l1_default_active_minus1, 0, 14);
+  READ_SE_ALLOWED (&nr, pps->init_qp_minus26, -(26 + qp_bd_offset), 25);
+
+  READ_UINT8 (&nr, pps->constrained_intra_pred_flag, 1);
+  READ_UINT8 (&nr, pps->transform_skip_enabled_flag, 1);
+
+  READ_UINT8 (&nr, pps->cu_qp_delta_enabled_flag, 1);
+  if (pps->cu_qp_delta_enabled_flag)
+    READ_UE_ALLOWED (&nr, pps->diff_cu_qp_delta_depth, 0,
+        sps->log2_diff_max_min_luma_coding_block_size);
+
+  READ_SE_ALLOWED (&nr, pps->cb_qp_offset, -12, 12);
+  READ_SE_ALLOWED (&nr, pps->cr_qp_offset, -12, 12);
+
+  READ_UINT8 (&nr, pps->slice_chroma_qp_offsets_present_flag, 1);
+  READ_UINT8 (&nr, pps->weighted_pred_flag, 1);
+  READ_UINT8 (&nr, pps->weighted_bipred_flag, 1);
+  READ_UINT8 (&nr, pps->transquant_bypass_enabled_flag, 1);
+  READ_UINT8 (&nr, pps->tiles_enabled_flag, 1);
+  READ_UINT8 (&nr, pps->entropy_coding_sync_enabled_flag, 1);
+
+  if (pps->tiles_enabled_flag) {
+    READ_UE_ALLOWED (&nr, pps->num_tile_columns_minus1, 0,
+        MIN (19, pps->PicWidthInCtbsY - 1));
+    READ_UE_ALLOWED (&nr, pps->num_tile_rows_minus1, 0,
+        MIN (21, pps->PicHeightInCtbsY - 1));
+
+    READ_UINT8 (&nr, pps->uniform_spacing_flag, 1);
+    if (!pps->uniform_spacing_flag) {
+      for (i = 0; i < pps->num_tile_columns_minus1; i++)
+        READ_UE (&nr, pps->column_width_minus1[i]);
+
+      for (i = 0; i < pps->num_tile_rows_minus1; i++)
+        READ_UE (&nr, pps->row_height_minus1[i]);
+    } else {
+      /* 6-3 and 6-4 */
+      for (i = 0; i < pps->num_tile_columns_minus1; i++)
+        pps->column_width_minus1[i] =
+            ((i + 1) * pps->PicWidthInCtbsY) / (pps->num_tile_columns_minus1 +
+            1) - (i * pps->PicWidthInCtbsY) / (pps->num_tile_columns_minus1 +
+            1) - 1;
+
+      for (i = 0; i < pps->num_tile_rows_minus1; i++)
+        pps->row_height_minus1[i] =
+            ((i + 1) * pps->PicHeightInCtbsY) / (pps->num_tile_rows_minus1 +
+            1) - (i * pps->PicHeightInCtbsY) / (pps->num_tile_rows_minus1 +
+            1) - 1;
+    }
+
+    READ_UINT8 (&nr, pps->loop_filter_across_tiles_enabled_flag, 1);
+  }
+
+  READ_UINT8 (&nr, pps->loop_filter_across_slices_enabled_flag, 1);
+
+  READ_UINT8 (&nr, pps->deblocking_filter_control_present_flag, 1);
+  if (pps->deblocking_filter_control_present_flag) {
+    READ_UINT8 (&nr, pps->deblocking_filter_override_enabled_flag, 1);
+
+    READ_UINT8 (&nr, pps->deblocking_filter_disabled_flag, 1);
+    if (!pps->deblocking_filter_disabled_flag) {
+      READ_SE_ALLOWED (&nr, pps->beta_offset_div2, -6, 6);
+      READ_SE_ALLOWED (&nr, pps->tc_offset_div2, -6, 6);
+    }
+  }
+
+  READ_UINT8 (&nr, pps->scaling_list_data_present_flag, 1);
+  if (pps->scaling_list_data_present_flag) {
+    if (!gst_h265_parser_parse_scaling_lists (&nr, &pps->scaling_list))
+      goto error;
+  } else {
+    pps->scaling_list = sps->scaling_list;
+  }
+
+  READ_UINT8 (&nr, pps->lists_modification_present_flag, 1);
+  READ_UE_ALLOWED (&nr, pps->log2_parallel_merge_level_minus2, 0,
+      ctb_log2_size_y - 2);
+  READ_UINT8 (&nr, pps->slice_segment_header_extension_present_flag, 1);
+  READ_UINT8 (&nr, pps->pps_extension_flag, 1);
+
+  pps->valid = TRUE;
+  return GST_H265_PARSER_OK;
+
+error:
+  GST_WARNING ("error parsing \"Picture parameter set\"");
+  pps->valid = FALSE;
+  return GST_H265_PARSER_ERROR;
+}
+
+/**
+ * gst_h265_parser_parse_pps:
+ * @parser: a #GstH265Parser
+ * @nalu: The #GST_H265_NAL_PPS #GstH265NalUnit to parse
+ * @pps: The #GstH265PPS to fill.
+ *
+ * Parses @data, and fills the @pps structure.
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parser_parse_pps (GstH265Parser * parser,
+    GstH265NalUnit * nalu, GstH265PPS * pps)
+{
+  GstH265ParserResult res = gst_h265_parse_pps (parser, nalu, pps);
+
+  if (res == GST_H265_PARSER_OK) {
+    GST_DEBUG ("adding picture parameter set with id: %d to array", pps->id);
+
+    parser->pps[pps->id] = *pps;
+    parser->last_pps = &parser->pps[pps->id];
+  }
+
+  return res;
+}
+
+/**
+ * gst_h265_parser_parse_slice_hdr:
+ * @parser: a #GstH265Parser
+ * @nalu: The #GST_H265_NAL_SLICE #GstH265NalUnit to parse
+ * @slice: The #GstH265SliceHdr to fill.
+ *
+ * Parses @data, and fills the @slice structure.
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parser_parse_slice_hdr (GstH265Parser * parser,
+    GstH265NalUnit * nalu, GstH265SliceHdr * slice)
+{
+  NalReader nr;
+  gint pps_id;
+  GstH265PPS *pps;
+  GstH265SPS *sps;
+  guint i;
+  GstH265ShortTermRefPicSet *rps = NULL;
+  guint32 pic_size_in_ctbs_y;
+
+  if (nalu->size <= nalu->header_bytes) {
+    GST_DEBUG ("Invalid Nal Unit");
+    return GST_H265_PARSER_ERROR;
+  }
+
+  nal_reader_init (&nr, nalu->data + nalu->offset + nalu->header_bytes,
+      nalu->size - nalu->header_bytes);
+
+  GST_DEBUG ("parsing \"Slice header\", slice type %u", slice->type);
+
+  READ_UINT8 (&nr, slice->first_slice_segment_in_pic_flag, 1);
+
+  slice->no_output_of_prior_pics_flag = 0;
+  if (GST_H265_IS_NAL_TYPE_IRAP (nalu->type))
+    READ_UINT8 (&nr, slice->no_output_of_prior_pics_flag, 1);
+
+  READ_UE_ALLOWED (&nr, pps_id, 0, GST_H265_MAX_PPS_COUNT - 1);
+  pps = gst_h265_parser_get_pps (parser, pps_id);
+  if (!pps) {
+    GST_WARNING ("couldn't find associated picture parameter set with id: %d",
+        pps_id);
+    return GST_H265_PARSER_BROKEN_LINK;
+  }
+
+  slice->pps = pps;
+  sps = pps->sps;
+  if (!sps) {
+    GST_WARNING ("couldn't find associated sequence parameter set with id: %d",
+        pps->id);
+    return GST_H265_PARSER_BROKEN_LINK;
+  }
+
+  pic_size_in_ctbs_y = pps->PicWidthInCtbsY * pps->PicHeightInCtbsY;
+
+  /* set default values for fields that might not be present in the bitstream
+     and have valid defaults */
+  slice->dependent_slice_segment_flag = 0;
+  slice->segment_address = 0;
+  slice->pic_output_flag = 1;
+  slice->colour_plane_id = 0;
+  slice->pic_order_cnt_lsb = 0;
+  slice->short_term_ref_pic_set_sps_flag = 0;
+  slice->short_term_ref_pic_set_idx = 0;
+  slice->num_long_term_sps = 0;
+  slice->num_long_term_pics = 0;
+  slice->temporal_mvp_enabled_flag = 0;
+  slice->sao_luma_flag = 0;
+  slice->sao_chroma_flag = 0;
+  slice->num_ref_idx_active_override_flag = 0;
+  slice->num_ref_idx_l0_active_minus1 =
+      pps->num_ref_idx_l0_default_active_minus1;
+  slice->num_ref_idx_l1_active_minus1 =
+      pps->num_ref_idx_l1_default_active_minus1;
+  slice->ref_pic_list_modification_flag_l0 = 0;
+  slice->ref_pic_list_modification_flag_l1 = 0;
+  slice->mvd_l1_zero_flag = 0;
+  slice->cabac_init_flag = 0;
+  slice->collocated_from_l0_flag = 1;
+  slice->collocated_ref_idx = 0;
+  slice->five_minus_max_num_merge_cand = 0;
+  slice->qp_delta = 0;
+  slice->cb_qp_offset = 0;
+  slice->cr_qp_offset = 0;
+  slice->deblocking_filter_override_flag = 0;
+  slice->deblocking_filter_disabled_flag =
+      pps->deblocking_filter_disabled_flag;
+  slice->beta_offset_div2 = pps->beta_offset_div2;
+  slice->tc_offset_div2 = pps->tc_offset_div2;
+  slice->loop_filter_across_slices_enabled_flag =
+      pps->loop_filter_across_slices_enabled_flag;
+  slice->num_entry_point_offsets = 0;
+  slice->offset_len_minus1 = 0;
+  slice->NumPicTotalCurr = 0;
+
+  if (!slice->first_slice_segment_in_pic_flag) {
+    if (pps->dependent_slice_segments_enabled_flag)
+      READ_UINT8 (&nr, slice->dependent_slice_segment_flag, 1);
+
+    if (pic_size_in_ctbs_y > 1) {
+      READ_UINT32 (&nr, slice->segment_address,
+          ceil_log2 (pic_size_in_ctbs_y));
+      if (slice->segment_address >= pic_size_in_ctbs_y) {
+        GST_WARNING ("slice segment address %u out of the picture",
+            slice->segment_address);
+        goto error;
+      }
+    }
+  }
+
+  if (!slice->dependent_slice_segment_flag) {
+    /* skip slice_reserved_flag */
+    if (!nal_reader_skip (&nr, pps->num_extra_slice_header_bits))
+      goto error;
+
+    READ_UE_ALLOWED (&nr, slice->type, 0, 2);
+
+    if (pps->output_flag_present_flag)
+      READ_UINT8 (&nr, slice->pic_output_flag, 1);
+
+    if (sps->separate_colour_plane_flag)
+      READ_UINT8 (&nr, slice->colour_plane_id, 2);
+
+    if (!GST_H265_IS_NAL_TYPE_IDR (nalu->type)) {
+      READ_UINT16 (&nr, slice->pic_order_cnt_lsb,
+          sps->log2_max_pic_order_cnt_lsb_minus4 + 4);
+
+      READ_UINT8 (&nr, slice->short_term_ref_pic_set_sps_flag, 1);
+      if (!slice->short_term_ref_pic_set_sps_flag) {
+        if (!gst_h265_parser_parse_short_term_ref_pic_set
+            (&slice->short_term_ref_pic_sets, &nr,
+                sps->num_short_term_ref_pic_sets, sps))
+          goto error;
+        rps = &slice->short_term_ref_pic_sets;
+      } else {
+        if (sps->num_short_term_ref_pic_sets == 0) {
+          GST_WARNING ("no short term reference picture set in the SPS");
+          goto error;
+        }
+
+        if (sps->num_short_term_ref_pic_sets > 1) {
+          READ_UINT8 (&nr, slice->short_term_ref_pic_set_idx,
+              ceil_log2 (sps->num_short_term_ref_pic_sets));
+          CHECK_ALLOWED (slice->short_term_ref_pic_set_idx, 0,
+              sps->num_short_term_ref_pic_sets - 1);
+        }
+        rps = &sps->short_term_ref_pic_set[slice->short_term_ref_pic_set_idx];
+      }
+
+      /* 7-55 */
+      for (i = 0; i < rps->NumNegativePics; i++)
+        slice->NumPicTotalCurr += rps->UsedByCurrPicS0[i];
+      for (i = 0; i < rps->NumPositivePics; i++)
+        slice->NumPicTotalCurr += rps->UsedByCurrPicS1[i];
+
+      if (sps->long_term_ref_pics_present_flag) {
+        if (sps->num_long_term_ref_pics_sps > 0)
+          READ_UE_ALLOWED (&nr, slice->num_long_term_sps, 0,
+              sps->num_long_term_ref_pics_sps);
+
+        READ_UE_ALLOWED (&nr, slice->num_long_term_pics, 0,
+            32 - slice->num_long_term_sps);
+
+        for (i = 0; i < slice->num_long_term_sps + slice->num_long_term_pics;
+            i++) {
+          if (i < slice->num_long_term_sps) {
+            slice->lt_idx_sps[i] = 0;
+            if (sps->num_long_term_ref_pics_sps > 1) {
+              READ_UINT8 (&nr, slice->lt_idx_sps[i],
+                  ceil_log2 (sps->num_long_term_ref_pics_sps));
+              CHECK_ALLOWED (slice->lt_idx_sps[i], 0,
+                  sps->num_long_term_ref_pics_sps - 1);
+            }
+            slice->NumPicTotalCurr +=
+                sps->used_by_curr_pic_lt_sps_flag[slice->lt_idx_sps[i]];
+          } else {
+            READ_UINT32 (&nr, slice->poc_lsb_lt[i],
+                sps->log2_max_pic_order_cnt_lsb_minus4 + 4);
+            READ_UINT8 (&nr, slice->used_by_curr_pic_lt_flag[i], 1);
+            slice->NumPicTotalCurr += slice->used_by_curr_pic_lt_flag[i];
+          }
+
+          READ_UINT8 (&nr, slice->delta_poc_msb_present_flag[i], 1);
+          slice->delta_poc_msb_cycle_lt[i] = 0;
+          if (slice->delta_poc_msb_present_flag[i])
+            READ_UE (&nr, slice->delta_poc_msb_cycle_lt[i]);
+        }
+      }
+
+      if (sps->temporal_mvp_enabled_flag)
+        READ_UINT8 (&nr, slice->temporal_mvp_enabled_flag, 1);
+    }
+
+    if (sps->sample_adaptive_offset_enabled_flag) {
+      READ_UINT8 (&nr, slice->sao_luma_flag, 1);
+      if (sps->chroma_array_type != 0)
+        READ_UINT8 (&nr, slice->sao_chroma_flag, 1);
+    }
+
+    if (GST_H265_IS_B_SLICE (slice) || GST_H265_IS_P_SLICE (slice)) {
+      READ_UINT8 (&nr, slice->num_ref_idx_active_override_flag, 1);
+
+      if (slice->num_ref_idx_active_override_flag) {
+        READ_UE_ALLOWED (&nr, slice->num_ref_idx_l0_active_minus1, 0, 14);
+        if (GST_H265_IS_B_SLICE (slice))
+          READ_UE_ALLOWED (&nr, slice->num_ref_idx_l1_active_minus1, 0, 14);
+      }
+
+      if (pps->lists_modification_present_flag && slice->NumPicTotalCurr > 1) {
+        guint n = ceil_log2 (slice->NumPicTotalCurr);
+
+        READ_UINT8 (&nr, slice->ref_pic_list_modification_flag_l0, 1);
+        if (slice->ref_pic_list_modification_flag_l0)
+          for (i = 0; i <= slice->num_ref_idx_l0_active_minus1; i++)
+            READ_UINT8 (&nr, slice->list_entry_l0[i], n);
+
+        if (GST_H265_IS_B_SLICE (slice)) {
+          READ_UINT8 (&nr, slice->ref_pic_list_modification_flag_l1, 1);
+          if (slice->ref_pic_list_modification_flag_l1)
+            for (i = 0; i <= slice->num_ref_idx_l1_active_minus1; i++)
+              READ_UINT8 (&nr, slice->list_entry_l1[i], n);
+        }
+      }
+
+      if (GST_H265_IS_B_SLICE (slice))
+        READ_UINT8 (&nr, slice->mvd_l1_zero_flag, 1);
+
+      if (pps->cabac_init_present_flag)
+        READ_UINT8 (&nr, slice->cabac_init_flag, 1);
+
+      if (slice->temporal_mvp_enabled_flag) {
+        if (GST_H265_IS_B_SLICE (slice))
+          READ_UINT8 (&nr, slice->collocated_from_l0_flag, 1);
+
+        if (slice->collocated_from_l0_flag &&
+            slice->num_ref_idx_l0_active_minus1 > 0) {
+          READ_UE_ALLOWED (&nr, slice->collocated_ref_idx, 0,
+              slice->num_ref_idx_l0_active_minus1);
+        } else if (!slice->collocated_from_l0_flag &&
+            slice->num_ref_idx_l1_active_minus1 > 0) {
+          READ_UE_ALLOWED (&nr, slice->collocated_ref_idx, 0,
+              slice->num_ref_idx_l1_active_minus1);
+        }
+      }
+
+      if ((pps->weighted_pred_flag && GST_H265_IS_P_SLICE (slice)) ||
+          (pps->weighted_bipred_flag && GST_H265_IS_B_SLICE (slice)))
+        if (!gst_h265_slice_parse_pred_weight_table (slice, &nr))
+          goto error;
+
+      READ_UE_ALLOWED (&nr, slice->five_minus_max_num_merge_cand, 0, 4);
+    }
+
+    READ_SE_ALLOWED (&nr, slice->qp_delta, -87, 77);
+    if (pps->slice_chroma_qp_offsets_present_flag) {
+      READ_SE_ALLOWED (&nr, slice->cb_qp_offset, -12, 12);
+      READ_SE_ALLOWED (&nr, slice->cr_qp_offset, -12, 12);
+    }
+
+    if (pps->deblocking_filter_override_enabled_flag)
+      READ_UINT8 (&nr, slice->deblocking_filter_override_flag, 1);
+    if (slice->deblocking_filter_override_flag) {
+      READ_UINT8 (&nr, slice->deblocking_filter_disabled_flag, 1);
+      if (!slice->deblocking_filter_disabled_flag) {
+        READ_SE_ALLOWED (&nr, slice->beta_offset_div2, -6, 6);
+        READ_SE_ALLOWED (&nr, slice->tc_offset_div2, -6, 6);
+      }
+    }
+
+    if (pps->loop_filter_across_slices_enabled_flag &&
+        (slice->sao_luma_flag || slice->sao_chroma_flag ||
+            !slice->deblocking_filter_disabled_flag))
+      READ_UINT8 (&nr, slice->loop_filter_across_slices_enabled_flag, 1);
+  }
+
+  if (pps->tiles_enabled_flag || pps->entropy_coding_sync_enabled_flag) {
+    guint32 offset_max;
+
+    if (!pps->tiles_enabled_flag)
+      offset_max = pps->PicHeightInCtbsY - 1;
+    else if (!pps->entropy_coding_sync_enabled_flag)
+      offset_max = (pps->num_tile_columns_minus1 + 1) *
+          (pps->num_tile_rows_minus1 + 1) - 1;
+    else
+      offset_max = (pps->num_tile_columns_minus1 + 1) *
+          pps->PicHeightInCtbsY - 1;
+
+    READ_UE_ALLOWED (&nr, slice->num_entry_point_offsets, 0, offset_max);
+    if (slice->num_entry_point_offsets > 0) {
+      READ_UE_ALLOWED (&nr, slice->offset_len_minus1, 0, 31);
+
+      /* skip the entry_point_offset_minus1 */
+      for (i = 0; i < slice->num_entry_point_offsets; i++)
+        if (!nal_reader_skip (&nr, slice->offset_len_minus1 + 1))
+          goto error;
+    }
+  }
+
+  if (pps->slice_segment_header_extension_present_flag) {
+    guint16 slice_segment_header_extension_length;
+
+    READ_UE_ALLOWED (&nr, slice_segment_header_extension_length, 0, 256);
+    for (i = 0; i < slice_segment_header_extension_length; i++)
+      if (!nal_reader_skip (&nr, 8))
+        goto error;
+  }
+
+  /* byte_alignment () */
+  {
+    guint8 alignment_bit_equal_to_one;
+
+    READ_UINT8 (&nr, alignment_bit_equal_to_one, 1);
+    if (!alignment_bit_equal_to_one)
+      GST_WARNING ("alignment_bit_equal_to_one is not set");
+
+    if (!nal_reader_skip (&nr, (8 - nal_reader_get_pos (&nr) % 8) % 8))
+      goto error;
+  }
+
+  slice->header_size = nal_reader_get_pos (&nr);
+  slice->n_emulation_prevention_bytes = nal_reader_get_epb_count (&nr);
+
+  return GST_H265_PARSER_OK;
+
+error:
+  GST_WARNING ("error parsing \"Slice header\"");
+  return GST_H265_PARSER_ERROR;
+}
+
+/**
+ * gst_h265_parser_parse_sei:
+ * @parser: a #GstH265Parser
+ * @nalu: The #GST_H265_NAL_PREFIX_SEI or #GST_H265_NAL_SUFFIX_SEI
+ *  #GstH265NalUnit to parse
+ * @sei: The #GstH265SEIMessage to fill.
+ *
+ * Parses @data, and fills the @sei structures. Only the first SEI message
+ * of @nalu is parsed.
+ *
+ * Returns: a #GstH265ParserResult
+ */
+GstH265ParserResult
+gst_h265_parser_parse_sei (GstH265Parser * parser, GstH265NalUnit * nalu,
+    GstH265SEIMessage * sei)
+{
+  NalReader nr;
+  guint32 payload_size;
+  guint8 payload_type_byte, payload_size_byte;
+  GstH265ParserResult res;
+
+  GST_DEBUG ("parsing \"Sei message\"");
+
+  nal_reader_init (&nr, nalu->data + nalu->offset + nalu->header_bytes,
+      nalu->size - nalu->header_bytes);
+
+  /* init */
+  memset (sei, 0, sizeof (*sei));
+
+  sei->payloadType = 0;
+  do {
+    READ_UINT8 (&nr, payload_type_byte, 8);
+    sei->payloadType += payload_type_byte;
+  } while (payload_type_byte == 0xff);
+
+  payload_size = 0;
+  do {
+    READ_UINT8 (&nr, payload_size_byte, 8);
+    payload_size += payload_size_byte;
+  } while (payload_size_byte == 0xff);
+
+  GST_DEBUG ("SEI message received: payloadType  %u, payloadSize = %u bytes",
+      sei->payloadType, payload_size);
+
+  /* the parsed messages are all prefix ones */
+  if (nalu->type != GST_H265_NAL_PREFIX_SEI)
+    return GST_H265_PARSER_OK;
+
+  switch (sei->payloadType) {
+    case GST_H265_SEI_BUF_PERIOD:
+      res = gst_h265_parser_parse_buffering_period (parser,
+          &sei->buffering_period, &nr);
+      break;
+    case GST_H265_SEI_PIC_TIMING:
+      res = gst_h265_parser_parse_pic_timing (parser, &sei->pic_timing, &nr);
+      break;
+    case GST_H265_SEI_RECOVERY_POINT:
+      res = gst_h265_parser_parse_recovery_point (parser,
+          &sei->recovery_point, &nr);
+      break;
+    default:
+      res = GST_H265_PARSER_OK;
+      break;
+  }
+
+  return res;
+
+error:
+  GST_WARNING ("error parsing \"Sei message\"");
+  return GST_H265_PARSER_ERROR;
+}
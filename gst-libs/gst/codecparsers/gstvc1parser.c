@@ -33,6 +33,7 @@
 #endif
 
 #include "gstvc1parser.h"
+#include "gstcodecparserutils.h"
 #include "parserutils.h"
 #include <gst/base/gstbytereader.h>
 #include <gst/base/gstbitreader.h>
@@ -674,17 +675,6 @@ failed:
   return FALSE;
 }
 
-static inline gint
-scan_for_start_codes (const guint8 * data, guint size)
-{
-  GstByteReader br;
-  gst_byte_reader_init (&br, data, size);
-
-  /* NALU not empty, so we can at least expect 1 (even 2) bytes following sc */
-  return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
-      0, size);
-}
-
 static inline gint
 get_unary (GstBitReader * br, gint stop, gint len)
 {
@@ -1674,7 +1664,7 @@ gst_vc1_identify_next_bdu (const guint8 * data, gsize size, GstVC1BDU * bdu)
     return GST_VC1_PARSER_ERROR;
   }
 
-  off1 = scan_for_start_codes (data, size);
+  off1 = gst_codec_parser_scan_start_code (data, size);
 
   if (off1 < 0) {
     GST_DEBUG ("No start code prefix in this buffer");
@@ -1693,7 +1683,8 @@ gst_vc1_identify_next_bdu (const guint8 * data, gsize size, GstVC1BDU * bdu)
     return GST_VC1_PARSER_OK;
   }
 
-  off2 = scan_for_start_codes (data + bdu->offset, size - bdu->offset);
+  off2 = gst_codec_parser_scan_start_code (data + bdu->offset,
+      size - bdu->offset);
   if (off2 < 0) {
     GST_DEBUG ("Bdu start %d, No end found", bdu->offset);
 
@@ -0,0 +1,242 @@
+/* Gstreamer
+ * Copyright (C) <2011> Intel Corporation
+ * Copyright (C) <2011> Collabora Ltd.
+ * Copyright (C) <2011> Thibault Saunier <thibault.saunier@collabora.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "nalutils.h"
+
+#include <string.h>
+
+/* How far ahead nal_reader_find_epb() looks for emulation prevention bytes,
+ * so that parsing a slice header does not scan the whole slice data */
+#define NAL_READER_EPB_WINDOW 128
+
+void
+nal_reader_init (NalReader * nr, const guint8 * data, guint size)
+{
+  nr->data = data;
+  nr->size = size;
+  nr->n_epb = 0;
+
+  nr->byte = 0;
+  /* the emulation prevention bytes are looked for on the first read */
+  nr->next_epb = 0;
+  nr->bits_in_cache = 0;
+  nr->cache = 0;
+}
+
+/* Returns the position of the first emulation_prevention_three_byte at or
+ * after @pos, or the end of the looked up window if there is none */
+guint
+nal_reader_find_epb (const NalReader * nr, guint pos)
+{
+  const guint8 *p, *end;
+  guint start, limit;
+
+  start = pos < 2 ? 0 : pos - 2;
+  limit = MIN (nr->size, pos + NAL_READER_EPB_WINDOW);
+  if (G_UNLIKELY (limit < start + 3))
+    return limit;
+
+  /* last position where a 0x000003 sequence ending before @limit can begin.
+   * Like gst_codec_parser_scan_start_code(), only the zero bytes found by
+   * memchr() are checked */
+  end = nr->data + limit - 2;
+
+  for (p = nr->data + start; p < end;) {
+    p = memchr (p, 0, end - p);
+    if (p == NULL)
+      break;
+
+    if (p[1] != 0)
+      p += 2;
+    else if (p[2] == 0x03)
+      return p + 2 - nr->data;
+    else if (p[2] == 0x00)
+      p++;
+    else
+      p += 3;
+  }
+
+  return limit;
+}
+
+gboolean
+nal_reader_skip_to_byte (NalReader * nr)
+{
+  guint nbits = nr->bits_in_cache % 8;
+
+  if (nbits == 0)
+    return nal_reader_skip (nr, 8);
+
+  nr->cache <<= nbits;
+  nr->bits_in_cache -= nbits;
+
+  return TRUE;
+}
+
+/* Number of leading zero bits of @v, which is not 0 */
+static inline guint
+nal_reader_clz (guint64 v)
+{
+#if defined(__GNUC__) && __GNUC__ >= 4
+  return __builtin_clzll (v);
+#else
+  guint n = 0;
+
+  if (!(v >> 32)) {
+    n += 32;
+    v <<= 32;
+  }
+  if (!(v >> 48)) {
+    n += 16;
+    v <<= 16;
+  }
+  if (!(v >> 56)) {
+    n += 8;
+    v <<= 8;
+  }
+  if (!(v >> 60)) {
+    n += 4;
+    v <<= 4;
+  }
+  if (!(v >> 62)) {
+    n += 2;
+    v <<= 2;
+  }
+  if (!(v >> 63))
+    n += 1;
+
+  return n;
+#endif
+}
+
+gboolean
+nal_reader_get_ue (NalReader * nr, guint32 * val)
+{
+  guint i = 0, n;
+  guint32 value;
+
+  /* the bits of the cache that are not used are 0, so the cache is 0 only
+   * if all its bits are leading zeros */
+  while (G_UNLIKELY (nr->cache == 0)) {
+    i += nr->bits_in_cache;
+    nr->bits_in_cache = 0;
+
+    if (G_UNLIKELY (i > 32))
+      return FALSE;
+
+    if (G_UNLIKELY (!nal_reader_read (nr, 1)))
+      return FALSE;
+  }
+
+  n = nal_reader_clz (nr->cache);
+  i += n;
+
+  if (G_UNLIKELY (i > 32))
+    return FALSE;
+
+  /* skip the leading zeros and the 1 */
+  nr->cache <<= n + 1;
+  nr->bits_in_cache -= n + 1;
+
+  if (G_UNLIKELY (!nal_reader_get_bits_uint32 (nr, &value, i)))
+    return FALSE;
+
+  *val = ((guint64) 1 << i) - 1 + value;
+
+  return TRUE;
+}
+
+gboolean
+nal_reader_get_se (NalReader * nr, gint32 * val)
+{
+  guint32 value;
+
+  if (G_UNLIKELY (!nal_reader_get_ue (nr, &value)))
+    return FALSE;
+
+  if (value % 2)
+    *val = (value / 2) + 1;
+  else
+    *val = -(value / 2);
+
+  return TRUE;
+}
+
+
+gboolean
+nal_reader_has_more_data (const NalReader * nr)
+{
+  guint remaining;
+
+  remaining = nal_reader_get_remaining (nr);
+  if (remaining == 0)
+    return FALSE;
+
+  if (remaining <= 8) {
+    guint8 rbsp_stop_one_bit;
+
+    if (!nal_reader_peek_bits_uint8 (nr, &rbsp_stop_one_bit, 1))
+      return FALSE;
+
+    if (rbsp_stop_one_bit == 1) {
+      guint8 zero_bits;
+
+      if (remaining == 1)
+        return FALSE;
+
+      if (!nal_reader_peek_bits_uint8 (nr, &zero_bits, remaining))
+        return FALSE;
+
+      if ((zero_bits - (1 << (remaining - 1))) == 0)
+        return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/* Compute Ceil(Log2(v)) */
+/* Derived from branchless code for integer log2(v) from:
+   <http://graphics.stanford.edu/~seander/bithacks.html#IntegerLog> */
+guint
+ceil_log2 (guint32 v)
+{
+  guint r, shift;
+
+  v--;
+  r = (v > 0xFFFF) << 4;
+  v >>= r;
+  shift = (v > 0xFF) << 3;
+  v >>= shift;
+  r |= shift;
+  shift = (v > 0xF) << 2;
+  v >>= shift;
+  r |= shift;
+  shift = (v > 0x3) << 1;
+  v >>= shift;
+  r |= shift;
+  r |= (v >> 1);
+  return r + 1;
+}
@@ -0,0 +1,234 @@
+/* Gstreamer
+ * Copyright (C) <2011> Intel Corporation
+ * Copyright (C) <2011> Collabora Ltd.
+ * Copyright (C) <2011> Thibault Saunier <thibault.saunier@collabora.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __NAL_UTILS_H__
+#define __NAL_UTILS_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* Reader of the RBSP of a NAL unit, shared by the H.264 and H.265 parsers */
+typedef struct
+{
+  const guint8 *data;
+  guint size;
+
+  guint n_epb;                  /* Number of emulation prevention bytes */
+  guint byte;                   /* Byte position */
+  guint next_epb;               /* There is no emulation prevention byte
+                                 * before this byte position */
+  guint bits_in_cache;          /* Number of bits in the cache */
+  guint64 cache;                /* Cached bits, MSB first, the unused
+                                 * lower bits are 0 */
+} NalReader;
+
+void nal_reader_init (NalReader * nr, const guint8 * data, guint size);
+
+guint nal_reader_find_epb (const NalReader * nr, guint pos);
+
+gboolean nal_reader_skip_to_byte (NalReader * nr);
+
+gboolean nal_reader_get_ue (NalReader * nr, guint32 * val);
+
+gboolean nal_reader_get_se (NalReader * nr, gint32 * val);
+
+gboolean nal_reader_has_more_data (const NalReader * nr);
+
+guint ceil_log2 (guint32 v);
+
+static inline gboolean
+nal_reader_read (NalReader * nr, guint nbits)
+{
+  if (G_LIKELY (nr->bits_in_cache >= nbits))
+    return TRUE;
+
+  if (G_UNLIKELY ((nr->size - nr->byte) * 8 + nr->bits_in_cache < nbits)) {
+    GST_DEBUG ("Can not read %u bits, bits in cache %u, Byte * 8 %u, size in "
+        "bits %u", nbits, nr->bits_in_cache, nr->byte * 8, nr->size * 8);
+    return FALSE;
+  }
+
+  while (nr->bits_in_cache < nbits) {
+    guint n;
+
+    /* as many bytes as fit in the cache without reaching the next
+     * emulation prevention byte are loaded at once */
+    n = MIN ((64 - nr->bits_in_cache) / 8, nr->next_epb - nr->byte);
+    if (G_LIKELY (n > 0 && nr->byte + 8 <= nr->size)) {
+      guint64 bytes;
+
+      bytes = GST_READ_UINT64_BE (nr->data + nr->byte) >> (64 - n * 8);
+      nr->cache |= bytes << (64 - nr->bits_in_cache - n * 8);
+      nr->bits_in_cache += n * 8;
+      nr->byte += n;
+      continue;
+    }
+
+    if (G_UNLIKELY (nr->byte >= nr->size))
+      return FALSE;
+
+    if (nr->byte == nr->next_epb) {
+      /* check if the byte is a emulation_prevention_three_byte, it can also
+       * just be the end of the window looked up */
+      if (nr->byte >= 2 && nr->data[nr->byte] == 0x03 &&
+          nr->data[nr->byte - 1] == 0x00 && nr->data[nr->byte - 2] == 0x00) {
+        nr->n_epb++;
+        nr->byte++;
+      }
+      nr->next_epb = nal_reader_find_epb (nr, nr->byte);
+      continue;
+    }
+
+    /* last bytes of the NAL unit, or a byte right before an emulation
+     * prevention byte */
+    nr->cache |= (guint64) nr->data[nr->byte++] << (56 - nr->bits_in_cache);
+    nr->bits_in_cache += 8;
+  }
+
+  return TRUE;
+}
+
+static inline gboolean
+nal_reader_skip (NalReader * nr, guint nbits)
+{
+  if (G_UNLIKELY (!nal_reader_read (nr, nbits)))
+    return FALSE;
+
+  nr->cache <<= nbits;
+  nr->bits_in_cache -= nbits;
+
+  return TRUE;
+}
+
+static inline guint
+nal_reader_get_pos (const NalReader * nr)
+{
+  return nr->byte * 8 - nr->bits_in_cache;
+}
+
+static inline guint
+nal_reader_get_remaining (const NalReader * nr)
+{
+  return (nr->size - nr->byte) * 8 + nr->bits_in_cache;
+}
+
+static inline guint
+nal_reader_get_epb_count (const NalReader * nr)
+{
+  return nr->n_epb;
+}
+
+#define GST_NAL_READER_READ_BITS(bits) \
+static inline gboolean \
+nal_reader_get_bits_uint##bits (NalReader *nr, guint##bits *val, guint nbits) \
+{ \
+  if (!nal_reader_read (nr, nbits)) \
+    return FALSE; \
+  \
+  /* the required bits are the upper bits of the cache */ \
+  if (G_UNLIKELY (nbits == 0)) { \
+    *val = 0; \
+    return TRUE; \
+  } \
+  *val = nr->cache >> (64 - nbits); \
+  \
+  nr->cache <<= nbits; \
+  nr->bits_in_cache -= nbits; \
+  \
+  return TRUE; \
+} \
+
+GST_NAL_READER_READ_BITS (8);
+GST_NAL_READER_READ_BITS (16);
+GST_NAL_READER_READ_BITS (32);
+
+#define GST_NAL_READER_PEAK_BITS(bits) \
+static inline gboolean \
+nal_reader_peek_bits_uint##bits (const NalReader *nr, guint##bits *val, guint nbits) \
+{ \
+  NalReader tmp; \
+  \
+  tmp = *nr; \
+  return nal_reader_get_bits_uint##bits (&tmp, val, nbits); \
+}
+
+GST_NAL_READER_PEAK_BITS (8);
+
+#define CHECK_ALLOWED(val, min, max) { \
+  if (val < min || val > max) { \
+    GST_WARNING ("value not in allowed range. value: %d, range %d-%d", \
+                     val, min, max); \
+    goto error; \
+  } \
+}
+
+#define READ_UINT8(nr, val, nbits) { \
+  if (!nal_reader_get_bits_uint8 (nr, &val, nbits)) { \
+    GST_WARNING ("failed to read uint8, nbits: %d", nbits); \
+    goto error; \
+  } \
+}
+
+#define READ_UINT16(nr, val, nbits) { \
+  if (!nal_reader_get_bits_uint16 (nr, &val, nbits)) { \
+  GST_WARNING ("failed to read uint16, nbits: %d", nbits); \
+    goto error; \
+  } \
+}
+
+#define READ_UINT32(nr, val, nbits) { \
+  if (!nal_reader_get_bits_uint32 (nr, &val, nbits)) { \
+  GST_WARNING ("failed to read uint32, nbits: %d", nbits); \
+    goto error; \
+  } \
+}
+
+#define READ_UE(nr, val) { \
+  if (!nal_reader_get_ue (nr, &val)) { \
+    GST_WARNING ("failed to read UE"); \
+    goto error; \
+  } \
+}
+
+#define READ_UE_ALLOWED(nr, val, min, max) { \
+  guint32 tmp; \
+  READ_UE (nr, tmp); \
+  CHECK_ALLOWED (tmp, min, max); \
+  val = tmp; \
+}
+
+#define READ_SE(nr, val) { \
+  if (!nal_reader_get_se (nr, &val)) { \
+    GST_WARNING ("failed to read SE"); \
+    goto error; \
+  } \
+}
+
+#define READ_SE_ALLOWED(nr, val, min, max) { \
+  gint32 tmp; \
+  READ_SE (nr, tmp); \
+  CHECK_ALLOWED (tmp, min, max); \
+  val = tmp; \
+}
+
+G_END_DECLS
+#endif /* __NAL_UTILS_H__ */
@@ -0,0 +1,100 @@
+/*
+ * mpeg-crc32-private.h
+ * CRC-32 as used by MPEG-2 systems (ISO/IEC 13818-1 Annex B)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __MPEG_CRC32_PRIVATE_H__
+#define __MPEG_CRC32_PRIVATE_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* Shared by the MPEG-TS demuxers, parsers and muxers to check and compute
+ * PSI section CRCs.
+ *
+ * The CRC is computed 8 bytes at a time ("slice-by-8"): table n holds the
+ * CRC contribution of a byte followed by n zero bytes, which lets the
+ * lookups for 8 input bytes be done independently of each other instead of
+ * forming one long dependency chain. The tables (8KB) are computed on first
+ * use. */
+
+#define MPEG_CRC32_POLYNOMIAL 0x04c11db7
+
+static guint32 mpeg_crc32_tables[8][256];
+
+static inline void
+mpeg_crc32_init_tables (void)
+{
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    guint32 crc;
+    guint i, j;
+
+    for (i = 0; i < 256; i++) {
+      crc = i << 24;
+      for (j = 0; j < 8; j++)
+        crc = (crc & 0x80000000) ? (crc << 1) ^ MPEG_CRC32_POLYNOMIAL :
+            (crc << 1);
+      mpeg_crc32_tables[0][i] = crc;
+    }
+    for (i = 0; i < 256; i++) {
+      crc = mpeg_crc32_tables[0][i];
+      for (j = 1; j < 8; j++) {
+        crc = (crc << 8) ^ mpeg_crc32_tables[0][crc >> 24];
+        mpeg_crc32_tables[j][i] = crc;
+      }
+    }
+
+    g_once_init_leave (&initialized, 1);
+  }
+}
+
+/* Returns the CRC of @length bytes of @data. Computing it over a whole
+ * section, including its CRC_32 field, gives 0 for a valid section */
+static inline guint32
+mpeg_crc32 (const guint8 * data, guint length)
+{
+  guint32 (*t)[256] = mpeg_crc32_tables;
+  guint32 crc = 0xffffffff;
+  guint32 hi, lo;
+
+  mpeg_crc32_init_tables ();
+
+  while (length >= 8) {
+    hi = crc ^ GST_READ_UINT32_BE (data);
+    lo = GST_READ_UINT32_BE (data + 4);
+    crc = t[7][hi >> 24] ^ t[6][(hi >> 16) & 0xff] ^
+        t[5][(hi >> 8) & 0xff] ^ t[4][hi & 0xff] ^
+        t[3][lo >> 24] ^ t[2][(lo >> 16) & 0xff] ^
+        t[1][(lo >> 8) & 0xff] ^ t[0][lo & 0xff];
+    data += 8;
+    length -= 8;
+  }
+
+  while (length--)
+    crc = (crc << 8) ^ t[0][((crc >> 24) ^ *data++) & 0xff];
+
+  return crc;
+}
+
+G_END_DECLS
+
+#endif /* __MPEG_CRC32_PRIVATE_H__ */
@@ -199,6 +199,23 @@ gst_fragment_add_buffer (GstFragment * fragment, GstBuffer * buffer)
   return TRUE;
 }
 
+gboolean
+gst_fragment_account_buffer (GstFragment * fragment, GstBuffer * buffer)
+{
+  g_return_val_if_fail (fragment != NULL, FALSE);
+  g_return_val_if_fail (buffer != NULL, FALSE);
+
+  if (fragment->completed) {
+    GST_WARNING ("Fragment is completed, could not account more buffers");
+    return FALSE;
+  }
+
+  /* The buffer is handed out while the fragment is being downloaded, only
+   * keep track of its size */
+  fragment->priv->accumulated_size += GST_BUFFER_SIZE (buffer);
+  return TRUE;
+}
+
 gsize
 gst_fragment_get_total_size (GstFragment * fragment)
 {
@@ -0,0 +1,266 @@
+/* GStreamer
+ *
+ * gsthlsabr.c:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Bandwidth estimation and variant selection for hlsdemux.
+ *
+ * Every downloaded fragment gives a bandwidth sample, its size divided by its
+ * transfer time. Two estimates are kept from these samples:
+ *   - two moving averages weighted by the transfer time, with half-lives of
+ *     2 and 5 seconds, of which the lowest is used: the fast one reacts
+ *     quickly to drops and the slow one ignores short peaks.
+ *   - the bandwidth of the last fragments, of which a percentile is used.
+ *
+ * The bitrate to switch to is the estimate of the selected policy scaled by
+ * the bitrate limit, adjusted with the amount of data buffered: no switch to
+ * a higher bitrate is done while the buffer is low and no switch to a lower
+ * one while it is high. Switching to a higher bitrate also needs an estimate
+ * above the current bitrate by a margin, to avoid oscillating between two
+ * variants when the bandwidth is close to one of them.
+ *
+ * Nothing here depends on the real time, so the selection can be replayed
+ * from synthetic bandwidth traces. */
+
+#include <math.h>
+#include <string.h>
+
+#include "gstfragmented.h"
+#include "gsthlsabr.h"
+
+#define GST_CAT_DEFAULT fragmented_debug
+
+#define DEFAULT_FAST_HALF_LIFE 2.0
+#define DEFAULT_SLOW_HALF_LIFE 5.0
+#define DEFAULT_BITRATE_LIMIT 0.8
+#define DEFAULT_PERCENTILE 50
+#define DEFAULT_HYSTERESIS 0.1
+#define DEFAULT_LOW_LEVEL (5 * GST_SECOND)
+#define DEFAULT_HIGH_LEVEL (20 * GST_SECOND)
+
+GType
+gst_hls_abr_policy_get_type (void)
+{
+  static GType policy_type = 0;
+  static const GEnumValue policies[] = {
+    {GST_HLS_ABR_POLICY_EWMA, "Lowest of a fast and a slow moving average",
+        "ewma"},
+    {GST_HLS_ABR_POLICY_PERCENTILE,
+        "Percentile of the bandwidth of the last fragments", "percentile"},
+    {0, NULL, NULL}
+  };
+
+  if (!policy_type)
+    policy_type = g_enum_register_static ("GstHLSAbrPolicy", policies);
+
+  return policy_type;
+}
+
+static void
+gst_hls_abr_ewma_init (GstHLSAbrEwma * ewma, gdouble half_life)
+{
+  ewma->half_life = half_life;
+  ewma->estimate = 0;
+  ewma->total_weight = 0;
+}
+
+static void
+gst_hls_abr_ewma_add (GstHLSAbrEwma * ewma, gdouble weight, gdouble value)
+{
+  gdouble alpha = pow (0.5, weight / ewma->half_life);
+
+  ewma->estimate = value * (1 - alpha) + alpha * ewma->estimate;
+  ewma->total_weight += weight;
+}
+
+static gdouble
+gst_hls_abr_ewma_get (GstHLSAbrEwma * ewma)
+{
+  /* The average starts from 0, correct it until enough samples were added
+   * for this to not matter anymore */
+  gdouble zero_factor = 1 - pow (0.5, ewma->total_weight / ewma->half_life);
+
+  if (zero_factor <= 0)
+    return 0;
+
+  return ewma->estimate / zero_factor;
+}
+
+GstHLSAbr *
+gst_hls_abr_new (guint window_size)
+{
+  GstHLSAbr *abr;
+
+  g_return_val_if_fail (window_size > 0, NULL);
+
+  abr = g_new0 (GstHLSAbr, 1);
+  abr->policy = GST_HLS_ABR_POLICY_EWMA;
+  abr->bitrate_limit = DEFAULT_BITRATE_LIMIT;
+  abr->percentile = DEFAULT_PERCENTILE;
+  abr->hysteresis = DEFAULT_HYSTERESIS;
+  abr->low_level = DEFAULT_LOW_LEVEL;
+  abr->high_level = DEFAULT_HIGH_LEVEL;
+  abr->window = g_new0 (guint, window_size);
+  abr->window_size = window_size;
+  gst_hls_abr_reset (abr);
+
+  return abr;
+}
+
+void
+gst_hls_abr_free (GstHLSAbr * abr)
+{
+  g_return_if_fail (abr != NULL);
+
+  g_free (abr->window);
+  g_free (abr);
+}
+
+void
+gst_hls_abr_reset (GstHLSAbr * abr)
+{
+  g_return_if_fail (abr != NULL);
+
+  gst_hls_abr_ewma_init (&abr->fast, DEFAULT_FAST_HALF_LIFE);
+  gst_hls_abr_ewma_init (&abr->slow, DEFAULT_SLOW_HALF_LIFE);
+  abr->n_samples = 0;
+  abr->last_bandwidth = 0;
+}
+
+void
+gst_hls_abr_add_sample (GstHLSAbr * abr, guint64 size,
+    GstClockTime transfer_time)
+{
+  gdouble seconds, bandwidth;
+
+  g_return_if_fail (abr != NULL);
+
+  if (size == 0 || transfer_time == 0 ||
+      !GST_CLOCK_TIME_IS_VALID (transfer_time))
+    return;
+
+  seconds = (gdouble) transfer_time / GST_SECOND;
+  bandwidth = MIN (size * 8 / seconds, G_MAXUINT);
+
+  gst_hls_abr_ewma_add (&abr->fast, seconds, bandwidth);
+  gst_hls_abr_ewma_add (&abr->slow, seconds, bandwidth);
+
+  abr->window[abr->n_samples % abr->window_size] = bandwidth;
+  abr->n_samples++;
+  abr->last_bandwidth = bandwidth;
+
+  GST_LOG ("Downloaded %" G_GUINT64_FORMAT " bytes in %" GST_TIME_FORMAT
+      ": %u bps", size, GST_TIME_ARGS (transfer_time), abr->last_bandwidth);
+}
+
+guint
+gst_hls_abr_get_ewma_estimate (GstHLSAbr * abr)
+{
+  g_return_val_if_fail (abr != NULL, 0);
+
+  return MIN (gst_hls_abr_ewma_get (&abr->fast),
+      gst_hls_abr_ewma_get (&abr->slow)) + 0.5;
+}
+
+static gint
+compare_bandwidth (gconstpointer a, gconstpointer b)
+{
+  guint ua = *(const guint *) a, ub = *(const guint *) b;
+
+  return ua < ub ? -1 : (ua > ub ? 1 : 0);
+}
+
+guint
+gst_hls_abr_get_percentile_estimate (GstHLSAbr * abr)
+{
+  guint *sorted;
+  guint n;
+
+  g_return_val_if_fail (abr != NULL, 0);
+
+  n = MIN (abr->n_samples, abr->window_size);
+  if (n == 0)
+    return 0;
+
+  sorted = g_newa (guint, n);
+  memcpy (sorted, abr->window, n * sizeof (guint));
+  qsort (sorted, n, sizeof (guint), compare_bandwidth);
+
+  return sorted[(n - 1) * abr->percentile / 100];
+}
+
+guint
+gst_hls_abr_get_estimate (GstHLSAbr * abr)
+{
+  g_return_val_if_fail (abr != NULL, 0);
+
+  switch (abr->policy) {
+    case GST_HLS_ABR_POLICY_PERCENTILE:
+      return gst_hls_abr_get_percentile_estimate (abr);
+    case GST_HLS_ABR_POLICY_EWMA:
+    default:
+      return gst_hls_abr_get_ewma_estimate (abr);
+  }
+}
+
+guint
+gst_hls_abr_get_last_bandwidth (GstHLSAbr * abr)
+{
+  g_return_val_if_fail (abr != NULL, 0);
+
+  return abr->last_bandwidth;
+}
+
+/* Returns the maximum bitrate of the variant to use, given the bitrate of the
+ * current one (0 if unknown) and the duration of the data buffered
+ * (GST_CLOCK_TIME_NONE if unknown) */
+guint
+gst_hls_abr_get_target_bitrate (GstHLSAbr * abr, guint current_bitrate,
+    GstClockTime buffer_level)
+{
+  guint target;
+
+  g_return_val_if_fail (abr != NULL, 0);
+
+  if (abr->n_samples == 0)
+    return current_bitrate;
+
+  target = gst_hls_abr_get_estimate (abr) * abr->bitrate_limit;
+  if (current_bitrate == 0)
+    return target;
+
+  if (target > current_bitrate) {
+    if (GST_CLOCK_TIME_IS_VALID (buffer_level)
+        && buffer_level < abr->low_level) {
+      GST_DEBUG ("Buffer level %" GST_TIME_FORMAT " too low to switch up",
+          GST_TIME_ARGS (buffer_level));
+      return current_bitrate;
+    }
+    if (target < current_bitrate * (1 + abr->hysteresis))
+      return current_bitrate;
+  } else if (target < current_bitrate) {
+    if (GST_CLOCK_TIME_IS_VALID (buffer_level)
+        && buffer_level >= abr->high_level) {
+      GST_DEBUG ("Buffer level %" GST_TIME_FORMAT " high enough to not switch"
+          " down", GST_TIME_ARGS (buffer_level));
+      return current_bitrate;
+    }
+  }
+
+  return target;
+}
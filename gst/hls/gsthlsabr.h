@@ -0,0 +1,91 @@
+/* GStreamer
+ *
+ * gsthlsabr.h:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_HLS_ABR_H__
+#define __GST_HLS_ABR_H__
+
+#include <glib.h>
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_HLS_ABR_POLICY (gst_hls_abr_policy_get_type ())
+
+typedef struct _GstHLSAbr GstHLSAbr;
+typedef struct _GstHLSAbrEwma GstHLSAbrEwma;
+
+/**
+ * GstHLSAbrPolicy:
+ * @GST_HLS_ABR_POLICY_EWMA: use the lowest of a fast and a slow moving
+ *     average of the measured bandwidth
+ * @GST_HLS_ABR_POLICY_PERCENTILE: use a percentile of the bandwidth measured
+ *     for the last fragments
+ *
+ * Bandwidth estimate used to select the variant playlists.
+ */
+typedef enum
+{
+  GST_HLS_ABR_POLICY_EWMA,
+  GST_HLS_ABR_POLICY_PERCENTILE
+} GstHLSAbrPolicy;
+
+/* Exponentially weighted moving average, weighted by the transfer time of
+ * the samples */
+struct _GstHLSAbrEwma
+{
+  gdouble half_life;            /* in seconds */
+  gdouble estimate;
+  gdouble total_weight;
+};
+
+struct _GstHLSAbr
+{
+  GstHLSAbrPolicy policy;
+  gfloat bitrate_limit;         /* Part of the bandwidth that can be used */
+  guint percentile;             /* Percentile used by the percentile policy */
+  gfloat hysteresis;            /* Margin needed to switch to higher bitrates */
+  GstClockTime low_level;       /* Below, don't switch to a higher bitrate */
+  GstClockTime high_level;      /* Above, don't switch to a lower bitrate */
+
+  /*< private >*/
+  GstHLSAbrEwma fast;
+  GstHLSAbrEwma slow;
+  guint *window;                /* Bandwidth of the last fragments, in bps */
+  guint window_size;
+  guint n_samples;
+  guint last_bandwidth;
+};
+
+GType gst_hls_abr_policy_get_type (void);
+
+GstHLSAbr * gst_hls_abr_new (guint window_size);
+void gst_hls_abr_free (GstHLSAbr * abr);
+void gst_hls_abr_reset (GstHLSAbr * abr);
+void gst_hls_abr_add_sample (GstHLSAbr * abr, guint64 size,
+                             GstClockTime transfer_time);
+guint gst_hls_abr_get_ewma_estimate (GstHLSAbr * abr);
+guint gst_hls_abr_get_percentile_estimate (GstHLSAbr * abr);
+guint gst_hls_abr_get_estimate (GstHLSAbr * abr);
+guint gst_hls_abr_get_last_bandwidth (GstHLSAbr * abr);
+guint gst_hls_abr_get_target_bitrate (GstHLSAbr * abr, guint current_bitrate,
+                                      GstClockTime buffer_level);
+
+G_END_DECLS
+#endif /* __GST_HLS_ABR_H__ */
@@ -70,6 +70,11 @@ enum
   PROP_FRAGMENTS_CACHE,
   PROP_BITRATE_LIMIT,
   PROP_CONNECTION_SPEED,
+  PROP_CACHE_SIZE,
+  PROP_CACHE_DURATION,
+  PROP_PROGRESSIVE,
+  PROP_MAX_DOWNLOADS,
+  PROP_ABR_POLICY,
   PROP_LAST
 };
 
@@ -79,6 +84,33 @@ static const float update_interval_factor[] = { 1, 0.5, 1.5, 3 };
 #define DEFAULT_FAILED_COUNT 3
 #define DEFAULT_BITRATE_LIMIT 0.8
 #define DEFAULT_CONNECTION_SPEED    0
+#define DEFAULT_CACHE_SIZE 0
+#define DEFAULT_CACHE_DURATION 0
+#define DEFAULT_PROGRESSIVE FALSE
+#define DEFAULT_MAX_DOWNLOADS 1
+#define DEFAULT_ABR_POLICY GST_HLS_ABR_POLICY_EWMA
+
+/* Number of fragments used by the percentile bandwidth estimate */
+#define ABR_WINDOW_SIZE 10
+
+/* Amount of data held back at the start of a fragment in progressive mode
+ * when its type needs to be found */
+#define TYPEFIND_MIN_SIZE 4096
+
+/* A fragment downloaded by the pool of downloaders */
+typedef struct _GstHLSDemuxDownload
+{
+  gchar *uri;
+  gint sequence;
+  GstClockTime duration;
+  GstClockTime timestamp;
+  gboolean discont;
+
+  GstUriDownloader *downloader; /* Downloader fetching the fragment */
+  GstFragment *fragment;        /* The downloaded fragment, NULL on error */
+  gboolean done;
+  gboolean cancelled;           /* Freed by the pool once done */
+} GstHLSDemuxDownload;
 
 /* GObject */
 static void gst_hls_demux_set_property (GObject * object, guint prop_id,
@@ -97,10 +129,16 @@ static gboolean gst_hls_demux_sink_event (GstPad * pad, GstEvent * event);
 static gboolean gst_hls_demux_src_event (GstPad * pad, GstEvent * event);
 static gboolean gst_hls_demux_src_query (GstPad * pad, GstQuery * query);
 static void gst_hls_demux_stream_loop (GstHLSDemux * demux);
+static void gst_hls_demux_progressive_loop (GstHLSDemux * demux);
 static void gst_hls_demux_updates_loop (GstHLSDemux * demux);
 static void gst_hls_demux_stop (GstHLSDemux * demux);
 static void gst_hls_demux_pause_tasks (GstHLSDemux * demux, gboolean caching);
+static gboolean gst_hls_demux_prepare_playlist (GstHLSDemux * demux);
 static gboolean gst_hls_demux_cache_fragments (GstHLSDemux * demux);
+static void gst_hls_demux_clear_pending (GstHLSDemux * demux);
+static void gst_hls_demux_download_func (GstHLSDemuxDownload * download,
+    GstHLSDemux * demux);
+static void gst_hls_demux_cancel_downloads (GstHLSDemux * demux);
 static gboolean gst_hls_demux_schedule (GstHLSDemux * demux);
 static gboolean gst_hls_demux_switch_playlist (GstHLSDemux * demux);
 static gboolean gst_hls_demux_get_next_fragment (GstHLSDemux * demux,
@@ -147,6 +185,7 @@ gst_hls_demux_dispose (GObject * obj)
   if (demux->stream_task) {
     if (GST_TASK_STATE (demux->stream_task) != GST_TASK_STOPPED) {
       GST_DEBUG_OBJECT (demux, "Leaving streaming task");
+      gst_uri_downloader_cancel (demux->stream_downloader);
       gst_task_stop (demux->stream_task);
       g_static_rec_mutex_lock (&demux->stream_lock);
       g_static_rec_mutex_unlock (&demux->stream_lock);
@@ -176,14 +215,38 @@ gst_hls_demux_dispose (GObject * obj)
     demux->updates_task = NULL;
   }
 
+  if (demux->download_pool) {
+    gst_hls_demux_cancel_downloads (demux);
+    g_thread_pool_free (demux->download_pool, FALSE, TRUE);
+    demux->download_pool = NULL;
+  }
+
+  while (!g_queue_is_empty (demux->free_downloaders))
+    g_object_unref (g_queue_pop_head (demux->free_downloaders));
+
   if (demux->downloader != NULL) {
     g_object_unref (demux->downloader);
     demux->downloader = NULL;
   }
 
+  if (demux->stream_downloader != NULL) {
+    g_object_unref (demux->stream_downloader);
+    demux->stream_downloader = NULL;
+  }
+
   gst_hls_demux_reset (demux, TRUE);
 
+  if (demux->abr) {
+    gst_hls_abr_free (demux->abr);
+    demux->abr = NULL;
+  }
+
   g_queue_free (demux->queue);
+  g_queue_free (demux->pending);
+  g_queue_free (demux->downloads);
+  g_queue_free (demux->free_downloaders);
+  g_mutex_free (demux->download_lock);
+  g_cond_free (demux->download_cond);
 
   G_OBJECT_CLASS (parent_class)->dispose (obj);
 }
@@ -220,6 +283,39 @@ gst_hls_demux_class_init (GstHLSDemuxClass * klass)
           0, G_MAXUINT / 1000, DEFAULT_CONNECTION_SPEED,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_CACHE_SIZE,
+      g_param_spec_uint64 ("cache-size", "Cache size",
+          "Amount of data in bytes needed to be cached to start playing "
+          "(0 = use fragments-cache or cache-duration)",
+          0, G_MAXUINT64, DEFAULT_CACHE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_CACHE_DURATION,
+      g_param_spec_uint64 ("cache-duration", "Cache duration",
+          "Amount of data in ns needed to be cached to start playing "
+          "(0 = use fragments-cache or cache-size)",
+          0, G_MAXUINT64, DEFAULT_CACHE_DURATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PROGRESSIVE,
+      g_param_spec_boolean ("progressive", "Progressive",
+          "Push the fragments downstream while they are downloaded instead "
+          "of once they are complete", DEFAULT_PROGRESSIVE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_DOWNLOADS,
+      g_param_spec_uint ("max-downloads", "Max downloads",
+          "Maximum number of fragments downloaded in parallel "
+          "(not used in progressive mode)",
+          1, 16, DEFAULT_MAX_DOWNLOADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_ABR_POLICY,
+      g_param_spec_enum ("abr-policy", "ABR policy",
+          "Bandwidth estimate used to select the variant playlists",
+          GST_TYPE_HLS_ABR_POLICY, DEFAULT_ABR_POLICY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_hls_demux_change_state);
 }
@@ -237,6 +333,7 @@ gst_hls_demux_init (GstHLSDemux * demux, GstHLSDemuxClass * klass)
 
   /* Downloader */
   demux->downloader = gst_uri_downloader_new ();
+  demux->stream_downloader = gst_uri_downloader_new ();
 
   demux->do_typefind = TRUE;
 
@@ -244,8 +341,27 @@ gst_hls_demux_init (GstHLSDemux * demux, GstHLSDemuxClass * klass)
   demux->fragments_cache = DEFAULT_FRAGMENTS_CACHE;
   demux->bitrate_limit = DEFAULT_BITRATE_LIMIT;
   demux->connection_speed = DEFAULT_CONNECTION_SPEED;
+  demux->cache_size = DEFAULT_CACHE_SIZE;
+  demux->cache_duration = DEFAULT_CACHE_DURATION;
+  demux->progressive = DEFAULT_PROGRESSIVE;
+  demux->max_downloads = DEFAULT_MAX_DOWNLOADS;
+
+  /* Bandwidth estimation */
+  demux->abr = gst_hls_abr_new (ABR_WINDOW_SIZE);
+  demux->abr->policy = DEFAULT_ABR_POLICY;
+  demux->abr->bitrate_limit = DEFAULT_BITRATE_LIMIT;
 
   demux->queue = g_queue_new ();
+  demux->pending = g_queue_new ();
+
+  /* Fragments downloads */
+  demux->downloads = g_queue_new ();
+  demux->free_downloaders = g_queue_new ();
+  demux->download_lock = g_mutex_new ();
+  demux->download_cond = g_cond_new ();
+  demux->download_pool =
+      g_thread_pool_new ((GFunc) gst_hls_demux_download_func, demux, -1,
+      FALSE, NULL);
 
   /* Updates task */
   g_static_rec_mutex_init (&demux->updates_lock);
@@ -273,10 +389,26 @@ gst_hls_demux_set_property (GObject * object, guint prop_id,
       break;
     case PROP_BITRATE_LIMIT:
       demux->bitrate_limit = g_value_get_float (value);
+      demux->abr->bitrate_limit = demux->bitrate_limit;
       break;
     case PROP_CONNECTION_SPEED:
       demux->connection_speed = g_value_get_uint (value) * 1000;
       break;
+    case PROP_CACHE_SIZE:
+      demux->cache_size = g_value_get_uint64 (value);
+      break;
+    case PROP_CACHE_DURATION:
+      demux->cache_duration = g_value_get_uint64 (value);
+      break;
+    case PROP_PROGRESSIVE:
+      demux->progressive = g_value_get_boolean (value);
+      break;
+    case PROP_MAX_DOWNLOADS:
+      demux->max_downloads = g_value_get_uint (value);
+      break;
+    case PROP_ABR_POLICY:
+      demux->abr->policy = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -299,6 +431,21 @@ gst_hls_demux_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_CONNECTION_SPEED:
       g_value_set_uint (value, demux->connection_speed / 1000);
       break;
+    case PROP_CACHE_SIZE:
+      g_value_set_uint64 (value, demux->cache_size);
+      break;
+    case PROP_CACHE_DURATION:
+      g_value_set_uint64 (value, demux->cache_duration);
+      break;
+    case PROP_PROGRESSIVE:
+      g_value_set_boolean (value, demux->progressive);
+      break;
+    case PROP_MAX_DOWNLOADS:
+      g_value_set_uint (value, demux->max_downloads);
+      break;
+    case PROP_ABR_POLICY:
+      g_value_set_enum (value, demux->abr->policy);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -333,6 +480,7 @@ gst_hls_demux_change_state (GstElement * element, GstStateChange transition)
     case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
       demux->cancelled = TRUE;
       gst_uri_downloader_cancel (demux->downloader);
+      gst_hls_demux_cancel_downloads (demux);
       gst_task_stop (demux->updates_task);
       g_mutex_lock (demux->updates_timed_lock);
       GST_TASK_SIGNAL (demux->updates_task);
@@ -340,6 +488,7 @@ gst_hls_demux_change_state (GstElement * element, GstStateChange transition)
       g_static_rec_mutex_lock (&demux->updates_lock);
       g_static_rec_mutex_unlock (&demux->updates_lock);
       demux->cancelled = FALSE;
+      gst_uri_downloader_reset (demux->downloader);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_READY:
       demux->cancelled = TRUE;
@@ -420,6 +569,8 @@ gst_hls_demux_src_event (GstPad * pad, GstEvent * event)
       demux->cancelled = TRUE;
       gst_task_pause (demux->stream_task);
       gst_uri_downloader_cancel (demux->downloader);
+      gst_uri_downloader_cancel (demux->stream_downloader);
+      gst_hls_demux_cancel_downloads (demux);
       gst_task_stop (demux->updates_task);
       g_mutex_lock (demux->updates_timed_lock);
       GST_TASK_SIGNAL (demux->updates_task);
@@ -433,10 +584,11 @@ gst_hls_demux_src_event (GstPad * pad, GstEvent * event)
 
       demux->need_cache = TRUE;
       while (!g_queue_is_empty (demux->queue)) {
-        GstBufferList *buf_list = g_queue_pop_head (demux->queue);
-        gst_buffer_list_unref (buf_list);
+        GstFragment *fragment = g_queue_pop_head (demux->queue);
+        g_object_unref (fragment);
       }
       g_queue_clear (demux->queue);
+      gst_hls_demux_clear_pending (demux);
 
       GST_M3U8_CLIENT_LOCK (demux->client);
       GST_DEBUG_OBJECT (demux, "seeking to sequence %d", current_sequence);
@@ -453,6 +605,8 @@ gst_hls_demux_src_event (GstPad * pad, GstEvent * event)
       }
 
       demux->cancelled = FALSE;
+      gst_uri_downloader_reset (demux->downloader);
+      gst_uri_downloader_reset (demux->stream_downloader);
       gst_task_start (demux->stream_task);
       g_static_rec_mutex_unlock (&demux->stream_lock);
 
@@ -626,6 +780,7 @@ gst_hls_demux_pause_tasks (GstHLSDemux * demux, gboolean caching)
   if (GST_TASK_STATE (demux->updates_task) != GST_TASK_STOPPED) {
     demux->cancelled = TRUE;
     gst_uri_downloader_cancel (demux->downloader);
+    gst_hls_demux_cancel_downloads (demux);
     gst_task_pause (demux->updates_task);
     if (!caching)
       g_mutex_lock (demux->updates_timed_lock);
@@ -644,6 +799,8 @@ static void
 gst_hls_demux_stop (GstHLSDemux * demux)
 {
   gst_uri_downloader_cancel (demux->downloader);
+  gst_uri_downloader_cancel (demux->stream_downloader);
+  gst_hls_demux_cancel_downloads (demux);
 
   if (GST_TASK_STATE (demux->updates_task) != GST_TASK_STOPPED) {
     demux->cancelled = TRUE;
@@ -705,6 +862,33 @@ switch_pads (GstHLSDemux * demux, GstCaps * newcaps)
   }
 }
 
+static void
+gst_hls_demux_configure_src_pad (GstHLSDemux * demux, GstBuffer * buf)
+{
+  /* Figure out if we need to create/switch pads */
+  if (G_UNLIKELY (!demux->srcpad
+          || !gst_caps_is_equal_fixed (GST_BUFFER_CAPS (buf),
+              GST_PAD_CAPS (demux->srcpad))
+          || demux->need_segment)) {
+    switch_pads (demux, GST_BUFFER_CAPS (buf));
+    demux->need_segment = TRUE;
+  }
+
+  if (demux->need_segment) {
+    GstClockTime start = GST_BUFFER_TIMESTAMP (buf);
+
+    start += demux->position_shift;
+    /* And send a newsegment */
+    GST_DEBUG_OBJECT (demux, "Sending new-segment. segment start:%"
+        GST_TIME_FORMAT, GST_TIME_ARGS (start));
+    gst_pad_push_event (demux->srcpad,
+        gst_event_new_new_segment (FALSE, 1.0, GST_FORMAT_TIME,
+            start, GST_CLOCK_TIME_NONE, start));
+    demux->need_segment = FALSE;
+    demux->position_shift = 0;
+  }
+}
+
 static void
 gst_hls_demux_stream_loop (GstHLSDemux * demux)
 {
@@ -719,6 +903,11 @@ gst_hls_demux_stream_loop (GstHLSDemux * demux)
    * queue. This task is woken up when we push a new fragment to the queue or
    * when we reached the end of the playlist  */
 
+  if (demux->progressive) {
+    gst_hls_demux_progressive_loop (demux);
+    return;
+  }
+
   if (G_UNLIKELY (demux->need_cache)) {
     if (!gst_hls_demux_cache_fragments (demux))
       goto cache_error;
@@ -740,30 +929,9 @@ gst_hls_demux_stream_loop (GstHLSDemux * demux)
   buffer_list = gst_fragment_get_buffer_list (fragment);
   /* Work with the first buffer of the list */
   buf = gst_buffer_list_get (buffer_list, 0, 0);
-
-  /* Figure out if we need to create/switch pads */
-  if (G_UNLIKELY (!demux->srcpad
-          || !gst_caps_is_equal_fixed (GST_BUFFER_CAPS (buf),
-              GST_PAD_CAPS (demux->srcpad))
-          || demux->need_segment)) {
-    switch_pads (demux, GST_BUFFER_CAPS (buf));
-    demux->need_segment = TRUE;
-  }
   g_object_unref (fragment);
 
-  if (demux->need_segment) {
-    GstClockTime start = GST_BUFFER_TIMESTAMP (buf);
-
-    start += demux->position_shift;
-    /* And send a newsegment */
-    GST_DEBUG_OBJECT (demux, "Sending new-segment. segment start:%"
-        GST_TIME_FORMAT, GST_TIME_ARGS (start));
-    gst_pad_push_event (demux->srcpad,
-        gst_event_new_new_segment (FALSE, 1.0, GST_FORMAT_TIME,
-            start, GST_CLOCK_TIME_NONE, start));
-    demux->need_segment = FALSE;
-    demux->position_shift = 0;
-  }
+  gst_hls_demux_configure_src_pad (demux, buf);
 
   ret = gst_pad_push_list (demux->srcpad, buffer_list);
   if (ret != GST_FLOW_OK)
@@ -811,6 +979,429 @@ pause_task:
   }
 }
 
+static gboolean
+gst_hls_demux_cache_filled (GstHLSDemux * demux)
+{
+  /* The cache is counted in whole fragments unless a size or a duration
+   * was set, in which case reaching any of them is enough */
+  if (demux->cache_size == 0 && demux->cache_duration == 0)
+    return demux->cached_fragments >= demux->fragments_cache;
+
+  if (demux->cache_size != 0 && demux->cached_bytes >= demux->cache_size)
+    return TRUE;
+  if (demux->cache_duration != 0
+      && demux->cached_time >= demux->cache_duration)
+    return TRUE;
+
+  return FALSE;
+}
+
+static gint
+gst_hls_demux_cache_percent (GstHLSDemux * demux)
+{
+  guint64 percent = 0;
+
+  if (demux->cache_size == 0 && demux->cache_duration == 0)
+    return MIN (100 * demux->cached_fragments / demux->fragments_cache, 100);
+
+  if (demux->cache_size != 0)
+    percent = MAX (percent, 100 * demux->cached_bytes / demux->cache_size);
+  if (demux->cache_duration != 0)
+    percent = MAX (percent, 100 * demux->cached_time / demux->cache_duration);
+
+  return MIN (percent, 100);
+}
+
+static void
+gst_hls_demux_reset_cache (GstHLSDemux * demux)
+{
+  demux->cached_fragments = 0;
+  demux->cached_bytes = 0;
+  demux->cached_time = 0;
+}
+
+static void
+gst_hls_demux_clear_pending (GstHLSDemux * demux)
+{
+  GstBuffer *buf;
+
+  while ((buf = g_queue_pop_head (demux->pending)))
+    gst_buffer_unref (buf);
+
+  if (demux->fragment_head) {
+    gst_buffer_unref (demux->fragment_head);
+    demux->fragment_head = NULL;
+  }
+  demux->fragment_truncated = FALSE;
+  demux->caching = FALSE;
+}
+
+static void
+gst_hls_demux_typefind (GstHLSDemux * demux, GstBuffer * buf)
+{
+  /* We actually need to do this every time we switch bitrate */
+  if (G_UNLIKELY (demux->do_typefind)) {
+    GstCaps *caps = gst_type_find_helper_for_buffer (NULL, buf, NULL);
+
+    if (caps == NULL) {
+      GST_WARNING_OBJECT (demux, "Could not find the type of the fragment");
+      return;
+    }
+
+    if (!demux->input_caps || !gst_caps_is_equal (caps, demux->input_caps)) {
+      gst_caps_replace (&demux->input_caps, caps);
+      /* gst_pad_set_caps (demux->srcpad, demux->input_caps); */
+      GST_INFO_OBJECT (demux, "Input source caps: %" GST_PTR_FORMAT,
+          demux->input_caps);
+      demux->do_typefind = FALSE;
+    }
+    gst_caps_unref (caps);
+  }
+}
+
+/* Accounts for @size more bytes of the fragment being downloaded in
+ * progressive mode. The duration of a partial fragment is estimated from the
+ * byte rate of the previous one, or from the bandwidth of the variant for the
+ * first one */
+static void
+gst_hls_demux_account_data (GstHLSDemux * demux, guint size,
+    gboolean complete)
+{
+  GstClockTime estimate = 0;
+  gint percent;
+
+  percent = gst_hls_demux_cache_percent (demux);
+
+  demux->fragment_bytes += size;
+  demux->cached_bytes += size;
+  if (complete) {
+    estimate = demux->fragment_duration;
+    demux->cached_fragments++;
+  } else if (demux->byte_rate != 0) {
+    estimate = gst_util_uint64_scale (demux->fragment_bytes, GST_SECOND,
+        demux->byte_rate);
+    estimate = MIN (estimate, demux->fragment_duration);
+  }
+  demux->cached_time += estimate - demux->fragment_cached_time;
+  demux->fragment_cached_time = estimate;
+
+  if (demux->caching && percent != gst_hls_demux_cache_percent (demux)
+      && !gst_hls_demux_cache_filled (demux))
+    gst_element_post_message (GST_ELEMENT (demux),
+        gst_message_new_buffering (GST_OBJECT (demux),
+            gst_hls_demux_cache_percent (demux)));
+}
+
+static GstFlowReturn
+gst_hls_demux_push (GstHLSDemux * demux, GstBuffer * buf)
+{
+  /* Only the first buffer of a fragment is timestamped and can start a new
+   * segment */
+  if (GST_BUFFER_TIMESTAMP_IS_VALID (buf)) {
+    if (G_UNLIKELY (GST_BUFFER_CAPS (buf) == NULL)) {
+      GST_WARNING_OBJECT (demux, "No caps for the fragment, dropping it");
+      gst_buffer_unref (buf);
+      return GST_FLOW_NOT_NEGOTIATED;
+    }
+    gst_hls_demux_configure_src_pad (demux, buf);
+  }
+
+  return gst_pad_push (demux->srcpad, buf);
+}
+
+static GstFlowReturn
+gst_hls_demux_flush_pending (GstHLSDemux * demux)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstBuffer *buf;
+
+  GST_INFO_OBJECT (demux, "Cache filled with %u bytes (%" GST_TIME_FORMAT
+      ")", (guint) demux->cached_bytes, GST_TIME_ARGS (demux->cached_time));
+  gst_element_post_message (GST_ELEMENT (demux),
+      gst_message_new_buffering (GST_OBJECT (demux), 100));
+  demux->caching = FALSE;
+
+  while ((buf = g_queue_pop_head (demux->pending))) {
+    if (ret == GST_FLOW_OK)
+      ret = gst_hls_demux_push (demux, buf);
+    else
+      gst_buffer_unref (buf);
+  }
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_hls_demux_deliver (GstHLSDemux * demux, GstBuffer * buf)
+{
+  GstClockTime start;
+  GstFlowReturn ret;
+
+  if (demux->caching) {
+    g_queue_push_tail (demux->pending, buf);
+    if (!gst_hls_demux_cache_filled (demux))
+      return GST_FLOW_OK;
+    buf = NULL;
+  }
+
+  start = gst_util_get_timestamp ();
+  if (buf)
+    ret = gst_hls_demux_push (demux, buf);
+  else
+    ret = gst_hls_demux_flush_pending (demux);
+  demux->push_time += gst_util_get_timestamp () - start;
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_hls_demux_deliver_head (GstHLSDemux * demux)
+{
+  GstBuffer *buf;
+
+  buf = gst_buffer_make_metadata_writable (demux->fragment_head);
+  demux->fragment_head = NULL;
+
+  GST_BUFFER_DURATION (buf) = demux->fragment_duration;
+  GST_BUFFER_TIMESTAMP (buf) = demux->fragment_timestamp;
+  gst_hls_demux_typefind (demux, buf);
+  gst_buffer_set_caps (buf, demux->input_caps);
+
+  if (demux->fragment_discont) {
+    GST_DEBUG_OBJECT (demux, "Marking fragment as discontinuous");
+    GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
+  }
+
+  return gst_hls_demux_deliver (demux, buf);
+}
+
+static gboolean
+gst_hls_demux_fragment_chunk (GstUriDownloader * downloader, GstBuffer * buf,
+    gpointer user_data)
+{
+  GstHLSDemux *demux = GST_HLS_DEMUX (user_data);
+  gboolean first;
+
+  first = (demux->fragment_bytes == 0 || demux->fragment_head != NULL);
+  gst_hls_demux_account_data (demux, GST_BUFFER_SIZE (buf), FALSE);
+
+  if (G_LIKELY (!first)) {
+    demux->last_ret = gst_hls_demux_deliver (demux, buf);
+    return demux->last_ret == GST_FLOW_OK;
+  }
+
+  /* Hold back the start of the fragment until there is enough of it to find
+   * its type */
+  if (demux->fragment_head)
+    demux->fragment_head = gst_buffer_join (demux->fragment_head, buf);
+  else
+    demux->fragment_head = buf;
+
+  if (demux->do_typefind
+      && GST_BUFFER_SIZE (demux->fragment_head) < TYPEFIND_MIN_SIZE)
+    return TRUE;
+
+  demux->last_ret = gst_hls_demux_deliver_head (demux);
+  return demux->last_ret == GST_FLOW_OK;
+}
+
+static GstFlowReturn
+gst_hls_demux_finish_fragment (GstHLSDemux * demux, GstFragment * download)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstClockTime download_time;
+
+  /* Fragment smaller than what we wanted for typefinding */
+  if (demux->fragment_head)
+    ret = gst_hls_demux_deliver_head (demux);
+
+  gst_hls_demux_account_data (demux, 0, TRUE);
+  if (demux->fragment_duration > 0)
+    demux->byte_rate = gst_util_uint64_scale (demux->fragment_bytes,
+        GST_SECOND, demux->fragment_duration);
+
+  /* The download time doesn't include the time spent blocked pushing the
+   * data downstream, which is not related to the available bandwidth */
+  download_time = download->download_stop_time -
+      download->download_start_time;
+  demux->download_time = download_time > demux->push_time ?
+      download_time - demux->push_time : 0;
+
+  if (ret == GST_FLOW_OK && demux->caching
+      && gst_hls_demux_cache_filled (demux))
+    ret = gst_hls_demux_flush_pending (demux);
+
+  return ret;
+}
+
+static void
+gst_hls_demux_progressive_loop (GstHLSDemux * demux)
+{
+  GstFragment *download;
+  const gchar *next_fragment_uri;
+  gchar *uri;
+  GstClockTime duration;
+  GstClockTime timestamp;
+  gboolean discont, truncated;
+  gint sequence;
+  GstFlowReturn ret;
+
+  /* In progressive mode the streaming task downloads the fragments itself and
+   * pushes their data as soon as it is received, once enough of it has been
+   * cached. The updates task only refreshes live playlists and wakes this
+   * task up when they might have new fragments */
+
+  if (G_UNLIKELY (demux->need_cache)) {
+    if (!gst_hls_demux_prepare_playlist (demux))
+      goto cache_error;
+
+    GST_M3U8_CLIENT_LOCK (demux->client);
+    if (demux->client->current)
+      demux->byte_rate = demux->client->current->bandwidth / 8;
+    GST_M3U8_CLIENT_UNLOCK (demux->client);
+
+    gst_hls_demux_reset_cache (demux);
+    demux->caching = TRUE;
+    demux->need_cache = FALSE;
+    gst_element_post_message (GST_ELEMENT (demux),
+        gst_message_new_buffering (GST_OBJECT (demux), 0));
+
+    g_get_current_time (&demux->next_update);
+    if (GST_STATE (demux) == GST_STATE_PLAYING)
+      gst_task_start (demux->updates_task);
+  }
+
+  if (!gst_m3u8_client_get_next_fragment (demux->client, &discont,
+          &next_fragment_uri, &duration, &timestamp)) {
+    if (gst_m3u8_client_is_live (demux->client)) {
+      GST_DEBUG_OBJECT (demux, "Waiting for the playlist to be updated");
+      goto pause_task;
+    }
+    goto end_of_playlist;
+  }
+
+  /* The playlist might be updated while we are downloading */
+  uri = g_strdup (next_fragment_uri);
+  GST_M3U8_CLIENT_LOCK (demux->client);
+  sequence = demux->client->sequence - 1;
+  GST_M3U8_CLIENT_UNLOCK (demux->client);
+  GST_INFO_OBJECT (demux, "Fetching next fragment %s", uri);
+
+  demux->fragment_timestamp = timestamp;
+  demux->fragment_duration = duration;
+  demux->fragment_discont = discont || demux->fragment_truncated;
+  demux->fragment_truncated = FALSE;
+  demux->fragment_bytes = 0;
+  demux->fragment_cached_time = 0;
+  demux->push_time = 0;
+  demux->last_ret = GST_FLOW_OK;
+
+  download = gst_uri_downloader_fetch_uri_progressive
+      (demux->stream_downloader, uri, gst_hls_demux_fragment_chunk, demux);
+  g_free (uri);
+
+  if (demux->last_ret != GST_FLOW_OK) {
+    ret = demux->last_ret;
+    if (download)
+      g_object_unref (download);
+    goto error_pushing;
+  }
+
+  if (download == NULL) {
+    /* If the download failed before any of the fragment was handed out, the
+     * fragment is fetched again from the start on the next iteration.
+     * Otherwise the data already pushed can't be taken back and fetching
+     * the fragment again would duplicate it, so the rest of the fragment is
+     * skipped and the next one is marked as discontinuous */
+    truncated = demux->fragment_bytes > 0 && demux->fragment_head == NULL;
+    if (demux->fragment_head) {
+      gst_buffer_unref (demux->fragment_head);
+      demux->fragment_head = NULL;
+    }
+    if (demux->cancelled)
+      goto pause_task;
+
+    if (truncated) {
+      GST_WARNING_OBJECT (demux, "Fragment truncated after %" G_GUINT64_FORMAT
+          " bytes, skipping the rest of it", demux->fragment_bytes);
+      demux->fragment_truncated = TRUE;
+    } else {
+      demux->cached_bytes -= demux->fragment_bytes;
+      demux->cached_time -= demux->fragment_cached_time;
+      GST_M3U8_CLIENT_LOCK (demux->client);
+      demux->client->sequence = sequence;
+      GST_M3U8_CLIENT_UNLOCK (demux->client);
+    }
+
+    demux->client->update_failed_count++;
+    if (demux->client->update_failed_count < DEFAULT_FAILED_COUNT) {
+      GST_WARNING_OBJECT (demux, "Could not fetch the next fragment");
+      return;
+    }
+    GST_ELEMENT_ERROR (demux, RESOURCE, NOT_FOUND,
+        ("Could not fetch the next fragment"), (NULL));
+    gst_hls_demux_pause_tasks (demux, FALSE);
+    return;
+  }
+  demux->client->update_failed_count = 0;
+
+  ret = gst_hls_demux_finish_fragment (demux, download);
+  g_object_unref (download);
+  if (ret != GST_FLOW_OK)
+    goto error_pushing;
+
+  /* try to switch to another bitrate if needed */
+  gst_hls_demux_switch_playlist (demux);
+  return;
+
+end_of_playlist:
+  {
+    GST_DEBUG_OBJECT (demux, "Reached end of playlist, sending EOS");
+    demux->end_of_playlist = TRUE;
+    if (demux->caching) {
+      ret = gst_hls_demux_flush_pending (demux);
+      if (ret != GST_FLOW_OK)
+        goto error_pushing;
+    }
+    if (demux->srcpad)
+      gst_pad_push_event (demux->srcpad, gst_event_new_eos ());
+    gst_hls_demux_pause_tasks (demux, FALSE);
+    return;
+  }
+
+cache_error:
+  {
+    gst_task_pause (demux->stream_task);
+    if (!demux->cancelled) {
+      GST_ELEMENT_ERROR (demux, RESOURCE, NOT_FOUND,
+          ("Could not cache the first fragments"), (NULL));
+      gst_hls_demux_pause_tasks (demux, FALSE);
+    }
+    return;
+  }
+
+error_pushing:
+  {
+    if (ret == GST_FLOW_NOT_LINKED || ret < GST_FLOW_UNEXPECTED) {
+      GST_ELEMENT_ERROR (demux, STREAM, FAILED, (NULL),
+          ("stream stopped, reason %s", gst_flow_get_name (ret)));
+      if (demux->srcpad)
+        gst_pad_push_event (demux->srcpad, gst_event_new_eos ());
+    } else {
+      GST_DEBUG_OBJECT (demux, "stream stopped, reason %s",
+          gst_flow_get_name (ret));
+    }
+    gst_hls_demux_pause_tasks (demux, FALSE);
+    return;
+  }
+
+pause_task:
+  {
+    gst_task_pause (demux->stream_task);
+    return;
+  }
+}
+
 static void
 gst_hls_demux_reset (GstHLSDemux * demux, gboolean dispose)
 {
@@ -829,6 +1420,8 @@ gst_hls_demux_reset (GstHLSDemux * demux, gboolean dispose)
     demux->playlist = NULL;
   }
 
+  gst_hls_demux_cancel_downloads (demux);
+
   if (demux->client) {
     gst_m3u8_client_free (demux->client);
     demux->client = NULL;
@@ -836,6 +1429,8 @@ gst_hls_demux_reset (GstHLSDemux * demux, gboolean dispose)
 
   if (!dispose) {
     demux->client = gst_m3u8_client_new ("");
+    gst_uri_downloader_reset (demux->downloader);
+    gst_uri_downloader_reset (demux->stream_downloader);
   }
 
   while (!g_queue_is_empty (demux->queue)) {
@@ -843,6 +1438,11 @@ gst_hls_demux_reset (GstHLSDemux * demux, gboolean dispose)
     g_object_unref (fragment);
   }
   g_queue_clear (demux->queue);
+  gst_hls_demux_clear_pending (demux);
+  gst_hls_demux_reset_cache (demux);
+  demux->byte_rate = 0;
+  if (demux->abr)
+    gst_hls_abr_reset (demux->abr);
 
   demux->position_shift = 0;
   demux->need_segment = TRUE;
@@ -916,6 +1516,13 @@ gst_hls_demux_updates_loop (GstHLSDemux * demux)
     if (demux->cancelled)
       goto quit;
 
+    /* the streaming task fetches the fragments itself in progressive mode,
+     * wake it up in case it was waiting for new ones */
+    if (demux->progressive) {
+      gst_task_start (demux->stream_task);
+      continue;
+    }
+
     /* fetch the next fragment */
     if (g_queue_is_empty (demux->queue)) {
       if (!gst_hls_demux_get_next_fragment (demux, FALSE)) {
@@ -960,10 +1567,8 @@ error:
 }
 
 static gboolean
-gst_hls_demux_cache_fragments (GstHLSDemux * demux)
+gst_hls_demux_prepare_playlist (GstHLSDemux * demux)
 {
-  gint i;
-
   /* If this playlist is a variant playlist, select the first one
    * and update it */
   if (gst_m3u8_client_has_variant_playlist (demux->client)) {
@@ -1000,11 +1605,23 @@ gst_hls_demux_cache_fragments (GstHLSDemux * demux)
               GST_FORMAT_TIME, duration));
   }
 
+  return TRUE;
+}
+
+static gboolean
+gst_hls_demux_cache_fragments (GstHLSDemux * demux)
+{
+  GstFragment *fragment;
+
+  if (!gst_hls_demux_prepare_playlist (demux))
+    return FALSE;
+
   /* Cache the first fragments */
-  for (i = 0; i < demux->fragments_cache; i++) {
+  gst_hls_demux_reset_cache (demux);
+  while (!gst_hls_demux_cache_filled (demux)) {
     gst_element_post_message (GST_ELEMENT (demux),
         gst_message_new_buffering (GST_OBJECT (demux),
-            100 * i / demux->fragments_cache));
+            gst_hls_demux_cache_percent (demux)));
     g_get_current_time (&demux->next_update);
     if (!gst_hls_demux_get_next_fragment (demux, TRUE)) {
       if (demux->end_of_playlist)
@@ -1017,6 +1634,11 @@ gst_hls_demux_cache_fragments (GstHLSDemux * demux)
     if (demux->cancelled)
       return FALSE;
 
+    fragment = g_queue_peek_tail (demux->queue);
+    demux->cached_fragments++;
+    demux->cached_bytes += gst_fragment_get_total_size (fragment);
+    demux->cached_time += fragment->stop_time - fragment->start_time;
+
     gst_hls_demux_switch_playlist (demux);
   }
   gst_element_post_message (GST_ELEMENT (demux),
@@ -1134,6 +1756,9 @@ retry_failover_protection:
     return TRUE;
   }
 
+  /* The fragments being downloaded belong to the previous variant */
+  gst_hls_demux_cancel_downloads (demux);
+
   demux->client->main->current_variant = current_variant;
   GST_M3U8_CLIENT_UNLOCK (demux->client);
 
@@ -1147,7 +1772,8 @@ retry_failover_protection:
 
     s = gst_structure_new ("playlist",
         "uri", G_TYPE_STRING, gst_m3u8_client_get_current_uri (demux->client),
-        "bitrate", G_TYPE_INT, new_bandwidth, NULL);
+        "bitrate", G_TYPE_INT, new_bandwidth,
+        "previous-bitrate", G_TYPE_INT, old_bandwidth, NULL);
     gst_element_post_message (GST_ELEMENT_CAST (demux),
         gst_message_new_element (GST_OBJECT_CAST (demux), s));
   } else {
@@ -1208,86 +1834,273 @@ gst_hls_demux_schedule (GstHLSDemux * demux)
   return TRUE;
 }
 
+/* Duration of the data fetched but not played yet, GST_CLOCK_TIME_NONE if the
+ * playback position is unknown */
+static GstClockTime
+gst_hls_demux_get_buffer_level (GstHLSDemux * demux)
+{
+  GstFormat format = GST_FORMAT_TIME;
+  GstClockTime end;
+  gint64 position;
+
+  if (demux->progressive) {
+    end = demux->fragment_timestamp + demux->fragment_duration;
+  } else {
+    GstFragment *fragment = g_queue_peek_tail (demux->queue);
+
+    if (fragment == NULL)
+      return GST_CLOCK_TIME_NONE;
+    end = fragment->stop_time;
+  }
+
+  if (!demux->srcpad || !gst_pad_query_peer_position (demux->srcpad, &format,
+          &position) || format != GST_FORMAT_TIME || position < 0)
+    return GST_CLOCK_TIME_NONE;
+
+  return end > position ? end - position : 0;
+}
+
 static gboolean
 gst_hls_demux_switch_playlist (GstHLSDemux * demux)
 {
-  GTimeVal now;
-  GstClockTime diff;
-  gsize size;
-  gint bitrate;
-  GstFragment *fragment = g_queue_peek_tail (demux->queue);
+  GstClockTime diff, buffer_level, target_duration;
+  GstStructure *s;
+  guint64 size;
+  guint current_bitrate, target_bitrate;
 
   GST_M3U8_CLIENT_LOCK (demux->client);
   if (!demux->client->main->lists) {
     GST_M3U8_CLIENT_UNLOCK (demux->client);
     return TRUE;
   }
+  current_bitrate = demux->client->current->bandwidth;
   GST_M3U8_CLIENT_UNLOCK (demux->client);
 
-  /* compare the time when the fragment was downloaded with the time when it was
-   * scheduled */
-  g_get_current_time (&now);
-  diff = (GST_TIMEVAL_TO_TIME (now) - GST_TIMEVAL_TO_TIME (demux->next_update));
-  size = gst_fragment_get_total_size (fragment);
-  bitrate = (size * 8) / ((double) diff / GST_SECOND);
+  if (demux->progressive) {
+    /* the fragment was pushed while it was downloaded, only the time spent
+     * receiving it is meaningful */
+    diff = demux->download_time;
+    size = demux->fragment_bytes;
+  } else {
+    /* use the time the fragment took to be transferred, not the time since
+     * it was scheduled which includes the time spent waiting for it to be
+     * downloaded and the playlist updates */
+    GstFragment *fragment = g_queue_peek_tail (demux->queue);
 
-  GST_DEBUG ("Downloaded %" G_GSIZE_FORMAT " bytes in %" GST_TIME_FORMAT
-      ". Bitrate is : %d", size, GST_TIME_ARGS (diff), bitrate);
+    diff = fragment->download_stop_time - fragment->download_start_time;
+    size = gst_fragment_get_total_size (fragment);
+  }
+  if (diff == 0 || size == 0)
+    return TRUE;
+
+  gst_hls_abr_add_sample (demux->abr, size, diff);
+
+  /* don't switch to a higher bitrate with less than a fragment buffered and
+   * stop switching to lower ones once a few are */
+  target_duration = gst_m3u8_client_get_target_duration (demux->client);
+  if (GST_CLOCK_TIME_IS_VALID (target_duration) && target_duration > 0) {
+    demux->abr->low_level = target_duration;
+    demux->abr->high_level = 3 * target_duration;
+  }
+  buffer_level = gst_hls_demux_get_buffer_level (demux);
+  target_bitrate = gst_hls_abr_get_target_bitrate (demux->abr,
+      current_bitrate, buffer_level);
+
+  GST_DEBUG_OBJECT (demux, "Downloaded %" G_GUINT64_FORMAT " bytes in %"
+      GST_TIME_FORMAT ". Bitrate is %u, estimate %u, buffer level %"
+      GST_TIME_FORMAT ", target bitrate %u", size, GST_TIME_ARGS (diff),
+      gst_hls_abr_get_last_bandwidth (demux->abr),
+      gst_hls_abr_get_estimate (demux->abr), GST_TIME_ARGS (buffer_level),
+      target_bitrate);
+
+  s = gst_structure_new ("hls-abr",
+      "size", G_TYPE_UINT64, size,
+      "transfer-time", G_TYPE_UINT64, diff,
+      "bandwidth", G_TYPE_UINT, gst_hls_abr_get_last_bandwidth (demux->abr),
+      "ewma", G_TYPE_UINT, gst_hls_abr_get_ewma_estimate (demux->abr),
+      "percentile", G_TYPE_UINT,
+      gst_hls_abr_get_percentile_estimate (demux->abr),
+      "buffer-level", G_TYPE_UINT64, buffer_level,
+      "current-bitrate", G_TYPE_UINT, current_bitrate,
+      "target-bitrate", G_TYPE_UINT, target_bitrate, NULL);
+  gst_element_post_message (GST_ELEMENT_CAST (demux),
+      gst_message_new_element (GST_OBJECT_CAST (demux), s));
+
+  /* The target already includes the bitrate limit and the hysteresis */
+  if (target_bitrate == current_bitrate)
+    return TRUE;
 
-  return gst_hls_demux_change_playlist (demux, bitrate * demux->bitrate_limit);
+  return gst_hls_demux_change_playlist (demux, target_bitrate);
+}
+
+static void
+gst_hls_demux_download_free (GstHLSDemuxDownload * download)
+{
+  if (download->fragment)
+    g_object_unref (download->fragment);
+  g_free (download->uri);
+  g_slice_free (GstHLSDemuxDownload, download);
+}
+
+/* Runs in a thread of the pool, fetches one fragment with an idle
+ * downloader */
+static void
+gst_hls_demux_download_func (GstHLSDemuxDownload * download,
+    GstHLSDemux * demux)
+{
+  GstUriDownloader *downloader;
+  GstFragment *fragment = NULL;
+
+  g_mutex_lock (demux->download_lock);
+  if (download->cancelled)
+    goto done;
+
+  /* From here on gst_hls_demux_cancel_downloads() cancels the downloader,
+   * which makes the fetch fail even if it has not started yet */
+  downloader = g_queue_pop_head (demux->free_downloaders);
+  if (downloader == NULL)
+    downloader = gst_uri_downloader_new ();
+  else
+    gst_uri_downloader_reset (downloader);
+  download->downloader = downloader;
+  g_mutex_unlock (demux->download_lock);
+
+  GST_INFO_OBJECT (demux, "Fetching fragment %d: %s", download->sequence,
+      download->uri);
+  fragment = gst_uri_downloader_fetch_uri (downloader, download->uri);
+
+  g_mutex_lock (demux->download_lock);
+  download->downloader = NULL;
+  g_queue_push_tail (demux->free_downloaders, downloader);
+
+done:
+  download->fragment = fragment;
+  download->done = TRUE;
+  if (download->cancelled)
+    gst_hls_demux_download_free (download);
+  else
+    g_cond_broadcast (demux->download_cond);
+  g_mutex_unlock (demux->download_lock);
+}
+
+/* Starts the downloads of the next fragments of the playlist, so that up to
+ * max-downloads of them are being fetched or waiting to be handed out */
+static void
+gst_hls_demux_queue_downloads (GstHLSDemux * demux)
+{
+  GstHLSDemuxDownload *download;
+  const gchar *uri;
+  GstClockTime duration;
+  GstClockTime timestamp;
+  gboolean discont;
+
+  g_mutex_lock (demux->download_lock);
+  while (g_queue_get_length (demux->downloads) < demux->max_downloads) {
+    if (!gst_m3u8_client_get_next_fragment (demux->client, &discont,
+            &uri, &duration, &timestamp))
+      break;
+
+    download = g_slice_new0 (GstHLSDemuxDownload);
+    download->uri = g_strdup (uri);
+    download->duration = duration;
+    download->timestamp = timestamp;
+    download->discont = discont;
+    GST_M3U8_CLIENT_LOCK (demux->client);
+    download->sequence = demux->client->sequence - 1;
+    GST_M3U8_CLIENT_UNLOCK (demux->client);
+
+    g_queue_push_tail (demux->downloads, download);
+    g_thread_pool_push (demux->download_pool, download, NULL);
+  }
+  g_mutex_unlock (demux->download_lock);
+}
+
+/* Cancels the pending downloads and moves the playlist back to the first
+ * fragment that wasn't handed out yet */
+static void
+gst_hls_demux_cancel_downloads (GstHLSDemux * demux)
+{
+  GstHLSDemuxDownload *download;
+  gint sequence = -1;
+
+  g_mutex_lock (demux->download_lock);
+  while ((download = g_queue_pop_head (demux->downloads))) {
+    if (sequence == -1)
+      sequence = download->sequence;
+
+    if (download->done) {
+      gst_hls_demux_download_free (download);
+    } else {
+      download->cancelled = TRUE;
+      if (download->downloader)
+        gst_uri_downloader_cancel (download->downloader);
+    }
+  }
+  g_cond_broadcast (demux->download_cond);
+  g_mutex_unlock (demux->download_lock);
+
+  if (sequence != -1 && demux->client) {
+    GST_DEBUG_OBJECT (demux, "Cancelled downloads, back to sequence %d",
+        sequence);
+    GST_M3U8_CLIENT_LOCK (demux->client);
+    demux->client->sequence = sequence;
+    GST_M3U8_CLIENT_UNLOCK (demux->client);
+  }
 }
 
 static gboolean
 gst_hls_demux_get_next_fragment (GstHLSDemux * demux, gboolean caching)
 {
+  GstHLSDemuxDownload *next;
   GstFragment *download;
-  const gchar *next_fragment_uri;
-  GstClockTime duration;
-  GstClockTime timestamp;
   GstBufferList *buffer_list;
   GstBuffer *buf;
-  gboolean discont;
 
-  if (!gst_m3u8_client_get_next_fragment (demux->client, &discont,
-          &next_fragment_uri, &duration, &timestamp)) {
+  /* The following fragments are downloaded in parallel while we wait for
+   * the next one and handed out in playlist order on the next calls */
+  gst_hls_demux_queue_downloads (demux);
+
+  g_mutex_lock (demux->download_lock);
+  if (g_queue_is_empty (demux->downloads)) {
+    g_mutex_unlock (demux->download_lock);
     GST_INFO_OBJECT (demux, "This playlist doesn't contain more fragments");
     demux->end_of_playlist = TRUE;
     gst_task_start (demux->stream_task);
     return FALSE;
   }
 
-  GST_INFO_OBJECT (demux, "Fetching next fragment %s", next_fragment_uri);
+  while ((next = g_queue_peek_head (demux->downloads)) && !next->done)
+    g_cond_wait (demux->download_cond, demux->download_lock);
+  /* NULL if the downloads were cancelled */
+  next = g_queue_pop_head (demux->downloads);
+  g_mutex_unlock (demux->download_lock);
 
-  download = gst_uri_downloader_fetch_uri (demux->downloader,
-      next_fragment_uri);
+  if (next == NULL)
+    goto error;
 
-  if (download == NULL)
+  download = next->fragment;
+  next->fragment = NULL;
+  if (download == NULL) {
+    gst_hls_demux_download_free (next);
     goto error;
+  }
+
+  download->start_time = next->timestamp;
+  download->stop_time = next->timestamp + next->duration;
 
   buffer_list = gst_fragment_get_buffer_list (download);
   buf = gst_buffer_list_get (buffer_list, 0, 0);
-  GST_BUFFER_DURATION (buf) = duration;
-  GST_BUFFER_TIMESTAMP (buf) = timestamp;
-
-  /* We actually need to do this every time we switch bitrate */
-  if (G_UNLIKELY (demux->do_typefind)) {
-    GstCaps *caps = gst_type_find_helper_for_buffer (NULL, buf, NULL);
+  GST_BUFFER_DURATION (buf) = next->duration;
+  GST_BUFFER_TIMESTAMP (buf) = next->timestamp;
 
-    if (!demux->input_caps || !gst_caps_is_equal (caps, demux->input_caps)) {
-      gst_caps_replace (&demux->input_caps, caps);
-      /* gst_pad_set_caps (demux->srcpad, demux->input_caps); */
-      GST_INFO_OBJECT (demux, "Input source caps: %" GST_PTR_FORMAT,
-          demux->input_caps);
-      demux->do_typefind = FALSE;
-    }
-    gst_caps_unref (caps);
-  }
+  gst_hls_demux_typefind (demux, buf);
   gst_buffer_set_caps (buf, demux->input_caps);
 
-  if (discont) {
+  if (next->discont) {
     GST_DEBUG_OBJECT (demux, "Marking fragment as discontinuous");
     GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_DISCONT);
   }
+  gst_hls_demux_download_free (next);
 
   g_queue_push_tail (demux->queue, download);
   gst_buffer_list_unref (buffer_list);
@@ -29,6 +29,7 @@
 #include "m3u8.h"
 #include "gstfragmented.h"
 #include "gsturidownloader.h"
+#include "gsthlsabr.h"
 
 G_BEGIN_DECLS
 #define GST_TYPE_HLS_DEMUX \
@@ -59,6 +60,7 @@ struct _GstHLSDemux
   GstBuffer *playlist;
   GstCaps *input_caps;
   GstUriDownloader *downloader;
+  GstUriDownloader *stream_downloader; /* Fragments downloader used by the streaming task in progressive mode */
   GstM3U8Client *client;        /* M3U8 client */
   GQueue *queue;                /* Queue storing the fetched fragments */
   gboolean need_cache;          /* Wheter we need to cache some fragments before starting to push data */
@@ -69,6 +71,40 @@ struct _GstHLSDemux
   guint fragments_cache;        /* number of fragments needed to be cached to start playing */
   gfloat bitrate_limit;         /* limit of the available bitrate to use */
   guint connection_speed;       /* Network connection speed in kbps (0 = unknown) */
+  guint64 cache_size;           /* bytes needed to be cached to start playing (0 = unused) */
+  GstClockTime cache_duration;  /* time needed to be cached to start playing (0 = unused) */
+  gboolean progressive;         /* Whether fragments are pushed while they are downloaded */
+
+  /* Cache filling */
+  guint cached_fragments;
+  guint64 cached_bytes;
+  GstClockTime cached_time;
+
+  /* Progressive delivery */
+  gboolean caching;             /* Whether the data is held back to fill the cache */
+  GQueue *pending;              /* Buffers held back until the cache is filled */
+  GstBuffer *fragment_head;     /* Start of the fragment, held back for typefinding */
+  guint64 fragment_bytes;       /* Bytes received for the current fragment */
+  GstClockTime fragment_timestamp;
+  GstClockTime fragment_duration;
+  GstClockTime fragment_cached_time; /* Estimated duration of the bytes received */
+  gboolean fragment_discont;
+  gboolean fragment_truncated;  /* The end of the previous fragment was lost */
+  guint64 byte_rate;            /* Bytes per second of the last fragment */
+  GstClockTime push_time;       /* Time spent pushing the current fragment downstream */
+  GstClockTime download_time;   /* Time spent receiving the last fragment */
+  GstFlowReturn last_ret;
+
+  /* Fragments downloads */
+  guint max_downloads;          /* Number of fragments downloaded in parallel */
+  GThreadPool *download_pool;
+  GQueue *downloads;            /* Pending downloads, in playlist order */
+  GQueue *free_downloaders;     /* Idle downloaders of the pool */
+  GMutex *download_lock;
+  GCond *download_cond;
+
+  /* Bandwidth estimation */
+  GstHLSAbr *abr;
 
   /* Streaming task */
   GstTask *stream_task;
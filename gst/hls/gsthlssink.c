@@ -38,6 +38,8 @@ GST_DEBUG_CATEGORY_STATIC (gst_hls_sink_debug);
 #define DEFAULT_MAX_FILES 10
 #define DEFAULT_TARGET_DURATION 15
 #define DEFAULT_PLAYLIST_LENGTH 5
+#define DEFAULT_WRITE_SEGMENTS TRUE
+#define DEFAULT_MEMORY_SEGMENTS 0
 
 enum
 {
@@ -47,9 +49,20 @@ enum
   PROP_PLAYLIST_ROOT,
   PROP_MAX_FILES,
   PROP_TARGET_DURATION,
-  PROP_PLAYLIST_LENGTH
+  PROP_PLAYLIST_LENGTH,
+  PROP_WRITE_SEGMENTS,
+  PROP_MEMORY_SEGMENTS,
+  PROP_PLAYLIST
 };
 
+enum
+{
+  SIGNAL_GET_SEGMENT,
+  LAST_SIGNAL
+};
+
+static guint gst_hls_sink_signals[LAST_SIGNAL] = { 0 };
+
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -61,13 +74,33 @@ static void gst_hls_sink_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * spec);
 static void gst_hls_sink_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * spec);
-static void gst_hls_sink_handle_message (GstBin * bin, GstMessage * message);
 static gboolean gst_hls_sink_ghost_event_probe (GstPad * pad,
     GstEvent * event, gpointer data);
+static gboolean gst_hls_sink_ghost_buffer_probe (GstPad * pad,
+    GstBuffer * buffer, gpointer data);
+static GstBuffer *gst_hls_sink_get_segment (GstHlsSink * sink,
+    const gchar * location);
 
 static GstStateChangeReturn
 gst_hls_sink_change_state (GstElement * element, GstStateChange trans);
 
+static void
+gst_hls_sink_segment_free (GstHlsSinkSegment * segment)
+{
+  g_free (segment->location);
+  g_free (segment->name);
+  gst_buffer_unref (segment->buffer);
+  g_slice_free (GstHlsSinkSegment, segment);
+}
+
+/* Drops the segments in memory above the maximum, with the object lock */
+static void
+gst_hls_sink_trim_segments (GstHlsSink * sink)
+{
+  while (g_queue_get_length (sink->segments) > sink->memory_segments)
+    gst_hls_sink_segment_free (g_queue_pop_head (sink->segments));
+}
+
 static void
 gst_hls_sink_finalize (GObject * object)
 {
@@ -78,6 +111,9 @@ gst_hls_sink_finalize (GObject * object)
   g_free (sink->playlist_location);
   g_free (sink->playlist_root);
   gst_m3u8_playlist_free (sink->playlist);
+  g_object_unref (sink->adapter);
+  g_queue_foreach (sink->segments, (GFunc) gst_hls_sink_segment_free, NULL);
+  g_queue_free (sink->segments);
 
   G_OBJECT_CLASS (parent_class)->finalize ((GObject *) sink);
 }
@@ -95,18 +131,46 @@ gst_hls_sink_base_init (gpointer g_class)
       "Alessandro Decina <alessandro.decina@gmail.com>");
 }
 
+/* GstBuffer is a GstMiniObject, a fundamental type that the GLib
+ * marshallers can't return, and GStreamer has no BUFFER:STRING one */
+static void
+gst_hls_sink_marshal_BUFFER__STRING (GClosure * closure,
+    GValue * return_value, guint n_param_values, const GValue * param_values,
+    gpointer invocation_hint, gpointer marshal_data)
+{
+  typedef GstBuffer *(*GMarshalFunc_BUFFER__STRING) (gpointer data1,
+      const gchar * arg_1, gpointer data2);
+  GMarshalFunc_BUFFER__STRING callback;
+  GCClosure *cc = (GCClosure *) closure;
+  gpointer data1, data2;
+  GstBuffer *v_return;
+
+  g_return_if_fail (return_value != NULL);
+  g_return_if_fail (n_param_values == 2);
+
+  if (G_CCLOSURE_SWAP_DATA (closure)) {
+    data1 = closure->data;
+    data2 = g_value_peek_pointer (param_values + 0);
+  } else {
+    data1 = g_value_peek_pointer (param_values + 0);
+    data2 = closure->data;
+  }
+  callback = (GMarshalFunc_BUFFER__STRING) (marshal_data ? marshal_data :
+      cc->callback);
+
+  v_return = callback (data1, g_value_get_string (param_values + 1), data2);
+
+  gst_value_take_buffer (return_value, v_return);
+}
+
 static void
 gst_hls_sink_class_init (GstHlsSinkClass * klass)
 {
   GObjectClass *gobject_class;
   GstElementClass *element_class;
-  GstBinClass *bin_class;
 
   gobject_class = (GObjectClass *) klass;
   element_class = GST_ELEMENT_CLASS (klass);
-  bin_class = GST_BIN_CLASS (klass);
-
-  bin_class->handle_message = gst_hls_sink_handle_message;
 
   element_class->change_state = GST_DEBUG_FUNCPTR (gst_hls_sink_change_state);
 
@@ -120,7 +184,8 @@ gst_hls_sink_class_init (GstHlsSinkClass * klass)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
   g_object_class_install_property (gobject_class, PROP_PLAYLIST_LOCATION,
       g_param_spec_string ("playlist-location", "Playlist Location",
-          "Location of the playlist to write", DEFAULT_PLAYLIST_LOCATION,
+          "Location of the playlist to write (NULL to not write it)",
+          DEFAULT_PLAYLIST_LOCATION,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
   g_object_class_install_property (gobject_class, PROP_PLAYLIST_ROOT,
       g_param_spec_string ("playlist-root", "Playlist Root",
@@ -145,6 +210,40 @@ gst_hls_sink_class_init (GstHlsSinkClass * klass)
           "of the HLS specification, this should be at least 3.",
           1, G_MAXUINT, DEFAULT_PLAYLIST_LENGTH,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_WRITE_SEGMENTS,
+      g_param_spec_boolean ("write-segments", "Write segments",
+          "Write the segments to the files given by location. Can only be "
+          "changed before the element leaves the NULL state",
+          DEFAULT_WRITE_SEGMENTS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_MEMORY_SEGMENTS,
+      g_param_spec_uint ("memory-segments", "Memory segments",
+          "Number of the last segments to keep in memory, to retrieve with "
+          "the get-segment action (0 - disabled)",
+          0, G_MAXUINT, DEFAULT_MEMORY_SEGMENTS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PLAYLIST,
+      g_param_spec_string ("playlist", "Playlist",
+          "The current playlist", NULL,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstHlsSink::get-segment:
+   * @sink: the #GstHlsSink
+   * @location: the location of the segment in the playlist, or its file name
+   *
+   * Get the data of one of the segments kept in memory, see
+   * #GstHlsSink:memory-segments.
+   *
+   * Returns: a #GstBuffer to unref after usage, or %NULL if the segment is
+   * not in memory.
+   */
+  gst_hls_sink_signals[SIGNAL_GET_SEGMENT] =
+      g_signal_new ("get-segment", G_TYPE_FROM_CLASS (klass),
+      G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+      G_STRUCT_OFFSET (GstHlsSinkClass, get_segment), NULL, NULL,
+      gst_hls_sink_marshal_BUFFER__STRING, GST_TYPE_BUFFER, 1, G_TYPE_STRING);
+
+  klass->get_segment = gst_hls_sink_get_segment;
 }
 
 static void
@@ -153,8 +252,19 @@ gst_hls_sink_reset (GstHlsSink * sink)
   sink->index = 0;
   sink->multifilesink = NULL;
   sink->last_stream_time = 0;
-
+  sink->last_running_time = GST_CLOCK_TIME_NONE;
+  sink->last_key_unit = GST_CLOCK_TIME_NONE;
+  sink->key_unit_interval = 0;
+  gst_segment_init (&sink->segment, GST_FORMAT_UNDEFINED);
+  gst_adapter_clear (sink->adapter);
+
+  GST_OBJECT_LOCK (sink);
+  g_queue_foreach (sink->segments, (GFunc) gst_hls_sink_segment_free, NULL);
+  g_queue_clear (sink->segments);
+  if (sink->playlist)
+    gst_m3u8_playlist_free (sink->playlist);
   sink->playlist = gst_m3u8_playlist_new (6, sink->playlist_length, FALSE);
+  GST_OBJECT_UNLOCK (sink);
 }
 
 static void
@@ -166,6 +276,8 @@ gst_hls_sink_init (GstHlsSink * sink, GstHlsSinkClass * sink_class)
   gst_element_add_pad (GST_ELEMENT_CAST (sink), sink->ghostpad);
   gst_pad_add_event_probe (sink->ghostpad,
       G_CALLBACK (gst_hls_sink_ghost_event_probe), sink);
+  gst_pad_add_buffer_probe (sink->ghostpad,
+      G_CALLBACK (gst_hls_sink_ghost_buffer_probe), sink);
 
   sink->location = g_strdup (DEFAULT_LOCATION);
   sink->playlist_location = g_strdup (DEFAULT_PLAYLIST_LOCATION);
@@ -174,12 +286,18 @@ gst_hls_sink_init (GstHlsSink * sink, GstHlsSinkClass * sink_class)
   sink->max_files = DEFAULT_MAX_FILES;
   sink->target_duration = DEFAULT_TARGET_DURATION;
   sink->count = 0;
+  sink->write_segments = DEFAULT_WRITE_SEGMENTS;
+  sink->memory_segments = DEFAULT_MEMORY_SEGMENTS;
+  sink->adapter = gst_adapter_new ();
+  sink->segments = g_queue_new ();
   gst_hls_sink_reset (sink);
 }
 
 static gboolean
 gst_hls_sink_create_elements (GstHlsSink * sink)
 {
+  GstElement *internal_sink;
+  const gchar *name;
   GstPad *pad = NULL;
 
   GST_DEBUG_OBJECT (sink, "Creating internal elements");
@@ -187,17 +305,25 @@ gst_hls_sink_create_elements (GstHlsSink * sink)
   if (sink->elements_created)
     return TRUE;
 
-  sink->multifilesink = gst_element_factory_make ("multifilesink", NULL);
-  if (sink->multifilesink == NULL)
+  /* Without files, the data only goes to the segments kept in memory */
+  name = sink->write_segments ? "multifilesink" : "fakesink";
+  internal_sink = gst_element_factory_make (name, NULL);
+  if (internal_sink == NULL)
     goto missing_element;
 
-  g_object_set (sink->multifilesink, "location", sink->location,
-      "next-file", 3, "post-messages", TRUE, "max-files", sink->max_files,
-      NULL);
+  if (sink->write_segments) {
+    sink->multifilesink = internal_sink;
+    g_object_set (sink->multifilesink, "location", sink->location,
+        "next-file", 3, "post-messages", TRUE, "max-files", sink->max_files,
+        NULL);
+  } else {
+    g_object_set (internal_sink, "sync", FALSE, "async", FALSE,
+        "silent", TRUE, NULL);
+  }
 
-  gst_bin_add (GST_BIN_CAST (sink), sink->multifilesink);
+  gst_bin_add (GST_BIN_CAST (sink), internal_sink);
 
-  pad = gst_element_get_static_pad (sink->multifilesink, "sink");
+  pad = gst_element_get_static_pad (internal_sink, "sink");
   gst_ghost_pad_set_target (GST_GHOST_PAD (sink->ghostpad), pad);
   gst_object_unref (pad);
 
@@ -207,83 +333,166 @@ gst_hls_sink_create_elements (GstHlsSink * sink)
 missing_element:
   gst_element_post_message (GST_ELEMENT_CAST (sink),
       gst_missing_element_message_new (GST_ELEMENT_CAST (sink),
-          "multifilesink"));
+          name));
   GST_ELEMENT_ERROR (sink, CORE, MISSING_PLUGIN,
       (("Missing element '%s' - check your GStreamer installation."),
-          "multifilesink"), (NULL));
+          name), (NULL));
   return FALSE;
 }
 
+/* Requests a key unit target duration after @running_time, where the
+ * current segment started */
 static void
-gst_hls_sink_send_force_key_unit_event (GstHlsSink * sink)
+gst_hls_sink_send_force_key_unit_event (GstHlsSink * sink,
+    GstClockTime running_time)
 {
-  GstPad *sinkpad = gst_element_get_static_pad (GST_ELEMENT (sink), "sink");
+  GstPad *sinkpad;
+
+  /* the segments are cut by the streaming server */
+  if (sink->target_duration == 0)
+    return;
+
+  sinkpad = gst_element_get_static_pad (GST_ELEMENT (sink), "sink");
 
-  /* FIXME - try to make segments >= target duration in length by setting the
-   * time parameter of the force key unit event to last segment cut time +
-   * target duration */
   sink->count++;
   if (!gst_pad_push_event (sinkpad,
-          gst_video_event_new_upstream_force_key_unit (sink->target_duration *
-              sink->count * GST_SECOND, TRUE, sink->count))) {
+          gst_video_event_new_upstream_force_key_unit (running_time +
+              sink->target_duration * GST_SECOND, TRUE, sink->count))) {
     GST_WARNING_OBJECT (sink, "Failed to push upstream force key unit event");
   }
 
   gst_object_unref (sinkpad);
 }
 
-
+/* Ends the current segment at the key unit at @running_time. When @split
+ * is set, the file is closed here, otherwise the caller lets the force key
+ * unit event that ends it through */
 static void
-gst_hls_sink_handle_message (GstBin * bin, GstMessage * message)
+gst_hls_sink_close_segment (GstHlsSink * sink, GstClockTime timestamp,
+    GstClockTime running_time, GstClockTime stream_time, gboolean split)
 {
-  GstHlsSink *sink = GST_HLS_SINK_CAST (bin);
+  GFile *file;
+  GList *old_files;
+  const char *title;
+  char *filename, *name, *playlist_content;
+  GstClockTime duration;
+  gboolean discont = FALSE;
+  GError *error = NULL;
+  gchar *entry_location;
+
+  if (split && sink->multifilesink) {
+    GstPad *pad = gst_element_get_static_pad (sink->multifilesink, "sink");
+
+    gst_pad_send_event (pad,
+        gst_video_event_new_downstream_force_key_unit (timestamp, stream_time,
+            running_time, TRUE, sink->index + 1));
+    gst_object_unref (pad);
+  }
 
-  switch (message->type) {
-    case GST_MESSAGE_ELEMENT:
-    {
-      GFile *file;
-      const char *filename, *title;
-      char *playlist_content;
-      GstClockTime stream_time, duration;
-      gboolean discont = FALSE;
-      GError *error = NULL;
-      gchar *entry_location;
-
-      if (strcmp (gst_structure_get_name (message->structure),
-              "GstMultiFileSink"))
-        break;
+  duration = 0;
+  if (GST_CLOCK_TIME_IS_VALID (stream_time) && stream_time >
+      sink->last_stream_time)
+    duration = stream_time - sink->last_stream_time;
+
+  filename = g_strdup_printf (sink->location, sink->index);
+  name = g_path_get_basename (filename);
+  file = g_file_new_for_path (filename);
+  title = "ciao";
+  GST_INFO_OBJECT (sink, "segment %u ends at %" GST_TIME_FORMAT ", duration %"
+      GST_TIME_FORMAT, sink->index, GST_TIME_ARGS (running_time),
+      GST_TIME_ARGS (duration));
+  if (sink->playlist_root == NULL)
+    entry_location = g_strdup (name);
+  else
+    entry_location = g_build_filename (sink->playlist_root, name, NULL);
+
+  if (sink->memory_segments > 0) {
+    GstHlsSinkSegment *segment = g_slice_new (GstHlsSinkSegment);
+    guint available = gst_adapter_available (sink->adapter);
+
+    segment->location = g_strdup (entry_location);
+    segment->name = g_strdup (name);
+    segment->index = sink->index;
+    segment->duration = duration;
+    if (available > 0)
+      segment->buffer = gst_adapter_take_buffer (sink->adapter, available);
+    else
+      segment->buffer = gst_buffer_new ();
+
+    GST_OBJECT_LOCK (sink);
+    g_queue_push_tail (sink->segments, segment);
+    gst_hls_sink_trim_segments (sink);
+    GST_OBJECT_UNLOCK (sink);
+  } else {
+    gst_adapter_clear (sink->adapter);
+  }
 
-      gst_hls_sink_send_force_key_unit_event (sink);
-
-      filename = gst_structure_get_string (message->structure, "filename");
-      gst_structure_get_clock_time (message->structure, "stream-time",
-          &stream_time);
-      duration = stream_time - sink->last_stream_time;
-      sink->last_stream_time = stream_time;
-      file = g_file_new_for_path (filename);
-      title = "ciao";
-      GST_INFO_OBJECT (sink, "COUNT %d", sink->index);
-      if (sink->playlist_root == NULL)
-        entry_location = g_path_get_basename (filename);
-      else {
-        gchar *name = g_path_get_basename (filename);
-        entry_location = g_build_filename (sink->playlist_root, name, NULL);
-        g_free (name);
-      }
-      gst_m3u8_playlist_add_entry (sink->playlist, entry_location, file,
-          title, duration, sink->index, discont);
-      g_free (entry_location);
-      playlist_content = gst_m3u8_playlist_render (sink->playlist);
-      g_file_set_contents (sink->playlist_location,
-          playlist_content, -1, &error);
-      g_free (playlist_content);
+  GST_OBJECT_LOCK (sink);
+  old_files = gst_m3u8_playlist_add_entry (sink->playlist, entry_location,
+      file, title, duration, sink->index, discont);
+  playlist_content = gst_m3u8_playlist_render (sink->playlist);
+  GST_OBJECT_UNLOCK (sink);
+
+  g_list_foreach (old_files, (GFunc) g_object_unref, NULL);
+  g_list_free (old_files);
+  g_free (entry_location);
+  g_free (name);
+  g_free (filename);
+
+  /* The playlist is written to a temporary file renamed over the old one,
+   * so that it is never read partially written */
+  if (sink->playlist_location && !g_file_set_contents (sink->playlist_location,
+          playlist_content, -1, &error)) {
+    GST_WARNING_OBJECT (sink, "Failed to write the playlist: %s",
+        error->message);
+    g_error_free (error);
+  }
+  g_free (playlist_content);
+
+  sink->index++;
+  sink->last_stream_time = stream_time;
+  sink->last_running_time = running_time;
+
+  gst_hls_sink_send_force_key_unit_event (sink, running_time);
+}
+
+/* Whether the segment has to be cut at the key unit at @running_time: the
+ * cut is made on the key unit nearest to the target duration, assuming the
+ * next one comes after the same interval as the last ones */
+static gboolean
+gst_hls_sink_is_cut_point (GstHlsSink * sink, GstClockTime running_time)
+{
+  GstClockTime target = sink->target_duration * GST_SECOND;
+  GstClockTime elapsed;
+
+  if (sink->target_duration == 0 || running_time < sink->last_running_time)
+    return FALSE;
+
+  elapsed = running_time - sink->last_running_time;
+  return elapsed + MIN (sink->key_unit_interval, target) / 2 >= target;
+}
+
+static GstBuffer *
+gst_hls_sink_get_segment (GstHlsSink * sink, const gchar * location)
+{
+  GstBuffer *buffer = NULL;
+  GList *walk;
+
+  g_return_val_if_fail (location != NULL, NULL);
+
+  GST_OBJECT_LOCK (sink);
+  for (walk = sink->segments->head; walk; walk = walk->next) {
+    GstHlsSinkSegment *segment = walk->data;
+
+    if (!strcmp (segment->location, location) ||
+        !strcmp (segment->name, location)) {
+      buffer = gst_buffer_ref (segment->buffer);
       break;
     }
-    default:
-      break;
   }
+  GST_OBJECT_UNLOCK (sink);
 
-  GST_BIN_CLASS (parent_class)->handle_message (bin, message);
+  return buffer;
 }
 
 static GstStateChangeReturn
@@ -299,7 +508,9 @@ gst_hls_sink_change_state (GstElement * element, GstStateChange trans)
       }
       break;
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
-      gst_hls_sink_send_force_key_unit_event (sink);
+      gst_hls_sink_send_force_key_unit_event (sink,
+          GST_CLOCK_TIME_IS_VALID (sink->last_running_time) ?
+          sink->last_running_time : 0);
       break;
     default:
       break;
@@ -358,7 +569,18 @@ gst_hls_sink_set_property (GObject * object, guint prop_id,
       break;
     case PROP_PLAYLIST_LENGTH:
       sink->playlist_length = g_value_get_uint (value);
+      GST_OBJECT_LOCK (sink);
       sink->playlist->window_size = sink->playlist_length;
+      GST_OBJECT_UNLOCK (sink);
+      break;
+    case PROP_WRITE_SEGMENTS:
+      sink->write_segments = g_value_get_boolean (value);
+      break;
+    case PROP_MEMORY_SEGMENTS:
+      GST_OBJECT_LOCK (sink);
+      sink->memory_segments = g_value_get_uint (value);
+      gst_hls_sink_trim_segments (sink);
+      GST_OBJECT_UNLOCK (sink);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -391,6 +613,17 @@ gst_hls_sink_get_property (GObject * object, guint prop_id,
     case PROP_PLAYLIST_LENGTH:
       g_value_set_uint (value, sink->playlist_length);
       break;
+    case PROP_WRITE_SEGMENTS:
+      g_value_set_boolean (value, sink->write_segments);
+      break;
+    case PROP_MEMORY_SEGMENTS:
+      g_value_set_uint (value, sink->memory_segments);
+      break;
+    case PROP_PLAYLIST:
+      GST_OBJECT_LOCK (sink);
+      g_value_take_string (value, gst_m3u8_playlist_render (sink->playlist));
+      GST_OBJECT_UNLOCK (sink);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -403,6 +636,19 @@ gst_hls_sink_ghost_event_probe (GstPad * pad, GstEvent * event, gpointer data)
   GstHlsSink *sink = GST_HLS_SINK_CAST (data);
 
   switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_NEWSEGMENT:
+    {
+      gboolean update;
+      gdouble rate, applied_rate;
+      GstFormat format;
+      gint64 start, stop, time;
+
+      gst_event_parse_new_segment_full (event, &update, &rate, &applied_rate,
+          &format, &start, &stop, &time);
+      gst_segment_set_newsegment_full (&sink->segment, update, rate,
+          applied_rate, format, start, stop, time);
+      break;
+    }
     case GST_EVENT_CUSTOM_DOWNSTREAM:
     {
       GstClockTime timestamp;
@@ -416,8 +662,20 @@ gst_hls_sink_ghost_event_probe (GstPad * pad, GstEvent * event, gpointer data)
       gst_event_replace (&sink->force_key_unit_event, event);
       gst_video_event_parse_downstream_force_key_unit (event,
           &timestamp, &stream_time, &running_time, &all_headers, &count);
-      GST_INFO_OBJECT (sink, "setting index %d", count);
-      sink->index = count;
+
+      /* Nothing to cut yet, or a key unit we didn't wait for so close to
+       * the last cut that the segment would be too short */
+      if (!GST_CLOCK_TIME_IS_VALID (sink->last_running_time) ||
+          (sink->target_duration > 0 &&
+              GST_CLOCK_TIME_IS_VALID (running_time) &&
+              running_time < sink->last_running_time +
+              sink->target_duration * GST_SECOND / 2)) {
+        GST_DEBUG_OBJECT (sink, "dropping force key unit event %d", count);
+        return FALSE;
+      }
+
+      gst_hls_sink_close_segment (sink, timestamp, running_time, stream_time,
+          FALSE);
       break;
     }
     default:
@@ -427,6 +685,47 @@ gst_hls_sink_ghost_event_probe (GstPad * pad, GstEvent * event, gpointer data)
   return TRUE;
 }
 
+static gboolean
+gst_hls_sink_ghost_buffer_probe (GstPad * pad, GstBuffer * buffer,
+    gpointer data)
+{
+  GstHlsSink *sink = GST_HLS_SINK_CAST (data);
+  GstClockTime timestamp = GST_BUFFER_TIMESTAMP (buffer);
+  GstClockTime running_time, stream_time;
+
+  if (sink->segment.format != GST_FORMAT_TIME ||
+      !GST_CLOCK_TIME_IS_VALID (timestamp))
+    goto done;
+
+  running_time = gst_segment_to_running_time (&sink->segment,
+      GST_FORMAT_TIME, timestamp);
+  stream_time = gst_segment_to_stream_time (&sink->segment,
+      GST_FORMAT_TIME, timestamp);
+  if (!GST_CLOCK_TIME_IS_VALID (running_time))
+    goto done;
+
+  if (!GST_CLOCK_TIME_IS_VALID (sink->last_running_time)) {
+    /* first segment */
+    sink->last_running_time = running_time;
+    sink->last_stream_time = stream_time;
+  } else if (!GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT)) {
+    if (GST_CLOCK_TIME_IS_VALID (sink->last_key_unit) &&
+        running_time > sink->last_key_unit)
+      sink->key_unit_interval = running_time - sink->last_key_unit;
+    sink->last_key_unit = running_time;
+
+    if (gst_hls_sink_is_cut_point (sink, running_time))
+      gst_hls_sink_close_segment (sink, timestamp, running_time, stream_time,
+          TRUE);
+  }
+
+done:
+  if (sink->memory_segments > 0)
+    gst_adapter_push (sink->adapter, gst_buffer_ref (buffer));
+
+  return TRUE;
+}
+
 
 gboolean
 gst_hls_sink_plugin_init (GstPlugin * plugin)
@@ -21,6 +21,7 @@
 
 #include "gstm3u8playlist.h"
 #include <gst/gst.h>
+#include <gst/base/gstadapter.h>
 
 G_BEGIN_DECLS
 
@@ -33,6 +34,17 @@ G_BEGIN_DECLS
 
 typedef struct _GstHlsSink GstHlsSink;
 typedef struct _GstHlsSinkClass GstHlsSinkClass;
+typedef struct _GstHlsSinkSegment GstHlsSinkSegment;
+
+/* A segment kept in memory */
+struct _GstHlsSinkSegment
+{
+  gchar *location;              /* as referenced by the playlist */
+  gchar *name;                  /* file name */
+  guint index;
+  GstClockTime duration;
+  GstBuffer *buffer;
+};
 
 struct _GstHlsSink
 {
@@ -43,7 +55,11 @@ struct _GstHlsSink
   gboolean elements_created;
   GstEvent *force_key_unit_event;
 
+  GstSegment segment;
   GstClockTime last_stream_time;
+  GstClockTime last_running_time;   /* running time of the last cut */
+  GstClockTime last_key_unit;
+  GstClockTime key_unit_interval;
   gchar *location;
   gchar *playlist_location;
   gchar *playlist_root;
@@ -54,11 +70,19 @@ struct _GstHlsSink
   gint target_duration;
   gint count;
   guint timeout_id;
+
+  gboolean write_segments;
+  guint memory_segments;
+  GstAdapter *adapter;          /* data of the current segment */
+  GQueue *segments;             /* last segments, protected by the object lock */
 };
 
 struct _GstHlsSinkClass
 {
   GstBinClass bin_class;
+
+  /* actions */
+  GstBuffer * (*get_segment) (GstHlsSink * sink, const gchar * location);
 };
 
 GType gst_hls_sink_get_type (void);
@@ -20,6 +20,7 @@
  */
 
 #include <glib.h>
+#include <string.h>
 
 #include "gstfragmented.h"
 #include "gstm3u8playlist.h"
@@ -71,22 +72,28 @@ gst_m3u8_entry_free (GstM3U8Entry * entry)
   g_free (entry);
 }
 
-static gchar *
-gst_m3u8_entry_render (GstM3U8Entry * entry, guint version)
+/* Appends the entry to @str and returns the length of its rendition */
+static gsize
+gst_m3u8_entry_render (GstM3U8Entry * entry, guint version, GString * str)
 {
-  g_return_val_if_fail (entry != NULL, NULL);
+  gsize len;
 
+  g_return_val_if_fail (entry != NULL, 0);
+
+  len = str->len;
   /* FIXME: Ensure the radix is always a '.' and not a ',' when printing
    * floating point number, but for now only use integers*/
   /* if (version < 3) */
   if (TRUE)
-    return g_strdup_printf ("%s" M3U8_INT_INF_TAG,
+    g_string_append_printf (str, "%s" M3U8_INT_INF_TAG,
         entry->discontinuous ? M3U8_DISCONTINUITY_TAG : "",
         (gint) (entry->duration / GST_SECOND), entry->title, entry->url);
+  else
+    g_string_append_printf (str, "%s" M3U8_FLOAT_INF_TAG,
+        entry->discontinuous ? M3U8_DISCONTINUITY_TAG : "",
+        (entry->duration / GST_SECOND), entry->title, entry->url);
 
-  return g_strdup_printf ("%s" M3U8_FLOAT_INF_TAG,
-      entry->discontinuous ? M3U8_DISCONTINUITY_TAG : "",
-      (entry->duration / GST_SECOND), entry->title, entry->url);
+  return str->len - len;
 }
 
 GstM3U8Playlist *
@@ -101,6 +108,7 @@ gst_m3u8_playlist_new (guint version, guint window_size, gboolean allow_cache)
   playlist->type = GST_M3U8_PLAYLIST_TYPE_EVENT;
   playlist->end_list = FALSE;
   playlist->entries = g_queue_new ();
+  playlist->playlist_str = g_string_new ("");
 
   return playlist;
 }
@@ -112,6 +120,7 @@ gst_m3u8_playlist_free (GstM3U8Playlist * playlist)
 
   g_queue_foreach (playlist->entries, (GFunc) gst_m3u8_entry_free, NULL);
   g_queue_free (playlist->entries);
+  g_string_free (playlist->playlist_str, TRUE);
   g_free (playlist);
 }
 
@@ -141,6 +150,17 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
       old_entry = g_queue_pop_head (playlist->entries);
       g_object_ref (old_entry->file);
       old_files = g_list_prepend (old_files, old_entry->file);
+
+      /* Drop its rendition, the string is compacted once the dropped
+       * entries take more than the remaining ones */
+      playlist->entries_offset += old_entry->rendered_length;
+      if (playlist->entries_offset > playlist->playlist_str->len / 2) {
+        g_string_erase (playlist->playlist_str, 0, playlist->entries_offset);
+        playlist->entries_offset = 0;
+      }
+      if (old_entry->duration >= playlist->target_duration)
+        playlist->target_duration_dirty = TRUE;
+
       gst_m3u8_entry_free (old_entry);
     }
   }
@@ -148,65 +168,77 @@ gst_m3u8_playlist_add_entry (GstM3U8Playlist * playlist,
   playlist->sequence_number = index + 1;
   g_queue_push_tail (playlist->entries, entry);
 
+  entry->rendered_length = gst_m3u8_entry_render (entry, playlist->version,
+      playlist->playlist_str);
+  if (entry->duration > playlist->target_duration)
+    playlist->target_duration = entry->duration;
+
   return old_files;
 }
 
 static guint
 gst_m3u8_playlist_target_duration (GstM3U8Playlist * playlist)
 {
-  gint i;
+  GList *walk;
   GstM3U8Entry *entry;
-  guint64 target_duration = 0;
-
-  for (i = 0; i < playlist->entries->length; i++) {
-    entry = (GstM3U8Entry *) g_queue_peek_nth (playlist->entries, i);
-    if (entry->duration > target_duration)
-      target_duration = entry->duration;
+  gfloat target_duration = 0;
+
+  /* Only needed when the longest entry left the playlist */
+  if (playlist->target_duration_dirty) {
+    for (walk = playlist->entries->head; walk; walk = walk->next) {
+      entry = (GstM3U8Entry *) walk->data;
+      if (entry->duration > target_duration)
+        target_duration = entry->duration;
+    }
+    playlist->target_duration = target_duration;
+    playlist->target_duration_dirty = FALSE;
   }
 
-  return (guint) (target_duration / GST_SECOND);
-}
-
-static void
-render_entry (GstM3U8Entry * entry, GstM3U8Playlist * playlist)
-{
-  gchar *entry_str;
-
-  entry_str = gst_m3u8_entry_render (entry, playlist->version);
-  g_string_append_printf (playlist->playlist_str, "%s", entry_str);
-  g_free (entry_str);
+  return (guint) (playlist->target_duration / GST_SECOND);
 }
 
+/* The entries are rendered once when they are added and kept in
+ * playlist_str, only the header and the end tag are rendered here */
 gchar *
 gst_m3u8_playlist_render (GstM3U8Playlist * playlist)
 {
-  gchar *pl;
+  GString *header;
+  gchar *pl, *p;
+  gsize entries_len;
 
   g_return_val_if_fail (playlist != NULL, NULL);
 
-  playlist->playlist_str = g_string_new ("");
+  header = g_string_sized_new (128);
 
   /* #EXTM3U */
-  g_string_append_printf (playlist->playlist_str, M3U8_HEADER_TAG);
+  g_string_append_printf (header, M3U8_HEADER_TAG);
   /* #EXT-X-VERSION */
-//  g_string_append_printf (playlist->playlist_str, M3U8_VERSION_TAG,
+//  g_string_append_printf (header, M3U8_VERSION_TAG,
 //      playlist->version);
   /* #EXT-X-MEDIA-SEQUENCE */
-  g_string_append_printf (playlist->playlist_str, M3U8_MEDIA_SEQUENCE_TAG,
+  g_string_append_printf (header, M3U8_MEDIA_SEQUENCE_TAG,
       playlist->sequence_number - playlist->entries->length);
   /* #EXT-X-TARGETDURATION */
-  g_string_append_printf (playlist->playlist_str, M3U8_TARGETDURATION_TAG,
+  g_string_append_printf (header, M3U8_TARGETDURATION_TAG,
       gst_m3u8_playlist_target_duration (playlist));
-  g_string_append_printf (playlist->playlist_str, "\n");
+  g_string_append_printf (header, "\n");
 
   /* Entries */
-  g_queue_foreach (playlist->entries, (GFunc) render_entry, playlist);
+  entries_len = playlist->playlist_str->len - playlist->entries_offset;
+  p = pl = g_malloc (header->len + entries_len +
+      (playlist->end_list ? sizeof (M3U8_ENDLIST_TAG) : 1));
+  memcpy (p, header->str, header->len);
+  p += header->len;
+  memcpy (p, playlist->playlist_str->str + playlist->entries_offset,
+      entries_len);
+  p += entries_len;
 
   if (playlist->end_list)
-    g_string_append_printf (playlist->playlist_str, M3U8_ENDLIST_TAG);
+    memcpy (p, M3U8_ENDLIST_TAG, sizeof (M3U8_ENDLIST_TAG));
+  else
+    *p = '\0';
 
-  pl = playlist->playlist_str->str;
-  g_string_free (playlist->playlist_str, FALSE);
+  g_string_free (header, TRUE);
   return pl;
 }
 
@@ -217,6 +249,10 @@ gst_m3u8_playlist_clear (GstM3U8Playlist * playlist)
 
   g_queue_foreach (playlist->entries, (GFunc) gst_m3u8_entry_free, NULL);
   g_queue_clear (playlist->entries);
+  g_string_truncate (playlist->playlist_str, 0);
+  playlist->entries_offset = 0;
+  playlist->target_duration = 0;
+  playlist->target_duration_dirty = FALSE;
 }
 
 guint
@@ -38,6 +38,9 @@ struct _GstM3U8Entry
   gchar *url;
   GFile *file;
   gboolean discontinuous;
+
+  /*< Private >*/
+  gsize rendered_length;        /* Length of the entry in playlist_str */
 };
 
 struct _GstM3U8Playlist
@@ -51,7 +54,10 @@ struct _GstM3U8Playlist
 
   /*< Private >*/
   GQueue *entries;
-  GString *playlist_str;
+  GString *playlist_str;        /* Rendition of the entries */
+  gsize entries_offset;         /* Start of the first entry in playlist_str */
+  gfloat target_duration;       /* Longest entry duration */
+  gboolean target_duration_dirty;
 };
 
 
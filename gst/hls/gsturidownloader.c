@@ -41,6 +41,9 @@ struct _GstUriDownloaderPrivate
   GstPad *pad;
   GTimeVal *timeout;
   GstFragment *download;
+  gboolean progressive;         /* Hand out the data as it arrives */
+  GQueue *chunks;               /* Buffers not handed out yet */
+  gboolean cancelled;           /* Fetches fail until the downloader is reset */
   GMutex *lock;
   GCond *cond;
 };
@@ -98,10 +101,20 @@ gst_uri_downloader_init (GstUriDownloader * downloader)
   /* Create a bus to handle error and warning message from the source element */
   downloader->priv->bus = gst_bus_new ();
 
+  downloader->priv->chunks = g_queue_new ();
   downloader->priv->lock = g_mutex_new ();
   downloader->priv->cond = g_cond_new ();
 }
 
+static void
+gst_uri_downloader_clear_chunks (GstUriDownloader * downloader)
+{
+  GstBuffer *buf;
+
+  while ((buf = g_queue_pop_head (downloader->priv->chunks)))
+    gst_buffer_unref (buf);
+}
+
 static void
 gst_uri_downloader_dispose (GObject * object)
 {
@@ -127,6 +140,8 @@ gst_uri_downloader_dispose (GObject * object)
     downloader->priv->download = NULL;
   }
 
+  gst_uri_downloader_clear_chunks (downloader);
+
   G_OBJECT_CLASS (gst_uri_downloader_parent_class)->dispose (object);
 }
 
@@ -135,6 +150,7 @@ gst_uri_downloader_finalize (GObject * object)
 {
   GstUriDownloader *downloader = GST_URI_DOWNLOADER (object);
 
+  g_queue_free (downloader->priv->chunks);
   g_mutex_free (downloader->priv->lock);
   g_cond_free (downloader->priv->cond);
 
@@ -164,14 +180,10 @@ gst_uri_downloader_sink_event (GstPad * pad, GstEvent * event)
         downloader->priv->download->completed = TRUE;
         downloader->priv->download->download_stop_time =
             gst_util_get_timestamp ();
-        GST_OBJECT_UNLOCK (downloader);
         GST_DEBUG_OBJECT (downloader, "Signaling chain funtion");
-        g_mutex_lock (downloader->priv->lock);
         g_cond_signal (downloader->priv->cond);
-        g_mutex_unlock (downloader->priv->lock);
-      } else {
-        GST_OBJECT_UNLOCK (downloader);
       }
+      GST_OBJECT_UNLOCK (downloader);
       gst_event_unref (event);
       break;
     }
@@ -226,13 +238,24 @@ gst_uri_downloader_chain (GstPad * pad, GstBuffer * buf)
   if (downloader->priv->download == NULL) {
     /* Download cancelled, quit */
     GST_OBJECT_UNLOCK (downloader);
+    gst_buffer_unref (buf);
     goto done;
   }
 
   GST_LOG_OBJECT (downloader, "The uri fetcher received a new buffer "
       "of size %u", GST_BUFFER_SIZE (buf));
-  if (!gst_fragment_add_buffer (downloader->priv->download, buf))
+  if (downloader->priv->progressive) {
+    /* Hand the buffer to the thread fetching the URI */
+    if (gst_fragment_account_buffer (downloader->priv->download, buf)) {
+      g_queue_push_tail (downloader->priv->chunks, buf);
+      g_cond_signal (downloader->priv->cond);
+    } else {
+      GST_WARNING_OBJECT (downloader, "Could not add buffer to fragment");
+      gst_buffer_unref (buf);
+    }
+  } else if (!gst_fragment_add_buffer (downloader->priv->download, buf)) {
     GST_WARNING_OBJECT (downloader, "Could not add buffer to fragment");
+  }
   GST_OBJECT_UNLOCK (downloader);
 
 done:
@@ -262,19 +285,23 @@ gst_uri_downloader_stop (GstUriDownloader * downloader)
       GST_CLOCK_TIME_NONE);
 }
 
+/* Cancels the current download. A download that has not started yet, for
+ * instance because the source element is still being created, fails as soon
+ * as it starts, as do all the following ones until
+ * gst_uri_downloader_reset() is called */
 void
 gst_uri_downloader_cancel (GstUriDownloader * downloader)
 {
   GST_OBJECT_LOCK (downloader);
+  downloader->priv->cancelled = TRUE;
   if (downloader->priv->download != NULL) {
     GST_DEBUG_OBJECT (downloader, "Cancelling download");
     g_object_unref (downloader->priv->download);
     downloader->priv->download = NULL;
-    GST_OBJECT_UNLOCK (downloader);
+    gst_uri_downloader_clear_chunks (downloader);
     GST_DEBUG_OBJECT (downloader, "Signaling chain funtion");
-    g_mutex_lock (downloader->priv->lock);
     g_cond_signal (downloader->priv->cond);
-    g_mutex_unlock (downloader->priv->lock);
+    GST_OBJECT_UNLOCK (downloader);
   } else {
     GST_OBJECT_UNLOCK (downloader);
     GST_DEBUG_OBJECT (downloader,
@@ -282,6 +309,15 @@ gst_uri_downloader_cancel (GstUriDownloader * downloader)
   }
 }
 
+/* Allows fetching again after gst_uri_downloader_cancel() */
+void
+gst_uri_downloader_reset (GstUriDownloader * downloader)
+{
+  GST_OBJECT_LOCK (downloader);
+  downloader->priv->cancelled = FALSE;
+  GST_OBJECT_UNLOCK (downloader);
+}
+
 static gboolean
 gst_uri_downloader_set_uri (GstUriDownloader * downloader, const gchar * uri)
 {
@@ -311,9 +347,22 @@ gst_uri_downloader_set_uri (GstUriDownloader * downloader, const gchar * uri)
 
 GstFragment *
 gst_uri_downloader_fetch_uri (GstUriDownloader * downloader, const gchar * uri)
+{
+  return gst_uri_downloader_fetch_uri_progressive (downloader, uri, NULL,
+      NULL);
+}
+
+/* Fetches @uri. If @func is not NULL, the downloaded buffers are passed to it
+ * from the calling thread as soon as they are received instead of being
+ * stored in the returned fragment, which then only keeps track of the
+ * download size and times */
+GstFragment *
+gst_uri_downloader_fetch_uri_progressive (GstUriDownloader * downloader,
+    const gchar * uri, GstUriDownloaderChunkFunc func, gpointer user_data)
 {
   GstStateChangeReturn ret;
   GstFragment *download = NULL;
+  GstBuffer *buf;
 
   g_mutex_lock (downloader->priv->lock);
 
@@ -321,12 +370,24 @@ gst_uri_downloader_fetch_uri (GstUriDownloader * downloader, const gchar * uri)
     goto quit;
   }
 
+  GST_OBJECT_LOCK (downloader);
+  if (downloader->priv->cancelled) {
+    GST_OBJECT_UNLOCK (downloader);
+    GST_DEBUG_OBJECT (downloader, "Download cancelled before it started");
+    goto quit;
+  }
   downloader->priv->download = gst_fragment_new ();
+  downloader->priv->progressive = (func != NULL);
+  GST_OBJECT_UNLOCK (downloader);
 
   ret = gst_element_set_state (downloader->priv->urisrc, GST_STATE_PLAYING);
   if (ret == GST_STATE_CHANGE_FAILURE) {
-    g_object_unref (downloader->priv->download);
-    downloader->priv->download = NULL;
+    GST_OBJECT_LOCK (downloader);
+    if (downloader->priv->download != NULL) {
+      g_object_unref (downloader->priv->download);
+      downloader->priv->download = NULL;
+    }
+    GST_OBJECT_UNLOCK (downloader);
     goto quit;
   }
 
@@ -334,13 +395,38 @@ gst_uri_downloader_fetch_uri (GstUriDownloader * downloader, const gchar * uri)
    *   - the download succeed (EOS in the src pad)
    *   - the download failed (Error message on the fetcher bus)
    *   - the download was canceled
+   * handing out the buffers received in the meantime in progressive mode.
+   * The object lock is released while doing so, the callback might block
+   * pushing the data downstream and the download must still be cancellable.
    */
   GST_DEBUG_OBJECT (downloader, "Waiting to fetch the URI");
-  g_cond_wait (downloader->priv->cond, downloader->priv->lock);
-
   GST_OBJECT_LOCK (downloader);
+  while (downloader->priv->download != NULL) {
+    buf = g_queue_pop_head (downloader->priv->chunks);
+    if (buf != NULL) {
+      GST_OBJECT_UNLOCK (downloader);
+      if (!func (downloader, buf, user_data)) {
+        /* Only this download is dropped, unlike with
+         * gst_uri_downloader_cancel() the next fetches still work */
+        GST_DEBUG_OBJECT (downloader, "Buffer refused, dropping download");
+        GST_OBJECT_LOCK (downloader);
+        if (downloader->priv->download != NULL) {
+          g_object_unref (downloader->priv->download);
+          downloader->priv->download = NULL;
+          gst_uri_downloader_clear_chunks (downloader);
+        }
+        continue;
+      }
+      GST_OBJECT_LOCK (downloader);
+      continue;
+    }
+    if (downloader->priv->download->completed)
+      break;
+    g_cond_wait (downloader->priv->cond, GST_OBJECT_GET_LOCK (downloader));
+  }
   download = downloader->priv->download;
   downloader->priv->download = NULL;
+  downloader->priv->progressive = FALSE;
   GST_OBJECT_UNLOCK (downloader);
 
   if (download != NULL)
@@ -53,11 +53,27 @@ struct _GstUriDownloaderClass
   gpointer _gst_reserved[GST_PADDING];
 };
 
+/**
+ * GstUriDownloaderChunkFunc:
+ * @downloader: the #GstUriDownloader
+ * @buffer: (transfer full): a buffer of downloaded data
+ * @user_data: user data passed to gst_uri_downloader_fetch_uri_progressive()
+ *
+ * Called from the thread fetching the URI for every buffer received from the
+ * source element.
+ *
+ * Returns: %FALSE to cancel the download
+ */
+typedef gboolean (*GstUriDownloaderChunkFunc) (GstUriDownloader * downloader,
+    GstBuffer * buffer, gpointer user_data);
+
 GType gst_uri_downloader_get_type (void);
 
 GstUriDownloader * gst_uri_downloader_new (void);
 GstFragment * gst_uri_downloader_fetch_uri (GstUriDownloader * downloader, const gchar * uri);
+GstFragment * gst_uri_downloader_fetch_uri_progressive (GstUriDownloader * downloader, const gchar * uri, GstUriDownloaderChunkFunc func, gpointer user_data);
 void gst_uri_downloader_cancel (GstUriDownloader *downloader);
+void gst_uri_downloader_reset (GstUriDownloader *downloader);
 void gst_uri_downloader_free (GstUriDownloader *downloader);
 
 G_END_DECLS
@@ -20,6 +20,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <errno.h>
 #include <glib.h>
@@ -211,17 +212,87 @@ gst_m3u8_compare_playlist_by_bitrate (gconstpointer a, gconstpointer b)
   return ((GstM3U8 *) (a))->bandwidth - ((GstM3U8 *) (b))->bandwidth;
 }
 
+/* Returns the media file with @sequence from the previous version of the
+ * playlist if there is one, freeing the ones before it which left the
+ * playlist window */
+static GstM3U8MediaFile *
+gst_m3u8_find_old_file (GList ** old_files, guint sequence)
+{
+  GstM3U8MediaFile *file;
+
+  while (*old_files) {
+    file = GST_M3U8_MEDIA_FILE ((*old_files)->data);
+    if (file->sequence >= sequence)
+      return file->sequence == sequence ? file : NULL;
+    *old_files = g_list_delete_link (*old_files, *old_files);
+    gst_m3u8_media_file_free (file);
+  }
+
+  return NULL;
+}
+
+/* Whether the URI line @line is the one @file was created from */
+static gboolean
+gst_m3u8_media_file_has_uri (GstM3U8MediaFile * file, const gchar * line)
+{
+  gsize uri_len = strlen (file->uri);
+  gsize len = strlen (line);
+
+  if (len > 0 && line[len - 1] == '\r')
+    len--;
+  if (len > uri_len || (len < uri_len && file->uri[uri_len - len - 1] != '/'))
+    return FALSE;
+
+  return strncmp (file->uri + uri_len - len, line, len) == 0;
+}
+
+static void
+parse_extinf (GstM3U8 * self, gchar * data, GstClockTime * duration,
+    gchar ** title)
+{
+  gdouble fval;
+
+  if (!double_from_string (data + 8, &data, &fval)) {
+    GST_WARNING ("Can't read EXTINF duration");
+    return;
+  }
+  *duration = fval * (gdouble) GST_SECOND;
+  if (*duration > self->targetduration)
+    GST_WARNING ("EXTINF duration > TARGETDURATION");
+  if (!data || *data != ',')
+    return;
+  data = g_utf8_next_char (data);
+  if (*data != '\0') {
+    g_free (*title);
+    *title = g_strdup (data);
+  }
+}
+
 /*
  * @data: a m3u8 playlist text data, taking ownership
+ *
+ * Live playlists are refreshed every target duration and mostly contain the
+ * media files already known, so those are not parsed again:
+ *   - if the playlist didn't change at all, nothing is done and @updated
+ *     is set to FALSE.
+ *   - if the previous data is a prefix of the new one (the playlist window
+ *     didn't move), only the lines after it are parsed and the media files
+ *     found are appended to the existing ones.
+ *   - otherwise the media files whose sequence number and URI are already
+ *     known are reused from the previous version of the playlist, without
+ *     parsing their EXTINF line and resolving their URI again.
  */
 static gboolean
 gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
 {
   gint val;
   GstClockTime duration;
-  gchar *title, *end;
+  gchar *title, *end, *lines, *extinf;
 //  gboolean discontinuity;
   GstM3U8 *list;
+  GList *files, *old_files;
+  GstM3U8MediaFile *file;
+  gsize last_size;
 
   g_return_val_if_fail (self != NULL, FALSE);
   g_return_val_if_fail (data != NULL, FALSE);
@@ -244,19 +315,34 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
     return FALSE;
   }
 
+  /* The lines are split in place, keep the data intact to compare it with
+   * the next version of the playlist */
+  old_files = self->files;
+  files = NULL;
+  self->files = NULL;
+
+  if (old_files && !self->lists && !self->endlist &&
+      (last_size = strlen (self->last_data)) > 0 &&
+      self->last_data[last_size - 1] == '\n' &&
+      strncmp (data, self->last_data, last_size) == 0) {
+    GST_DEBUG ("Playlist was appended to, parsing the new lines only");
+    /* mediasequence is already the one of the next media file */
+    self->files = old_files;
+    old_files = NULL;
+    lines = g_strdup (data + last_size);
+  } else {
+    /* the first media file is 0 if there is no EXT-X-MEDIA-SEQUENCE */
+    self->mediasequence = 0;
+    lines = g_strdup (data + 7);
+  }
   g_free (self->last_data);
   self->last_data = data;
-
-  if (self->files) {
-    g_list_foreach (self->files, (GFunc) gst_m3u8_media_file_free, NULL);
-    g_list_free (self->files);
-    self->files = NULL;
-  }
+  data = lines;
 
   list = NULL;
   duration = 0;
   title = NULL;
-  data += 7;
+  extinf = NULL;
   while (TRUE) {
     end = g_utf8_strchr (data, -1, '\n');
     if (end)
@@ -265,6 +351,21 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
     if (data[0] != '#') {
       gchar *r;
 
+      if (extinf) {
+        file = GST_M3U8_MEDIA_FILE (old_files->data);
+        if (gst_m3u8_media_file_has_uri (file, data)) {
+          /* already known, keep the previous one */
+          old_files = g_list_delete_link (old_files, old_files);
+          self->mediasequence++;
+          extinf = NULL;
+          files = g_list_prepend (files, file);
+          goto next_line;
+        }
+        /* the sequence number was reused for another media file */
+        parse_extinf (self, extinf, &duration, &title);
+        extinf = NULL;
+      }
+
       if (duration <= 0 && list == NULL) {
         GST_LOG ("%s: got line without EXTINF or EXTSTREAMINF, dropping", data);
         goto next_line;
@@ -305,13 +406,12 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
         }
         list = NULL;
       } else {
-        GstM3U8MediaFile *file;
         file =
             gst_m3u8_media_file_new (data, title, duration,
             self->mediasequence++);
         duration = 0;
         title = NULL;
-        self->files = g_list_append (self->files, file);
+        files = g_list_prepend (files, file);
       }
 
     } else if (g_str_has_prefix (data, "#EXT-X-ENDLIST")) {
@@ -366,21 +466,12 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
       g_free (self->allowcache);
       self->allowcache = g_strdup (data + 19);
     } else if (g_str_has_prefix (data, "#EXTINF:")) {
-      gdouble fval;
-      if (!double_from_string (data + 8, &data, &fval)) {
-        GST_WARNING ("Can't read EXTINF duration");
-        goto next_line;
-      }
-      duration = fval * (gdouble) GST_SECOND;
-      if (duration > self->targetduration)
-        GST_WARNING ("EXTINF duration > TARGETDURATION");
-      if (!data || *data != ',')
-        goto next_line;
-      data = g_utf8_next_char (data);
-      if (data != end) {
-        g_free (title);
-        title = g_strdup (data);
-      }
+      /* no need to parse it if the media file is already known */
+      if (old_files && list == NULL
+          && gst_m3u8_find_old_file (&old_files, self->mediasequence))
+        extinf = data;
+      else
+        parse_extinf (self, data, &duration, &title);
     } else {
       GST_LOG ("Ignored line: %s", data);
     }
@@ -390,6 +481,14 @@ gst_m3u8_update (GstM3U8 * self, gchar * data, gboolean * updated)
       break;
     data = g_utf8_next_char (end);      /* skip \n */
   }
+  g_free (title);
+  g_free (lines);
+
+  /* the media files that left the playlist window */
+  g_list_foreach (old_files, (GFunc) gst_m3u8_media_file_free, NULL);
+  g_list_free (old_files);
+
+  self->files = g_list_concat (self->files, g_list_reverse (files));
 
   /* redorder playlists by bitrate */
   if (self->lists) {
@@ -118,6 +118,18 @@ struct _MpegTSBase {
   guint8 *known_psi;
   guint8 *is_pes;
 
+  /* If TRUE, the packetizer only parses packets of the known PSI PIDs and of
+   * the PIDs selected with mpegts_base_select_pid(), all others are dropped
+   * as early as possible. Meant to be set by subclasses at init time */
+  gboolean filter_pids;
+  guint8 *selected_pids;
+  /* known_psi | selected_pids, handed to the packetizer */
+  guint8 *pid_filter;
+
+  /* If FALSE, the DVB SI tables (NIT, SDT, EIT) are only parsed when they
+   * are needed for the program tags, and no element message is posted */
+  gboolean emit_si_messages;
+
   gboolean disposed;
 
   /* size of the MpegTSBaseProgram structure, can be overridden
@@ -176,10 +188,6 @@ struct _MpegTSBaseClass {
   void (*eit_info) (GstStructure *eit);
 };
 
-#define MPEGTS_BIT_SET(field, offs)    ((field)[(offs) >> 3] |=  (1 << ((offs) & 0x7)))
-#define MPEGTS_BIT_UNSET(field, offs)  ((field)[(offs) >> 3] &= ~(1 << ((offs) & 0x7)))
-#define MPEGTS_BIT_IS_SET(field, offs) ((field)[(offs) >> 3] &   (1 << ((offs) & 0x7)))
-
 GType mpegts_base_get_type(void);
 
 MpegTSBaseProgram *mpegts_base_get_program (MpegTSBase * base, gint program_number);
@@ -198,6 +206,8 @@ gboolean mpegts_base_handle_psi (MpegTSBase * base, MpegTSPacketizerSection * se
 void mpegts_base_program_remove_stream (MpegTSBase * base, MpegTSBaseProgram * program, guint16 pid);
 
 void mpegts_base_remove_program(MpegTSBase *base, gint program_number);
+
+void mpegts_base_select_pid (MpegTSBase * base, guint16 pid, gboolean selected);
 G_END_DECLS
 
 #endif /* GST_MPEG_TS_BASE_H */
@@ -38,6 +38,7 @@
 
 #include "mpegtspacketizer.h"
 #include "gstmpegdesc.h"
+#include <gst/mpeg-crc32-private.h>
 
 GST_DEBUG_CATEGORY_STATIC (mpegts_packetizer_debug);
 #define GST_CAT_DEFAULT mpegts_packetizer_debug
@@ -110,12 +111,27 @@ struct _MpegTSPacketizerPrivate
   /* Reference offset */
   guint64 refoffset;
 
+  /* Seek index: PCR values (rollover fixed) and the offsets where they were
+   * seen, sorted by offset. Filled in as PCRs are seen and only kept in
+   * memory, there are no random access points since the packetizer doesn't
+   * look into the PES payloads */
+  GArray *index;
+
   guint nb_seen_offsets;
 
   /* Last inputted timestamp */
   GstClockTime last_in_time;
 };
 
+typedef struct
+{
+  guint64 offset;
+  guint64 pcr;
+} MpegTSPacketizerIndexEntry;
+
+/* Minimum PCR distance between two seek index entries (500ms) */
+#define INDEX_PCR_INTERVAL (300 * CLOCK_BASE * 5000)
+
 static void mpegts_packetizer_dispose (GObject * object);
 static void mpegts_packetizer_finalize (GObject * object);
 static gchar *convert_to_utf8 (const gchar * text, gint length, guint start,
@@ -135,23 +151,20 @@ static void mpegts_packetizer_reset_skew (MpegTSPacketizer2 * packetizer);
 #define TABLE_ID_UNSET 0xFF
 #define PACKET_SYNC_BYTE 0x47
 
-static gint
-mpegts_packetizer_stream_subtable_compare (gconstpointer a, gconstpointer b)
+/* The subtable_extension of EIT sections is the service_id, the same service
+ * can be described for several transport streams */
+static guint32
+mpegts_packetizer_subtable_ts_key (guint8 table_id, const guint8 * data)
 {
-  MpegTSPacketizerStreamSubtable *asub, *bsub;
+  if (table_id >= 0x4E && table_id <= 0x6F)
+    return GST_READ_UINT32_BE (data + 8);
 
-  asub = (MpegTSPacketizerStreamSubtable *) a;
-  bsub = (MpegTSPacketizerStreamSubtable *) b;
-
-  if (asub->table_id == bsub->table_id &&
-      asub->subtable_extension == bsub->subtable_extension)
-    return 0;
-  return -1;
+  return 0;
 }
 
 static MpegTSPacketizerStreamSubtable *
 mpegts_packetizer_stream_subtable_new (guint8 table_id,
-    guint16 subtable_extension)
+    guint16 subtable_extension, guint32 ts_key)
 {
   MpegTSPacketizerStreamSubtable *subtable;
 
@@ -159,10 +172,30 @@ mpegts_packetizer_stream_subtable_new (guint8 table_id,
   subtable->version_number = VERSION_NUMBER_UNSET;
   subtable->table_id = table_id;
   subtable->subtable_extension = subtable_extension;
+  subtable->ts_key = ts_key;
   subtable->crc = 0;
   return subtable;
 }
 
+static MpegTSPacketizerStreamSubtable *
+mpegts_packetizer_stream_find_subtable (MpegTSPacketizerStream * stream,
+    guint8 table_id, guint16 subtable_extension, guint32 ts_key)
+{
+  GSList *tmp;
+
+  for (tmp = stream->subtables; tmp; tmp = tmp->next) {
+    MpegTSPacketizerStreamSubtable *sub =
+        (MpegTSPacketizerStreamSubtable *) tmp->data;
+
+    if (sub->table_id == table_id &&
+        sub->subtable_extension == subtable_extension &&
+        sub->ts_key == ts_key)
+      return sub;
+  }
+
+  return NULL;
+}
+
 static MpegTSPacketizerStream *
 mpegts_packetizer_stream_new (void)
 {
@@ -182,6 +215,7 @@ mpegts_packetizer_clear_section (MpegTSPacketizerStream * stream)
   stream->section_length = 0;
   stream->section_offset = 0;
   stream->section_table_id = TABLE_ID_UNSET;
+  stream->section_skip = FALSE;
 }
 
 static void
@@ -233,6 +267,8 @@ mpegts_packetizer_init (MpegTSPacketizer2 * packetizer)
   packetizer->priv->last_pcr = -1;
   packetizer->priv->last_pcr_ts = GST_CLOCK_TIME_NONE;
   packetizer->priv->nb_seen_offsets = 0;
+  packetizer->priv->index =
+      g_array_new (FALSE, FALSE, sizeof (MpegTSPacketizerIndexEntry));
   packetizer->priv->refoffset = -1;
   packetizer->priv->last_in_time = GST_CLOCK_TIME_NONE;
 }
@@ -271,6 +307,10 @@ mpegts_packetizer_dispose (GObject * object)
 static void
 mpegts_packetizer_finalize (GObject * object)
 {
+  MpegTSPacketizer2 *packetizer = GST_MPEGTS_PACKETIZER (object);
+
+  g_array_free (packetizer->priv->index, TRUE);
+
   if (G_OBJECT_CLASS (mpegts_packetizer_parent_class)->finalize)
     G_OBJECT_CLASS (mpegts_packetizer_parent_class)->finalize (object);
 }
@@ -373,6 +413,11 @@ mpegts_packetizer_parse_packet (MpegTSPacketizer2 * packetizer,
   packet->pid = GST_READ_UINT16_BE (data) & 0x1FFF;
   data += 2;
 
+  /* Drop the PIDs nobody is interested in before parsing anything else */
+  if (packetizer->pid_filter
+      && !MPEGTS_BIT_IS_SET (packetizer->pid_filter, packet->pid))
+    return PACKET_SKIPPED;
+
   /* transport_scrambling_control 2 */
   if (G_UNLIKELY (*data >> 6))
     return PACKET_BAD;
@@ -405,7 +450,8 @@ mpegts_packetizer_parse_section_header (MpegTSPacketizer2 * packetizer,
   guint8 tmp;
   guint8 *data, *crc_data;
   MpegTSPacketizerStreamSubtable *subtable;
-  GSList *subtable_list = NULL;
+  guint8 section_number = 0;
+  guint32 ts_key = 0;
 
   section->complete = TRUE;
   /* get the section buffer, ownership stays with the stream */
@@ -431,15 +477,16 @@ mpegts_packetizer_parse_section_header (MpegTSPacketizer2 * packetizer,
   else
     section->subtable_extension = GST_READ_UINT16_BE (data + 2);
 
-  subtable = mpegts_packetizer_stream_subtable_new (section->table_id,
-      section->subtable_extension);
+  /* EIT sections are at least 18 bytes long, checked when parsing them */
+  if (stream->section_length >= 12)
+    ts_key = mpegts_packetizer_subtable_ts_key (section->table_id,
+        section->data);
 
-  subtable_list = g_slist_find_custom (stream->subtables, subtable,
-      mpegts_packetizer_stream_subtable_compare);
-  if (subtable_list) {
-    g_free (subtable);
-    subtable = (MpegTSPacketizerStreamSubtable *) (subtable_list->data);
-  } else {
+  subtable = mpegts_packetizer_stream_find_subtable (stream, section->table_id,
+      section->subtable_extension, ts_key);
+  if (subtable == NULL) {
+    subtable = mpegts_packetizer_stream_subtable_new (section->table_id,
+        section->subtable_extension, ts_key);
     stream->subtables = g_slist_prepend (stream->subtables, subtable);
   }
 
@@ -464,14 +511,35 @@ mpegts_packetizer_parse_section_header (MpegTSPacketizer2 * packetizer,
   if (!section->current_next_indicator)
     goto not_applicable;
 
+  /* section_number         : 8 bits (long sections only) */
+  if (section->section_length >= 8 && (section->data[1] & 0x80))
+    section_number = *data;
+
   /* CRC is at the end of the section */
   crc_data = section->data + section->section_length - 4;
   section->crc = GST_READ_UINT32_BE (crc_data);
 
+  /* table ids 0x70 - 0x73 do not have a crc (EN 300 468) */
+  /* table ids 0x75 - 0x77 do not have a crc (TS 102 323) */
+  /* table id 0x7e does not have a crc (EN 300 468) */
+  /* table ids 0x80 - 0x8f do not have a crc (CA_message section ETR 289) */
+  /* check it before the section is marked as seen, so that the next copy
+   * of a corrupt section is not skipped */
+  if (G_LIKELY ((section->table_id < 0x70 || section->table_id > 0x73)
+          && (section->table_id < 0x75 || section->table_id > 0x77)
+          && (section->table_id < 0x80 || section->table_id > 0x8f)
+          && (section->table_id != 0x7e))) {
+    if (G_UNLIKELY (mpeg_crc32 (section->data, section->section_length) != 0))
+      goto bad_crc;
+  }
+
   if (section->version_number == subtable->version_number &&
       section->crc == subtable->crc)
     goto no_changes;
 
+  if (section->version_number != subtable->version_number)
+    memset (subtable->seen_sections, 0, sizeof (subtable->seen_sections));
+  subtable->seen_sections[section_number >> 3] |= 1 << (section_number & 7);
   subtable->version_number = section->version_number;
   subtable->crc = section->crc;
   stream->section_table_id = section->table_id;
@@ -486,6 +554,12 @@ no_changes:
   section->complete = FALSE;
   return TRUE;
 
+bad_crc:
+  GST_WARNING ("bad crc in psi pid 0x%04x (table_id:0x%02x)", section->pid,
+      section->table_id);
+  section->complete = FALSE;
+  return FALSE;
+
 not_applicable:
   GST_LOG
       ("not applicable pid 0x%04x table_id 0x%02x subtable_extension %d, current_next %d version %d, crc 0x%x",
@@ -2281,6 +2355,15 @@ mpegts_packetizer_clear (MpegTSPacketizer2 * packetizer)
   packetizer->priv->last_in_time = GST_CLOCK_TIME_NONE;
 }
 
+/* The seek index outlives mpegts_packetizer_clear() and
+ * mpegts_packetizer_flush(), the offsets stay valid as long as the stream
+ * is the same. This drops it when the stream changes */
+void
+mpegts_packetizer_reset_index (MpegTSPacketizer2 * packetizer)
+{
+  g_array_set_size (packetizer->priv->index, 0);
+}
+
 void
 mpegts_packetizer_flush (MpegTSPacketizer2 * packetizer)
 {
@@ -2292,7 +2375,7 @@ mpegts_packetizer_flush (MpegTSPacketizer2 * packetizer)
       }
     }
   }
-  gst_adapter_flush (packetizer->adapter, packetizer->priv->available);
+  gst_adapter_clear (packetizer->adapter);
 
   packetizer->offset = 0;
   packetizer->empty = TRUE;
@@ -2345,7 +2428,7 @@ mpegts_packetizer_push (MpegTSPacketizer2 * packetizer, GstBuffer * buffer)
 static gboolean
 mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
 {
-  guint8 *dest;
+  const guint8 *data, *sync;
   int i, pos = -1, j;
   static const guint psizes[] = {
     MPEGTS_NORMAL_PACKETSIZE,
@@ -2354,37 +2437,36 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
     MPEGTS_ATSC_PACKETSIZE
   };
 
-
-  dest = g_malloc (MPEGTS_MAX_PACKETSIZE * 4);
   /* wait for 3 sync bytes */
   while (packetizer->priv->available >= MPEGTS_MAX_PACKETSIZE * 4) {
 
-    /* check for sync bytes */
-    gst_adapter_copy (packetizer->adapter, dest, 0, MPEGTS_MAX_PACKETSIZE * 4);
-    /* find first sync byte */
-    pos = -1;
-    for (i = 0; i < MPEGTS_MAX_PACKETSIZE; i++) {
-      if (dest[i] == PACKET_SYNC_BYTE) {
-        for (j = 0; j < 4; j++) {
-          guint packetsize = psizes[j];
-          /* check each of the packet size possibilities in turn */
-          if (dest[i] == PACKET_SYNC_BYTE
-              && dest[i + packetsize] == PACKET_SYNC_BYTE
-              && dest[i + packetsize * 2] == PACKET_SYNC_BYTE
-              && dest[i + packetsize * 3] == PACKET_SYNC_BYTE) {
-            packetizer->know_packet_size = TRUE;
-            packetizer->packet_size = packetsize;
-            packetizer->caps = gst_caps_new_simple ("video/mpegts",
-                "systemstream", G_TYPE_BOOLEAN, TRUE,
-                "packetsize", G_TYPE_INT, packetsize, NULL);
-            if (packetsize == MPEGTS_M2TS_PACKETSIZE)
-              pos = i - 4;
-            else
-              pos = i;
-            break;
-          }
-        }
+    /* check for sync bytes. The adapter hands out a pointer in the first
+     * buffer, or reuses its own assembly area, so there's no need to copy */
+    data = gst_adapter_peek (packetizer->adapter, MPEGTS_MAX_PACKETSIZE * 4);
+    /* try each sync byte candidate of the first packet */
+    for (i = 0; i < MPEGTS_MAX_PACKETSIZE && !packetizer->know_packet_size;
+        i = sync - data + 1) {
+      sync = memchr (data + i, PACKET_SYNC_BYTE, MPEGTS_MAX_PACKETSIZE - i);
+      if (sync == NULL)
         break;
+      i = sync - data;
+      for (j = 0; j < 4; j++) {
+        guint packetsize = psizes[j];
+        /* check each of the packet size possibilities in turn */
+        if (data[i + packetsize] == PACKET_SYNC_BYTE
+            && data[i + packetsize * 2] == PACKET_SYNC_BYTE
+            && data[i + packetsize * 3] == PACKET_SYNC_BYTE) {
+          packetizer->know_packet_size = TRUE;
+          packetizer->packet_size = packetsize;
+          packetizer->caps = gst_caps_new_simple ("video/mpegts",
+              "systemstream", G_TYPE_BOOLEAN, TRUE,
+              "packetsize", G_TYPE_INT, packetsize, NULL);
+          if (packetsize == MPEGTS_M2TS_PACKETSIZE)
+            pos = i - 4;
+          else
+            pos = i;
+          break;
+        }
       }
     }
 
@@ -2397,8 +2479,6 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
     packetizer->offset += MPEGTS_MAX_PACKETSIZE;
   }
 
-  g_free (dest);
-
   if (packetizer->know_packet_size) {
     GST_DEBUG ("have packetsize detected: %d of %u bytes",
         packetizer->know_packet_size, packetizer->packet_size);
@@ -2407,7 +2487,7 @@ mpegts_try_discover_packet_size (MpegTSPacketizer2 * packetizer)
       GST_DEBUG ("Flushing out %d bytes", pos);
       gst_adapter_flush (packetizer->adapter, pos);
       packetizer->offset += pos;
-      packetizer->priv->available -= MPEGTS_MAX_PACKETSIZE;
+      packetizer->priv->available -= pos;
     }
   } else {
     /* drop invalid data and move to the next possible packets */
@@ -2427,36 +2507,105 @@ mpegts_packetizer_has_packets (MpegTSPacketizer2 * packetizer)
   return packetizer->priv->available >= packetizer->packet_size;
 }
 
+/* Maps as many complete packets as available from the adapter */
+static inline void
+mpegts_packetizer_map (MpegTSPacketizer2 * packetizer)
+{
+  MpegTSPacketizerPrivate *priv = packetizer->priv;
+
+  priv->mapped_size =
+      priv->available - (priv->available % packetizer->packet_size);
+  priv->mapped =
+      (guint8 *) gst_adapter_peek (packetizer->adapter, priv->mapped_size);
+  priv->offset = 0;
+}
+
+/* Flushes the consumed data out of the adapter once the mapped region doesn't
+ * contain any complete packet anymore */
+static inline void
+mpegts_packetizer_flush_mapped (MpegTSPacketizer2 * packetizer)
+{
+  MpegTSPacketizerPrivate *priv = packetizer->priv;
+
+  if (priv->mapped
+      && priv->offset + packetizer->packet_size > priv->mapped_size) {
+    gst_adapter_flush (packetizer->adapter, priv->offset);
+    priv->mapped = NULL;
+  }
+}
+
+/* Moves the read position to the next sync byte of the mapped region, or to
+ * the end of the region if it doesn't contain any */
+static void
+mpegts_packetizer_find_sync (MpegTSPacketizer2 * packetizer)
+{
+  MpegTSPacketizerPrivate *priv = packetizer->priv;
+  guint packet_size = packetizer->packet_size;
+  const guint8 *start, *end, *pos, *sync = NULL;
+  guint skip;
+
+  /* M2TS packets don't start with the sync byte, all other variants do */
+  start = priv->mapped + priv->offset;
+  if (packet_size == MPEGTS_M2TS_PACKETSIZE)
+    start += 4;
+  end = priv->mapped + priv->mapped_size;
+
+  /* memchr() is vectorized by the C library, which makes it a lot faster
+   * than checking the bytes one by one */
+  for (pos = start + 1; pos < end; pos = sync + 1) {
+    sync = memchr (pos, PACKET_SYNC_BYTE, end - pos);
+    if (sync == NULL)
+      break;
+    /* Check against the sync byte of the following packet if we have it, to
+     * avoid locking on a 0x47 contained in the payload */
+    if (sync + packet_size >= end || sync[packet_size] == PACKET_SYNC_BYTE)
+      break;
+  }
+
+  if (G_UNLIKELY (sync == NULL || sync >= end)) {
+    GST_ERROR ("REALLY lost the sync");
+    skip = priv->mapped_size - priv->offset;
+  } else
+    skip = sync - start;
+
+  GST_LOG ("Skipping %u bytes to resync", skip);
+  priv->offset += skip;
+  priv->available -= skip;
+  packetizer->offset += skip;
+}
+
 MpegTSPacketizerPacketReturn
 mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
     MpegTSPacketizerPacket * packet)
 {
-  guint avail;
+  MpegTSPacketizerPrivate *priv = packetizer->priv;
 
   if (G_UNLIKELY (!packetizer->know_packet_size)) {
     if (!mpegts_try_discover_packet_size (packetizer))
       return PACKET_NEED_MORE;
   }
 
-  while ((avail = packetizer->priv->available) >= packetizer->packet_size) {
+  mpegts_packetizer_flush_mapped (packetizer);
+
+  while (priv->available >= packetizer->packet_size) {
     GST_DEBUG ("mapped:%p, mapped_size:%d, offset:%d",
-        packetizer->priv->mapped,
-        packetizer->priv->mapped_size, packetizer->priv->offset);
-    if (packetizer->priv->mapped == NULL) {
-      packetizer->priv->mapped_size =
-          packetizer->priv->available -
-          (packetizer->priv->available % packetizer->packet_size);
-      packetizer->priv->mapped =
-          (guint8 *) gst_adapter_peek (packetizer->adapter,
-          packetizer->priv->mapped_size);
-      packetizer->priv->offset = 0;
-    }
-    packet->data_start = packetizer->priv->mapped + packetizer->priv->offset;
+        priv->mapped, priv->mapped_size, priv->offset);
+    if (priv->mapped == NULL)
+      mpegts_packetizer_map (packetizer);
+    packet->data_start = priv->mapped + priv->offset;
 
     /* M2TS packets don't start with the sync byte, all other variants do */
     if (packetizer->packet_size == MPEGTS_M2TS_PACKETSIZE)
       packet->data_start += 4;
 
+    /* Check sync byte */
+    if (G_UNLIKELY (packet->data_start[0] != PACKET_SYNC_BYTE)) {
+      GST_LOG ("Lost sync %d", packetizer->packet_size);
+      mpegts_packetizer_find_sync (packetizer);
+      mpegts_packetizer_flush_mapped (packetizer);
+      continue;
+    }
+
     /* ALL mpeg-ts variants contain 188 bytes of data. Those with bigger packet
      * sizes contain either extra data (timesync, FEC, ..) either before or after
      * the data */
@@ -2465,44 +2614,96 @@ mpegts_packetizer_next_packet (MpegTSPacketizer2 * packetizer,
     GST_DEBUG ("offset %" G_GUINT64_FORMAT, packet->offset);
     packetizer->offset += packetizer->packet_size;
     GST_MEMDUMP ("data_start", packet->data_start, 16);
-    packet->origts = packetizer->priv->last_in_time;
+    packet->origts = priv->last_in_time;
 
-    /* Check sync byte */
-    if (G_UNLIKELY (packet->data_start[0] != 0x47)) {
-      guint i;
+    return mpegts_packetizer_parse_packet (packetizer, packet);
+  }
 
-      GST_LOG ("Lost sync %d", packetizer->packet_size);
-      /* Find the 0x47 in the buffer */
-      for (i = 0; i < packetizer->packet_size; i++)
-        if (packet->data_start[i] == 0x47)
-          break;
-      if (G_UNLIKELY (i == packetizer->packet_size)) {
-        GST_ERROR ("REALLY lost the sync");
-        goto done;
-      }
+  return PACKET_NEED_MORE;
+}
 
-      if (packetizer->packet_size == MPEGTS_M2TS_PACKETSIZE) {
-        if (i >= 4)
-          i -= 4;
-        else
-          i += 188;
-      }
+/**
+ * mpegts_packetizer_next_packets:
+ * @packetizer: a #MpegTSPacketizer2
+ * @packets: (out caller-allocates): array of at least @max_packets packets
+ * @max_packets: maximum number of packets to parse
+ *
+ * Parses up to @max_packets packets from the data currently available in
+ * one go, skipping bad packets and the ones filtered out by
+ * @packetizer's pid_filter. The batch ends after a packet of one of
+ * @packetizer's psi_pids, as handling it may change the pid_filter.
+ * Contrary to mpegts_packetizer_next_packet(), the returned packets are
+ * consumed by this call and must NOT be passed to
+ * mpegts_packetizer_clear_packet().
+ *
+ * The data of the returned packets stays valid until the next call to this
+ * function, mpegts_packetizer_flush() or mpegts_packetizer_clear().
+ *
+ * Returns: the number of packets stored in @packets, 0 if more data is needed
+ */
+guint
+mpegts_packetizer_next_packets (MpegTSPacketizer2 * packetizer,
+    MpegTSPacketizerPacket * packets, guint max_packets)
+{
+  MpegTSPacketizerPrivate *priv = packetizer->priv;
+  MpegTSPacketizerPacket *packet;
+  MpegTSPacketizerPacketReturn ret;
+  guint packet_size, nb = 0;
 
-      /* Pop out the remaining data... */
-      packetizer->priv->offset += i;
-      packetizer->priv->available -= i;
-      if (G_UNLIKELY (packetizer->priv->available < packetizer->packet_size)) {
-        gst_adapter_flush (packetizer->adapter, packetizer->priv->offset);
-        packetizer->priv->mapped = NULL;
-      }
+  if (G_UNLIKELY (!packetizer->know_packet_size)) {
+    if (!mpegts_try_discover_packet_size (packetizer))
+      return 0;
+  }
+  packet_size = packetizer->packet_size;
+
+  /* The packets handed out by the previous call are not used anymore */
+  mpegts_packetizer_flush_mapped (packetizer);
+
+  while (nb < max_packets && priv->available >= packet_size) {
+    if (priv->mapped && priv->offset + packet_size > priv->mapped_size) {
+      /* The packets we already parsed point into the mapped region, we can
+       * only release it on the next call */
+      if (nb > 0)
+        break;
+      mpegts_packetizer_flush_mapped (packetizer);
+    }
+    if (priv->mapped == NULL)
+      mpegts_packetizer_map (packetizer);
+
+    packet = &packets[nb];
+    packet->data_start = priv->mapped + priv->offset;
+    if (packet_size == MPEGTS_M2TS_PACKETSIZE)
+      packet->data_start += 4;
+
+    if (G_UNLIKELY (packet->data_start[0] != PACKET_SYNC_BYTE)) {
+      GST_LOG ("Lost sync %d", packet_size);
+      mpegts_packetizer_find_sync (packetizer);
       continue;
     }
 
-    return mpegts_packetizer_parse_packet (packetizer, packet);
+    packet->data_end = packet->data_start + 188;
+    packet->offset = packetizer->offset;
+    packet->origts = priv->last_in_time;
+    packetizer->offset += packet_size;
+    priv->offset += packet_size;
+    priv->available -= packet_size;
+
+    ret = mpegts_packetizer_parse_packet (packetizer, packet);
+    if (G_LIKELY (ret == PACKET_OK)) {
+      nb++;
+      /* the following packets have to go through the pid filter as it is
+       * once this one is handled */
+      if (packetizer->psi_pids
+          && MPEGTS_BIT_IS_SET (packetizer->psi_pids, packet->pid))
+        break;
+    } else if (ret == PACKET_BAD)
+      GST_DEBUG ("bad packet at offset %" G_GUINT64_FORMAT ", skipping",
+          packet->offset);
   }
 
-done:
-  return PACKET_NEED_MORE;
+  GST_LOG ("Parsed %u packets", nb);
+
+  return nb;
 }
 
 MpegTSPacketizerPacketReturn
@@ -2515,10 +2716,7 @@ mpegts_packetizer_process_next_packet (MpegTSPacketizer2 * packetizer)
   if (ret != PACKET_NEED_MORE) {
     packetizer->priv->offset += packetizer->packet_size;
     packetizer->priv->available -= packetizer->packet_size;
-    if (G_UNLIKELY (packetizer->priv->available < packetizer->packet_size)) {
-      gst_adapter_flush (packetizer->adapter, packetizer->priv->offset);
-      packetizer->priv->mapped = NULL;
-    }
+    mpegts_packetizer_flush_mapped (packetizer);
   }
   return ret;
 }
@@ -2530,10 +2728,7 @@ mpegts_packetizer_clear_packet (MpegTSPacketizer2 * packetizer,
   memset (packet, 0, sizeof (MpegTSPacketizerPacket));
   packetizer->priv->offset += packetizer->packet_size;
   packetizer->priv->available -= packetizer->packet_size;
-  if (G_UNLIKELY (packetizer->priv->available < packetizer->packet_size)) {
-    gst_adapter_flush (packetizer->adapter, packetizer->priv->offset);
-    packetizer->priv->mapped = NULL;
-  }
+  mpegts_packetizer_flush_mapped (packetizer);
 }
 
 gboolean
@@ -2546,6 +2741,7 @@ mpegts_packetizer_push_section (MpegTSPacketizer2 * packetizer,
   guint16 subtable_extension;
   guint section_length;
   guint8 *data, *data_start;
+  MpegTSPacketizerStreamSubtable *subtable;
 
   data = packet->data;
   section->pid = packet->pid;
@@ -2620,6 +2816,31 @@ mpegts_packetizer_push_section (MpegTSPacketizer2 * packetizer,
     }
     stream->continuity_counter = packet->continuity_counter;
     stream->section_length = section_length;
+    stream->section_table_id = table_id;
+    stream->offset = packet->offset;
+
+    /* Long sections carry their version and section_number in the first 8
+     * bytes. If this section of the current subtable version was already
+     * seen, there is no need to reassemble it again: only keep track of the
+     * continuity until it is over */
+    if ((data[0] & 0x80) && packet->data_end - data_start >= 12 &&
+        (data_start[5] & 0x01)) {
+      subtable = mpegts_packetizer_stream_find_subtable (stream,
+          table_id, table_id == 0 ? 0 : subtable_extension,
+          mpegts_packetizer_subtable_ts_key (table_id, data_start));
+      if (subtable &&
+          subtable->version_number == ((data_start[5] >> 1) & 0x1F) &&
+          (subtable->seen_sections[data_start[6] >> 3] &
+              (1 << (data_start[6] & 7)))) {
+        GST_LOG ("PID 0x%04x table_id 0x%02x section %d of version %d "
+            "already seen, skipping", packet->pid, table_id, data_start[6],
+            subtable->version_number);
+        stream->section_skip = TRUE;
+        stream->section_offset = packet->data_end - data_start;
+        res = TRUE;
+        goto check_complete;
+      }
+    }
 
     /* Create enough room to store chunks of sections, including FF padding */
     if (stream->section_allocated == 0) {
@@ -2633,9 +2854,6 @@ mpegts_packetizer_push_section (MpegTSPacketizer2 * packetizer,
     memcpy (stream->section_data, data_start, packet->data_end - data_start);
     stream->section_offset = packet->data_end - data_start;
 
-    stream->section_table_id = table_id;
-    stream->offset = packet->offset;
-
     res = TRUE;
   } else if (stream->continuity_counter != CONTINUITY_UNSET &&
       (packet->continuity_counter == stream->continuity_counter + 1 ||
@@ -2643,8 +2861,9 @@ mpegts_packetizer_push_section (MpegTSPacketizer2 * packetizer,
               packet->continuity_counter == 0))) {
     stream->continuity_counter = packet->continuity_counter;
 
-    memcpy (stream->section_data + stream->section_offset, data_start,
-        packet->data_end - data_start);
+    if (!stream->section_skip)
+      memcpy (stream->section_data + stream->section_offset, data_start,
+          packet->data_end - data_start);
     stream->section_offset += packet->data_end - data_start;
     GST_DEBUG ("Appending data (need %d, have %d)", stream->section_length,
         stream->section_offset);
@@ -2660,6 +2879,7 @@ mpegts_packetizer_push_section (MpegTSPacketizer2 * packetizer,
     mpegts_packetizer_clear_section (stream);
   }
 
+check_complete:
   if (res) {
     /* we pushed some data in the section adapter, see if the section is
      * complete now */
@@ -2667,8 +2887,11 @@ mpegts_packetizer_push_section (MpegTSPacketizer2 * packetizer,
     /* >= as sections can be padded and padding is not included in
      * section_length */
     if (stream->section_offset >= stream->section_length) {
-      res = mpegts_packetizer_parse_section_header (packetizer,
-          stream, section);
+      if (stream->section_skip)
+        section->complete = FALSE;
+      else
+        res = mpegts_packetizer_parse_section_header (packetizer,
+            stream, section);
 
       /* flush stuffing bytes */
       mpegts_packetizer_clear_section (stream);
@@ -3322,11 +3545,86 @@ no_skew:
   return out_time;
 }
 
+/* Adds a PCR to the seek index, unless it is too close to the existing
+ * neighbouring entries or inconsistent with them (discontinuity) */
+static void
+mpegts_packetizer_index_add (MpegTSPacketizerPrivate * priv, guint64 pcr,
+    guint64 offset)
+{
+  MpegTSPacketizerIndexEntry *entries, entry;
+  guint len = priv->index->len;
+  guint low = 0, high = len, mid;
+
+  entries = (MpegTSPacketizerIndexEntry *) priv->index->data;
+
+  /* Look for the first entry after offset. While playing, PCRs come in
+   * order so that's the end of the index */
+  if (len > 0 && entries[len - 1].offset < offset) {
+    low = len;
+  } else {
+    while (low < high) {
+      mid = (low + high) / 2;
+      if (entries[mid].offset <= offset)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+  }
+
+  if (low > 0 && (entries[low - 1].offset == offset ||
+          pcr < entries[low - 1].pcr + INDEX_PCR_INTERVAL))
+    return;
+  if (low < len && pcr + INDEX_PCR_INTERVAL > entries[low].pcr)
+    return;
+
+  entry.offset = offset;
+  entry.pcr = pcr;
+  g_array_insert_val (priv->index, low, entry);
+}
+
+/* Looks for the index entries around pcr and interpolates the offset
+ * between them. Returns FALSE if pcr is not within the index */
+static gboolean
+mpegts_packetizer_index_lookup (MpegTSPacketizerPrivate * priv, guint64 pcr,
+    guint64 * offset)
+{
+  MpegTSPacketizerIndexEntry *entries, *prev, *next;
+  guint low = 0, high = priv->index->len, mid;
+
+  entries = (MpegTSPacketizerIndexEntry *) priv->index->data;
+
+  if (high < 2 || pcr < entries[0].pcr || pcr > entries[high - 1].pcr)
+    return FALSE;
+
+  /* first entry with a PCR above the target */
+  while (low < high) {
+    mid = (low + high) / 2;
+    if (entries[mid].pcr <= pcr)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  if (low == priv->index->len)
+    low--;
+
+  prev = &entries[low - 1];
+  next = &entries[low];
+  *offset = prev->offset + gst_util_uint64_scale (pcr - prev->pcr,
+      next->offset - prev->offset, next->pcr - prev->pcr);
+
+  return TRUE;
+}
+
 static void
 record_pcr (MpegTSPacketizer2 * packetizer, guint64 pcr, guint64 offset)
 {
   MpegTSPacketizerPrivate *priv = packetizer->priv;
 
+  if (priv->first_pcr != -1 && pcr < priv->first_pcr)
+    mpegts_packetizer_index_add (priv, pcr + PCR_MAX_VALUE, offset);
+  else
+    mpegts_packetizer_index_add (priv, pcr, offset);
+
   /* Check against first PCR */
   if (priv->first_pcr == -1 || priv->first_offset > offset) {
     GST_DEBUG ("Recording first value. PCR:%" G_GUINT64_FORMAT " offset:%"
@@ -3421,10 +3719,19 @@ mpegts_packetizer_ts_to_offset (MpegTSPacketizer2 * packetizer, GstClockTime ts)
   GST_DEBUG ("ts(pcr) %" G_GUINT64_FORMAT " first_pcr:%" G_GUINT64_FORMAT,
       GSTTIME_TO_MPEGTIME (ts), priv->first_pcr);
 
-  /* Convert ts to PCRTIME */
-  res = gst_util_uint64_scale (GSTTIME_TO_PCRTIME (ts),
-      priv->last_offset - priv->first_offset, priv->last_pcr - priv->first_pcr);
-  res += priv->first_offset + priv->refoffset;
+  /* Use the closest PCRs seen so far if possible, else interpolate between
+   * the first and last ones */
+  if (mpegts_packetizer_index_lookup (priv,
+          priv->first_pcr + GSTTIME_TO_PCRTIME (ts), &res)) {
+    GST_DEBUG ("Found offset in index (%u entries)", priv->index->len);
+    res += priv->refoffset;
+  } else {
+    /* Convert ts to PCRTIME */
+    res = gst_util_uint64_scale (GSTTIME_TO_PCRTIME (ts),
+        priv->last_offset - priv->first_offset,
+        priv->last_pcr - priv->first_pcr);
+    res += priv->first_offset + priv->refoffset;
+  }
 
   GST_DEBUG ("Returning offset %" G_GUINT64_FORMAT " for ts %" GST_TIME_FORMAT,
       res, GST_TIME_ARGS (ts));
@@ -43,6 +43,10 @@
 
 #define MAX_WINDOW 512
 
+#define MPEGTS_BIT_SET(field, offs)    ((field)[(offs) >> 3] |=  (1 << ((offs) & 0x7)))
+#define MPEGTS_BIT_UNSET(field, offs)  ((field)[(offs) >> 3] &= ~(1 << ((offs) & 0x7)))
+#define MPEGTS_BIT_IS_SET(field, offs) ((field)[(offs) >> 3] &   (1 << ((offs) & 0x7)))
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_MPEGTS_PACKETIZER \
@@ -74,6 +78,8 @@ typedef struct
   guint16 section_offset;
   /* table_id of the pending section_data */
   guint8  section_table_id;
+  /* TRUE if the pending section was already seen and is not copied */
+  gboolean section_skip;
 
   GSList *subtables;
 
@@ -93,6 +99,15 @@ struct _MpegTSPacketizer2 {
   guint16     packet_size;
   GstCaps    *caps;
 
+  /* PIDs to parse (8192 bits), or NULL to parse all of them. Packets of
+   * other PIDs are dropped right after reading their header.
+   * Not owned, use MPEGTS_BIT_* to check the values */
+  const guint8 *pid_filter;
+  /* PIDs carrying PSI (8192 bits), or NULL. Handling such a packet can
+   * change pid_filter, so mpegts_packetizer_next_packets() ends its batch
+   * right after one. Not owned */
+  const guint8 *psi_pids;
+
   /* current offset of the tip of the adapter */
   guint64  offset;
   gboolean empty;
@@ -171,14 +186,20 @@ typedef struct
    * section when the section_syntax_indicator is set to a value of "1". If 
    * section_syntax_indicator is 0, sub_table_extension will be set to 0 */
   guint16 subtable_extension;
+  /* EIT subtables are also identified by their transport_stream_id and
+   * original_network_id (bytes 8 to 11), 0 for other tables */
+  guint32 ts_key;
   guint8 version_number;
   guint32 crc;
+  /* section_number values seen for version_number (256 bits) */
+  guint8 seen_sections[32];
 } MpegTSPacketizerStreamSubtable;
 
 typedef enum {
   PACKET_BAD       = FALSE,
   PACKET_OK        = TRUE,
-  PACKET_NEED_MORE
+  PACKET_NEED_MORE,
+  PACKET_SKIPPED		/* PID not in the filter */
 } MpegTSPacketizerPacketReturn;
 
 GType mpegts_packetizer_get_type(void);
@@ -186,12 +207,15 @@ GType mpegts_packetizer_get_type(void);
 MpegTSPacketizer2 *mpegts_packetizer_new (void);
 void mpegts_packetizer_clear (MpegTSPacketizer2 *packetizer);
 void mpegts_packetizer_flush (MpegTSPacketizer2 *packetizer);
+void mpegts_packetizer_reset_index (MpegTSPacketizer2 *packetizer);
 void mpegts_packetizer_push (MpegTSPacketizer2 *packetizer, GstBuffer *buffer);
 gboolean mpegts_packetizer_has_packets (MpegTSPacketizer2 *packetizer);
 MpegTSPacketizerPacketReturn mpegts_packetizer_next_packet (MpegTSPacketizer2 *packetizer,
   MpegTSPacketizerPacket *packet);
 MpegTSPacketizerPacketReturn
 mpegts_packetizer_process_next_packet(MpegTSPacketizer2 * packetizer);
+guint mpegts_packetizer_next_packets (MpegTSPacketizer2 *packetizer,
+  MpegTSPacketizerPacket *packets, guint max_packets);
 void mpegts_packetizer_clear_packet (MpegTSPacketizer2 *packetizer,
   MpegTSPacketizerPacket *packet);
 void mpegts_packetizer_remove_stream(MpegTSPacketizer2 *packetizer,
@@ -36,6 +36,7 @@
 
 #include <glib.h>
 #include <gst/tag/tag.h>
+#include <gst/base/gstdataqueue.h>
 
 #include "mpegtsbase.h"
 #include "tsdemux.h"
@@ -53,6 +54,16 @@
 /* latency in mseconds */
 #define TS_LATENCY 700
 
+/* Limits of the per-pad queue used with threaded-push */
+#define THREADED_PUSH_MAX_BUFFERS 100
+#define THREADED_PUSH_MAX_BYTES (4 * 1024 * 1024)
+
+/* Limits of the initial size of PES buffers with an unbounded length. They
+ * are still grown as needed past the maximum, but a single huge payload
+ * (corrupt or missing PES start) doesn't inflate all the following ones */
+#define PES_MIN_ALLOC 8192
+#define PES_MAX_ALLOC (2 * 1024 * 1024)
+
 #define TABLE_ID_UNSET 0xFF
 
 #define PCR_WRAP_SIZE_128KBPS (((gint64)1490)*(1024*1024))
@@ -115,8 +126,10 @@ struct _TSDemuxStream
   /* Whether the pad was added or not */
   gboolean active;
 
-  /* the return of the latest push */
-  GstFlowReturn flow_return;
+  /* the return of the latest push (GstFlowReturn). Accessed atomically, with
+   * threaded-push it is set by the pad task and read by the streaming
+   * thread */
+  gint flow_return;
 
   /* Output data */
   PendingPacketState state;
@@ -130,6 +143,9 @@ struct _TSDemuxStream
   /* Size of currently queued data */
   guint current_size;
   guint allocated_size;
+  /* Size of the last pushed PES payload, used to size the next one when the
+   * PES packet length is unbounded (video) */
+  guint last_size;
 
   /* Current PTS/DTS for this stream */
   GstClockTime pts;
@@ -148,6 +164,14 @@ struct _TSDemuxStream
   gboolean need_newsegment;
 
   GstTagList *taglist;
+
+  /* threaded-push: buffers and events waiting to be pushed by the pad task */
+  GstDataQueue *queue;
+  /* protects drained */
+  GMutex *queue_lock;
+  GCond *queue_cond;
+  /* Set by the pad task once it pushed an EOS or stopped */
+  gboolean drained;
 };
 
 #define VIDEO_CAPS \
@@ -217,6 +241,7 @@ enum
   ARG_0,
   PROP_PROGRAM_NUMBER,
   PROP_EMIT_STATS,
+  PROP_THREADED_PUSH,
   /* FILL ME */
 };
 
@@ -305,6 +330,13 @@ gst_ts_demux_class_init (GstTSDemuxClass * klass)
           "Emit messages for every pcr/opcr/pts/dts", FALSE,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_THREADED_PUSH,
+      g_param_spec_boolean ("threaded-push", "Threaded push",
+          "Push the data of each source pad from its own streaming thread, "
+          "so that a slow downstream branch does not block the others "
+          "(only applies to pads created afterwards)", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
 
   ts_class = GST_MPEGTS_BASE_CLASS (klass);
   ts_class->reset = GST_DEBUG_FUNCPTR (gst_ts_demux_reset);
@@ -342,6 +374,8 @@ static void
 gst_ts_demux_init (GstTSDemux * demux, GstTSDemuxClass * klass)
 {
   GST_MPEGTS_BASE (demux)->stream_size = sizeof (TSDemuxStream);
+  /* We only output one program, don't parse packets of the other ones */
+  GST_MPEGTS_BASE (demux)->filter_pids = TRUE;
 
   gst_ts_demux_reset ((MpegTSBase *) demux);
 }
@@ -362,6 +396,9 @@ gst_ts_demux_set_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       demux->emit_statistics = g_value_get_boolean (value);
       break;
+    case PROP_THREADED_PUSH:
+      demux->threaded_push = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -380,6 +417,9 @@ gst_ts_demux_get_property (GObject * object, guint prop_id,
     case PROP_EMIT_STATS:
       g_value_set_boolean (value, demux->emit_statistics);
       break;
+    case PROP_THREADED_PUSH:
+      g_value_set_boolean (value, demux->threaded_push);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
   }
@@ -590,6 +630,172 @@ gst_ts_demux_srcpad_event (GstPad * pad, GstEvent * event)
   return res;
 }
 
+static void
+queue_item_destroy (GstDataQueueItem * item)
+{
+  gst_mini_object_replace (&item->object, NULL);
+  g_slice_free (GstDataQueueItem, item);
+}
+
+static gboolean
+queue_check_full_func (GstDataQueue * queue, guint visible, guint bytes,
+    guint64 time, gpointer checkdata)
+{
+  return visible >= THREADED_PUSH_MAX_BUFFERS
+      || bytes >= THREADED_PUSH_MAX_BYTES;
+}
+
+/* Takes ownership of @object. Returns FALSE if the queue is flushing */
+static gboolean
+gst_ts_demux_stream_queue_object (TSDemuxStream * stream,
+    GstMiniObject * object)
+{
+  GstDataQueueItem *item;
+
+  item = g_slice_new0 (GstDataQueueItem);
+  item->object = object;
+  if (GST_IS_BUFFER (object)) {
+    item->size = GST_BUFFER_SIZE (object);
+    item->duration = GST_BUFFER_DURATION (object);
+    item->visible = TRUE;
+  } else {
+    item->duration = GST_CLOCK_TIME_NONE;
+  }
+  item->destroy = (GDestroyNotify) queue_item_destroy;
+
+  if (!gst_data_queue_push (stream->queue, item)) {
+    GST_DEBUG_OBJECT (stream->pad, "queue flushing, dropping %"
+        GST_PTR_FORMAT, object);
+    item->destroy (item);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+gst_ts_demux_stream_set_drained (TSDemuxStream * stream)
+{
+  g_mutex_lock (stream->queue_lock);
+  stream->drained = TRUE;
+  g_cond_broadcast (stream->queue_cond);
+  g_mutex_unlock (stream->queue_lock);
+}
+
+static void
+gst_ts_demux_stream_loop (TSDemuxStream * stream)
+{
+  GstDataQueueItem *item;
+  GstMiniObject *object;
+
+  if (!gst_data_queue_pop (stream->queue, &item))
+    goto flushing;
+
+  object = item->object;
+  item->object = NULL;
+  item->destroy (item);
+
+  if (GST_IS_BUFFER (object)) {
+    GstFlowReturn ret;
+
+    ret = gst_pad_push (stream->pad, GST_BUFFER_CAST (object));
+    GST_LOG_OBJECT (stream->pad, "Returned %s", gst_flow_get_name (ret));
+    /* picked up by the streaming thread on its next push */
+    g_atomic_int_set (&stream->flow_return, ret);
+  } else {
+    GstEvent *event = GST_EVENT_CAST (object);
+    gboolean is_eos = GST_EVENT_TYPE (event) == GST_EVENT_EOS;
+
+    gst_pad_push_event (stream->pad, event);
+    if (is_eos)
+      gst_ts_demux_stream_set_drained (stream);
+  }
+  return;
+
+flushing:
+  {
+    GST_DEBUG_OBJECT (stream->pad, "queue flushing, pausing task");
+    gst_pad_pause_task (stream->pad);
+    gst_ts_demux_stream_set_drained (stream);
+  }
+}
+
+static gboolean
+gst_ts_demux_srcpad_activate_push (GstPad * pad, gboolean active)
+{
+  TSDemuxStream *stream = gst_pad_get_element_private (pad);
+
+  if (active) {
+    gst_data_queue_set_flushing (stream->queue, FALSE);
+    return gst_pad_start_task (pad, (GstTaskFunction) gst_ts_demux_stream_loop,
+        stream);
+  }
+
+  gst_data_queue_set_flushing (stream->queue, TRUE);
+  return gst_pad_stop_task (pad);
+}
+
+/* Pushes @event on the pad of @stream, or queues it behind the pending
+ * buffers if the stream is pushed from its own thread */
+static gboolean
+gst_ts_demux_stream_push_event (TSDemuxStream * stream, GstEvent * event)
+{
+  gboolean res;
+
+  if (stream->queue == NULL)
+    return gst_pad_push_event (stream->pad, event);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      /* drop the queued data and unblock the pad task */
+      gst_data_queue_set_flushing (stream->queue, TRUE);
+      res = gst_pad_push_event (stream->pad, event);
+      gst_pad_pause_task (stream->pad);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      res = gst_pad_push_event (stream->pad, event);
+      gst_data_queue_flush (stream->queue);
+      g_atomic_int_set (&stream->flow_return, GST_FLOW_OK);
+      if (stream->active) {
+        gst_data_queue_set_flushing (stream->queue, FALSE);
+        gst_pad_start_task (stream->pad,
+            (GstTaskFunction) gst_ts_demux_stream_loop, stream);
+      }
+      break;
+    default:
+      res = gst_ts_demux_stream_queue_object (stream,
+          GST_MINI_OBJECT_CAST (event));
+      break;
+  }
+
+  return res;
+}
+
+static void
+gst_ts_demux_stream_create_queue (TSDemuxStream * stream)
+{
+  stream->queue = gst_data_queue_new (queue_check_full_func, NULL);
+  gst_data_queue_set_flushing (stream->queue, TRUE);
+  stream->queue_lock = g_mutex_new ();
+  stream->queue_cond = g_cond_new ();
+  stream->drained = FALSE;
+
+  gst_pad_set_element_private (stream->pad, stream);
+  gst_pad_set_activatepush_function (stream->pad,
+      gst_ts_demux_srcpad_activate_push);
+}
+
+static void
+gst_ts_demux_stream_free_queue (TSDemuxStream * stream)
+{
+  g_object_unref (stream->queue);
+  stream->queue = NULL;
+  g_mutex_free (stream->queue_lock);
+  stream->queue_lock = NULL;
+  g_cond_free (stream->queue_cond);
+  stream->queue_cond = NULL;
+}
+
 static gboolean
 push_event (MpegTSBase * base, GstEvent * event)
 {
@@ -605,7 +811,7 @@ push_event (MpegTSBase * base, GstEvent * event)
     TSDemuxStream *stream = (TSDemuxStream *) tmp->data;
     if (stream->pad) {
       gst_event_ref (event);
-      gst_pad_push_event (stream->pad, event);
+      gst_ts_demux_stream_push_event (stream, event);
     }
   }
 
@@ -620,8 +826,9 @@ tsdemux_combine_flows (GstTSDemux * demux, TSDemuxStream * stream,
 {
   GList *tmp;
 
-  /* Store the value */
-  stream->flow_return = ret;
+  /* Store the value, with threaded-push the pad task stores it */
+  if (stream->queue == NULL)
+    g_atomic_int_set (&stream->flow_return, ret);
 
   /* any other error that is not-linked can be returned right away */
   if (ret != GST_FLOW_NOT_LINKED)
@@ -631,7 +838,7 @@ tsdemux_combine_flows (GstTSDemux * demux, TSDemuxStream * stream,
   for (tmp = demux->program->stream_list; tmp; tmp = tmp->next) {
     stream = (TSDemuxStream *) tmp->data;
     if (stream->pad) {
-      ret = stream->flow_return;
+      ret = g_atomic_int_get (&stream->flow_return);
       /* some other return value (must be SUCCESS but we can return
        * other values as well) */
       if (ret != GST_FLOW_NOT_LINKED)
@@ -1014,6 +1221,9 @@ gst_ts_demux_stream_added (MpegTSBase * base, MpegTSBaseStream * bstream,
       stream->pad = create_pad_for_stream (base, bstream, program);
     stream->active = FALSE;
 
+    if (stream->pad && GST_TS_DEMUX_CAST (base)->threaded_push)
+      gst_ts_demux_stream_create_queue (stream);
+
     stream->need_newsegment = TRUE;
     stream->pts = GST_CLOCK_TIME_NONE;
     stream->dts = GST_CLOCK_TIME_NONE;
@@ -1024,7 +1234,7 @@ gst_ts_demux_stream_added (MpegTSBase * base, MpegTSBaseStream * bstream,
     stream->nb_pts_rollover = 0;
     stream->nb_dts_rollover = 0;
   }
-  stream->flow_return = GST_FLOW_OK;
+  g_atomic_int_set (&stream->flow_return, GST_FLOW_OK);
 }
 
 static void
@@ -1039,16 +1249,32 @@ gst_ts_demux_stream_removed (MpegTSBase * base, MpegTSBaseStream * bstream)
       gst_ts_demux_push_pending_data ((GstTSDemux *) base, stream);
 
       GST_DEBUG_OBJECT (stream->pad, "Pushing out EOS");
-      gst_pad_push_event (stream->pad, gst_event_new_eos ());
+      if (stream->queue) {
+        g_mutex_lock (stream->queue_lock);
+        stream->drained = FALSE;
+        g_mutex_unlock (stream->queue_lock);
+
+        /* wait for the pad task to push everything up to the EOS */
+        if (gst_ts_demux_stream_push_event (stream, gst_event_new_eos ())) {
+          g_mutex_lock (stream->queue_lock);
+          while (!stream->drained)
+            g_cond_wait (stream->queue_cond, stream->queue_lock);
+          g_mutex_unlock (stream->queue_lock);
+        }
+      } else
+        gst_pad_push_event (stream->pad, gst_event_new_eos ());
       GST_DEBUG_OBJECT (stream->pad, "Deactivating and removing pad");
       gst_pad_set_active (stream->pad, FALSE);
       gst_element_remove_pad (GST_ELEMENT_CAST (base), stream->pad);
       stream->active = FALSE;
     }
+    /* the pad task was stopped when deactivating the pad */
+    if (stream->queue)
+      gst_ts_demux_stream_free_queue (stream);
     stream->pad = NULL;
   }
   gst_ts_demux_stream_flush (stream);
-  stream->flow_return = GST_FLOW_NOT_LINKED;
+  g_atomic_int_set (&stream->flow_return, GST_FLOW_NOT_LINKED);
 }
 
 static void
@@ -1096,6 +1322,7 @@ gst_ts_demux_stream_flush (TSDemuxStream * stream)
   stream->expected_size = 0;
   stream->allocated_size = 0;
   stream->current_size = 0;
+  stream->last_size = 0;
   stream->need_newsegment = TRUE;
   stream->pts = GST_CLOCK_TIME_NONE;
   stream->dts = GST_CLOCK_TIME_NONE;
@@ -1114,6 +1341,17 @@ gst_ts_demux_flush_streams (GstTSDemux * demux)
       (GFunc) gst_ts_demux_stream_flush, NULL);
 }
 
+static void
+gst_ts_demux_select_program_pids (GstTSDemux * demux,
+    MpegTSBaseProgram * program, gboolean selected)
+{
+  GList *tmp;
+
+  for (tmp = program->stream_list; tmp; tmp = tmp->next)
+    mpegts_base_select_pid ((MpegTSBase *) demux,
+        ((MpegTSBaseStream *) tmp->data)->pid, selected);
+}
+
 static void
 gst_ts_demux_program_started (MpegTSBase * base, MpegTSBaseProgram * program)
 {
@@ -1128,6 +1366,7 @@ gst_ts_demux_program_started (MpegTSBase * base, MpegTSBaseProgram * program)
     GST_LOG ("program %d started", program->program_number);
     demux->program_number = program->program_number;
     demux->program = program;
+    gst_ts_demux_select_program_pids (demux, program, TRUE);
 
     /* If this is not the initial program, we need to calculate
      * an update newsegment */
@@ -1156,6 +1395,7 @@ gst_ts_demux_program_stopped (MpegTSBase * base, MpegTSBaseProgram * program)
   GstTSDemux *demux = GST_TS_DEMUX (base);
 
   if (demux->program == program) {
+    gst_ts_demux_select_program_pids (demux, program, FALSE);
     demux->program = NULL;
     demux->program_number = -1;
   }
@@ -1349,11 +1589,20 @@ gst_ts_demux_parse_pes_header (GstTSDemux * demux, TSDemuxStream * stream,
   data += header.header_size;
   length -= header.header_size;
 
-  /* Create the output buffer */
-  if (stream->expected_size)
+  /* Create the output buffer. When the size is unknown, start from the size
+   * of the previous payload (plus some margin) so that the buffer doesn't
+   * need to be grown (and copied) several times for each frame.
+   * The payload is always copied: packets are read from the adapter, which
+   * already joins data spanning input buffers, and one sub-buffer per 184
+   * bytes TS payload would cost more than the copy it saves */
+  if (stream->expected_size) {
     stream->allocated_size = stream->expected_size;
-  else
-    stream->allocated_size = 8192;
+  } else {
+    guint last_size = MIN (stream->last_size, PES_MAX_ALLOC);
+
+    stream->allocated_size =
+        CLAMP (last_size + (last_size >> 3), PES_MIN_ALLOC, PES_MAX_ALLOC);
+  }
   g_assert (stream->data == NULL);
   stream->data = g_malloc (stream->allocated_size);
   memcpy (stream->data, data, length);
@@ -1440,8 +1689,16 @@ gst_ts_demux_push_tags (GstTSDemux * demux, TSDemuxStream * stream)
 
     GST_DEBUG_OBJECT (demux, "Sending tags %s for pad %s:%s",
         str, GST_DEBUG_PAD_NAME (stream->pad));
-    gst_element_found_tags_for_pad (GST_ELEMENT (demux), stream->pad,
-        stream->taglist);
+    if (stream->queue) {
+      /* keep the tag event after the queued newsegment */
+      gst_element_post_message (GST_ELEMENT (demux),
+          gst_message_new_tag_full (GST_OBJECT (demux), stream->pad,
+              gst_tag_list_copy (stream->taglist)));
+      gst_ts_demux_stream_push_event (stream,
+          gst_event_new_tag (stream->taglist));
+    } else
+      gst_element_found_tags_for_pad (GST_ELEMENT (demux), stream->pad,
+          stream->taglist);
 
     stream->taglist = NULL;
     g_free (str);
@@ -1528,13 +1785,13 @@ push_new_segment:
   if (demux->update_segment) {
     GST_DEBUG_OBJECT (stream->pad, "Pushing update segment");
     gst_event_ref (demux->update_segment);
-    gst_pad_push_event (stream->pad, demux->update_segment);
+    gst_ts_demux_stream_push_event (stream, demux->update_segment);
   }
 
   if (demux->segment_event) {
     GST_DEBUG_OBJECT (stream->pad, "Pushing newsegment event");
     gst_event_ref (demux->segment_event);
-    gst_pad_push_event (stream->pad, demux->segment_event);
+    gst_ts_demux_stream_push_event (stream, demux->segment_event);
   }
 
   gst_ts_demux_push_tags (demux, stream);
@@ -1581,6 +1838,7 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream)
   if (G_UNLIKELY (stream->need_newsegment))
     calculate_and_push_newsegment (demux, stream);
 
+  stream->last_size = stream->current_size;
   buffer = gst_buffer_new ();
   GST_BUFFER_DATA (buffer) = stream->data;
   GST_BUFFER_MALLOCDATA (buffer) = stream->data;
@@ -1597,7 +1855,15 @@ gst_ts_demux_push_pending_data (GstTSDemux * demux, TSDemuxStream * stream)
       "Pushing buffer with timestamp: %" GST_TIME_FORMAT,
       GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buffer)));
 
-  res = gst_pad_push (stream->pad, buffer);
+  if (stream->queue) {
+    /* report the result of the previous pushes done by the pad task */
+    if (gst_ts_demux_stream_queue_object (stream,
+            GST_MINI_OBJECT_CAST (buffer)))
+      res = g_atomic_int_get (&stream->flow_return);
+    else
+      res = GST_FLOW_WRONG_STATE;
+  } else
+    res = gst_pad_push (stream->pad, buffer);
   GST_DEBUG_OBJECT (stream->pad, "Returned %s", gst_flow_get_name (res));
   res = tsdemux_combine_flows (demux, stream, res);
   GST_DEBUG_OBJECT (stream->pad, "combined %s", gst_flow_get_name (res));
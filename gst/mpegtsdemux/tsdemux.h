@@ -57,6 +57,7 @@ struct _GstTSDemux
    * accessed from the application thread and the streaming thread */
   guint program_number;		/* Required program number (ignore:-1) */
   gboolean emit_statistics;
+  gboolean threaded_push;	/* Push each pad from its own task */
 
   /*< private >*/
   MpegTSBaseProgram *program;	/* Current program */
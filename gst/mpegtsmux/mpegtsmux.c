@@ -110,10 +110,15 @@ enum
   ARG_M2TS_MODE,
   ARG_PAT_INTERVAL,
   ARG_PMT_INTERVAL,
-  ARG_ALIGNMENT
+  ARG_ALIGNMENT,
+  ARG_MUX_RATE
 };
 
 #define MPEGTSMUX_DEFAULT_ALIGNMENT    -1
+#define MPEGTSMUX_DEFAULT_MUX_RATE     0
+
+/* Number of packets allocated at once, see alloc_packet_cb() */
+#define MPEGTSMUX_PACKETS_PER_BLOCK    32
 #define MPEGTSMUX_DEFAULT_M2TS         FALSE
 
 static GstStaticPadTemplate mpegtsmux_sink_factory =
@@ -256,6 +261,16 @@ mpegtsmux_class_init (MpegTsMuxClass * klass)
           "(-1 = auto, 0 = all available packets)",
           -1, G_MAXINT, MPEGTSMUX_DEFAULT_ALIGNMENT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (G_OBJECT_CLASS (klass), ARG_MUX_RATE,
+      g_param_spec_uint64 ("mux-rate", "Mux rate",
+          "Constant output bitrate in bits per second, reached by inserting "
+          "null packets, with the PCR following from the output position. "
+          "A \"mpegtsmux-stats\" element message is posted when data has to "
+          "be sent after its decoding time (0 = variable bitrate)",
+          0, G_MAXUINT64, MPEGTSMUX_DEFAULT_MUX_RATE,
+          G_PARAM_READWRITE | GST_PARAM_MUTABLE_READY |
+          G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -287,6 +302,7 @@ mpegtsmux_init (MpegTsMux * mux, MpegTsMuxClass * g_class)
   mux->pmt_interval = TSMUX_DEFAULT_PMT_INTERVAL;
   mux->prog_map = NULL;
   mux->alignment = MPEGTSMUX_DEFAULT_ALIGNMENT;
+  mux->mux_rate = MPEGTSMUX_DEFAULT_MUX_RATE;
 
   /* initial state */
   mpegtsmux_reset (mux, TRUE);
@@ -297,6 +313,9 @@ mpegtsmux_pad_reset (MpegTsPadData * pad_data)
 {
   pad_data->pid = 0;
   pad_data->last_ts = GST_CLOCK_TIME_NONE;
+  pad_data->reorder = -1;
+  pad_data->last_dts = GST_CLOCK_TIME_NONE;
+  pad_data->next_dts = GST_CLOCK_TIME_NONE;
   pad_data->prog_id = -1;
   pad_data->element_index_writer_id = -1;
 
@@ -324,6 +343,7 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
   mux->previous_pcr = -1;
   mux->pcr_rate_num = mux->pcr_rate_den = 1;
   mux->last_ts = 0;
+  mux->late_packets = 0;
   mux->is_delta = TRUE;
 
   mux->streamheader = NULL;
@@ -361,6 +381,7 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
   }
   gst_event_replace (&mux->force_key_unit_event, NULL);
   gst_buffer_replace (&mux->out_buffer, NULL);
+  mux->out_offset = 0;
 
   GST_COLLECT_PADS2_STREAM_LOCK (mux->collect);
   for (walk = mux->collect->data; walk != NULL; walk = g_slist_next (walk))
@@ -371,6 +392,7 @@ mpegtsmux_reset (MpegTsMux * mux, gboolean alloc)
     mux->tsmux = tsmux_new ();
     tsmux_set_write_func (mux->tsmux, new_packet_cb, mux);
     tsmux_set_alloc_func (mux->tsmux, alloc_packet_cb, mux);
+    tsmux_set_bitrate (mux->tsmux, mux->mux_rate);
   }
 }
 
@@ -443,6 +465,20 @@ gst_mpegtsmux_set_property (GObject * object, guint prop_id,
     case ARG_ALIGNMENT:
       mux->alignment = g_value_get_int (value);
       break;
+    case ARG_MUX_RATE:
+      /* The streaming thread reads it without locking, and the PCR follows
+       * from the bytes written so the rate can't change mid-stream */
+      GST_OBJECT_LOCK (mux);
+      if (GST_STATE (mux) > GST_STATE_READY) {
+        GST_OBJECT_UNLOCK (mux);
+        GST_WARNING_OBJECT (mux, "mux-rate can only be set in NULL or READY");
+        break;
+      }
+      mux->mux_rate = g_value_get_uint64 (value);
+      if (mux->tsmux)
+        tsmux_set_bitrate (mux->tsmux, mux->mux_rate);
+      GST_OBJECT_UNLOCK (mux);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -471,6 +507,9 @@ gst_mpegtsmux_get_property (GObject * object, guint prop_id,
     case ARG_ALIGNMENT:
       g_value_set_int (value, mux->alignment);
       break;
+    case ARG_MUX_RATE:
+      g_value_set_uint64 (value, mux->mux_rate);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -927,6 +966,66 @@ out:
   return event;
 }
 
+/* H.264 pictures come in decoding order, stamped with their presentation
+ * time, which then goes backward for reordered pictures */
+static gboolean
+mpegtsmux_pad_can_reorder (MpegTsPadData * pad_data)
+{
+  GstCaps *caps;
+  GstStructure *s;
+
+  if (G_LIKELY (pad_data->reorder != -1))
+    return pad_data->reorder;
+
+  caps = gst_pad_get_negotiated_caps (pad_data->collect.pad);
+  if (caps == NULL)
+    return FALSE;
+
+  s = gst_caps_get_structure (caps, 0);
+  pad_data->reorder = gst_structure_has_name (s, "video/x-h264");
+  gst_caps_unref (caps);
+
+  return pad_data->reorder;
+}
+
+/* derives the decoding time of @buf from that of the previous picture,
+ * advanced by its duration. It can be no later than the presentation time
+ * and does not go backward. Without duration it follows the presentation
+ * time as long as that does not go backward.
+ * The first picture is decoded one picture ahead of its presentation (but
+ * not before 0), which leaves room for the pictures reordered behind it and
+ * keeps the decoding times increasing */
+static GstClockTime
+mpegtsmux_pad_derive_dts (MpegTsPadData * pad_data, GstBuffer * buf)
+{
+  GstClockTime pts, dts;
+
+  dts = pts = GST_BUFFER_TIMESTAMP (buf);
+  if (!GST_CLOCK_TIME_IS_VALID (pad_data->last_dts) &&
+      GST_BUFFER_DURATION_IS_VALID (buf))
+    dts -= MIN (dts, GST_BUFFER_DURATION (buf));
+  if (GST_CLOCK_TIME_IS_VALID (pad_data->next_dts) && pad_data->next_dts < dts)
+    dts = pad_data->next_dts;
+  if (GST_CLOCK_TIME_IS_VALID (pad_data->last_dts) &&
+      dts < pad_data->last_dts)
+    dts = pad_data->last_dts;
+
+  if (dts > pts) {
+    GST_DEBUG_OBJECT (pad_data->collect.pad, "no decoding time before PTS %"
+        GST_TIME_FORMAT, GST_TIME_ARGS (pts));
+    dts = pts;
+  } else {
+    pad_data->last_dts = dts;
+  }
+
+  if (GST_BUFFER_DURATION_IS_VALID (buf))
+    pad_data->next_dts = dts + GST_BUFFER_DURATION (buf);
+  else
+    pad_data->next_dts = GST_CLOCK_TIME_NONE;
+
+  return dts;
+}
+
 GstFlowReturn
 mpegtsmux_clip_inc_running_time (GstCollectPads2 * pads,
     GstCollectData2 * cdata, GstBuffer * buf, GstBuffer ** outbuf,
@@ -951,10 +1050,12 @@ mpegtsmux_clip_inc_running_time (GstCollectPads2 * pads,
           GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buf)), GST_TIME_ARGS (time));
       if (GST_CLOCK_TIME_IS_VALID (pad_data->last_ts) &&
           time < pad_data->last_ts) {
-        /* FIXME DTS/PTS mess again;
-         * probably needs a whole lot more subtle handling (cf qtmux) */
-        GST_DEBUG_OBJECT (cdata->pad, "ignoring PTS going backward");
-        time = pad_data->last_ts;
+        if (!mpegtsmux_pad_can_reorder (pad_data)) {
+          /* FIXME DTS/PTS mess again;
+           * probably needs a whole lot more subtle handling (cf qtmux) */
+          GST_DEBUG_OBJECT (cdata->pad, "ignoring PTS going backward");
+          time = pad_data->last_ts;
+        }
       } else {
         pad_data->last_ts = time;
       }
@@ -967,14 +1068,43 @@ mpegtsmux_clip_inc_running_time (GstCollectPads2 * pads,
   if (pad_data->prepare_func) {
     MpegTsMux *mux = (MpegTsMux *) user_data;
 
+    /* the prepared buffer may be the input one, modified in place */
     buf = pad_data->prepare_func (buf, pad_data, mux);
-    if (buf)
-      gst_buffer_replace (outbuf, buf);
+    if (buf) {
+      gst_buffer_unref (*outbuf);
+      *outbuf = buf;
+    }
   }
 
   return GST_FLOW_OK;
 }
 
+/* In CBR mode, post the muxing statistics when data is first sent after its
+ * decoding time, and as a summary on EOS */
+static void
+mpegtsmux_check_cbr_stats (MpegTsMux * mux, gboolean eos)
+{
+  guint64 null_packets, late_packets;
+
+  tsmux_get_cbr_stats (mux->tsmux, &null_packets, &late_packets);
+
+  if (!eos && (mux->late_packets || !late_packets))
+    return;
+
+  if (late_packets > mux->late_packets)
+    GST_WARNING_OBJECT (mux, "%" G_GUINT64_FORMAT " packets sent after their "
+        "decoding time, mux-rate %" G_GUINT64_FORMAT " is too low",
+        late_packets, mux->mux_rate);
+  mux->late_packets = late_packets;
+
+  gst_element_post_message (GST_ELEMENT_CAST (mux),
+      gst_message_new_element (GST_OBJECT_CAST (mux),
+          gst_structure_new ("mpegtsmux-stats",
+              "mux-rate", G_TYPE_UINT64, mux->mux_rate,
+              "null-packets", G_TYPE_UINT64, null_packets,
+              "late-packets", G_TYPE_UINT64, late_packets, NULL)));
+}
+
 static GstFlowReturn
 mpegtsmux_collected (GstCollectPads2 * pads, GstCollectData2 * data,
     GstBuffer * buf, MpegTsMux * mux)
@@ -996,7 +1126,8 @@ mpegtsmux_collected (GstCollectPads2 * pads, GstCollectData2 * data,
 
   if (best != NULL) {
     TsMuxProgram *prog = best->prog;
-    gint64 pts = -1;
+    GstClockTime time = GST_BUFFER_TIMESTAMP (buf);
+    gint64 pts = -1, dts = -1;
     gboolean delta = TRUE;
 
     if (prog == NULL)
@@ -1052,11 +1183,15 @@ mpegtsmux_collected (GstCollectPads2 * pads, GstCollectData2 * data,
     GST_DEBUG_OBJECT (COLLECT_DATA_PAD (best),
         "Chose stream for output (PID: 0x%04x)", best->pid);
 
-    if (GST_CLOCK_TIME_IS_VALID (GST_BUFFER_TIMESTAMP (buf)) &&
-        GST_CLOCK_TIME_IS_VALID (best->last_ts)) {
-      pts = GSTTIME_TO_MPEGTIME (best->last_ts);
+    if (GST_CLOCK_TIME_IS_VALID (time)) {
+      pts = GSTTIME_TO_MPEGTIME (time);
+      if (mpegtsmux_pad_can_reorder (best)) {
+        time = mpegtsmux_pad_derive_dts (best, buf);
+        dts = GSTTIME_TO_MPEGTIME (time);
+      }
       GST_DEBUG_OBJECT (mux, "Buffer has TS %" GST_TIME_FORMAT " pts %"
-          G_GINT64_FORMAT, GST_TIME_ARGS (best->last_ts), pts);
+          G_GINT64_FORMAT " dts %" G_GINT64_FORMAT,
+          GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buf)), pts, dts);
     }
 
     if (best->stream->is_video_stream) {
@@ -1073,11 +1208,11 @@ mpegtsmux_collected (GstCollectPads2 * pads, GstCollectData2 * data,
     GST_DEBUG_OBJECT (mux, "delta: %d", delta);
 
     tsmux_stream_add_data (best->stream, GST_BUFFER_DATA (buf),
-        GST_BUFFER_SIZE (buf), buf, pts, -1, !delta);
+        GST_BUFFER_SIZE (buf), buf, pts, dts, !delta);
 
-    /* outgoing ts follows ts of PCR program stream */
-    if (prog->pcr_stream == best->stream) {
-      mux->last_ts = best->last_ts;
+    /* outgoing ts follows the decoding ts of PCR program stream */
+    if (prog->pcr_stream == best->stream && GST_CLOCK_TIME_IS_VALID (time)) {
+      mux->last_ts = time;
     }
 
     mux->is_delta = delta;
@@ -1092,10 +1227,14 @@ mpegtsmux_collected (GstCollectPads2 * pads, GstCollectData2 * data,
         goto write_fail;
       }
     }
+    if (mux->mux_rate)
+      mpegtsmux_check_cbr_stats (mux, FALSE);
     /* flush packet cache */
     mpegtsmux_push_packets (mux, FALSE);
   } else {
     /* EOS */
+    if (mux->mux_rate)
+      mpegtsmux_check_cbr_stats (mux, TRUE);
     /* drain some possibly cached data */
     new_packet_m2ts (mux, NULL, -1);
     mpegtsmux_push_packets (mux, TRUE);
@@ -1443,14 +1582,16 @@ new_packet_cb (GstBuffer * buf, void *user_data, gint64 new_pcr)
   GST_LOG_OBJECT (mux, "handling packet %d", mux->spn_count);
   mux->spn_count++;
 
-  offset = GST_BUFFER_DATA (buf) - GST_BUFFER_MALLOCDATA (buf);
+  if (mux->m2ts_mode == TRUE)
+    offset = 4;
+
   GST_BUFFER_TIMESTAMP (buf) = mux->last_ts;
   /* do common init (flags and streamheaders) */
   new_packet_common_init (mux, buf,
       GST_BUFFER_DATA (buf), GST_BUFFER_SIZE (buf));
 
   /* all is meant for downstream, including any prefix */
-  GST_BUFFER_DATA (buf) = GST_BUFFER_MALLOCDATA (buf);
+  GST_BUFFER_DATA (buf) -= offset;
   GST_BUFFER_SIZE (buf) += offset;
 
   if (offset)
@@ -1467,14 +1608,26 @@ alloc_packet_cb (GstBuffer ** _buf, void *user_data)
 {
   MpegTsMux *mux = (MpegTsMux *) user_data;
   GstBuffer *buf;
-  gint offset = 0;
+  gint offset = 0, packet_size;
 
   if (mux->m2ts_mode == TRUE)
     offset = 4;
+  packet_size = NORMAL_TS_PACKET_LENGTH + offset;
+
+  /* Packets are sub-buffers of a larger block so that consecutive packets
+   * are contiguous in memory. This saves a memory allocation per packet, and
+   * lets the output adapter join them back into one buffer without copying
+   * them */
+  if (mux->out_buffer == NULL ||
+      mux->out_offset + packet_size > GST_BUFFER_SIZE (mux->out_buffer)) {
+    gst_buffer_replace (&mux->out_buffer, NULL);
+    mux->out_buffer =
+        gst_buffer_new_and_alloc (packet_size * MPEGTSMUX_PACKETS_PER_BLOCK);
+    mux->out_offset = 0;
+  }
 
-  /* TODO might be even more efficient to avoid later memcpy
-   * if these are subbuffer from a larger buffer or so */
-  buf = gst_buffer_new_and_alloc (NORMAL_TS_PACKET_LENGTH + offset);
+  buf = gst_buffer_create_sub (mux->out_buffer, mux->out_offset, packet_size);
+  mux->out_offset += packet_size;
   GST_BUFFER_DATA (buf) += offset;
   GST_BUFFER_SIZE (buf) -= offset;
 
@@ -140,6 +140,7 @@ struct MpegTsMux {
   guint pat_interval;
   guint pmt_interval;
   gint alignment;
+  guint64 mux_rate;
 
   /* state */
   gboolean first;
@@ -152,6 +153,8 @@ struct MpegTsMux {
   gboolean streamheader_sent;
   gboolean is_delta;
   GstClockTime last_ts;
+  /* number of late packets already reported in CBR mode */
+  guint64 late_packets;
 
   /* m2ts specific */
   gint64 previous_pcr;
@@ -162,6 +165,7 @@ struct MpegTsMux {
 
   /* output buffer aggregation */
   GstAdapter *out_adapter;
+  /* block the packets are allocated from, and its used size */
   GstBuffer *out_buffer;
   gint out_offset;
   gint last_size;
@@ -186,6 +190,11 @@ struct MpegTsPadData {
 
   /* most recent valid TS for this stream */
   GstClockTime last_ts;
+  /* whether the TS of this stream can go backward (reordered pictures),
+   * and the decoding time derived for it then */
+  gint reorder;
+  GstClockTime last_dts;
+  GstClockTime next_dts;
 
   /* (optional) index writing */
   gint element_index_writer_id;
@@ -214,20 +214,48 @@ mpegtsmux_process_codec_data_h264 (MpegTsPadData * data, MpegTsMux * mux)
   return ret;
 }
 
+/* Returns the size of @buf once its NAL length prefixes are replaced by
+ * start codes, or 0 if it is not made of whole NAL units */
+static gsize
+mpegtsmux_get_es_size_h264 (GstBuffer * buf, guint nal_length_size)
+{
+  const guint8 *data = GST_BUFFER_DATA (buf);
+  gsize in_offset = 0, out_size = 0;
+
+  while (in_offset + nal_length_size <= GST_BUFFER_SIZE (buf)) {
+    guint32 nal_size = 0;
+    guint i;
+
+    for (i = 0; i < nal_length_size; i++)
+      nal_size = (nal_size << 8) | data[in_offset + i];
+    in_offset += nal_length_size;
+
+    if (nal_size > GST_BUFFER_SIZE (buf) - in_offset)
+      return 0;
+
+    in_offset += nal_size;
+    out_size += 4 + nal_size;
+  }
+
+  return in_offset == GST_BUFFER_SIZE (buf) ? out_size : 0;
+}
+
 GstBuffer *
 mpegtsmux_prepare_h264 (GstBuffer * buf, MpegTsPadData * data, MpegTsMux * mux)
 {
   guint8 startcode[4] = { 0x00, 0x00, 0x00, 0x01 };
-  gsize out_offset = 0, in_offset = 0;
+  gsize out_offset = 0, in_offset = 0, out_size;
   GstBuffer *out_buf;
   gboolean changed;
   PrivDataH264 *h264_data;
   GstClockTimeDiff diff = GST_CLOCK_TIME_NONE;
+  guint nal_length_size;
 
   GST_DEBUG_OBJECT (mux, "Preparing H264 buffer for output");
 
   changed = mpegtsmux_process_codec_data_h264 (data, mux);
   h264_data = (PrivDataH264 *) data->prepare_data;
+  nal_length_size = h264_data->nal_length_size;
 
   if (GST_CLOCK_TIME_IS_VALID (h264_data->last_resync_ts) &&
       GST_CLOCK_TIME_IS_VALID (GST_BUFFER_TIMESTAMP (buf))) {
@@ -235,59 +263,59 @@ mpegtsmux_prepare_h264 (GstBuffer * buf, MpegTsPadData * data, MpegTsMux * mux)
         GST_BUFFER_TIMESTAMP (buf));
   }
 
-  if (changed || (GST_CLOCK_TIME_IS_VALID (diff) && diff > SPS_PPS_PERIOD)) {
-    out_buf = gst_buffer_new_and_alloc (GST_BUFFER_SIZE (buf) * 2 +
-        GST_BUFFER_SIZE (h264_data->cached_es));
-    h264_data->last_resync_ts = GST_BUFFER_TIMESTAMP (buf);
-    memcpy (GST_BUFFER_DATA (out_buf), GST_BUFFER_DATA (h264_data->cached_es),
-        GST_BUFFER_SIZE (h264_data->cached_es));
-    out_offset = GST_BUFFER_SIZE (h264_data->cached_es);
-    GST_DEBUG_OBJECT (mux, "prepending SPS/PPS information to that packet");
-  } else {
-    out_buf = gst_buffer_new_and_alloc (GST_BUFFER_SIZE (buf) * 2);
+  out_size = mpegtsmux_get_es_size_h264 (buf, nal_length_size);
+  if (out_size == 0) {
+    GST_WARNING_OBJECT (mux, "Buffer of %u bytes is not made of NAL units "
+        "coded on %u bytes, not converting it (Input might not be in avc "
+        "format)", GST_BUFFER_SIZE (buf), nal_length_size);
+    return NULL;
   }
 
-  /* We want the same metadata */
-  gst_buffer_copy_metadata (out_buf, buf, GST_BUFFER_COPY_ALL);
+  if (nal_length_size == 4) {
+    /* Start codes have the size of the NAL lengths, so write them over */
+    if (gst_buffer_is_writable (buf))
+      out_buf = gst_buffer_ref (buf);
+    else
+      out_buf = gst_buffer_copy (buf);
+    while (in_offset < GST_BUFFER_SIZE (out_buf)) {
+      guint32 nal_size =
+          GST_READ_UINT32_BE (GST_BUFFER_DATA (out_buf) + in_offset);
+
+      memcpy (GST_BUFFER_DATA (out_buf) + in_offset, startcode, 4);
+      in_offset += 4 + nal_size;
+    }
+  } else {
+    out_buf = gst_buffer_new_and_alloc (out_size);
+    gst_buffer_copy_metadata (out_buf, buf, GST_BUFFER_COPY_ALL);
+
+    while (in_offset < GST_BUFFER_SIZE (buf)) {
+      guint32 nal_size = 0;
+      guint i;
 
-  while (in_offset < GST_BUFFER_SIZE (buf) &&
-      out_offset < GST_BUFFER_SIZE (out_buf) - 4) {
-    guint32 nal_size = 0;
+      for (i = 0; i < nal_length_size; i++)
+        nal_size = (nal_size << 8) | GST_BUFFER_DATA (buf)[in_offset + i];
+      in_offset += nal_length_size;
 
-    switch (h264_data->nal_length_size) {
-      case 1:
-        nal_size = GST_READ_UINT8 (GST_BUFFER_DATA (buf) + in_offset);
-        break;
-      case 2:
-        nal_size = GST_READ_UINT16_BE (GST_BUFFER_DATA (buf) + in_offset);
-        break;
-      case 4:
-        nal_size = GST_READ_UINT32_BE (GST_BUFFER_DATA (buf) + in_offset);
-        break;
-      default:
-        GST_WARNING_OBJECT (mux, "unsupported NAL length size %u",
-            h264_data->nal_length_size);
+      /* Generate an Elementary stream buffer by inserting a startcode */
+      memcpy (GST_BUFFER_DATA (out_buf) + out_offset, startcode, 4);
+      out_offset += 4;
+      memcpy (GST_BUFFER_DATA (out_buf) + out_offset,
+          GST_BUFFER_DATA (buf) + in_offset, nal_size);
+      in_offset += nal_size;
+      out_offset += nal_size;
     }
-    in_offset += h264_data->nal_length_size;
-
-    /* Generate an Elementary stream buffer by inserting a startcode */
-    memcpy (GST_BUFFER_DATA (out_buf) + out_offset, startcode, 4);
-    out_offset += 4;
-    memcpy (GST_BUFFER_DATA (out_buf) + out_offset,
-        GST_BUFFER_DATA (buf) + in_offset,
-        MIN (nal_size, GST_BUFFER_SIZE (out_buf) - out_offset));
-    in_offset += nal_size;
-    out_offset += nal_size;
   }
 
-  if (out_offset > GST_BUFFER_SIZE (out_buf)) {
-    GST_WARNING_OBJECT (mux, "Calculated buffer size %" G_GSIZE_FORMAT
-        " is greater than max expected size %u, "
-        "using max expected size (Input might not be in "
-        "avc format", out_offset, GST_BUFFER_SIZE (out_buf));
-    out_offset = GST_BUFFER_SIZE (out_buf);
+  if (changed || (GST_CLOCK_TIME_IS_VALID (diff) && diff > SPS_PPS_PERIOD)) {
+    GstBuffer *es_buf;
+
+    h264_data->last_resync_ts = GST_BUFFER_TIMESTAMP (buf);
+    GST_DEBUG_OBJECT (mux, "prepending SPS/PPS information to that packet");
+    es_buf = gst_buffer_merge (h264_data->cached_es, out_buf);
+    gst_buffer_copy_metadata (es_buf, out_buf, GST_BUFFER_COPY_ALL);
+    gst_buffer_unref (out_buf);
+    out_buf = es_buf;
   }
-  GST_BUFFER_SIZE (out_buf) = out_offset;
 
   return out_buf;
 }
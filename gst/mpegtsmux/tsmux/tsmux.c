@@ -83,9 +83,10 @@
 
 #include <string.h>
 
+#include <gst/mpeg-crc32-private.h>
+
 #include "tsmux.h"
 #include "tsmuxstream.h"
-#include "crc.h"
 
 #define GST_CAT_DEFAULT mpegtsmux_debug
 
@@ -112,6 +113,10 @@
  * so we have some slack to go backwards */
 #define CLOCK_BASE (TSMUX_CLOCK_FREQ * 10 * 360)
 
+/* Offset in a packet of the byte a PCR value refers to: the last byte of
+ * program_clock_reference_base */
+#define TSMUX_PCR_BYTE_OFFSET 10
+
 static gboolean tsmux_write_pat (TsMux * mux);
 static gboolean tsmux_write_pmt (TsMux * mux, TsMuxProgram * program);
 
@@ -139,6 +144,8 @@ tsmux_new (void)
   mux->last_pat_ts = -1;
   mux->pat_interval = TSMUX_DEFAULT_PAT_INTERVAL;
 
+  mux->first_pcr = -1;
+
   return mux;
 }
 
@@ -214,6 +221,65 @@ tsmux_get_pat_interval (TsMux * mux)
   return mux->pat_interval;
 }
 
+/**
+ * tsmux_set_bitrate:
+ * @mux: a #TsMux
+ * @bitrate: the output bitrate in bits per second
+ *
+ * Set a constant output bitrate for @mux. With a non-zero @bitrate, PCR
+ * values follow from the position of a packet in the output and null packets
+ * are inserted whenever the streams do not provide enough data to fill the
+ * bitrate. 0 disables this and gives a variable bitrate output.
+ *
+ * The bitrate must be set before the first packet is written.
+ */
+void
+tsmux_set_bitrate (TsMux * mux, guint64 bitrate)
+{
+  g_return_if_fail (mux != NULL);
+
+  mux->bitrate = bitrate;
+}
+
+/**
+ * tsmux_get_bitrate:
+ * @mux: a #TsMux
+ *
+ * Get the configured output bitrate. See also tsmux_set_bitrate().
+ *
+ * Returns: the configured bitrate, 0 for variable bitrate output
+ */
+guint64
+tsmux_get_bitrate (TsMux * mux)
+{
+  g_return_val_if_fail (mux != NULL, 0);
+
+  return mux->bitrate;
+}
+
+/**
+ * tsmux_get_cbr_stats:
+ * @mux: a #TsMux
+ * @null_packets: location for the number of null packets inserted, or NULL
+ * @late_packets: location for the number of late packets, or NULL
+ *
+ * Get the statistics of constant bitrate output. Late packets carry data
+ * that could only be sent after its decoding time at the configured bitrate,
+ * meaning the bitrate is too low for the streams and the buffer of a
+ * receiving decoder would underflow.
+ */
+void
+tsmux_get_cbr_stats (TsMux * mux, guint64 * null_packets,
+    guint64 * late_packets)
+{
+  g_return_if_fail (mux != NULL);
+
+  if (null_packets)
+    *null_packets = mux->null_packets;
+  if (late_packets)
+    *late_packets = mux->late_packets;
+}
+
 /**
  * tsmux_free:
  * @mux: a #TsMux
@@ -473,6 +539,8 @@ tsmux_get_buffer (TsMux * mux, GstBuffer ** buf)
 static gboolean
 tsmux_packet_out (TsMux * mux, GstBuffer * buf, gint64 pcr)
 {
+  mux->n_bytes += TSMUX_PACKET_LENGTH;
+
   if (G_UNLIKELY (mux->write_func == NULL)) {
     if (buf)
       gst_buffer_unref (buf);
@@ -729,6 +797,136 @@ tsmux_write_ts_header (guint8 * buf, TsMuxPacketInfo * pi,
   return TRUE;
 }
 
+/* In CBR mode, the PCR of the next packet follows from the number of bytes
+ * written before it */
+static gint64
+tsmux_get_current_pcr (TsMux * mux)
+{
+  return mux->first_pcr +
+      gst_util_uint64_scale ((mux->n_bytes + TSMUX_PCR_BYTE_OFFSET) * 8,
+      TSMUX_SYS_CLOCK_FREQ, mux->bitrate);
+}
+
+static gboolean
+tsmux_write_null_packet (TsMux * mux)
+{
+  GstBuffer *buf = NULL;
+  guint8 *data, *tmp;
+
+  if (!tsmux_get_buffer (mux, &buf))
+    return FALSE;
+
+  data = GST_BUFFER_DATA (buf);
+
+  data[0] = TSMUX_SYNC_BYTE;
+  tmp = data + 1;
+  tsmux_put16 (&tmp, TSMUX_NULL_PACKET_PID);
+  /* payload only, continuity counter undefined */
+  data[3] = 0x10;
+  memset (data + TSMUX_HEADER_LENGTH, 0xff, TSMUX_PAYLOAD_LENGTH);
+
+  mux->null_packets++;
+
+  return tsmux_packet_out (mux, buf, -1);
+}
+
+/* Write a packet carrying only a PCR (and no payload) on the PID of @stream */
+static gboolean
+tsmux_write_pcr_packet (TsMux * mux, TsMuxStream * stream, gint64 pcr)
+{
+  TsMuxPacketInfo pi = stream->pi;
+  guint payload_len, payload_offs;
+  GstBuffer *buf = NULL;
+
+  /* Packets without payload repeat the continuity counter of the
+   * previous packet */
+  pi.packet_count--;
+  pi.flags = TSMUX_PACKET_FLAG_ADAPTATION | TSMUX_PACKET_FLAG_WRITE_PCR;
+  pi.pcr = pcr;
+  pi.packet_start_unit_indicator = FALSE;
+  pi.stream_avail = 0;
+  pi.private_data_len = 0;
+
+  if (!tsmux_get_buffer (mux, &buf))
+    return FALSE;
+
+  if (!tsmux_write_ts_header (GST_BUFFER_DATA (buf), &pi, &payload_len,
+          &payload_offs)) {
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+
+  stream->last_pcr = pcr;
+
+  return tsmux_packet_out (mux, buf, pcr);
+}
+
+/* In CBR mode, fill the output up to the time at which the data of @stream
+ * is to be sent. That is TSMUX_PCR_OFFSET ahead of its decoding time, as for
+ * the PCR in VBR mode. The filling is done with null packets, or with a PCR
+ * for a program whose PCR stream did not carry one for too long. Data that
+ * can only be sent after its decoding time is counted as late. */
+static gboolean
+tsmux_pad_stream (TsMux * mux, TsMuxStream * stream)
+{
+  gint64 cur_ts = tsmux_stream_get_dts (stream);
+  gint64 cur_pcr, send_pcr, packet_duration;
+
+  if (cur_ts == -1)
+    return TRUE;
+
+  /* CLOCK_BASE >= TSMUX_PCR_OFFSET */
+  cur_ts += CLOCK_BASE;
+  send_pcr = (cur_ts - TSMUX_PCR_OFFSET) *
+      (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
+
+  if (mux->first_pcr == -1) {
+    /* Start the packet clock such that this packet is sent on time */
+    mux->first_pcr = send_pcr - gst_util_uint64_scale (mux->n_bytes * 8,
+        TSMUX_SYS_CLOCK_FREQ, mux->bitrate);
+  }
+
+  cur_pcr = tsmux_get_current_pcr (mux);
+  if (cur_pcr > cur_ts * (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ)) {
+    TS_DEBUG ("PID 0x%04x is late by %" G_GINT64_FORMAT " 27MHz ticks",
+        stream->id, cur_pcr - cur_ts * (TSMUX_SYS_CLOCK_FREQ /
+            TSMUX_CLOCK_FREQ));
+    mux->late_packets++;
+    return TRUE;
+  }
+
+  packet_duration = gst_util_uint64_scale (TSMUX_PACKET_LENGTH * 8,
+      TSMUX_SYS_CLOCK_FREQ, mux->bitrate);
+
+  while (cur_pcr + packet_duration <= send_pcr) {
+    TsMuxStream *pcr_stream = NULL;
+    GList *cur;
+
+    for (cur = mux->programs; cur; cur = cur->next) {
+      TsMuxProgram *program = (TsMuxProgram *) cur->data;
+
+      if (program->pcr_stream && program->pcr_stream->last_pcr != -1 &&
+          cur_pcr - program->pcr_stream->last_pcr >
+          TSMUX_SYS_CLOCK_FREQ / TSMUX_DEFAULT_PCR_FREQ) {
+        pcr_stream = program->pcr_stream;
+        break;
+      }
+    }
+
+    if (pcr_stream) {
+      if (!tsmux_write_pcr_packet (mux, pcr_stream, cur_pcr))
+        return FALSE;
+    } else {
+      if (!tsmux_write_null_packet (mux))
+        return FALSE;
+    }
+
+    cur_pcr = tsmux_get_current_pcr (mux);
+  }
+
+  return TRUE;
+}
+
 /**
  * tsmux_write_stream_packet:
  * @mux: a #TsMux
@@ -751,48 +949,31 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
   g_return_val_if_fail (mux != NULL, FALSE);
   g_return_val_if_fail (stream != NULL, FALSE);
 
+  if (mux->bitrate && !tsmux_pad_stream (mux, stream))
+    return FALSE;
+
   if (tsmux_stream_is_pcr (stream)) {
-    gint64 cur_pts = tsmux_stream_get_pts (stream);
+    gint64 cur_ts = tsmux_stream_get_dts (stream);
     gboolean write_pat;
     GList *cur;
 
     cur_pcr = 0;
-    if (cur_pts != -1) {
-      TS_DEBUG ("TS for PCR stream is %" G_GINT64_FORMAT, cur_pts);
-    }
-
-    /* FIXME: The current PCR needs more careful calculation than just
-     * writing a fixed offset */
-    if (cur_pts != -1) {
+    if (cur_ts != -1) {
+      TS_DEBUG ("TS for PCR stream is %" G_GINT64_FORMAT, cur_ts);
       /* CLOCK_BASE >= TSMUX_PCR_OFFSET */
-      cur_pts += CLOCK_BASE;
-      cur_pcr = (cur_pts - TSMUX_PCR_OFFSET) *
-          (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
-    }
-
-    /* Need to decide whether to write a new PCR in this packet */
-    if (stream->last_pcr == -1 ||
-        (cur_pcr - stream->last_pcr >
-            (TSMUX_SYS_CLOCK_FREQ / TSMUX_DEFAULT_PCR_FREQ))) {
-
-      stream->pi.flags |=
-          TSMUX_PACKET_FLAG_ADAPTATION | TSMUX_PACKET_FLAG_WRITE_PCR;
-      stream->pi.pcr = cur_pcr;
-      stream->last_pcr = cur_pcr;
-    } else {
-      cur_pcr = -1;
+      cur_ts += CLOCK_BASE;
     }
 
     /* check if we need to rewrite pat */
     if (mux->last_pat_ts == -1 || mux->pat_changed)
       write_pat = TRUE;
-    else if (cur_pts >= mux->last_pat_ts + mux->pat_interval)
+    else if (cur_ts >= mux->last_pat_ts + mux->pat_interval)
       write_pat = TRUE;
     else
       write_pat = FALSE;
 
     if (write_pat) {
-      mux->last_pat_ts = cur_pts;
+      mux->last_pat_ts = cur_ts;
       if (!tsmux_write_pat (mux))
         return FALSE;
     }
@@ -804,17 +985,40 @@ tsmux_write_stream_packet (TsMux * mux, TsMuxStream * stream)
 
       if (program->last_pmt_ts == -1 || program->pmt_changed)
         write_pmt = TRUE;
-      else if (cur_pts >= program->last_pmt_ts + program->pmt_interval)
+      else if (cur_ts >= program->last_pmt_ts + program->pmt_interval)
         write_pmt = TRUE;
       else
         write_pmt = FALSE;
 
       if (write_pmt) {
-        program->last_pmt_ts = cur_pts;
+        program->last_pmt_ts = cur_ts;
         if (!tsmux_write_pmt (mux, program))
           return FALSE;
       }
     }
+
+    if (mux->bitrate && mux->first_pcr != -1) {
+      /* The PCR is the time this packet is sent at, after the PAT/PMT */
+      cur_pcr = tsmux_get_current_pcr (mux);
+    } else if (cur_ts != -1) {
+      /* FIXME: The current PCR needs more careful calculation than just
+       * writing a fixed offset */
+      cur_pcr = (cur_ts - TSMUX_PCR_OFFSET) *
+          (TSMUX_SYS_CLOCK_FREQ / TSMUX_CLOCK_FREQ);
+    }
+
+    /* Need to decide whether to write a new PCR in this packet */
+    if (stream->last_pcr == -1 ||
+        (cur_pcr - stream->last_pcr >
+            (TSMUX_SYS_CLOCK_FREQ / TSMUX_DEFAULT_PCR_FREQ))) {
+
+      stream->pi.flags |=
+          TSMUX_PACKET_FLAG_ADAPTATION | TSMUX_PACKET_FLAG_WRITE_PCR;
+      stream->pi.pcr = cur_pcr;
+      stream->last_pcr = cur_pcr;
+    } else {
+      cur_pcr = -1;
+    }
   }
 
   pi->packet_start_unit_indicator = tsmux_stream_at_pes_start (stream);
@@ -1014,7 +1218,7 @@ tsmux_write_pat (TsMux * mux)
         mux->transport_id, mux->pat_version, 0, 0);
 
     /* Calc and output CRC for data bytes, not including itself */
-    crc = calc_crc32 (pat->data, pat->pi.stream_avail - 4);
+    crc = mpeg_crc32 (pat->data, pat->pi.stream_avail - 4);
     tsmux_put32 (&pos, crc);
 
     TS_DEBUG ("PAT has %d programs, is %u bytes",
@@ -1119,7 +1323,7 @@ tsmux_write_pmt (TsMux * mux, TsMuxProgram * program)
 
     /* Calc and output CRC for data bytes, 
      * but not counting the CRC bytes this time */
-    crc = calc_crc32 (pmt->data, pmt->pi.stream_avail - 4);
+    crc = mpeg_crc32 (pmt->data, pmt->pi.stream_avail - 4);
     tsmux_put32 (&pos, crc);
 
     TS_DEBUG ("PMT for program %d has %d streams, is %u bytes",
@@ -169,6 +169,16 @@ struct TsMux {
 
   /* scratch space for writing ES_info descriptors */
   guint8 es_info_buf[TSMUX_MAX_ES_INFO_LENGTH];
+
+  /* constant output bitrate in bits per second, 0 for VBR output */
+  guint64 bitrate;
+  /* number of bytes written out so far */
+  guint64 n_bytes;
+  /* PCR at byte 0 of the output in CBR mode, -1 if not known yet */
+  gint64 first_pcr;
+  /* CBR statistics: null packets inserted and packets sent too late */
+  guint64 null_packets;
+  guint64 late_packets;
 };
 
 /* create/free new muxer session */
@@ -180,6 +190,10 @@ void 		tsmux_set_write_func 		(TsMux *mux, TsMuxWriteFunc func, void *user_data)
 void 		tsmux_set_alloc_func 		(TsMux *mux, TsMuxAllocFunc func, void *user_data);
 void 		tsmux_set_pat_interval          (TsMux *mux, guint interval);
 guint 		tsmux_get_pat_interval          (TsMux *mux);
+void 		tsmux_set_bitrate 		(TsMux *mux, guint64 bitrate);
+guint64 	tsmux_get_bitrate 		(TsMux *mux);
+void 		tsmux_get_cbr_stats 		(TsMux *mux, guint64 *null_packets,
+						 guint64 *late_packets);
 guint16		tsmux_get_new_pid 		(TsMux *mux);
 
 /* pid/program management */
@@ -90,6 +90,8 @@ G_BEGIN_DECLS
 #define TSMUX_HEADER_LENGTH 4
 #define TSMUX_PAYLOAD_LENGTH (TSMUX_PACKET_LENGTH - TSMUX_HEADER_LENGTH)
 
+#define TSMUX_NULL_PACKET_PID 0x1FFF
+
 #define TSMUX_MIN_ES_DESC_LEN 8
 
 /* Frequency for PCR representation */
@@ -674,8 +674,10 @@ tsmux_stream_add_data (TsMuxStream * stream, guint8 * data, guint len,
   packet->pts = pts;
   packet->dts = dts;
 
-  if (stream->bytes_avail == 0)
+  if (stream->bytes_avail == 0) {
     stream->last_pts = pts;
+    stream->last_dts = dts;
+  }
 
   stream->bytes_avail += len;
   stream->buffers = g_list_append (stream->buffers, packet);
@@ -957,3 +959,23 @@ tsmux_stream_get_pts (TsMuxStream * stream)
 
   return stream->last_pts;
 }
+
+/**
+ * tsmux_stream_get_dts:
+ * @stream: a #TsMuxStream
+ *
+ * Return the DTS of the last buffer that has had bytes written and
+ * which _had_ a PTS in @stream, or that PTS if the buffer had no DTS.
+ * Unlike the PTS, this does not go backward for reordered pictures.
+ *
+ * Returns: the DTS of the last buffer in @stream.
+ */
+guint64
+tsmux_stream_get_dts (TsMuxStream * stream)
+{
+  g_return_val_if_fail (stream != NULL, -1);
+
+  if (stream->last_dts != -1)
+    return stream->last_dts;
+  return stream->last_pts;
+}
@@ -114,7 +114,8 @@ enum
   PROP_0,
   PROP_PACKAGE,
   PROP_MAX_DRIFT,
-  PROP_STRUCTURE
+  PROP_STRUCTURE,
+  PROP_SEQUENTIAL_TRACKS
 };
 
 static gboolean gst_mxf_demux_sink_event (GstPad * pad, GstEvent * event);
@@ -177,6 +178,7 @@ gst_mxf_demux_reset_mxf_state (GstMXFDemux * demux)
       gst_caps_unref (t->caps);
   }
   g_array_set_size (demux->essence_tracks, 0);
+  demux->reader_track = NULL;
 }
 
 static void
@@ -236,6 +238,7 @@ gst_mxf_demux_reset (GstMXFDemux * demux)
   demux->offset = 0;
 
   demux->pull_footer_metadata = TRUE;
+  demux->pulled_index_table_segments = FALSE;
 
   demux->run_in = -1;
 
@@ -367,8 +370,8 @@ gst_mxf_demux_get_earliest_pad (GstMXFDemux * demux)
   for (i = 0; i < demux->src->len; i++) {
     GstMXFDemuxPad *p = g_ptr_array_index (demux->src, i);
 
-    if (!p->eos && p->last_flow < earliest) {
-      earliest = p->last_flow;
+    if (!p->eos && p->last_stop < earliest) {
+      earliest = p->last_stop;
       pad = p;
     }
   }
@@ -740,6 +743,9 @@ gst_mxf_demux_update_essence_tracks (GstMXFDemux * demux)
             &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack,
             demux->essence_tracks->len - 1);
         new = TRUE;
+        /* The array might have been reallocated, the reader track is
+         * selected again before the next essence element is read */
+        demux->reader_track = NULL;
       }
 
       etrack->source_package = NULL;
@@ -1544,12 +1550,59 @@ gst_mxf_demux_pad_set_component (GstMXFDemux * demux, GstMXFDemuxPad * pad,
   return ret;
 }
 
+/* Returns the position of the last entry of @offsets with a known offset
+ * that is not after @offset, or -1. Known offsets are increasing with the
+ * position, but there might be unknown (0) entries in between */
+static gint64
+gst_mxf_demux_index_find_position (GArray * offsets, guint64 offset)
+{
+  gint64 lo = 0, hi = offsets->len - 1, ret = -1;
+
+  while (lo <= hi) {
+    gint64 mid = lo + (hi - lo) / 2;
+    gint64 i = mid;
+
+    while (i >= lo && g_array_index (offsets, GstMXFDemuxIndex, i).offset == 0)
+      i--;
+
+    if (i < lo) {
+      lo = mid + 1;
+    } else if (g_array_index (offsets, GstMXFDemuxIndex, i).offset <= offset) {
+      ret = i;
+      lo = mid + 1;
+    } else {
+      hi = i - 1;
+    }
+  }
+
+  return ret;
+}
+
+/* Returns the essence track of the current partition's essence container
+ * the essence element with this key belongs to */
+static GstMXFDemuxEssenceTrack *
+gst_mxf_demux_find_essence_track (GstMXFDemux * demux, const MXFUL * key)
+{
+  guint32 track_number = GST_READ_UINT32_BE (&key->u[12]);
+  guint i;
+
+  for (i = 0; i < demux->essence_tracks->len; i++) {
+    GstMXFDemuxEssenceTrack *tmp =
+        &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+
+    if (tmp->body_sid == demux->current_partition->partition.body_sid &&
+        (tmp->track_number == track_number || tmp->track_number == 0))
+      return tmp;
+  }
+
+  return NULL;
+}
+
 static GstFlowReturn
 gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
     const MXFUL * key, GstBuffer * buffer, gboolean peek)
 {
   GstFlowReturn ret = GST_FLOW_OK;
-  guint32 track_number;
   guint i;
   GstBuffer *inbuf = NULL;
   GstBuffer *outbuf = NULL;
@@ -1585,19 +1638,7 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
     return GST_FLOW_ERROR;
   }
 
-  track_number = GST_READ_UINT32_BE (&key->u[12]);
-
-  for (i = 0; i < demux->essence_tracks->len; i++) {
-    GstMXFDemuxEssenceTrack *tmp =
-        &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
-
-    if (tmp->body_sid == demux->current_partition->partition.body_sid &&
-        (tmp->track_number == track_number || tmp->track_number == 0)) {
-      etrack = tmp;
-      break;
-    }
-  }
-
+  etrack = gst_mxf_demux_find_essence_track (demux, key);
   if (!etrack) {
     GST_WARNING_OBJECT (demux,
         "No essence track for this essence element found");
@@ -1608,13 +1649,26 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
     GST_DEBUG_OBJECT (demux,
         "Unknown essence track position, looking into index");
     if (etrack->offsets) {
-      for (i = 0; i < etrack->offsets->len; i++) {
-        GstMXFDemuxIndex *idx =
-            &g_array_index (etrack->offsets, GstMXFDemuxIndex, i);
+      guint64 offset = demux->offset - demux->run_in;
+      gint64 position =
+          gst_mxf_demux_index_find_position (etrack->offsets, offset);
 
-        if (idx->offset != 0 && idx->offset == demux->offset - demux->run_in) {
-          etrack->position = i;
-          break;
+      if (position != -1) {
+        GstMXFDemuxIndex *idx =
+            &g_array_index (etrack->offsets, GstMXFDemuxIndex, position);
+
+        if (idx->offset == offset) {
+          etrack->position = position;
+        } else if (idx->from_index_table) {
+          /* The element is inside this edit unit if the next one starts
+           * after it */
+          if (position + 1 < etrack->offsets->len) {
+            if (g_array_index (etrack->offsets, GstMXFDemuxIndex,
+                    position + 1).offset > offset)
+              etrack->position = position;
+          } else if (etrack->duration == etrack->offsets->len) {
+            etrack->position = position;
+          }
         }
       }
     }
@@ -1670,11 +1724,13 @@ gst_mxf_demux_handle_generic_container_essence_element (GstMXFDemux * demux,
 
       index->offset = demux->offset - demux->run_in;
       index->keyframe = keyframe;
+      index->from_index_table = FALSE;
     } else {
       GstMXFDemuxIndex index;
 
       index.offset = demux->offset - demux->run_in;
       index.keyframe = keyframe;
+      index.from_index_table = FALSE;
       g_array_insert_val (etrack->offsets, etrack->position, index);
     }
   }
@@ -1939,44 +1995,59 @@ gst_mxf_demux_handle_index_table_segment (GstMXFDemux * demux,
   return GST_FLOW_OK;
 }
 
+/* Pulls the 16 byte key and the BER encoded length of the KLV packet at
+ * offset with a single pull, the value itself is not read */
 static GstFlowReturn
-gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
-    GstBuffer ** outbuf, guint * read)
+gst_mxf_demux_pull_klv_header (GstMXFDemux * demux, guint64 offset,
+    MXFUL * key, guint64 * length, guint * data_offset)
 {
-  GstBuffer *buffer = NULL;
+  GstBuffer *buffer = NULL, *lbuffer = NULL;
   const guint8 *data;
-  guint64 data_offset = 0;
-  guint64 length;
+  guint size, slen;
   GstFlowReturn ret = GST_FLOW_OK;
 #ifndef GST_DISABLE_GST_DEBUG
   gchar str[48];
 #endif
 
-  memset (key, 0, sizeof (MXFUL));
-
-  /* Pull 16 byte key and first byte of BER encoded length */
-  if ((ret =
-          gst_mxf_demux_pull_range (demux, offset, 17, &buffer)) != GST_FLOW_OK)
-    goto beach;
+  /* Key, first byte of the length and the (at most 8) following bytes of
+   * the length. Less than that might be available at the end of the file */
+  ret = gst_pad_pull_range (demux->sinkpad, offset, 16 + 1 + 8, &buffer);
+  /* Some sources refuse to read over the end of the file instead of
+   * returning less, a short length then still fits into the minimal pull */
+  if (ret == GST_FLOW_UNEXPECTED) {
+    GST_DEBUG_OBJECT (demux, "Retrying KLV header pull at offset %"
+        G_GUINT64_FORMAT " with the minimal size", offset);
+    ret = gst_pad_pull_range (demux->sinkpad, offset, 16 + 1, &buffer);
+  }
+  if (G_UNLIKELY (ret != GST_FLOW_OK)) {
+    GST_WARNING_OBJECT (demux,
+        "failed when pulling KLV header from offset %" G_GUINT64_FORMAT
+        ": %s", offset, gst_flow_get_name (ret));
+    return ret;
+  }
 
   data = GST_BUFFER_DATA (buffer);
+  size = GST_BUFFER_SIZE (buffer);
 
-  memcpy (key, GST_BUFFER_DATA (buffer), 16);
+  if (G_UNLIKELY (size < 17)) {
+    GST_WARNING_OBJECT (demux,
+        "partial pull got %u when expecting at least 17 from offset %"
+        G_GUINT64_FORMAT, size, offset);
+    ret = GST_FLOW_UNEXPECTED;
+    goto beach;
+  }
+
+  memcpy (key, data, 16);
 
   GST_DEBUG_OBJECT (demux, "Got KLV packet with key %s", mxf_ul_to_string (key,
           str));
 
   /* Decode BER encoded packet length */
   if ((data[16] & 0x80) == 0) {
-    length = data[16];
-    data_offset = 17;
+    *length = data[16];
+    *data_offset = 17;
   } else {
-    guint slen = data[16] & 0x7f;
-
-    data_offset = 16 + 1 + slen;
-
-    gst_buffer_unref (buffer);
-    buffer = NULL;
+    slen = data[16] & 0x7f;
 
     /* Must be at most 8 according to SMPTE-379M 5.3.4 */
     if (slen > 8) {
@@ -1985,52 +2056,93 @@ gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
       goto beach;
     }
 
-    /* Now pull the length of the packet */
-    if ((ret = gst_mxf_demux_pull_range (demux, offset + 17, slen,
-                &buffer)) != GST_FLOW_OK)
-      goto beach;
-    data = GST_BUFFER_DATA (buffer);
+    if (size >= 17 + slen) {
+      data += 17;
+    } else {
+      /* Now pull the remaining bytes of the length */
+      if ((ret = gst_mxf_demux_pull_range (demux, offset + 17, slen,
+                  &lbuffer)) != GST_FLOW_OK)
+        goto beach;
+      data = GST_BUFFER_DATA (lbuffer);
+    }
+
+    *data_offset = 17 + slen;
 
-    length = 0;
+    *length = 0;
     while (slen) {
-      length = (length << 8) | *data;
+      *length = (*length << 8) | *data;
       data++;
       slen--;
     }
   }
 
+beach:
   gst_buffer_unref (buffer);
-  buffer = NULL;
+  if (lbuffer)
+    gst_buffer_unref (lbuffer);
+
+  return ret;
+}
+
+/* Pulls the value of the KLV packet at offset, whose header was already
+ * read by gst_mxf_demux_pull_klv_header() */
+static GstFlowReturn
+gst_mxf_demux_pull_klv_value (GstMXFDemux * demux, guint64 offset,
+    const MXFUL * key, guint64 length, guint data_offset, GstBuffer ** outbuf,
+    guint * read)
+{
+  GstBuffer *buffer = NULL;
+  GstFlowReturn ret = GST_FLOW_OK;
+#ifndef GST_DISABLE_GST_DEBUG
+  gchar str[48];
+#endif
 
   /* GStreamer's buffer sizes are stored in a guint so we
    * limit ourself to G_MAXUINT large buffers */
   if (length > G_MAXUINT) {
     GST_ERROR_OBJECT (demux,
         "Unsupported KLV packet length: %" G_GUINT64_FORMAT, length);
-    ret = GST_FLOW_ERROR;
-    goto beach;
+    return GST_FLOW_ERROR;
   }
 
   GST_DEBUG_OBJECT (demux, "KLV packet with key %s has length "
       "%" G_GUINT64_FORMAT, mxf_ul_to_string (key, str), length);
 
-  /* Pull the complete KLV packet */
-  if ((ret = gst_mxf_demux_pull_range (demux, offset + data_offset, length,
-              &buffer)) != GST_FLOW_OK)
-    goto beach;
+  if (mxf_is_fill (key)) {
+    /* Nobody looks at the content of fill items, don't read it */
+    buffer = gst_buffer_new ();
+  } else {
+    /* Pull the value directly into the buffer that is passed on */
+    if ((ret = gst_mxf_demux_pull_range (demux, offset + data_offset,
+                length, &buffer)) != GST_FLOW_OK)
+      return ret;
+  }
 
   *outbuf = buffer;
-  buffer = NULL;
   if (read)
     *read = data_offset + length;
 
-beach:
-  if (buffer)
-    gst_buffer_unref (buffer);
-
   return ret;
 }
 
+static GstFlowReturn
+gst_mxf_demux_pull_klv_packet (GstMXFDemux * demux, guint64 offset, MXFUL * key,
+    GstBuffer ** outbuf, guint * read)
+{
+  guint data_offset = 0;
+  guint64 length;
+  GstFlowReturn ret;
+
+  memset (key, 0, sizeof (MXFUL));
+
+  if ((ret = gst_mxf_demux_pull_klv_header (demux, offset, key, &length,
+              &data_offset)) != GST_FLOW_OK)
+    return ret;
+
+  return gst_mxf_demux_pull_klv_value (demux, offset, key, length,
+      data_offset, outbuf, read);
+}
+
 static void
 gst_mxf_demux_pull_random_index_pack (GstMXFDemux * demux)
 {
@@ -2272,15 +2384,15 @@ gst_mxf_demux_handle_klv_packet (GstMXFDemux * demux, const MXFUL * key,
   gchar key_str[48];
 #endif
   GstFlowReturn ret = GST_FLOW_OK;
+  MXFKLVPacketType type = mxf_klv_packet_type (key);
 
   if (demux->update_metadata
       && demux->preface
       && (demux->offset >=
           demux->run_in + demux->current_partition->primer.offset +
           demux->current_partition->partition.header_byte_count ||
-          mxf_is_generic_container_system_item (key) ||
-          mxf_is_generic_container_essence_element (key) ||
-          mxf_is_avid_essence_container_essence_element (key))) {
+          type == MXF_KLV_PACKET_TYPE_GENERIC_CONTAINER_SYSTEM_ITEM ||
+          type == MXF_KLV_PACKET_TYPE_ESSENCE_ELEMENT)) {
     demux->current_partition->parsed_metadata = TRUE;
     if ((ret = gst_mxf_demux_resolve_references (demux)) != GST_FLOW_OK ||
         (ret = gst_mxf_demux_update_tracks (demux)) != GST_FLOW_OK) {
@@ -2292,63 +2404,80 @@ gst_mxf_demux_handle_klv_packet (GstMXFDemux * demux, const MXFUL * key,
     }
   }
 
-  if (!mxf_is_mxf_packet (key)) {
-    GST_WARNING_OBJECT (demux,
-        "Skipping non-MXF packet of size %u at offset %"
-        G_GUINT64_FORMAT ", key: %s", GST_BUFFER_SIZE (buffer), demux->offset,
-        mxf_ul_to_string (key, key_str));
-  } else if (mxf_is_partition_pack (key)) {
-    ret = gst_mxf_demux_handle_partition_pack (demux, key, buffer);
-
-    /* If this partition contains the start of an essence container
-     * set the positions of all essence streams to 0
-     */
-    if (ret == GST_FLOW_OK && demux->current_partition
-        && demux->current_partition->partition.body_sid != 0
-        && demux->current_partition->partition.body_offset == 0) {
-      guint i;
+  switch (type) {
+    case MXF_KLV_PACKET_TYPE_ESSENCE_ELEMENT:
+      ret =
+          gst_mxf_demux_handle_generic_container_essence_element (demux, key,
+          buffer, peek);
+      break;
+    case MXF_KLV_PACKET_TYPE_GENERIC_CONTAINER_SYSTEM_ITEM:
+      ret =
+          gst_mxf_demux_handle_generic_container_system_item (demux, key,
+          buffer);
+      break;
+    case MXF_KLV_PACKET_TYPE_NON_MXF:
+      GST_WARNING_OBJECT (demux,
+          "Skipping non-MXF packet of size %u at offset %"
+          G_GUINT64_FORMAT ", key: %s", GST_BUFFER_SIZE (buffer),
+          demux->offset, mxf_ul_to_string (key, key_str));
+      break;
+    case MXF_KLV_PACKET_TYPE_PARTITION_PACK:
+      ret = gst_mxf_demux_handle_partition_pack (demux, key, buffer);
 
-      for (i = 0; i < demux->essence_tracks->len; i++) {
-        GstMXFDemuxEssenceTrack *etrack =
-            &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+      /* If this partition contains the start of an essence container
+       * set the positions of all essence streams to 0
+       */
+      if (ret == GST_FLOW_OK && demux->current_partition
+          && demux->current_partition->partition.body_sid != 0
+          && demux->current_partition->partition.body_offset == 0) {
+        guint i;
 
-        if (etrack->body_sid != demux->current_partition->partition.body_sid)
-          continue;
+        for (i = 0; i < demux->essence_tracks->len; i++) {
+          GstMXFDemuxEssenceTrack *etrack =
+              &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack,
+              i);
 
-        etrack->position = 0;
+          if (etrack->body_sid != demux->current_partition->partition.body_sid)
+            continue;
+
+          /* Other tracks continue at their own position */
+          if (demux->reader_track && etrack != demux->reader_track)
+            continue;
+
+          etrack->position = 0;
+        }
       }
-    }
-  } else if (mxf_is_primer_pack (key)) {
-    ret = gst_mxf_demux_handle_primer_pack (demux, key, buffer);
-  } else if (mxf_is_metadata (key)) {
-    ret = gst_mxf_demux_handle_metadata (demux, key, buffer);
-  } else if (mxf_is_descriptive_metadata (key)) {
-    ret = gst_mxf_demux_handle_descriptive_metadata (demux, key, buffer);
-  } else if (mxf_is_generic_container_system_item (key)) {
-    ret =
-        gst_mxf_demux_handle_generic_container_system_item (demux, key, buffer);
-  } else if (mxf_is_generic_container_essence_element (key) ||
-      mxf_is_avid_essence_container_essence_element (key)) {
-    ret =
-        gst_mxf_demux_handle_generic_container_essence_element (demux, key,
-        buffer, peek);
-  } else if (mxf_is_random_index_pack (key)) {
-    ret = gst_mxf_demux_handle_random_index_pack (demux, key, buffer);
-  } else if (mxf_is_index_table_segment (key)) {
-    ret = gst_mxf_demux_handle_index_table_segment (demux, key, buffer);
-  } else if (mxf_is_fill (key)) {
-    GST_DEBUG_OBJECT (demux,
-        "Skipping filler packet of size %u at offset %"
-        G_GUINT64_FORMAT, GST_BUFFER_SIZE (buffer), demux->offset);
-  } else {
-    GST_DEBUG_OBJECT (demux,
-        "Skipping unknown packet of size %u at offset %"
-        G_GUINT64_FORMAT ", key: %s", GST_BUFFER_SIZE (buffer), demux->offset,
-        mxf_ul_to_string (key, key_str));
+      break;
+    case MXF_KLV_PACKET_TYPE_PRIMER_PACK:
+      ret = gst_mxf_demux_handle_primer_pack (demux, key, buffer);
+      break;
+    case MXF_KLV_PACKET_TYPE_METADATA:
+      ret = gst_mxf_demux_handle_metadata (demux, key, buffer);
+      break;
+    case MXF_KLV_PACKET_TYPE_DESCRIPTIVE_METADATA:
+      ret = gst_mxf_demux_handle_descriptive_metadata (demux, key, buffer);
+      break;
+    case MXF_KLV_PACKET_TYPE_RANDOM_INDEX_PACK:
+      ret = gst_mxf_demux_handle_random_index_pack (demux, key, buffer);
+      break;
+    case MXF_KLV_PACKET_TYPE_INDEX_TABLE_SEGMENT:
+      ret = gst_mxf_demux_handle_index_table_segment (demux, key, buffer);
+      break;
+    case MXF_KLV_PACKET_TYPE_FILL:
+      GST_DEBUG_OBJECT (demux,
+          "Skipping filler packet at offset %" G_GUINT64_FORMAT,
+          demux->offset);
+      break;
+    default:
+      GST_DEBUG_OBJECT (demux,
+          "Skipping unknown packet of size %u at offset %"
+          G_GUINT64_FORMAT ", key: %s", GST_BUFFER_SIZE (buffer),
+          demux->offset, mxf_ul_to_string (key, key_str));
+      break;
   }
 
   /* In pull mode try to get the last metadata */
-  if (mxf_is_partition_pack (key) && ret == GST_FLOW_OK
+  if (type == MXF_KLV_PACKET_TYPE_PARTITION_PACK && ret == GST_FLOW_OK
       && demux->pull_footer_metadata
       && demux->random_access && demux->current_partition
       && demux->current_partition->partition.type == MXF_PARTITION_PACK_HEADER
@@ -2394,6 +2523,241 @@ gst_mxf_demux_set_partition_for_offset (GstMXFDemux * demux, guint64 offset)
   }
 }
 
+/* Returns the offset of the first KLV packet at or after @offset that is not
+ * fill, with its key in @key, or -1 if there is none */
+static guint64
+gst_mxf_demux_skip_fill (GstMXFDemux * demux, guint64 offset, MXFUL * key)
+{
+  guint64 length;
+  guint data_offset;
+
+  while (gst_mxf_demux_pull_klv_header (demux, offset, key, &length,
+          &data_offset) == GST_FLOW_OK) {
+    if (!mxf_is_fill (key))
+      return offset;
+    offset += data_offset + length;
+  }
+
+  return -1;
+}
+
+/* Pull the index table segments of all partitions listed in the random
+ * index pack. This also parses all partition packs and sets the essence
+ * container offsets of the partitions, which are needed to map the stream
+ * offsets of index entries to file offsets */
+static void
+gst_mxf_demux_pull_index_table_segments (GstMXFDemux * demux)
+{
+  guint64 old_offset = demux->offset;
+  GstMXFDemuxPartition *old_partition = demux->current_partition;
+  guint i;
+
+  if (demux->pulled_index_table_segments)
+    return;
+  demux->pulled_index_table_segments = TRUE;
+
+  if (!demux->random_index_pack) {
+    GST_DEBUG_OBJECT (demux, "No random index pack, not pulling index tables");
+    return;
+  }
+
+  for (i = 0; i < demux->random_index_pack->len; i++) {
+    MXFRandomIndexPackEntry *e =
+        &g_array_index (demux->random_index_pack, MXFRandomIndexPackEntry, i);
+    GstMXFDemuxPartition *p;
+    GstBuffer *buffer = NULL;
+    MXFUL key;
+    guint read = 0;
+    guint64 offset, end;
+
+    demux->offset = e->offset;
+    if (gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
+            &read) != GST_FLOW_OK)
+      continue;
+
+    if (!mxf_is_partition_pack (&key) ||
+        gst_mxf_demux_handle_partition_pack (demux, &key,
+            buffer) != GST_FLOW_OK) {
+      gst_buffer_unref (buffer);
+      continue;
+    }
+    gst_buffer_unref (buffer);
+
+    p = demux->current_partition;
+    /* The header metadata and then the index table segments follow the
+     * partition pack, after the fill that aligns them to the KAG */
+    offset = gst_mxf_demux_skip_fill (demux, e->offset + read, &key);
+    if (offset == -1)
+      continue;
+    offset += p->partition.header_byte_count;
+    end = offset + p->partition.index_byte_count;
+
+    while (offset < end) {
+      if (gst_mxf_demux_pull_klv_packet (demux, offset, &key, &buffer,
+              &read) != GST_FLOW_OK)
+        break;
+
+      demux->offset = offset;
+      if (mxf_is_index_table_segment (&key))
+        gst_mxf_demux_handle_index_table_segment (demux, &key, buffer);
+      gst_buffer_unref (buffer);
+      offset += read;
+    }
+
+    /* The essence container starts with the first essence element after
+     * them, which can again be preceded by fill */
+    if (p->partition.body_sid != 0 && p->essence_container_offset == 0) {
+      offset = gst_mxf_demux_skip_fill (demux, end, &key);
+      if (offset != -1 && (mxf_is_generic_container_system_item (&key) ||
+              mxf_is_generic_container_essence_element (&key) ||
+              mxf_is_avid_essence_container_essence_element (&key)))
+        p->essence_container_offset =
+            offset - demux->run_in - p->partition.this_partition;
+    }
+  }
+
+  demux->offset = old_offset;
+  demux->current_partition = old_partition;
+}
+
+static void
+gst_mxf_demux_apply_index_table_segment (GstMXFDemux * demux,
+    GstMXFDemuxEssenceTrack * etrack, const MXFIndexTableSegment * segment,
+    gboolean single_track)
+{
+  GList *l = demux->partitions;
+  GstMXFDemuxPartition *p = NULL;
+  MXFFraction *edit_rate = NULL;
+  gint64 start, duration, i;
+  guint32 element_delta = 0;
+  guint8 slice = 0;
+
+  if (etrack->source_track)
+    edit_rate = &etrack->source_track->edit_rate;
+
+  if (edit_rate && edit_rate->d != 0 && segment->index_edit_rate.d != 0 &&
+      (gint64) edit_rate->n * segment->index_edit_rate.d !=
+      (gint64) segment->index_edit_rate.n * edit_rate->d) {
+    GST_DEBUG_OBJECT (demux, "Index edit rate differs from track edit rate");
+    return;
+  }
+
+  start = segment->index_start_position;
+  if (segment->edit_unit_byte_count == 0)
+    duration = segment->n_index_entries;
+  else if (segment->index_duration > 0)
+    duration = segment->index_duration;
+  else
+    duration = etrack->duration - start;
+
+  if (start < 0 || duration <= 0)
+    return;
+
+  GST_DEBUG_OBJECT (demux, "Applying index table segment for edit units %"
+      G_GINT64_FORMAT " to %" G_GINT64_FORMAT " to track %u", start,
+      start + duration - 1, etrack->track_number);
+
+  /* The delta entries give the offset of each element in the content
+   * package. Which element belongs to which track is only known if the
+   * container has a single one, which then is the last element after a
+   * possible system item */
+  if (single_track && segment->n_delta_entries > 0) {
+    const MXFDeltaEntry *delta =
+        &segment->delta_entries[segment->n_delta_entries - 1];
+
+    element_delta = delta->element_delta;
+    slice = delta->slice;
+  }
+
+  if (!etrack->offsets)
+    etrack->offsets = g_array_new (FALSE, TRUE, sizeof (GstMXFDemuxIndex));
+  if (etrack->offsets->len < start + duration)
+    g_array_set_size (etrack->offsets, start + duration);
+
+  for (i = 0; i < duration; i++) {
+    GstMXFDemuxIndex *idx =
+        &g_array_index (etrack->offsets, GstMXFDemuxIndex, start + i);
+    guint64 stream_offset;
+    gboolean keyframe;
+
+    /* Already known from the essence element itself */
+    if (idx->offset != 0)
+      continue;
+
+    if (segment->edit_unit_byte_count) {
+      stream_offset = (start + i) * segment->edit_unit_byte_count;
+      keyframe = TRUE;
+    } else {
+      const MXFIndexEntry *entry = &segment->index_entries[i];
+
+      stream_offset = entry->stream_offset;
+      if (slice > 0 && slice <= segment->slice_count)
+        stream_offset += entry->slice_offset[slice - 1];
+      /* random access flag */
+      keyframe = (entry->flags & 0x80) != 0;
+    }
+    stream_offset += element_delta;
+
+    /* Stream offsets are increasing, so find the partition containing this
+     * one starting from the previous one */
+    while (l) {
+      GstMXFDemuxPartition *tmp = l->data;
+
+      if (tmp->partition.body_sid == etrack->body_sid) {
+        if (tmp->partition.body_offset > stream_offset)
+          break;
+        p = tmp;
+      }
+      l = l->next;
+    }
+
+    if (!p || p->essence_container_offset == 0)
+      continue;
+
+    idx->offset = p->partition.this_partition + p->essence_container_offset +
+        stream_offset - p->partition.body_offset;
+    idx->keyframe = keyframe;
+    idx->from_index_table = TRUE;
+  }
+}
+
+/* Fill the offsets of the essence tracks from the pending index table
+ * segments, so that seeking becomes a lookup instead of a scan */
+static void
+gst_mxf_demux_apply_index_table_segments (GstMXFDemux * demux)
+{
+  GList *l;
+  guint i;
+
+  if (!demux->pending_index_table_segments || !demux->essence_tracks->len)
+    return;
+
+  for (l = demux->pending_index_table_segments; l; l = l->next) {
+    MXFIndexTableSegment *segment = l->data;
+    guint n_tracks = 0;
+
+    for (i = 0; i < demux->essence_tracks->len; i++) {
+      if (g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack,
+              i).body_sid == segment->body_sid)
+        n_tracks++;
+    }
+
+    for (i = 0; i < demux->essence_tracks->len; i++) {
+      GstMXFDemuxEssenceTrack *etrack =
+          &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+
+      if (etrack->body_sid == segment->body_sid)
+        gst_mxf_demux_apply_index_table_segment (demux, etrack, segment,
+            n_tracks == 1);
+    }
+
+    mxf_index_table_segment_reset (segment);
+    g_free (segment);
+  }
+  g_list_free (demux->pending_index_table_segments);
+  demux->pending_index_table_segments = NULL;
+}
+
 static guint64
 gst_mxf_demux_find_essence_element (GstMXFDemux * demux,
     GstMXFDemuxEssenceTrack * etrack, gint64 * position, gboolean keyframe)
@@ -2407,6 +2771,10 @@ gst_mxf_demux_find_essence_element (GstMXFDemux * demux,
       " of track %u with body_sid %u (keyframe %d)", *position,
       etrack->track_number, etrack->body_sid, keyframe);
 
+  if (demux->random_access)
+    gst_mxf_demux_pull_index_table_segments (demux);
+  gst_mxf_demux_apply_index_table_segments (demux);
+
 from_index:
 
   if (etrack->duration > 0 && *position >= etrack->duration) {
@@ -2565,6 +2933,73 @@ from_index:
   return -1;
 }
 
+/* In sequential-tracks mode the essence track of the earliest pad is read
+ * from its own position until that pad is more than max-drift ahead of the
+ * others. Essence elements of other tracks are skipped without reading them
+ * and every track only continues where its reading stopped, which avoids
+ * seeking between tracks that are stored far apart for every edit unit */
+static void
+gst_mxf_demux_select_reader_track (GstMXFDemux * demux)
+{
+  GstMXFDemuxPad *earliest, *pad = NULL;
+  GstMXFDemuxEssenceTrack *etrack;
+  guint i;
+
+  earliest = gst_mxf_demux_get_earliest_pad (demux);
+  if (!earliest)
+    return;
+
+  if (demux->reader_track) {
+    for (i = 0; i < demux->src->len; i++) {
+      GstMXFDemuxPad *p = g_ptr_array_index (demux->src, i);
+
+      if (!p->eos && p->current_essence_track == demux->reader_track) {
+        pad = p;
+        break;
+      }
+    }
+
+    if (pad && pad->last_stop <= earliest->last_stop + demux->max_drift)
+      return;
+
+    demux->reader_track->reader_offset = demux->offset;
+    demux->reader_track->reader_position = demux->reader_track->position;
+  }
+
+  etrack = earliest->current_essence_track;
+
+  GST_DEBUG_OBJECT (demux, "Switching to reading track %u with body_sid %u",
+      etrack->track_number, etrack->body_sid);
+
+  if (etrack->reader_offset != 0) {
+    demux->offset = etrack->reader_offset;
+    etrack->position = etrack->reader_position;
+  } else {
+    gint64 position = earliest->current_essence_track_position;
+    guint64 offset;
+
+    offset =
+        gst_mxf_demux_find_essence_element (demux, etrack, &position, FALSE);
+    if (offset == -1) {
+      GstEvent *e;
+
+      GST_WARNING_OBJECT (demux, "Failed to find offset for essence track");
+      earliest->eos = TRUE;
+      e = gst_event_new_eos ();
+      gst_event_set_seqnum (e, demux->seqnum);
+      gst_pad_push_event (GST_PAD_CAST (earliest), e);
+      demux->reader_track = NULL;
+      return;
+    }
+
+    demux->offset = offset + demux->run_in;
+    etrack->position = position;
+  }
+
+  gst_mxf_demux_set_partition_for_offset (demux, demux->offset);
+  demux->reader_track = etrack;
+}
+
 static GstFlowReturn
 gst_mxf_demux_pull_and_handle_klv_packet (GstMXFDemux * demux)
 {
@@ -2579,13 +3014,99 @@ gst_mxf_demux_pull_and_handle_klv_packet (GstMXFDemux * demux)
       GST_DEBUG_OBJECT (demux, "All tracks are EOS");
       goto beach;
     }
+
+    if (demux->sequential_tracks && demux->essence_tracks->len > 0) {
+      gst_mxf_demux_select_reader_track (demux);
+      /* The selected pad went EOS, try again with the next one */
+      if (!demux->reader_track)
+        goto beach;
+    }
   }
 
-  ret =
-      gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
-      &read);
+  if (demux->reader_track) {
+    guint64 length = 0;
+    guint data_offset = 0;
+
+    /* If the partition belongs to another essence container continue with
+     * the next partition of this track's container, all partitions are
+     * known if there is a random index pack */
+    if (demux->random_index_pack && demux->current_partition
+        && demux->current_partition->partition.body_sid !=
+        demux->reader_track->body_sid) {
+      GstMXFDemuxPartition *next = NULL;
+      GList *l;
+
+      for (l = demux->partitions; l; l = l->next) {
+        GstMXFDemuxPartition *tmp = l->data;
+
+        if (tmp->partition.this_partition + demux->run_in > demux->offset &&
+            tmp->partition.body_sid == demux->reader_track->body_sid) {
+          next = tmp;
+          break;
+        }
+      }
+
+      if (next) {
+        demux->offset = next->partition.this_partition + demux->run_in;
+        demux->current_partition = next;
+      } else {
+        ret = GST_FLOW_UNEXPECTED;
+      }
+    }
 
-  if (ret == GST_FLOW_UNEXPECTED && demux->src->len > 0) {
+    memset (&key, 0, sizeof (MXFUL));
+    if (ret == GST_FLOW_OK)
+      ret =
+          gst_mxf_demux_pull_klv_header (demux, demux->offset, &key, &length,
+          &data_offset);
+
+    if (ret == GST_FLOW_OK
+        && mxf_klv_packet_type (&key) == MXF_KLV_PACKET_TYPE_ESSENCE_ELEMENT
+        && demux->current_partition
+        && gst_mxf_demux_find_essence_track (demux,
+            &key) != demux->reader_track) {
+      GST_LOG_OBJECT (demux, "Skipping essence element of another track at "
+          "offset %" G_GUINT64_FORMAT, demux->offset);
+      demux->offset += data_offset + length;
+      goto beach;
+    }
+
+    if (ret == GST_FLOW_OK)
+      ret =
+          gst_mxf_demux_pull_klv_value (demux, demux->offset, &key, length,
+          data_offset, &buffer, &read);
+  } else {
+    ret =
+        gst_mxf_demux_pull_klv_packet (demux, demux->offset, &key, &buffer,
+        &read);
+  }
+
+  if (ret == GST_FLOW_UNEXPECTED && demux->reader_track) {
+    guint i;
+
+    /* Only the track that was read reached the end of the file, all
+     * others continue at their own position */
+    if (demux->reader_track->position > 0)
+      demux->reader_track->duration = demux->reader_track->position;
+
+    for (i = 0; i < demux->src->len; i++) {
+      GstMXFDemuxPad *p = g_ptr_array_index (demux->src, i);
+
+      if (!p->eos && p->current_essence_track == demux->reader_track) {
+        GstEvent *e;
+
+        p->eos = TRUE;
+        e = gst_event_new_eos ();
+        gst_event_set_seqnum (e, demux->seqnum);
+        gst_pad_push_event (GST_PAD_CAST (p), e);
+      }
+    }
+    demux->reader_track = NULL;
+
+    if (gst_mxf_demux_get_earliest_pad (demux))
+      ret = GST_FLOW_OK;
+    goto beach;
+  } else if (ret == GST_FLOW_UNEXPECTED && demux->src->len > 0) {
     guint i;
     GstMXFDemuxPad *p = NULL;
 
@@ -2648,8 +3169,9 @@ gst_mxf_demux_pull_and_handle_klv_packet (GstMXFDemux * demux)
   ret = gst_mxf_demux_handle_klv_packet (demux, &key, buffer, FALSE);
   demux->offset += read;
 
+  /* Tracks are switched in gst_mxf_demux_select_reader_track() instead */
   if (ret == GST_FLOW_OK && demux->src->len > 0
-      && demux->essence_tracks->len > 0) {
+      && demux->essence_tracks->len > 0 && !demux->reader_track) {
     GstMXFDemuxPad *earliest = NULL;
     /* We allow time drifts of at most 500ms */
     while ((earliest = gst_mxf_demux_get_earliest_pad (demux)) &&
@@ -3293,6 +3815,13 @@ gst_mxf_demux_seek_pull (GstMXFDemux * demux, GstEvent * event)
       }
     }
 
+    /* Reading positions of the tracks are set again below */
+    for (i = 0; i < demux->essence_tracks->len; i++) {
+      GstMXFDemuxEssenceTrack *t =
+          &g_array_index (demux->essence_tracks, GstMXFDemuxEssenceTrack, i);
+      t->reader_offset = 0;
+    }
+
     /* Do the actual seeking */
     for (i = 0; i < demux->src->len; i++) {
       GstMXFDemuxPad *p = g_ptr_array_index (demux->src, i);
@@ -3315,16 +3844,19 @@ gst_mxf_demux_seek_pull (GstMXFDemux * demux, GstEvent * event)
       } else {
         new_offset = MIN (off, new_offset);
         if (position != p->current_essence_track_position) {
-          p->last_flow -=
+          p->last_stop -=
               gst_util_uint64_scale (p->current_essence_track_position -
               position,
               GST_SECOND * p->current_essence_track->source_track->edit_rate.d,
-              p->current_essence_track->source_track->edit_rate.d);
+              p->current_essence_track->source_track->edit_rate.n);
         }
         p->current_essence_track_position = position;
+        p->current_essence_track->reader_offset = off + demux->run_in;
+        p->current_essence_track->reader_position = position;
       }
       p->discont = TRUE;
     }
+    demux->reader_track = NULL;
     if (new_offset == -1) {
       GST_WARNING_OBJECT (demux, "No new offset found");
       ret = FALSE;
@@ -3912,6 +4444,9 @@ gst_mxf_demux_set_property (GObject * object, guint prop_id,
     case PROP_MAX_DRIFT:
       demux->max_drift = g_value_get_uint64 (value);
       break;
+    case PROP_SEQUENTIAL_TRACKS:
+      demux->sequential_tracks = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -3931,6 +4466,9 @@ gst_mxf_demux_get_property (GObject * object, guint prop_id,
     case PROP_MAX_DRIFT:
       g_value_set_uint64 (value, demux->max_drift);
       break;
+    case PROP_SEQUENTIAL_TRACKS:
+      g_value_set_boolean (value, demux->sequential_tracks);
+      break;
     case PROP_STRUCTURE:{
       GstStructure *s;
 
@@ -4028,6 +4566,13 @@ gst_mxf_demux_class_init (GstMXFDemuxClass * klass)
           "Structural metadata of the MXF file",
           GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_SEQUENTIAL_TRACKS,
+      g_param_spec_boolean ("sequential-tracks", "Sequential tracks",
+          "Read every essence track sequentially from its own position "
+          "until it is max-drift ahead of the other tracks instead of "
+          "following the interleaving of the file (pull mode only)", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_mxf_demux_change_state);
   gstelement_class->query = GST_DEBUG_FUNCPTR (gst_mxf_demux_query);
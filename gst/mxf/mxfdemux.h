@@ -59,6 +59,9 @@ typedef struct
 {
   guint64 offset;
   gboolean keyframe;
+  /* offset is the start of the edit unit, taken from an index table
+   * segment, and not necessarily the one of the essence element */
+  gboolean from_index_table;
 } GstMXFDemuxIndex;
 
 typedef struct
@@ -84,6 +87,11 @@ typedef struct
   GstTagList *tags;
 
   GstCaps *caps;
+
+  /* Where reading of this track continues in sequential-tracks mode,
+   * reader_offset is 0 if unknown */
+  guint64 reader_offset;
+  gint64 reader_position;
 } GstMXFDemuxEssenceTrack;
 
 struct _GstMXFDemuxPad
@@ -149,7 +157,10 @@ struct _GstMXFDemux
   GstMXFDemuxPartition *current_partition;
 
   GArray *essence_tracks;
+  /* Track that is currently read in sequential-tracks mode */
+  GstMXFDemuxEssenceTrack *reader_track;
   GList *pending_index_table_segments;
+  gboolean pulled_index_table_segments;
 
   GArray *random_index_pack;
 
@@ -169,6 +180,7 @@ struct _GstMXFDemux
   /* Properties */
   gchar *requested_package_string;
   GstClockTime max_drift;
+  gboolean sequential_tracks;
 };
 
 struct _GstMXFDemuxClass
@@ -5657,8 +5657,8 @@ mxf_dms1_initialize (void)
   _add_dm_type (MXF_TYPE_DMS1_CONTACTS_LIST);
   _add_dm_type (MXF_TYPE_DMS1_CUE_WORDS);
 
-  mxf_descriptive_metadata_register (0x01, (GType *) g_array_free (dms1_sets,
-          FALSE));
+  mxf_descriptive_metadata_register (0x01, (GType *) dms1_sets->data);
+  g_array_free (dms1_sets, TRUE);
 }
 
 #undef _add_dm_type
@@ -402,80 +402,84 @@ mxf_metadata_init (MXFMetadata * self)
 {
 }
 
-static GArray *_mxf_metadata_registry = NULL;
+/* Maps the 16 bit set type of a metadata key (bytes 13 and 14 of the UL)
+ * to the GType handling it */
+static GHashTable *_mxf_metadata_registry = NULL;
 
-#define _add_metadata_type(type) G_STMT_START { \
-  GType t = type; \
-  \
-  g_array_append_val (_mxf_metadata_registry, t); \
-} G_STMT_END
+static void
+_mxf_metadata_registry_add (GType type)
+{
+  MXFMetadataClass *klass = MXF_METADATA_CLASS (g_type_class_ref (type));
+  gpointer key = GUINT_TO_POINTER ((guint) klass->type);
+
+  /* Abstract base types have no set type and the first handler registered
+   * for a set type wins */
+  if (klass->type != 0 && !g_hash_table_lookup (_mxf_metadata_registry, key))
+    g_hash_table_insert (_mxf_metadata_registry, key, GSIZE_TO_POINTER (type));
+
+  g_type_class_unref (klass);
+}
 
 void
 mxf_metadata_init_types (void)
 {
   g_return_if_fail (_mxf_metadata_registry == NULL);
 
-  _mxf_metadata_registry = g_array_new (FALSE, TRUE, sizeof (GType));
-
-  _add_metadata_type (MXF_TYPE_METADATA_PREFACE);
-  _add_metadata_type (MXF_TYPE_METADATA_IDENTIFICATION);
-  _add_metadata_type (MXF_TYPE_METADATA_CONTENT_STORAGE);
-  _add_metadata_type (MXF_TYPE_METADATA_ESSENCE_CONTAINER_DATA);
-  _add_metadata_type (MXF_TYPE_METADATA_MATERIAL_PACKAGE);
-  _add_metadata_type (MXF_TYPE_METADATA_SOURCE_PACKAGE);
-  _add_metadata_type (MXF_TYPE_METADATA_TIMELINE_TRACK);
-  _add_metadata_type (MXF_TYPE_METADATA_EVENT_TRACK);
-  _add_metadata_type (MXF_TYPE_METADATA_STATIC_TRACK);
-  _add_metadata_type (MXF_TYPE_METADATA_SEQUENCE);
-  _add_metadata_type (MXF_TYPE_METADATA_SOURCE_CLIP);
-  _add_metadata_type (MXF_TYPE_METADATA_FILLER);
-  _add_metadata_type (MXF_TYPE_METADATA_TIMECODE_COMPONENT);
-  _add_metadata_type (MXF_TYPE_METADATA_DM_SEGMENT);
-  _add_metadata_type (MXF_TYPE_METADATA_DM_SOURCE_CLIP);
-  _add_metadata_type (MXF_TYPE_METADATA_FILE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_GENERIC_PICTURE_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_CDCI_PICTURE_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_RGBA_PICTURE_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_GENERIC_SOUND_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_GENERIC_DATA_ESSENCE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_MULTIPLE_DESCRIPTOR);
-  _add_metadata_type (MXF_TYPE_METADATA_NETWORK_LOCATOR);
-  _add_metadata_type (MXF_TYPE_METADATA_TEXT_LOCATOR);
-}
-
-#undef _add_metadata_type
+  _mxf_metadata_registry = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_PREFACE);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_IDENTIFICATION);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_CONTENT_STORAGE);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_ESSENCE_CONTAINER_DATA);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_MATERIAL_PACKAGE);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_SOURCE_PACKAGE);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_TIMELINE_TRACK);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_EVENT_TRACK);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_STATIC_TRACK);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_SEQUENCE);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_SOURCE_CLIP);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_FILLER);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_TIMECODE_COMPONENT);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_DM_SEGMENT);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_DM_SOURCE_CLIP);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_FILE_DESCRIPTOR);
+  _mxf_metadata_registry_add
+      (MXF_TYPE_METADATA_GENERIC_PICTURE_ESSENCE_DESCRIPTOR);
+  _mxf_metadata_registry_add
+      (MXF_TYPE_METADATA_CDCI_PICTURE_ESSENCE_DESCRIPTOR);
+  _mxf_metadata_registry_add
+      (MXF_TYPE_METADATA_RGBA_PICTURE_ESSENCE_DESCRIPTOR);
+  _mxf_metadata_registry_add
+      (MXF_TYPE_METADATA_GENERIC_SOUND_ESSENCE_DESCRIPTOR);
+  _mxf_metadata_registry_add
+      (MXF_TYPE_METADATA_GENERIC_DATA_ESSENCE_DESCRIPTOR);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_MULTIPLE_DESCRIPTOR);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_NETWORK_LOCATOR);
+  _mxf_metadata_registry_add (MXF_TYPE_METADATA_TEXT_LOCATOR);
+}
 
 void
 mxf_metadata_register (GType type)
 {
   g_return_if_fail (g_type_is_a (type, MXF_TYPE_METADATA));
+  g_return_if_fail (_mxf_metadata_registry != NULL);
 
-  g_array_append_val (_mxf_metadata_registry, type);
+  _mxf_metadata_registry_add (type);
 }
 
 MXFMetadata *
 mxf_metadata_new (guint16 type, MXFPrimerPack * primer, guint64 offset,
     const guint8 * data, guint size)
 {
-  guint i;
-  GType t = G_TYPE_INVALID;
+  GType t;
   MXFMetadata *ret = NULL;
 
   g_return_val_if_fail (type != 0, NULL);
   g_return_val_if_fail (primer != NULL, NULL);
   g_return_val_if_fail (_mxf_metadata_registry != NULL, NULL);
 
-  for (i = 0; i < _mxf_metadata_registry->len; i++) {
-    GType tmp = g_array_index (_mxf_metadata_registry, GType, i);
-    MXFMetadataClass *klass = MXF_METADATA_CLASS (g_type_class_ref (tmp));
-
-    if (klass->type == type) {
-      g_type_class_unref (klass);
-      t = tmp;
-      break;
-    }
-    g_type_class_unref (klass);
-  }
+  t = (GType) GPOINTER_TO_SIZE (g_hash_table_lookup (_mxf_metadata_registry,
+          GUINT_TO_POINTER ((guint) type)));
 
   if (t == G_TYPE_INVALID) {
     GST_WARNING
@@ -6434,13 +6438,14 @@ mxf_descriptive_metadata_class_init (MXFDescriptiveMetadataClass * klass)
 typedef struct
 {
   guint8 scheme;
-  GType *types;
+  /* set type => GType */
+  GHashTable *types;
 } _MXFDescriptiveMetadataScheme;
 
 static GArray *_dm_schemes = NULL;
 
 void
-mxf_descriptive_metadata_register (guint8 scheme, GType * types)
+mxf_descriptive_metadata_register (guint8 scheme, const GType * types)
 {
   _MXFDescriptiveMetadataScheme s;
 
@@ -6449,7 +6454,17 @@ mxf_descriptive_metadata_register (guint8 scheme, GType * types)
         g_array_new (FALSE, TRUE, sizeof (_MXFDescriptiveMetadataScheme));
 
   s.scheme = scheme;
-  s.types = types;
+  s.types = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  for (; *types; types++) {
+    MXFDescriptiveMetadataClass *klass =
+        MXF_DESCRIPTIVE_METADATA_CLASS (g_type_class_ref (*types));
+    gpointer key = GUINT_TO_POINTER (klass->type);
+
+    if (klass->type != 0 && !g_hash_table_lookup (s.types, key))
+      g_hash_table_insert (s.types, key, GSIZE_TO_POINTER (*types));
+    g_type_class_unref (klass);
+  }
 
   g_array_append_val (_dm_schemes, s);
 }
@@ -6459,7 +6474,7 @@ mxf_descriptive_metadata_new (guint8 scheme, guint32 type,
     MXFPrimerPack * primer, guint64 offset, const guint8 * data, guint size)
 {
   guint i;
-  GType t = G_TYPE_INVALID, *p;
+  GType t;
   _MXFDescriptiveMetadataScheme *s = NULL;
   MXFDescriptiveMetadata *ret = NULL;
 
@@ -6485,20 +6500,8 @@ mxf_descriptive_metadata_new (guint8 scheme, guint32 type,
     return NULL;
   }
 
-  p = s->types;
-  while (*p) {
-    GType tmp = *p;
-    MXFDescriptiveMetadataClass *klass =
-        MXF_DESCRIPTIVE_METADATA_CLASS (g_type_class_ref (tmp));
-
-    if (klass->type == type) {
-      g_type_class_unref (klass);
-      t = tmp;
-      break;
-    }
-    g_type_class_unref (klass);
-    p++;
-  }
+  t = (GType) GPOINTER_TO_SIZE (g_hash_table_lookup (s->types,
+          GUINT_TO_POINTER (type)));
 
   if (t == G_TYPE_INVALID) {
     GST_WARNING
@@ -781,7 +781,7 @@ gboolean mxf_metadata_generic_picture_essence_descriptor_from_caps (MXFMetadataG
 void mxf_metadata_generic_sound_essence_descriptor_set_caps (MXFMetadataGenericSoundEssenceDescriptor * self, GstCaps * caps);
 gboolean mxf_metadata_generic_sound_essence_descriptor_from_caps (MXFMetadataGenericSoundEssenceDescriptor * self, GstCaps * caps);
 
-void mxf_descriptive_metadata_register (guint8 scheme, GType *types);
+void mxf_descriptive_metadata_register (guint8 scheme, const GType *types);
 MXFDescriptiveMetadata * mxf_descriptive_metadata_new (guint8 scheme, guint32 type, MXFPrimerPack * primer, guint64 offset, const guint8 * data, guint size);
 
 GHashTable *mxf_metadata_hash_table_new (void);
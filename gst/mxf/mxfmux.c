@@ -46,6 +46,10 @@
 GST_DEBUG_CATEGORY_STATIC (mxfmux_debug);
 #define GST_CAT_DEFAULT mxfmux_debug
 
+#define GST_MXF_MUX_INDEX_SID 2
+/* Keeps the index entry array within the 16 bit local tag length */
+#define GST_MXF_MUX_INDEX_ENTRIES_PER_SEGMENT 4096
+
 static GstStaticPadTemplate src_templ = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
@@ -149,6 +153,8 @@ gst_mxf_mux_init (GstMXFMux * mux, GstMXFMuxClass * g_class)
   gst_collect_pads2_set_function (mux->collect,
       (GstCollectPads2Function) GST_DEBUG_FUNCPTR (gst_mxf_mux_collected), mux);
 
+  mux->index_entries = g_array_new (FALSE, TRUE, sizeof (MXFIndexEntry));
+
   gst_mxf_mux_reset (mux);
 }
 
@@ -167,6 +173,7 @@ gst_mxf_mux_finalize (GObject * object)
   }
 
   gst_object_unref (mux->collect);
+  g_array_free (mux->index_entries, TRUE);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -228,6 +235,8 @@ gst_mxf_mux_reset (GstMXFMux * mux)
   mux->last_gc_timestamp = 0;
   mux->last_gc_position = 0;
   mux->offset = 0;
+  mux->essence_offset = 0;
+  g_array_set_size (mux->index_entries, 0);
 }
 
 static gboolean
@@ -939,7 +948,8 @@ gst_mxf_mux_create_metadata (GstMXFMux * mux)
 
     cstorage->essence_container_data[0]->linked_package =
         MXF_METADATA_SOURCE_PACKAGE (cstorage->packages[1]);
-    cstorage->essence_container_data[0]->index_sid = 0;
+    /* The index table is written to the footer partition */
+    cstorage->essence_container_data[0]->index_sid = GST_MXF_MUX_INDEX_SID;
     cstorage->essence_container_data[0]->body_sid = 1;
   }
 
@@ -1100,6 +1110,7 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
   guint8 slen, ber[9];
   gboolean flush = ((cpad->collect.state & GST_COLLECT_PADS2_STATE_EOS)
       && !cpad->have_complete_edit_unit && cpad->collect.buffer == NULL);
+  gboolean delta = FALSE;
 
   if (cpad->have_complete_edit_unit) {
     GST_DEBUG_OBJECT (cpad->collect.pad,
@@ -1114,6 +1125,7 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
     GST_DEBUG_OBJECT (cpad->collect.pad,
         "Handling buffer of size %u for track %u at position %" G_GINT64_FORMAT,
         GST_BUFFER_SIZE (buf), cpad->source_track->parent.track_id, cpad->pos);
+    delta = GST_BUFFER_FLAG_IS_SET (buf, GST_BUFFER_FLAG_DELTA_UNIT);
   } else {
     flush = TRUE;
     GST_DEBUG_OBJECT (cpad->collect.pad,
@@ -1152,6 +1164,19 @@ gst_mxf_mux_handle_buffer (GstMXFMux * mux, GstMXFMuxPad * cpad)
       GST_BUFFER_SIZE (buf));
   gst_buffer_unref (buf);
 
+  /* Remember where each content package starts for the index table, it
+   * is a random access point if none of its elements is a delta unit */
+  while (mux->index_entries->len <= mux->last_gc_position) {
+    MXFIndexEntry entry = { 0, };
+
+    entry.flags = 0x80;
+    entry.stream_offset = mux->offset - mux->essence_offset;
+    g_array_append_val (mux->index_entries, entry);
+  }
+  if (delta)
+    g_array_index (mux->index_entries, MXFIndexEntry,
+        mux->last_gc_position).flags &= ~0x80;
+
   GST_DEBUG_OBJECT (cpad->collect.pad, "Pushing buffer of size %u for track %u",
       GST_BUFFER_SIZE (packet), cpad->source_track->parent.track_id);
 
@@ -1174,6 +1199,7 @@ static GstFlowReturn
 gst_mxf_mux_write_body_partition (GstMXFMux * mux)
 {
   GstBuffer *buf;
+  GstFlowReturn ret;
 
   mux->partition.type = MXF_PARTITION_PACK_BODY;
   mux->partition.this_partition = mux->offset;
@@ -1187,7 +1213,92 @@ gst_mxf_mux_write_body_partition (GstMXFMux * mux)
       mux->preface->content_storage->essence_container_data[0]->body_sid;
 
   buf = mxf_partition_pack_to_buffer (&mux->partition);
-  return gst_mxf_mux_push (mux, buf);
+  ret = gst_mxf_mux_push (mux, buf);
+  mux->essence_offset = mux->offset;
+
+  return ret;
+}
+
+/* Create the index table segments for the content packages of the body
+ * partition. If all of them are random access points of the same size, a
+ * single constant edit unit size segment is enough. Otherwise every edit
+ * unit gets an index entry, split into segments small enough for the 16
+ * bit length of the index entry array */
+static GList *
+gst_mxf_mux_create_index_table_segments (GstMXFMux * mux, guint64 * size)
+{
+  MXFIndexTableSegment segment;
+  guint64 essence_size = mux->offset - mux->essence_offset;
+  guint32 edit_unit_byte_count = 0;
+  GList *buffers = NULL;
+  GstBuffer *buf;
+  guint i, n = mux->index_entries->len;
+  gint last_keyframe = -1;
+
+  *size = 0;
+
+  if (n == 0)
+    return NULL;
+
+  for (i = 0; i < n; i++) {
+    MXFIndexEntry *entry =
+        &g_array_index (mux->index_entries, MXFIndexEntry, i);
+    guint64 end = (i + 1 < n) ? g_array_index (mux->index_entries,
+        MXFIndexEntry, i + 1).stream_offset : essence_size;
+
+    if (!(entry->flags & 0x80) || end - entry->stream_offset > G_MAXUINT32 ||
+        (i > 0 && end - entry->stream_offset != edit_unit_byte_count)) {
+      edit_unit_byte_count = 0;
+      break;
+    }
+    edit_unit_byte_count = end - entry->stream_offset;
+  }
+
+  memset (&segment, 0, sizeof (segment));
+  segment.index_edit_rate = mux->min_edit_rate;
+  segment.index_sid = GST_MXF_MUX_INDEX_SID;
+  segment.body_sid =
+      mux->preface->content_storage->essence_container_data[0]->body_sid;
+
+  if (edit_unit_byte_count) {
+    GST_DEBUG_OBJECT (mux, "Writing constant edit unit size index table, "
+        "%u bytes per edit unit", edit_unit_byte_count);
+    mxf_uuid_init (&segment.instance_id, mux->metadata);
+    segment.index_duration = n;
+    segment.edit_unit_byte_count = edit_unit_byte_count;
+
+    buf = mxf_index_table_segment_to_buffer (&segment);
+    *size += GST_BUFFER_SIZE (buf);
+    return g_list_prepend (NULL, buf);
+  }
+
+  GST_DEBUG_OBJECT (mux, "Writing index table with %u entries", n);
+
+  /* Key frame offsets point back to the previous random access point */
+  for (i = 0; i < n; i++) {
+    MXFIndexEntry *entry =
+        &g_array_index (mux->index_entries, MXFIndexEntry, i);
+
+    if (entry->flags & 0x80)
+      last_keyframe = i;
+    else if (last_keyframe != -1)
+      entry->key_frame_offset = MAX (last_keyframe - (gint) i, G_MININT8);
+  }
+
+  for (i = 0; i < n; i += GST_MXF_MUX_INDEX_ENTRIES_PER_SEGMENT) {
+    mxf_uuid_init (&segment.instance_id, mux->metadata);
+    segment.index_start_position = i;
+    segment.index_duration = MIN (n - i, GST_MXF_MUX_INDEX_ENTRIES_PER_SEGMENT);
+    segment.n_index_entries = segment.index_duration;
+    segment.index_entries =
+        &g_array_index (mux->index_entries, MXFIndexEntry, i);
+
+    buf = mxf_index_table_segment_to_buffer (&segment);
+    *size += GST_BUFFER_SIZE (buf);
+    buffers = g_list_prepend (buffers, buf);
+  }
+
+  return g_list_reverse (buffers);
 }
 
 static GstFlowReturn
@@ -1289,6 +1400,10 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
     GArray *rip;
     GstFlowReturn ret;
     MXFRandomIndexPackEntry entry;
+    GList *index, *l;
+    guint64 index_byte_count;
+
+    index = gst_mxf_mux_create_index_table_segments (mux, &index_byte_count);
 
     mux->partition.type = MXF_PARTITION_PACK_FOOTER;
     mux->partition.closed = TRUE;
@@ -1297,12 +1412,31 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
     mux->partition.prev_partition = body_partition;
     mux->partition.footer_partition = mux->offset;
     mux->partition.header_byte_count = 0;
-    mux->partition.index_byte_count = 0;
-    mux->partition.index_sid = 0;
+    mux->partition.index_byte_count = index_byte_count;
+    mux->partition.index_sid = index ? GST_MXF_MUX_INDEX_SID : 0;
     mux->partition.body_offset = 0;
     mux->partition.body_sid = 0;
 
-    gst_mxf_mux_write_header_metadata (mux);
+    ret = gst_mxf_mux_write_header_metadata (mux);
+    if (ret != GST_FLOW_OK) {
+      GST_ERROR_OBJECT (mux, "Writing footer partition failed");
+      g_list_foreach (index, (GFunc) gst_mini_object_unref, NULL);
+      g_list_free (index);
+      return ret;
+    }
+
+    /* The index table segments follow the header metadata */
+    for (l = index; l; l = l->next) {
+      packet = l->data;
+      l->data = NULL;
+      if ((ret = gst_mxf_mux_push (mux, packet)) != GST_FLOW_OK) {
+        GST_ERROR_OBJECT (mux, "Failed pushing index table segment");
+        g_list_foreach (l->next, (GFunc) gst_mini_object_unref, NULL);
+        g_list_free (index);
+        return ret;
+      }
+    }
+    g_list_free (index);
 
     rip = g_array_sized_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry), 3);
     entry.offset = 0;
@@ -1316,10 +1450,11 @@ gst_mxf_mux_handle_eos (GstMXFMux * mux)
     g_array_append_val (rip, entry);
 
     packet = mxf_random_index_pack_to_buffer (rip);
+    g_array_free (rip, TRUE);
     if ((ret = gst_mxf_mux_push (mux, packet)) != GST_FLOW_OK) {
       GST_ERROR_OBJECT (mux, "Failed pushing random index pack");
+      return ret;
     }
-    g_array_free (rip, TRUE);
 
     /* Rewrite header partition with updated values */
     if (gst_pad_push_event (mux->srcpad,
@@ -1455,7 +1590,9 @@ gst_mxf_mux_collected (GstCollectPads2 * pads, gpointer user_data)
   } else if (eos) {
     GST_DEBUG_OBJECT (mux, "Handling EOS");
 
-    gst_mxf_mux_handle_eos (mux);
+    ret = gst_mxf_mux_handle_eos (mux);
+    if (ret != GST_FLOW_OK)
+      goto error;
     gst_pad_push_event (mux->srcpad, gst_event_new_eos ());
     mux->state = GST_MXF_MUX_STATE_EOS;
     return GST_FLOW_UNEXPECTED;
@@ -92,6 +92,11 @@ typedef struct _GstMXFMux {
   guint64 last_gc_position;
   GstClockTime last_gc_timestamp;
 
+  /* offset of the essence in the body partition, and an index entry
+   * for each content package written to it */
+  guint64 essence_offset;
+  GArray *index_entries;
+
   gchar *application;
 } GstMXFMux;
 
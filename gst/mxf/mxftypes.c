@@ -157,6 +157,75 @@ mxf_is_avid_essence_container_essence_element (const MXFUL * ul)
           ul));
 }
 
+/* Classifies a KLV key with a single switch on the first 4 bytes of the
+ * item designator instead of trying every mxf_is_*() predicate in turn.
+ * All the keys handled here have these bytes fixed, so only the predicates
+ * of the matching group have to be checked to confirm the key.
+ */
+MXFKLVPacketType
+mxf_klv_packet_type (const MXFUL * ul)
+{
+  g_return_val_if_fail (ul != NULL, MXF_KLV_PACKET_TYPE_UNKNOWN);
+
+  if (!mxf_is_mxf_packet (ul))
+    return MXF_KLV_PACKET_TYPE_NON_MXF;
+
+  switch (GST_READ_UINT32_BE (&ul->u[8])) {
+    case 0x0d010301:
+      /* Essence elements are by far the most common packets, check
+       * them first */
+      if (mxf_is_generic_container_essence_element (ul))
+        return MXF_KLV_PACKET_TYPE_ESSENCE_ELEMENT;
+      else if (mxf_is_generic_container_system_item (ul))
+        return MXF_KLV_PACKET_TYPE_GENERIC_CONTAINER_SYSTEM_ITEM;
+      break;
+    case 0x0e040301:
+      if (mxf_is_avid_essence_container_essence_element (ul))
+        return MXF_KLV_PACKET_TYPE_ESSENCE_ELEMENT;
+      break;
+    case 0x0d010101:
+      if (mxf_is_metadata (ul))
+        return MXF_KLV_PACKET_TYPE_METADATA;
+      break;
+    case 0x0d010401:
+      if (mxf_is_descriptive_metadata (ul))
+        return MXF_KLV_PACKET_TYPE_DESCRIPTIVE_METADATA;
+      break;
+    case 0x0d010201:
+      switch (ul->u[13]) {
+        case 0x02:
+        case 0x03:
+        case 0x04:
+          if (mxf_is_partition_pack (ul))
+            return MXF_KLV_PACKET_TYPE_PARTITION_PACK;
+          break;
+        case 0x05:
+          if (mxf_is_primer_pack (ul))
+            return MXF_KLV_PACKET_TYPE_PRIMER_PACK;
+          break;
+        case 0x10:
+          if (mxf_is_index_table_segment (ul))
+            return MXF_KLV_PACKET_TYPE_INDEX_TABLE_SEGMENT;
+          break;
+        case 0x11:
+          if (mxf_is_random_index_pack (ul))
+            return MXF_KLV_PACKET_TYPE_RANDOM_INDEX_PACK;
+          break;
+        default:
+          break;
+      }
+      break;
+    case 0x03010210:
+      if (mxf_is_fill (ul))
+        return MXF_KLV_PACKET_TYPE_FILL;
+      break;
+    default:
+      break;
+  }
+
+  return MXF_KLV_PACKET_TYPE_UNKNOWN;
+}
+
 guint
 mxf_ber_encode_size (guint size, guint8 ber[9])
 {
@@ -1292,6 +1361,128 @@ mxf_index_table_segment_reset (MXFIndexTableSegment * segment)
   memset (segment, 0, sizeof (MXFIndexTableSegment));
 }
 
+GstBuffer *
+mxf_index_table_segment_to_buffer (const MXFIndexTableSegment * segment)
+{
+  guint entry_size =
+      11 + 4 * segment->slice_count + 8 * segment->pos_table_count;
+  guint size, slen, i, j;
+  guint8 ber[9];
+  GstBuffer *ret;
+  guint8 *data;
+
+  /* Array lengths have to fit into the 16 bit local tag length */
+  g_return_val_if_fail (8 + 6 * segment->n_delta_entries <= G_MAXUINT16, NULL);
+  g_return_val_if_fail (8 + entry_size * segment->n_index_entries <=
+      G_MAXUINT16, NULL);
+
+  size = 20 + 12 + 12 + 12 + 8 + 8 + 8 + 5 + 5;
+  if (segment->n_delta_entries > 0)
+    size += 4 + 8 + 6 * segment->n_delta_entries;
+  if (segment->n_index_entries > 0)
+    size += 4 + 8 + entry_size * segment->n_index_entries;
+
+  slen = mxf_ber_encode_size (size, ber);
+
+  ret = gst_buffer_new_and_alloc (16 + slen + size);
+  memcpy (GST_BUFFER_DATA (ret), MXF_UL (INDEX_TABLE_SEGMENT), 16);
+  memcpy (GST_BUFFER_DATA (ret) + 16, ber, slen);
+
+  data = GST_BUFFER_DATA (ret) + 16 + slen;
+
+  GST_WRITE_UINT16_BE (data, 0x3c0a);
+  GST_WRITE_UINT16_BE (data + 2, 16);
+  memcpy (data + 4, &segment->instance_id, 16);
+  data += 20;
+
+  GST_WRITE_UINT16_BE (data, 0x3f0b);
+  GST_WRITE_UINT16_BE (data + 2, 8);
+  GST_WRITE_UINT32_BE (data + 4, segment->index_edit_rate.n);
+  GST_WRITE_UINT32_BE (data + 8, segment->index_edit_rate.d);
+  data += 12;
+
+  GST_WRITE_UINT16_BE (data, 0x3f0c);
+  GST_WRITE_UINT16_BE (data + 2, 8);
+  GST_WRITE_UINT64_BE (data + 4, segment->index_start_position);
+  data += 12;
+
+  GST_WRITE_UINT16_BE (data, 0x3f0d);
+  GST_WRITE_UINT16_BE (data + 2, 8);
+  GST_WRITE_UINT64_BE (data + 4, segment->index_duration);
+  data += 12;
+
+  GST_WRITE_UINT16_BE (data, 0x3f05);
+  GST_WRITE_UINT16_BE (data + 2, 4);
+  GST_WRITE_UINT32_BE (data + 4, segment->edit_unit_byte_count);
+  data += 8;
+
+  GST_WRITE_UINT16_BE (data, 0x3f06);
+  GST_WRITE_UINT16_BE (data + 2, 4);
+  GST_WRITE_UINT32_BE (data + 4, segment->index_sid);
+  data += 8;
+
+  GST_WRITE_UINT16_BE (data, 0x3f07);
+  GST_WRITE_UINT16_BE (data + 2, 4);
+  GST_WRITE_UINT32_BE (data + 4, segment->body_sid);
+  data += 8;
+
+  GST_WRITE_UINT16_BE (data, 0x3f08);
+  GST_WRITE_UINT16_BE (data + 2, 1);
+  GST_WRITE_UINT8 (data + 4, segment->slice_count);
+  data += 5;
+
+  GST_WRITE_UINT16_BE (data, 0x3f0e);
+  GST_WRITE_UINT16_BE (data + 2, 1);
+  GST_WRITE_UINT8 (data + 4, segment->pos_table_count);
+  data += 5;
+
+  if (segment->n_delta_entries > 0) {
+    GST_WRITE_UINT16_BE (data, 0x3f09);
+    GST_WRITE_UINT16_BE (data + 2, 8 + 6 * segment->n_delta_entries);
+    GST_WRITE_UINT32_BE (data + 4, segment->n_delta_entries);
+    GST_WRITE_UINT32_BE (data + 8, 6);
+    data += 12;
+
+    for (i = 0; i < segment->n_delta_entries; i++) {
+      GST_WRITE_UINT8 (data, segment->delta_entries[i].pos_table_index);
+      GST_WRITE_UINT8 (data + 1, segment->delta_entries[i].slice);
+      GST_WRITE_UINT32_BE (data + 2, segment->delta_entries[i].element_delta);
+      data += 6;
+    }
+  }
+
+  if (segment->n_index_entries > 0) {
+    GST_WRITE_UINT16_BE (data, 0x3f0a);
+    GST_WRITE_UINT16_BE (data + 2, 8 + entry_size * segment->n_index_entries);
+    GST_WRITE_UINT32_BE (data + 4, segment->n_index_entries);
+    GST_WRITE_UINT32_BE (data + 8, entry_size);
+    data += 12;
+
+    for (i = 0; i < segment->n_index_entries; i++) {
+      const MXFIndexEntry *entry = &segment->index_entries[i];
+
+      GST_WRITE_UINT8 (data, entry->temporal_offset);
+      GST_WRITE_UINT8 (data + 1, entry->key_frame_offset);
+      GST_WRITE_UINT8 (data + 2, entry->flags);
+      GST_WRITE_UINT64_BE (data + 3, entry->stream_offset);
+      data += 11;
+
+      for (j = 0; j < segment->slice_count; j++) {
+        GST_WRITE_UINT32_BE (data, entry->slice_offset[j]);
+        data += 4;
+      }
+
+      for (j = 0; j < segment->pos_table_count; j++) {
+        GST_WRITE_UINT32_BE (data, entry->pos_table[j].n);
+        GST_WRITE_UINT32_BE (data + 4, entry->pos_table[j].d);
+        data += 8;
+      }
+    }
+  }
+
+  return ret;
+}
+
 /* SMPTE 377M 8.2 Table 1 and 2 */
 
 static void
@@ -215,6 +215,22 @@ gboolean mxf_is_avid_essence_container_label (const MXFUL *ul);
 
 gboolean mxf_is_fill (const MXFUL *ul);
 
+typedef enum {
+  MXF_KLV_PACKET_TYPE_UNKNOWN = 0,
+  MXF_KLV_PACKET_TYPE_NON_MXF,
+  MXF_KLV_PACKET_TYPE_FILL,
+  MXF_KLV_PACKET_TYPE_PARTITION_PACK,
+  MXF_KLV_PACKET_TYPE_PRIMER_PACK,
+  MXF_KLV_PACKET_TYPE_METADATA,
+  MXF_KLV_PACKET_TYPE_DESCRIPTIVE_METADATA,
+  MXF_KLV_PACKET_TYPE_RANDOM_INDEX_PACK,
+  MXF_KLV_PACKET_TYPE_INDEX_TABLE_SEGMENT,
+  MXF_KLV_PACKET_TYPE_GENERIC_CONTAINER_SYSTEM_ITEM,
+  MXF_KLV_PACKET_TYPE_ESSENCE_ELEMENT
+} MXFKLVPacketType;
+
+MXFKLVPacketType mxf_klv_packet_type (const MXFUL *ul);
+
 guint mxf_ber_encode_size (guint size, guint8 ber[9]);
 
 gchar * mxf_utf16_to_utf8 (const guint8 * data, guint size);
@@ -255,6 +271,7 @@ GstBuffer * mxf_random_index_pack_to_buffer (const GArray *array);
 
 gboolean mxf_index_table_segment_parse (const MXFUL *ul, MXFIndexTableSegment *segment, const MXFPrimerPack *primer, const guint8 *data, guint size);
 void mxf_index_table_segment_reset (MXFIndexTableSegment *segment);
+GstBuffer * mxf_index_table_segment_to_buffer (const MXFIndexTableSegment *segment);
 
 gboolean mxf_local_tag_parse (const guint8 * data, guint size, guint16 * tag,
     guint16 * tag_size, const guint8 ** tag_data);
@@ -163,8 +163,9 @@ mxf_up_handle_essence_element (const MXFUL * key, GstBuffer * buffer,
     return GST_FLOW_ERROR;
   }
 
-  if (data->bpp != 4
-      || GST_ROUND_UP_4 (data->width * data->bpp) != data->width * data->bpp) {
+  /* Only copy if the lines have to be padded to the 4 byte aligned row
+   * stride of GStreamer raw video, otherwise pass the buffer through */
+  if (GST_ROUND_UP_4 (data->width * data->bpp) != data->width * data->bpp) {
     guint y;
     GstBuffer *ret;
     guint8 *indata, *outdata;
@@ -398,8 +399,8 @@ mxf_up_write_func (GstBuffer * buffer, GstCaps * caps, gpointer mapping_data,
     return GST_FLOW_ERROR;
   }
 
-  if (data->bpp != 4
-      || GST_ROUND_UP_4 (data->width * data->bpp) != data->width * data->bpp) {
+  /* Only copy if the row stride padding has to be removed */
+  if (GST_ROUND_UP_4 (data->width * data->bpp) != data->width * data->bpp) {
     guint y;
     GstBuffer *ret;
     guint8 *indata, *outdata;
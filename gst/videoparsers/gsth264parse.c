@@ -28,7 +28,6 @@
 
 #include <gst/base/gstbytereader.h>
 #include <gst/base/gstbytewriter.h>
-#include <gst/base/gstadapter.h>
 #include <gst/video/video.h>
 #include "gsth264parse.h"
 
@@ -43,6 +42,7 @@ enum
 {
   PROP_0,
   PROP_CONFIG_INTERVAL,
+  PROP_REORDER_DEPTH,
   PROP_LAST
 };
 
@@ -60,6 +60,14 @@ enum
   GST_H264_PARSE_ALIGN_AU
 };
 
+/* position of a NAL unit in the frame */
+typedef struct
+{
+  guint sc_offset;
+  guint offset;
+  guint size;
+} GstH264ParseNal;
+
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -132,6 +140,13 @@ gst_h264_parse_class_init (GstH264ParseClass * klass)
           0, 3600, DEFAULT_CONFIG_INTERVAL,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  g_object_class_install_property (gobject_class, PROP_REORDER_DEPTH,
+      g_param_spec_uint ("reorder-depth", "Reorder depth",
+          "Number of frames a decoder has to hold to output them in display "
+          "order, as signalled by the stream or detected while parsing",
+          0, GST_H264_MAX_DPB_FRAMES, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   /* Override BaseParse vfuncs */
   parse_class->start = GST_DEBUG_FUNCPTR (gst_h264_parse_start);
   parse_class->stop = GST_DEBUG_FUNCPTR (gst_h264_parse_stop);
@@ -149,7 +164,7 @@ gst_h264_parse_class_init (GstH264ParseClass * klass)
 static void
 gst_h264_parse_init (GstH264Parse * h264parse, GstH264ParseClass * g_class)
 {
-  h264parse->frame_out = gst_adapter_new ();
+  h264parse->frame_nals = g_array_new (FALSE, FALSE, sizeof (GstH264ParseNal));
 
   /* retrieve and intercept baseparse.
    * Quite HACKish, but fairly OK since it is needed to perform avc packet
@@ -166,7 +181,7 @@ gst_h264_parse_finalize (GObject * object)
 {
   GstH264Parse *h264parse = GST_H264_PARSE (object);
 
-  g_object_unref (h264parse->frame_out);
+  g_array_free (h264parse->frame_nals, TRUE);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -186,7 +201,22 @@ gst_h264_parse_reset_frame (GstH264Parse * h264parse)
   h264parse->sei_pos = -1;
   h264parse->keyframe = FALSE;
   h264parse->frame_start = FALSE;
-  gst_adapter_clear (h264parse->frame_out);
+  h264parse->have_poc = FALSE;
+  g_array_set_size (h264parse->frame_nals, 0);
+  h264parse->frame_out_size = 0;
+}
+
+static void
+gst_h264_parse_reset_poc (GstH264Parse * h264parse)
+{
+  gst_h264_poc_state_init (&h264parse->poc_state);
+  h264parse->dpb_sps = NULL;
+  h264parse->poc_step = 2;
+  h264parse->first_field = FALSE;
+  h264parse->second_field = FALSE;
+  h264parse->prev_field = FALSE;
+  h264parse->have_cvs = FALSE;
+  h264parse->cvs_dts = GST_CLOCK_TIME_NONE;
 }
 
 static void
@@ -217,6 +247,7 @@ gst_h264_parse_reset (GstH264Parse * h264parse)
   h264parse->dts = GST_CLOCK_TIME_NONE;
   h264parse->ts_trn_nb = GST_CLOCK_TIME_NONE;
   h264parse->do_ts = TRUE;
+  gst_h264_parse_reset_poc (h264parse);
 
   h264parse->pending_key_unit_ts = GST_CLOCK_TIME_NONE;
   h264parse->force_key_unit_event = NULL;
@@ -427,6 +458,12 @@ gst_h264_parser_store_nal (GstH264Parse * h264parse, guint id,
     return;
   }
 
+  /* parameter sets are usually repeated unchanged */
+  if (store[id] && GST_BUFFER_SIZE (store[id]) == size &&
+      memcmp (GST_BUFFER_DATA (store[id]), nalu->data + nalu->offset,
+          size) == 0)
+    return;
+
   buf = gst_buffer_new_and_alloc (size);
   memcpy (GST_BUFFER_DATA (buf), nalu->data + nalu->offset, size);
 
@@ -436,10 +473,139 @@ gst_h264_parser_store_nal (GstH264Parse * h264parse, guint id,
   store[id] = buf;
 }
 
+static inline void
+gst_h264_parse_write_nal_length (guint8 * data, guint nl, guint size)
+{
+  guint i;
+
+  for (i = 0; i < nl; i++)
+    data[i] = size >> (8 * (nl - 1 - i));
+}
+
+/* replaces the start codes of the frame by length prefixes; this is done in
+ * place when the nals follow each other with start codes as long as the
+ * prefixes, which is the usual case with 4 bytes prefixes */
+static void
+gst_h264_parse_convert_to_avc (GstH264Parse * h264parse,
+    GstBaseParseFrame * frame)
+{
+  GstH264ParseNal *nals = (GstH264ParseNal *) h264parse->frame_nals->data;
+  guint n_nals = h264parse->frame_nals->len;
+  guint nl = h264parse->nal_length_size;
+  guint i, pos = 0;
+  GstBuffer *buf;
+  guint8 *data;
+
+  for (i = 0; i < n_nals; i++) {
+    if (nals[i].sc_offset != pos || nals[i].offset - pos != nl)
+      break;
+    pos = nals[i].offset + nals[i].size;
+  }
+
+  if (i == n_nals && pos == GST_BUFFER_SIZE (frame->buffer)) {
+    GST_LOG_OBJECT (h264parse, "converting %u NALs in place", n_nals);
+    frame->buffer = gst_buffer_make_writable (frame->buffer);
+    data = GST_BUFFER_DATA (frame->buffer);
+    for (i = 0; i < n_nals; i++)
+      gst_h264_parse_write_nal_length (data + nals[i].sc_offset, nl,
+          nals[i].size);
+    return;
+  }
+
+  GST_LOG_OBJECT (h264parse, "converting %u NALs to a new buffer", n_nals);
+  buf = gst_buffer_new_and_alloc (h264parse->frame_out_size);
+  data = GST_BUFFER_DATA (buf);
+  for (i = 0; i < n_nals; i++) {
+    gst_h264_parse_write_nal_length (data, nl, nals[i].size);
+    memcpy (data + nl, GST_BUFFER_DATA (frame->buffer) + nals[i].offset,
+        nals[i].size);
+    data += nl + nals[i].size;
+  }
+  gst_buffer_copy_metadata (buf, frame->buffer, GST_BUFFER_COPY_ALL);
+  gst_buffer_replace (&frame->buffer, buf);
+  gst_buffer_unref (buf);
+}
+
 /* SPS/PPS/IDR considered key, all others DELTA;
  * so downstream waiting for keyframe can pick up at SPS/PPS/IDR */
 #define NAL_TYPE_IS_KEY(nt) (((nt) == 5) || ((nt) == 7) || ((nt) == 8))
 
+/* computes the picture order count of the picture starting with @slice */
+static void
+gst_h264_parse_update_poc (GstH264Parse * h264parse, GstH264NalUnit * nalu,
+    GstH264SliceHdr * slice)
+{
+  GstH264ParserResult pres;
+
+  h264parse->field_pic_flag = slice->field_pic_flag;
+
+  h264parse->second_field = slice->field_pic_flag && h264parse->first_field &&
+      slice->frame_num == h264parse->first_field_frame_num &&
+      slice->bottom_field_flag != h264parse->first_field_bottom;
+  h264parse->first_field = slice->field_pic_flag && !h264parse->second_field;
+  h264parse->first_field_frame_num = slice->frame_num;
+  h264parse->first_field_bottom = slice->bottom_field_flag;
+
+  pres = gst_h264_poc_state_compute (&h264parse->poc_state, nalu, slice,
+      &h264parse->poc);
+  if (pres != GST_H264_PARSER_OK) {
+    GST_DEBUG_OBJECT (h264parse, "failed to compute picture order count");
+    return;
+  }
+
+  h264parse->have_poc = TRUE;
+  h264parse->new_seq = nalu->idr_pic_flag || h264parse->poc_state.mmco5;
+  h264parse->poc_sps = slice->pps->sequence;
+  GST_LOG_OBJECT (h264parse, "picture order count %d, new sequence %d",
+      h264parse->poc, h264parse->new_seq);
+}
+
+/* runs the current picture, decoded at @dts, through the reordering model.
+ * A field pair counts as one picture, with the order count of its first
+ * field */
+static void
+gst_h264_parse_update_dpb (GstH264Parse * h264parse, GstClockTime dts)
+{
+  gint32 poc;
+
+  if (h264parse->second_field) {
+    GST_LOG_OBJECT (h264parse, "second field of picture %d",
+        h264parse->prev_poc);
+    return;
+  }
+
+  if (h264parse->new_seq || !h264parse->have_cvs) {
+    /* output the pictures of the previous coded video sequence */
+    while (gst_h264_dpb_model_bump (&h264parse->dpb, TRUE, NULL));
+
+    /* the active SPS can only change here */
+    if (h264parse->poc_sps != h264parse->dpb_sps) {
+      gst_h264_dpb_model_init (&h264parse->dpb, h264parse->poc_sps);
+      h264parse->dpb_sps = h264parse->poc_sps;
+      GST_DEBUG_OBJECT (h264parse, "reorder depth %u",
+          gst_h264_dpb_model_get_max_num_reorder_frames (&h264parse->dpb));
+    }
+
+    h264parse->have_cvs = TRUE;
+    h264parse->cvs_poc = h264parse->poc;
+    h264parse->cvs_dts = dts;
+  } else if (!h264parse->field_pic_flag && !h264parse->prev_field &&
+      ABS (h264parse->poc - h264parse->prev_poc) == 1) {
+    /* the poc of a frame usually counts its 2 fields */
+    h264parse->poc_step = 1;
+  }
+  h264parse->prev_poc = h264parse->poc;
+  h264parse->prev_field = h264parse->field_pic_flag;
+
+  if (!gst_h264_dpb_model_add (&h264parse->dpb, h264parse->poc,
+          h264parse->new_seq)) {
+    GST_DEBUG_OBJECT (h264parse, "late picture, reorder depth now %u",
+        gst_h264_dpb_model_get_max_num_reorder_frames (&h264parse->dpb));
+  }
+  while (gst_h264_dpb_model_bump (&h264parse->dpb, FALSE, &poc))
+    GST_LOG_OBJECT (h264parse, "picture %d output", poc);
+}
+
 /* caller guarantees 2 bytes of nal payload */
 static void
 gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
@@ -531,7 +697,7 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       /* mark SEI pos */
       if (h264parse->sei_pos == -1) {
         if (h264parse->format == GST_H264_PARSE_FORMAT_AVC)
-          h264parse->sei_pos = gst_adapter_available (h264parse->frame_out);
+          h264parse->sei_pos = h264parse->frame_out_size;
         else
           h264parse->sei_pos = nalu->sc_offset;
         GST_DEBUG_OBJECT (h264parse, "marking SEI in frame at offset %d",
@@ -544,18 +710,27 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
     case GST_H264_NAL_SLICE_DPB:
     case GST_H264_NAL_SLICE_DPC:
     case GST_H264_NAL_SLICE_IDR:
-      /* don't need to parse the whole slice (header) here */
+      /* only the first slice header of a picture is needed */
       if (*(nalu->data + nalu->offset + 1) & 0x80) {
+        GstH264SliceHdr slice;
+
         /* means first_mb_in_slice == 0 */
         /* real frame data */
         GST_DEBUG_OBJECT (h264parse, "first_mb_in_slice = 0");
         h264parse->frame_start = TRUE;
+
+        /* the first slice header gives the picture order count */
+        pres = gst_h264_parser_parse_slice_hdr (nalparser, nalu, &slice,
+            FALSE, TRUE);
+        GST_DEBUG_OBJECT (h264parse,
+            "parse result %d, first MB: %u, slice type: %u",
+            pres, slice.first_mb_in_slice, slice.type);
+        if (pres == GST_H264_PARSER_OK)
+          gst_h264_parse_update_poc (h264parse, nalu, &slice);
       }
-      GST_DEBUG_OBJECT (h264parse, "frame start: %i", h264parse->frame_start);
 #ifndef GST_DISABLE_GST_DEBUG
-      {
+      else {
         GstH264SliceHdr slice;
-        GstH264ParserResult pres;
 
         pres = gst_h264_parser_parse_slice_hdr (nalparser, nalu, &slice,
             FALSE, FALSE);
@@ -564,6 +739,7 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
             pres, slice.first_mb_in_slice, slice.type);
       }
 #endif
+      GST_DEBUG_OBJECT (h264parse, "frame start: %i", h264parse->frame_start);
       if (G_LIKELY (nal_type != GST_H264_NAL_SLICE_IDR &&
               !h264parse->push_codec))
         break;
@@ -574,7 +750,7 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       /* mind replacement buffer if applicable */
       if (h264parse->idr_pos == -1) {
         if (h264parse->format == GST_H264_PARSE_FORMAT_AVC)
-          h264parse->idr_pos = gst_adapter_available (h264parse->frame_out);
+          h264parse->idr_pos = h264parse->frame_out_size;
         else
           h264parse->idr_pos = nalu->sc_offset;
         GST_DEBUG_OBJECT (h264parse, "marking IDR in frame at offset %d",
@@ -591,15 +767,17 @@ gst_h264_parse_process_nal (GstH264Parse * h264parse, GstH264NalUnit * nalu)
       gst_h264_parser_parse_nal (nalparser, nalu);
   }
 
-  /* if AVC output needed, collect properly prefixed nal in adapter,
-   * and use that to replace outgoing buffer data later on */
+  /* if AVC output needed, collect the position of the nal,
+   * and use that to convert outgoing buffer data later on */
   if (h264parse->format == GST_H264_PARSE_FORMAT_AVC) {
-    GstBuffer *buf;
+    GstH264ParseNal nal;
 
     GST_LOG_OBJECT (h264parse, "collecting NAL in AVC frame");
-    buf = gst_h264_parse_wrap_nal (h264parse, h264parse->format,
-        nalu->data + nalu->offset, nalu->size);
-    gst_adapter_push (h264parse->frame_out, buf);
+    nal.sc_offset = nalu->sc_offset;
+    nal.offset = nalu->offset;
+    nal.size = nalu->size;
+    g_array_append_val (h264parse->frame_nals, nal);
+    h264parse->frame_out_size += h264parse->nal_length_size + nalu->size;
   }
 }
 
@@ -1197,7 +1375,7 @@ gst_h264_parse_get_timestamp (GstH264Parse * h264parse,
     GstClockTime * out_ts, GstClockTime * out_dur, gboolean frame)
 {
   GstH264SPS *sps = h264parse->nalparser->last_sps;
-  GstClockTime upstream;
+  GstClockTime upstream, pts = GST_CLOCK_TIME_NONE;
   gint duration = 1;
 
   g_return_if_fail (out_dur != NULL);
@@ -1311,9 +1489,47 @@ gst_h264_parse_get_timestamp (GstH264Parse * h264parse,
     }
   }
 
+  /* the timestamps interpolated so far follow the decoding order; without
+   * upstream timestamp, derive the presentation one from the picture order
+   * count, delayed by the pictures a decoder holds for reordering */
+  if (!GST_CLOCK_TIME_IS_VALID (*out_ts) && h264parse->have_poc &&
+      !h264parse->field_pic_flag) {
+    GstClockTime frame_dur;
+    gint64 delay;
+
+    frame_dur = gst_util_uint64_scale_int (2 * GST_SECOND,
+        sps->vui_parameters.num_units_in_tick, sps->vui_parameters.time_scale);
+    /* same sanity check as above */
+    if (frame_dur < GST_MSECOND)
+      goto exit;
+
+    if (!GST_CLOCK_TIME_IS_VALID (upstream)) {
+      if (!GST_CLOCK_TIME_IS_VALID (h264parse->dts))
+        h264parse->dts = 0;
+      upstream = h264parse->dts;
+    }
+    if (!GST_CLOCK_TIME_IS_VALID (h264parse->cvs_dts))
+      goto exit;
+
+    delay = gst_h264_dpb_model_get_max_num_reorder_frames (&h264parse->dpb) +
+        (h264parse->poc - h264parse->cvs_poc) / h264parse->poc_step;
+
+    if (delay > 0)
+      pts = h264parse->cvs_dts + delay * frame_dur;
+    /* a picture can not be presented before it is decoded */
+    if (!GST_CLOCK_TIME_IS_VALID (pts) || pts < upstream)
+      pts = upstream;
+
+    GST_LOG_OBJECT (h264parse, "poc %d, dts %" GST_TIME_FORMAT ", pts %"
+        GST_TIME_FORMAT, h264parse->poc, GST_TIME_ARGS (upstream),
+        GST_TIME_ARGS (pts));
+  }
+
 exit:
   if (GST_CLOCK_TIME_IS_VALID (upstream))
     *out_ts = h264parse->dts = upstream;
+  if (GST_CLOCK_TIME_IS_VALID (pts))
+    *out_ts = pts;
 
   if (GST_CLOCK_TIME_IS_VALID (*out_dur) &&
       GST_CLOCK_TIME_IS_VALID (h264parse->dts))
@@ -1325,7 +1541,6 @@ gst_h264_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
 {
   GstH264Parse *h264parse;
   GstBuffer *buffer;
-  guint av;
 
   h264parse = GST_H264_PARSE (parse);
   buffer = frame->buffer;
@@ -1335,6 +1550,15 @@ gst_h264_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
 
   gst_h264_parse_update_src_caps (h264parse, NULL);
 
+  if (h264parse->have_poc) {
+    GstClockTime dts = GST_BUFFER_TIMESTAMP (buffer);
+
+    /* decoding time of the picture, as get_timestamp() tracks it */
+    if (!GST_CLOCK_TIME_IS_VALID (dts))
+      dts = GST_CLOCK_TIME_IS_VALID (h264parse->dts) ? h264parse->dts : 0;
+    gst_h264_parse_update_dpb (h264parse, dts);
+  }
+
   /* don't mess with timestamps if provided by upstream,
    * particularly since our ts not that good they handle seeking etc */
   if (h264parse->do_ts)
@@ -1348,15 +1572,8 @@ gst_h264_parse_parse_frame (GstBaseParse * parse, GstBaseParseFrame * frame)
     GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
 
   /* replace with transformed AVC output if applicable */
-  av = gst_adapter_available (h264parse->frame_out);
-  if (av) {
-    GstBuffer *buf;
-
-    buf = gst_adapter_take_buffer (h264parse->frame_out, av);
-    gst_buffer_copy_metadata (buf, buffer, GST_BUFFER_COPY_ALL);
-    gst_buffer_replace (&frame->buffer, buf);
-    gst_buffer_unref (buf);
-  }
+  if (h264parse->frame_nals->len)
+    gst_h264_parse_convert_to_avc (h264parse, frame);
 
   return GST_FLOW_OK;
 }
@@ -1849,6 +2066,7 @@ gst_h264_parse_event (GstBaseParse * parse, GstEvent * event)
     case GST_EVENT_FLUSH_STOP:
       h264parse->dts = GST_CLOCK_TIME_NONE;
       h264parse->ts_trn_nb = GST_CLOCK_TIME_NONE;
+      gst_h264_parse_reset_poc (h264parse);
       h264parse->have_error = FALSE;
       break;
     case GST_EVENT_NEWSEGMENT:
@@ -1933,6 +2151,10 @@ gst_h264_parse_chain (GstPad * pad, GstBuffer * buffer)
     GST_LOG_OBJECT (h264parse, "processing packet buffer of size %d",
         GST_BUFFER_SIZE (buffer));
 
+    /* 4 bytes length prefixes are replaced by start codes in place */
+    if (h264parse->split_packetized && nl == 4)
+      buffer = gst_buffer_make_writable (buffer);
+
     parse_res = gst_h264_parser_identify_nalu_avc (h264parse->nalparser,
         GST_BUFFER_DATA (buffer), 0, GST_BUFFER_SIZE (buffer), nl, &nalu);
 
@@ -1942,8 +2164,14 @@ gst_h264_parse_chain (GstPad * pad, GstBuffer * buffer)
 
       if (h264parse->split_packetized) {
         /* convert to NAL aligned byte stream input */
-        sub = gst_h264_parse_wrap_nal (h264parse, GST_H264_PARSE_FORMAT_BYTE,
-            nalu.data + nalu.offset, nalu.size);
+        if (nl == 4) {
+          GST_WRITE_UINT32_BE (GST_BUFFER_DATA (buffer) + nalu.sc_offset, 1);
+          sub = gst_buffer_create_sub (buffer, nalu.sc_offset, nalu.size + nl);
+          gst_buffer_set_caps (sub, NULL);
+        } else {
+          sub = gst_h264_parse_wrap_nal (h264parse, GST_H264_PARSE_FORMAT_BYTE,
+              nalu.data + nalu.offset, nalu.size);
+        }
         /* at least this should make sense */
         GST_BUFFER_TIMESTAMP (sub) = GST_BUFFER_TIMESTAMP (buffer);
         /* transfer flags (e.g. DISCONT) for first fragment */
@@ -1979,7 +2207,8 @@ gst_h264_parse_chain (GstPad * pad, GstBuffer * buffer)
     } else {
       /* nal processing in pass-through might have collected stuff;
        * ensure nothing happens with this later on */
-      gst_adapter_clear (h264parse->frame_out);
+      g_array_set_size (h264parse->frame_nals, 0);
+      h264parse->frame_out_size = 0;
     }
 
     if (parse_res == GST_H264_PARSER_NO_NAL_END ||
@@ -2031,6 +2260,10 @@ gst_h264_parse_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_CONFIG_INTERVAL:
       g_value_set_uint (value, parse->interval);
       break;
+    case PROP_REORDER_DEPTH:
+      g_value_set_uint (value,
+          gst_h264_dpb_model_get_max_num_reorder_frames (&parse->dpb));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -99,12 +99,37 @@ struct _GstH264Parse
   GstClockTime ts_trn_nb;
   gboolean do_ts;
 
+  /* picture order count and reordering of the pictures, used to
+   * timestamp pictures when upstream does not */
+  GstH264POCState poc_state;
+  GstH264DpbModel dpb;
+  GstH264SPS *dpb_sps;
+  /* current picture */
+  gboolean have_poc;
+  gboolean new_seq;
+  GstH264SPS *poc_sps;
+  gint32 poc;
+  /* field pairing: the second field of a pair is not a picture of its own */
+  gboolean second_field;
+  gboolean first_field;
+  guint16 first_field_frame_num;
+  guint8 first_field_bottom;
+  /* poc increment between frames, and start of the coded video sequence */
+  gint32 prev_poc;
+  gboolean prev_field;
+  gint32 poc_step;
+  gboolean have_cvs;
+  gint32 cvs_poc;
+  GstClockTime cvs_dts;
+
   /* frame parsing */
   /*guint last_nal_pos;*/
   /*guint next_sc_pos;*/
   gint idr_pos, sei_pos;
   gboolean update_caps;
-  GstAdapter *frame_out;
+  /* NAL units of the frame, and the size of the frame once converted */
+  GArray *frame_nals;
+  guint frame_out_size;
   gboolean keyframe;
   gboolean frame_start;
   /* AU state */
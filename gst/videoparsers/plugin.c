@@ -24,6 +24,7 @@
 
 #include "gsth263parse.h"
 #include "gsth264parse.h"
+#include "gsth265parse.h"
 #include "gstdiracparse.h"
 #include "gstmpegvideoparse.h"
 #include "gstmpeg4videoparse.h"
@@ -37,6 +38,8 @@ plugin_init (GstPlugin * plugin)
       GST_RANK_PRIMARY + 1, GST_TYPE_H263_PARSE);
   ret |= gst_element_register (plugin, "h264parse",
       GST_RANK_PRIMARY + 1, GST_TYPE_H264_PARSE);
+  ret |= gst_element_register (plugin, "h265parse",
+      GST_RANK_PRIMARY + 1, GST_TYPE_H265_PARSE);
   ret |= gst_element_register (plugin, "diracparse",
       GST_RANK_NONE, GST_TYPE_DIRAC_PARSE);
   ret |= gst_element_register (plugin, "mpegvideoparse",
@@ -43,6 +43,13 @@ GstStaticPadTemplate sinktemplate_avc_au = GST_STATIC_PAD_TEMPLATE ("sink",
         ", stream-format = (string) avc, alignment = (string) au")
     );
 
+GstStaticPadTemplate sinktemplate_bs_au = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SINK_CAPS_TMPL
+        ", stream-format = (string) byte-stream, alignment = (string) au")
+    );
+
 GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
     GST_PAD_ALWAYS,
@@ -85,6 +92,42 @@ static guint8 garbage_frame[] = {
   0x00, 0x00, 0x00, 0x01, 0x05
 };
 
+/* 32x32 at 25 fps (num_units_in_tick 1, time_scale 50), with
+ * pic_order_cnt_type 0 and num_reorder_frames 1 */
+static guint8 h264_sps_timing[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x4d, 0x40, 0x1e,
+  0xf6, 0x4b, 0x42, 0x00, 0x00, 0x03, 0x00, 0x02,
+  0x00, 0x00, 0x03, 0x00, 0x65, 0x1e, 0x11, 0x08,
+  0xa7
+};
+
+/* and its PPS */
+static guint8 h264_pps_timing[] = {
+  0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x3c, 0x80
+};
+
+/* slices of an I P B B group of pictures, with picture order counts
+ * 0 6 2 4 */
+static guint8 h264_slice_i[] = {
+  0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x0a,
+  0xab, 0xcd, 0x5a, 0x80
+};
+
+static guint8 h264_slice_p[] = {
+  0x00, 0x00, 0x00, 0x01, 0x41, 0x9a, 0x2c, 0x2a,
+  0xaf, 0x35, 0x6a
+};
+
+static guint8 h264_slice_b1[] = {
+  0x00, 0x00, 0x00, 0x01, 0x01, 0x9e, 0x45, 0x15,
+  0x57, 0x9a, 0xb5
+};
+
+static guint8 h264_slice_b2[] = {
+  0x00, 0x00, 0x00, 0x01, 0x01, 0x9e, 0x49, 0x15,
+  0x57, 0x9a, 0xb5
+};
+
 /* context to tweak tests */
 static const gchar *ctx_suite;
 static gboolean ctx_codec_data;
@@ -306,6 +349,309 @@ GST_START_TEST (test_parse_packetized)
 
 GST_END_TEST;
 
+GST_START_TEST (test_parse_reorder_timestamps)
+{
+  static const struct
+  {
+    guint8 *data;
+    guint size;
+  } nals[] = {
+    {h264_sps_timing, sizeof (h264_sps_timing)},
+    {h264_pps_timing, sizeof (h264_pps_timing)},
+    {h264_slice_i, sizeof (h264_slice_i)},
+    {h264_slice_p, sizeof (h264_slice_p)},
+    {h264_slice_b1, sizeof (h264_slice_b1)},
+    {h264_slice_b2, sizeof (h264_slice_b2)}
+  };
+  /* presentation times of the pictures in decoding order, displayed one
+   * picture later than they would be without reordering */
+  static const GstClockTime pts[] = { 40, 160, 80, 120 };
+  GstElement *h264parse;
+  GstPad *mysrcpad, *mysinkpad;
+  GstBuffer *buffer;
+  GstCaps *caps;
+  guint8 *data;
+  guint i, size = 0, depth;
+  GList *l;
+
+  h264parse = gst_check_setup_element ("h264parse");
+  mysrcpad = gst_check_setup_src_pad (h264parse, &srctemplate, NULL);
+  mysinkpad = gst_check_setup_sink_pad (h264parse, &sinktemplate_bs_au, NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+  fail_unless (gst_element_set_state (h264parse,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  for (i = 0; i < G_N_ELEMENTS (nals); i++)
+    size += nals[i].size;
+  buffer = gst_buffer_new_and_alloc (size);
+  data = GST_BUFFER_DATA (buffer);
+  for (i = 0; i < G_N_ELEMENTS (nals); i++) {
+    memcpy (data, nals[i].data, nals[i].size);
+    data += nals[i].size;
+  }
+  caps = gst_caps_from_string (SRC_CAPS_TMPL
+      ", stream-format = (string) byte-stream");
+  gst_buffer_set_caps (buffer, caps);
+  gst_caps_unref (caps);
+
+  /* no timestamp at all */
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  fail_unless_equals_int (g_list_length (buffers), G_N_ELEMENTS (pts));
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    buffer = GST_BUFFER (l->data);
+    GST_DEBUG ("picture %u: %" GST_TIME_FORMAT, i,
+        GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buffer)));
+    fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buffer),
+        pts[i] * GST_MSECOND);
+    fail_unless_equals_uint64 (GST_BUFFER_DURATION (buffer),
+        40 * GST_MSECOND);
+  }
+
+  g_object_get (h264parse, "reorder-depth", &depth, NULL);
+  fail_unless_equals_int (depth, 1);
+
+  gst_check_drop_buffers ();
+  gst_element_set_state (h264parse, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (h264parse);
+  gst_check_teardown_sink_pad (h264parse);
+  gst_check_teardown_element (h264parse);
+}
+
+GST_END_TEST;
+
+/* NALs of the conversion tests, as byte-stream with 4 bytes start codes */
+static const struct
+{
+  const guint8 *data;
+  guint size;
+} conv_nals[] = {
+  {h264_sps, sizeof (h264_sps)},
+  {h264_pps, sizeof (h264_pps)},
+  {h264_idrframe, sizeof (h264_idrframe)}
+};
+
+/* Joins @n_nals NALs from @first in conv_nals, prefixed by @prefix bytes
+ * long start codes, or lengths if @avc */
+static GstBuffer *
+join_nals (guint first, guint n_nals, guint prefix, gboolean avc)
+{
+  GstBuffer *buffer;
+  guint8 *data;
+  guint i, j, size = 0;
+
+  for (i = first; i < first + n_nals; i++)
+    size += prefix + conv_nals[i].size - 4;
+
+  buffer = gst_buffer_new_and_alloc (size);
+  data = GST_BUFFER_DATA (buffer);
+  for (i = first; i < first + n_nals; i++) {
+    guint nal_size = conv_nals[i].size - 4;
+
+    for (j = 0; j < prefix; j++) {
+      if (avc)
+        data[j] = nal_size >> (8 * (prefix - 1 - j));
+      else
+        data[j] = j == prefix - 1 ? 0x01 : 0x00;
+    }
+    memcpy (data + prefix, conv_nals[i].data + 4, nal_size);
+    data += prefix + nal_size;
+  }
+
+  return buffer;
+}
+
+/* Pushes @inbuffer through h264parse and returns the data of all the output
+ * buffers joined together */
+static GstBuffer *
+convert_stream (GstStaticPadTemplate * sinktemplate, GstBuffer * inbuffer,
+    GstCaps ** outcaps)
+{
+  GstElement *h264parse;
+  GstPad *mysrcpad, *mysinkpad;
+  GstBuffer *outbuffer;
+  guint8 *data;
+  guint size = 0;
+  GList *l;
+
+  h264parse = gst_check_setup_element ("h264parse");
+  mysrcpad = gst_check_setup_src_pad (h264parse, &srctemplate, NULL);
+  mysinkpad = gst_check_setup_sink_pad (h264parse, sinktemplate, NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+  fail_unless (gst_element_set_state (h264parse,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, inbuffer), GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  for (l = buffers; l; l = l->next)
+    size += GST_BUFFER_SIZE (GST_BUFFER (l->data));
+  outbuffer = gst_buffer_new_and_alloc (size);
+  data = GST_BUFFER_DATA (outbuffer);
+  for (l = buffers; l; l = l->next) {
+    memcpy (data, GST_BUFFER_DATA (GST_BUFFER (l->data)),
+        GST_BUFFER_SIZE (GST_BUFFER (l->data)));
+    data += GST_BUFFER_SIZE (GST_BUFFER (l->data));
+  }
+  if (outcaps)
+    *outcaps = gst_pad_get_negotiated_caps (mysinkpad);
+
+  gst_check_drop_buffers ();
+  gst_element_set_state (h264parse, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (h264parse);
+  gst_check_teardown_sink_pad (h264parse);
+  gst_check_teardown_element (h264parse);
+
+  return outbuffer;
+}
+
+static void
+check_buffer_equal (GstBuffer * buffer, GstBuffer * expected)
+{
+  fail_unless_equals_int (GST_BUFFER_SIZE (buffer),
+      GST_BUFFER_SIZE (expected));
+  fail_unless (memcmp (GST_BUFFER_DATA (buffer), GST_BUFFER_DATA (expected),
+          GST_BUFFER_SIZE (buffer)) == 0);
+}
+
+static void
+check_bs_to_avc (guint start_code_size)
+{
+  GstBuffer *inbuffer, *outbuffer, *expected;
+  const GValue *value;
+  GstBuffer *codec_data;
+  GstCaps *caps;
+
+  inbuffer = join_nals (0, G_N_ELEMENTS (conv_nals), start_code_size, FALSE);
+  caps = gst_caps_from_string (SRC_CAPS_TMPL
+      ", stream-format = (string) byte-stream");
+  gst_buffer_set_caps (inbuffer, caps);
+  gst_caps_unref (caps);
+
+  outbuffer = convert_stream (&sinktemplate_avc_au, inbuffer, &caps);
+
+  /* a single access unit with 4 bytes NAL lengths */
+  expected = join_nals (0, G_N_ELEMENTS (conv_nals), 4, TRUE);
+  check_buffer_equal (outbuffer, expected);
+  gst_buffer_unref (expected);
+  gst_buffer_unref (outbuffer);
+
+  fail_unless (caps != NULL);
+  value = gst_structure_get_value (gst_caps_get_structure (caps, 0),
+      "codec_data");
+  fail_unless (value != NULL);
+  codec_data = gst_value_get_buffer (value);
+  fail_unless_equals_int (GST_BUFFER_SIZE (codec_data),
+      sizeof (h264_codec_data));
+  fail_unless (memcmp (GST_BUFFER_DATA (codec_data), h264_codec_data,
+          sizeof (h264_codec_data)) == 0);
+  gst_caps_unref (caps);
+}
+
+/* start codes as long as the NAL lengths are replaced in place */
+GST_START_TEST (test_convert_bs_to_avc)
+{
+  check_bs_to_avc (4);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_convert_bs_to_avc_short_start_codes)
+{
+  check_bs_to_avc (3);
+}
+
+GST_END_TEST;
+
+static void
+check_avc_to_bs (guint nal_length_size)
+{
+  GstBuffer *inbuffer, *outbuffer, *expected, *cdata;
+  guint8 codec_data[sizeof (h264_codec_data)];
+  GstCaps *caps;
+
+  memcpy (codec_data, h264_codec_data, sizeof (h264_codec_data));
+  codec_data[4] = 0xfc | (nal_length_size - 1);
+  cdata = gst_buffer_new ();
+  GST_BUFFER_DATA (cdata) = codec_data;
+  GST_BUFFER_SIZE (cdata) = sizeof (codec_data);
+  caps = gst_caps_from_string (SRC_CAPS_TMPL
+      ", stream-format = (string) avc, alignment = (string) au");
+  gst_caps_set_simple (caps, "codec_data", GST_TYPE_BUFFER, cdata, NULL);
+  gst_buffer_unref (cdata);
+
+  /* keep a reference, the data of a shared buffer must not be modified */
+  inbuffer = join_nals (2, 1, nal_length_size, TRUE);
+  gst_buffer_set_caps (inbuffer, caps);
+  gst_caps_unref (caps);
+  expected = gst_buffer_copy (inbuffer);
+  gst_buffer_ref (inbuffer);
+
+  outbuffer = convert_stream (&sinktemplate_bs_nal, inbuffer, NULL);
+
+  check_buffer_equal (inbuffer, expected);
+  ASSERT_BUFFER_REFCOUNT (inbuffer, "inbuffer", 1);
+  gst_buffer_unref (inbuffer);
+  gst_buffer_unref (expected);
+
+  /* SPS and PPS from the codec data, then the frame, with 4 bytes start
+   * codes */
+  expected = join_nals (0, G_N_ELEMENTS (conv_nals), 4, FALSE);
+  check_buffer_equal (outbuffer, expected);
+  gst_buffer_unref (expected);
+  gst_buffer_unref (outbuffer);
+}
+
+GST_START_TEST (test_convert_avc_to_bs)
+{
+  check_avc_to_bs (4);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_convert_avc_to_bs_short_lengths)
+{
+  check_avc_to_bs (2);
+}
+
+GST_END_TEST;
+
+static Suite *
+h264parse_conversion_suite (void)
+{
+  Suite *s = suite_create (ctx_suite);
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_convert_bs_to_avc);
+  tcase_add_test (tc_chain, test_convert_bs_to_avc_short_start_codes);
+  tcase_add_test (tc_chain, test_convert_avc_to_bs);
+  tcase_add_test (tc_chain, test_convert_avc_to_bs_short_lengths);
+
+  return s;
+}
+
+static Suite *
+h264parse_timestamps_suite (void)
+{
+  Suite *s = suite_create (ctx_suite);
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_parse_reorder_timestamps);
+
+  return s;
+}
+
 static Suite *
 h264parse_packetized_suite (void)
 {
@@ -389,5 +735,19 @@ main (int argc, char **argv)
   nf += srunner_ntests_failed (sr);
   srunner_free (sr);
 
+  ctx_suite = "h264parse_timestamps";
+  s = h264parse_timestamps_suite ();
+  sr = srunner_create (s);
+  srunner_run_all (sr, CK_NORMAL);
+  nf += srunner_ntests_failed (sr);
+  srunner_free (sr);
+
+  ctx_suite = "h264parse_conversion";
+  s = h264parse_conversion_suite ();
+  sr = srunner_create (s);
+  srunner_run_all (sr, CK_NORMAL);
+  nf += srunner_ntests_failed (sr);
+  srunner_free (sr);
+
   return nf;
 }
@@ -0,0 +1,424 @@
+/*
+ * GStreamer
+ *
+ * unit test for h265parse
+ *
+ * Copyright (C) 2011 Nokia Corporation. All rights reserved.
+ *
+ * Contact: Stefan Kost <stefan.kost@nokia.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include "parser.h"
+
+#define SRC_CAPS_TMPL   "video/x-h265, parsed=(boolean)false"
+#define SINK_CAPS_TMPL  "video/x-h265, parsed=(boolean)true"
+
+GstStaticPadTemplate sinktemplate_bs_nal = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SINK_CAPS_TMPL
+        ", stream-format = (string) byte-stream, alignment = (string) nal")
+    );
+
+GstStaticPadTemplate sinktemplate_hvc1_au = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SINK_CAPS_TMPL
+        ", stream-format = (string) hvc1, alignment = (string) au")
+    );
+
+GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS (SRC_CAPS_TMPL)
+    );
+
+/* some data */
+
+/* VPS */
+static guint8 h265_vps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+  0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+  0x5d, 0x95, 0x98, 0x09
+};
+
+/* SPS */
+static guint8 h265_sps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+  0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x78, 0xa0, 0x03,
+  0xc0, 0x80, 0x11, 0x07, 0xcb, 0x96, 0x56, 0x69, 0x24, 0x4b, 0x55, 0x55,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0x92, 0xab, 0x27, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xfe, 0x6d, 0x7a, 0x79, 0xbc, 0x05, 0xa8, 0x08, 0x08,
+  0x08, 0x20, 0x00, 0x00, 0x03, 0x00, 0x20, 0x00, 0x00, 0x03, 0x03, 0x2c,
+  0x00, 0xbd, 0xef, 0xc0, 0x01, 0x38, 0x80, 0x00, 0x1d, 0x4c, 0x04
+};
+
+/* PPS */
+static guint8 h265_pps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc1, 0xa8, 0x92, 0x8a, 0x60, 0x97,
+  0xe2, 0x33, 0x40
+};
+
+/* combines to this codec-data */
+static guint8 h265_codec_data[] = {
+  0x01, 0x01, 0x60, 0x00, 0x00, 0x00, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x78, 0xf0, 0x00, 0xfc, 0xfd, 0xf8, 0xf8, 0x00, 0x00, 0x0f, 0x03, 0xa0,
+  0x00, 0x01, 0x00, 0x18, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+  0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+  0x5d, 0x95, 0x98, 0x09, 0xa1, 0x00, 0x01, 0x00, 0x5b, 0x42, 0x01, 0x01,
+  0x01, 0x60, 0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00,
+  0x03, 0x00, 0x78, 0xa0, 0x03, 0xc0, 0x80, 0x11, 0x07, 0xcb, 0x96, 0x56,
+  0x69, 0x24, 0x4b, 0x55, 0x55, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0x92, 0xab,
+  0x27, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfe, 0x6d, 0x7a, 0x79,
+  0xbc, 0x05, 0xa8, 0x08, 0x08, 0x08, 0x20, 0x00, 0x00, 0x03, 0x00, 0x20,
+  0x00, 0x00, 0x03, 0x03, 0x2c, 0x00, 0xbd, 0xef, 0xc0, 0x01, 0x38, 0x80,
+  0x00, 0x1d, 0x4c, 0x04, 0xa2, 0x00, 0x01, 0x00, 0x0b, 0x44, 0x01, 0xc1,
+  0xa8, 0x92, 0x8a, 0x60, 0x97, 0xe2, 0x33, 0x40
+};
+
+/* keyframes all around */
+static guint8 h265_idrframe[] = {
+  0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x3c, 0x8a, 0xe0, 0x81, 0xb6,
+  0x0d, 0xed, 0x7e, 0x19, 0x4f, 0x38, 0xbd, 0xef, 0x7d, 0xc1, 0x33, 0x7e,
+  0x05, 0x6d, 0xcf, 0x8e, 0x5c, 0xc6, 0x50, 0x23, 0x46, 0xe2, 0x3f, 0x42,
+  0x00, 0x01, 0x6a, 0x6d, 0x53, 0x54
+};
+
+/* truncated nal */
+static guint8 garbage_frame[] = {
+  0x00, 0x00, 0x00, 0x01, 0x26
+};
+
+/* context to tweak tests */
+static const gchar *ctx_suite;
+static gboolean ctx_codec_data;
+
+#define NUM_HEADERS 3
+
+static gboolean
+verify_buffer (buffer_verify_data_s * vdata, GstBuffer * buffer)
+{
+  if (vdata->discard) {
+    /* check separate header NALs */
+    gint i = vdata->buffer_counter;
+
+    fail_unless (i < NUM_HEADERS);
+    fail_unless (GST_BUFFER_SIZE (buffer) == ctx_headers[i].size);
+    fail_unless (memcmp (GST_BUFFER_DATA (buffer), ctx_headers[i].data,
+            GST_BUFFER_SIZE (buffer)) == 0);
+  } else {
+    fail_unless (GST_BUFFER_SIZE (buffer) > 4);
+    /* only need to check hvc1 output case */
+    if (GST_READ_UINT32_BE (GST_BUFFER_DATA (buffer)) == 0x01)
+      return FALSE;
+    /* header is merged in initial frame */
+    if (vdata->buffer_counter == 0) {
+      guint8 *data = GST_BUFFER_DATA (buffer);
+      guint i, size = vdata->data_to_verify_size;
+
+      for (i = 0; i < NUM_HEADERS; i++)
+        size += ctx_headers[i].size;
+      fail_unless (GST_BUFFER_SIZE (buffer) == size);
+      for (i = 0; i < NUM_HEADERS; i++) {
+        fail_unless (GST_READ_UINT32_BE (data) == ctx_headers[i].size - 4);
+        fail_unless (memcmp (data + 4, ctx_headers[i].data + 4,
+                ctx_headers[i].size - 4) == 0);
+        data += ctx_headers[i].size;
+      }
+      fail_unless (GST_READ_UINT32_BE (data) == vdata->data_to_verify_size - 4);
+      fail_unless (memcmp (data + 4, vdata->data_to_verify + 4,
+              vdata->data_to_verify_size - 4) == 0);
+    } else {
+      fail_unless (GST_READ_UINT32_BE (GST_BUFFER_DATA (buffer)) ==
+          GST_BUFFER_SIZE (buffer) - 4);
+      fail_unless (GST_BUFFER_SIZE (buffer) == vdata->data_to_verify_size);
+      fail_unless (memcmp (GST_BUFFER_DATA (buffer) + 4,
+              vdata->data_to_verify + 4, GST_BUFFER_SIZE (buffer) - 4) == 0);
+    }
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+GST_START_TEST (test_parse_normal)
+{
+  gst_parser_test_normal (h265_idrframe, sizeof (h265_idrframe));
+}
+
+GST_END_TEST;
+
+
+GST_START_TEST (test_parse_drain_single)
+{
+  gst_parser_test_drain_single (h265_idrframe, sizeof (h265_idrframe));
+}
+
+GST_END_TEST;
+
+
+GST_START_TEST (test_parse_drain_garbage)
+{
+  gst_parser_test_drain_garbage (h265_idrframe, sizeof (h265_idrframe),
+      garbage_frame, sizeof (garbage_frame));
+}
+
+GST_END_TEST
+GST_START_TEST (test_parse_split)
+{
+  gst_parser_test_split (h265_idrframe, sizeof (h265_idrframe));
+}
+
+GST_END_TEST;
+
+
+GST_START_TEST (test_parse_skip_garbage)
+{
+  gst_parser_test_skip_garbage (h265_idrframe, sizeof (h265_idrframe),
+      garbage_frame, sizeof (garbage_frame));
+}
+
+GST_END_TEST;
+
+#define structure_get_int(s,f) \
+    (g_value_get_int(gst_structure_get_value(s,f)))
+#define fail_unless_structure_field_int_equals(s,field,num) \
+    fail_unless_equals_int (structure_get_int(s,field), num)
+
+
+GST_START_TEST (test_parse_detect_stream)
+{
+  GstCaps *caps;
+  GstStructure *s;
+  GstBuffer *buf;
+  const GValue *val;
+
+  /* parser does not really care that mpeg1 and mpeg2 frame data
+   * should be a bit different */
+  caps = gst_parser_test_get_output_caps (h265_idrframe, sizeof (h265_idrframe),
+      NULL);
+  fail_unless (caps != NULL);
+
+  /* Check that the negotiated caps are as expected */
+  /* When codec_data is present, parser assumes that data is version 4 */
+  GST_LOG ("h265 output caps: %" GST_PTR_FORMAT, caps);
+  s = gst_caps_get_structure (caps, 0);
+  fail_unless (gst_structure_has_name (s, "video/x-h265"));
+  fail_unless_structure_field_int_equals (s, "width", 1920);
+  fail_unless_structure_field_int_equals (s, "height", 1080);
+
+  if (ctx_codec_data) {
+    fail_unless (gst_structure_has_field (s, "codec_data"));
+
+    /* check codec-data in more detail */
+    val = gst_structure_get_value (s, "codec_data");
+    fail_unless (val != NULL);
+    buf = gst_value_get_buffer (val);
+    fail_unless (buf != NULL);
+    fail_unless (GST_BUFFER_SIZE (buf) == sizeof (h265_codec_data));
+    fail_unless (memcmp (GST_BUFFER_DATA (buf), h265_codec_data,
+            GST_BUFFER_SIZE (buf)) == 0);
+  }
+
+  gst_caps_unref (caps);
+}
+
+GST_END_TEST;
+
+
+static Suite *
+h265parse_suite (void)
+{
+  Suite *s = suite_create (ctx_suite);
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_parse_normal);
+  tcase_add_test (tc_chain, test_parse_drain_single);
+  tcase_add_test (tc_chain, test_parse_drain_garbage);
+  tcase_add_test (tc_chain, test_parse_split);
+  tcase_add_test (tc_chain, test_parse_skip_garbage);
+  tcase_add_test (tc_chain, test_parse_detect_stream);
+
+  return s;
+}
+
+static gboolean
+verify_buffer_packetized (buffer_verify_data_s * vdata, GstBuffer * buffer)
+{
+  fail_unless (GST_BUFFER_SIZE (buffer) > 4);
+  fail_unless (GST_READ_UINT32_BE (GST_BUFFER_DATA (buffer)) == 0x01);
+  if (vdata->discard) {
+    /* check separate header NALs */
+    guint8 *data;
+    gint size;
+
+    if (vdata->buffer_counter == 0) {
+      data = h265_vps;
+      size = sizeof (h265_vps);
+    } else if (vdata->buffer_counter == 1) {
+      data = h265_sps;
+      size = sizeof (h265_sps);
+    } else {
+      data = h265_pps;
+      size = sizeof (h265_pps);
+    }
+
+    fail_unless (GST_BUFFER_SIZE (buffer) == size);
+    fail_unless (memcmp (GST_BUFFER_DATA (buffer) + 4, data + 4,
+            size - 4) == 0);
+  } else {
+    fail_unless (GST_BUFFER_SIZE (buffer) == vdata->data_to_verify_size);
+    fail_unless (memcmp (GST_BUFFER_DATA (buffer) + 4,
+            vdata->data_to_verify + 4, GST_BUFFER_SIZE (buffer) - 4) == 0);
+  }
+
+  return TRUE;
+}
+
+GST_START_TEST (test_parse_packetized)
+{
+  guint8 *frame;
+  GstCaps *caps;
+  GstBuffer *cdata;
+  GstStructure *s;
+  gchar *desc;
+
+  /* make hvc1 frame */
+  frame = g_malloc (sizeof (h265_idrframe));
+  GST_WRITE_UINT32_BE (frame, sizeof (h265_idrframe) - 4);
+  memcpy (frame + 4, h265_idrframe + 4, sizeof (h265_idrframe) - 4);
+
+  /* some caps messing */
+  caps = gst_caps_from_string (SRC_CAPS_TMPL);
+  cdata = gst_buffer_new ();
+  GST_BUFFER_DATA (cdata) = h265_codec_data;
+  GST_BUFFER_SIZE (cdata) = sizeof (h265_codec_data);
+  gst_caps_set_simple (caps, "codec_data", GST_TYPE_BUFFER, cdata, NULL);
+  gst_buffer_unref (cdata);
+  desc = gst_caps_to_string (caps);
+  gst_caps_unref (caps);
+
+  caps = gst_parser_test_get_output_caps (frame, sizeof (h265_idrframe), desc);
+  g_free (desc);
+  g_free (frame);
+
+  /* minor caps checks */
+  GST_LOG ("h265 output caps: %" GST_PTR_FORMAT, caps);
+  s = gst_caps_get_structure (caps, 0);
+  fail_unless (gst_structure_has_name (s, "video/x-h265"));
+  fail_unless_structure_field_int_equals (s, "width", 1920);
+  fail_unless_structure_field_int_equals (s, "height", 1080);
+
+  gst_caps_unref (caps);
+}
+
+GST_END_TEST;
+
+static Suite *
+h265parse_packetized_suite (void)
+{
+  Suite *s = suite_create (ctx_suite);
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_parse_packetized);
+
+  return s;
+}
+
+
+/*
+ * TODO:
+ *   - Both push- and pull-modes need to be tested
+ *      * Pull-mode & EOS
+ */
+
+int
+main (int argc, char **argv)
+{
+  int nf = 0;
+
+  Suite *s;
+  SRunner *sr;
+
+  gst_check_init (&argc, &argv);
+
+  /* globabl init test context */
+  ctx_factory = "h265parse";
+  ctx_sink_template = &sinktemplate_bs_nal;
+  ctx_src_template = &srctemplate;
+  ctx_headers[0].data = h265_vps;
+  ctx_headers[0].size = sizeof (h265_vps);
+  ctx_headers[1].data = h265_sps;
+  ctx_headers[1].size = sizeof (h265_sps);
+  ctx_headers[2].data = h265_pps;
+  ctx_headers[2].size = sizeof (h265_pps);
+  ctx_verify_buffer = verify_buffer;
+  /* discard initial vps/sps/pps buffers */
+  ctx_discard = NUM_HEADERS;
+  /* no timing info to parse */
+  ctx_no_metadata = TRUE;
+  ctx_codec_data = FALSE;
+
+  ctx_suite = "h265parse_to_bs_nal";
+  s = h265parse_suite ();
+  sr = srunner_create (s);
+  srunner_run_all (sr, CK_NORMAL);
+  nf += srunner_ntests_failed (sr);
+  srunner_free (sr);
+
+  /* setup and tweak to handle hvc1 au output */
+  ctx_suite = "h265parse_to_hvc1_au";
+  ctx_sink_template = &sinktemplate_hvc1_au;
+  ctx_discard = 0;
+  ctx_codec_data = TRUE;
+
+  s = h265parse_suite ();
+  sr = srunner_create (s);
+  srunner_run_all (sr, CK_NORMAL);
+  nf += srunner_ntests_failed (sr);
+  srunner_free (sr);
+
+  /* setup and tweak to handle hvc1 packetized input */
+  ctx_suite = "h265parse_packetized";
+  /* turn into separate byte stream NALs */
+  ctx_sink_template = &sinktemplate_bs_nal;
+  /* and ignore inserted codec-data NALs */
+  ctx_discard = NUM_HEADERS;
+  /* no more config headers */
+  ctx_headers[0].data = NULL;
+  ctx_headers[1].data = NULL;
+  ctx_headers[2].data = NULL;
+  ctx_headers[0].size = 0;
+  ctx_headers[1].size = 0;
+  ctx_headers[2].size = 0;
+  /* and need adapter buffer check */
+  ctx_verify_buffer = verify_buffer_packetized;
+
+  s = h265parse_packetized_suite ();
+  sr = srunner_create (s);
+  srunner_run_all (sr, CK_NORMAL);
+  nf += srunner_ntests_failed (sr);
+  srunner_free (sr);
+
+  return nf;
+}
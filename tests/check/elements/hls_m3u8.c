@@ -0,0 +1,329 @@
+/* GStreamer
+ *
+ * unit test for the m3u8 playlist parser and renderer of the hls plugin
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include "m3u8.h"
+#include "gstm3u8playlist.h"
+
+GST_DEBUG_CATEGORY (fragmented_debug);
+
+#define BENCHMARK_ENTRIES 10000
+#define BENCHMARK_ITERATIONS 100
+
+/* Live playlist with the media files @first to @last, numbered from
+ * @sequence, or without EXT-X-MEDIA-SEQUENCE if it is -1 */
+static gchar *
+_media_playlist (gint sequence, guint first, guint last, gboolean endlist)
+{
+  GString *str;
+  guint i;
+
+  str = g_string_new ("#EXTM3U\n#EXT-X-TARGETDURATION:10\n");
+  if (sequence >= 0)
+    g_string_append_printf (str, "#EXT-X-MEDIA-SEQUENCE:%d\n", sequence);
+  for (i = first; i <= last; i++)
+    g_string_append_printf (str, "#EXTINF:10,\nsegment%u.ts\n", i);
+  if (endlist)
+    g_string_append (str, "#EXT-X-ENDLIST\n");
+
+  return g_string_free (str, FALSE);
+}
+
+static void
+_check_files (GstM3U8Client * client, guint first_sequence, guint first,
+    guint n_files)
+{
+  GList *walk;
+  guint i = 0;
+  gchar *uri;
+
+  fail_unless_equals_int (g_list_length (client->current->files), n_files);
+  for (walk = client->current->files; walk; walk = walk->next, i++) {
+    GstM3U8MediaFile *file = GST_M3U8_MEDIA_FILE (walk->data);
+
+    fail_unless_equals_int (file->sequence, first_sequence + i);
+    fail_unless_equals_uint64 (file->duration, 10 * GST_SECOND);
+    uri = g_strdup_printf ("http://localhost/live/segment%u.ts", first + i);
+    fail_unless_equals_string (file->uri, uri);
+    g_free (uri);
+  }
+}
+
+GST_START_TEST (test_parse_media_playlist)
+{
+  GstM3U8Client *client;
+
+  client = gst_m3u8_client_new ("http://localhost/live/index.m3u8");
+  fail_unless (gst_m3u8_client_update (client, _media_playlist (5, 0, 3,
+              TRUE)));
+  fail_unless (client->current->endlist);
+  fail_unless_equals_uint64 (client->current->targetduration,
+      10 * GST_SECOND);
+  _check_files (client, 5, 0, 4);
+  fail_unless_equals_uint64 (gst_m3u8_client_get_duration (client),
+      40 * GST_SECOND);
+
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_update_sliding_window)
+{
+  GstM3U8Client *client;
+  gpointer known;
+
+  client = gst_m3u8_client_new ("http://localhost/live/index.m3u8");
+  fail_unless (gst_m3u8_client_update (client, _media_playlist (10, 10, 14,
+              FALSE)));
+  _check_files (client, 10, 10, 5);
+  known = g_list_nth_data (client->current->files, 2);
+
+  /* The window moved by 3 media files, the known ones are kept */
+  fail_unless (gst_m3u8_client_update (client, _media_playlist (12, 12, 17,
+              FALSE)));
+  _check_files (client, 12, 12, 6);
+  fail_unless (client->current->files->data == known);
+
+  /* Same playlist again, this is not an update */
+  fail_if (gst_m3u8_client_update (client, _media_playlist (12, 12, 17,
+              FALSE)));
+  fail_unless_equals_int (client->update_failed_count, 1);
+  _check_files (client, 12, 12, 6);
+  fail_unless (client->current->files->data == known);
+
+  /* The stream restarted */
+  fail_unless (gst_m3u8_client_update (client, _media_playlist (0, 100, 101,
+              FALSE)));
+  _check_files (client, 0, 100, 2);
+
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_update_appended)
+{
+  GstM3U8Client *client;
+  gpointer known;
+
+  client = gst_m3u8_client_new ("http://localhost/live/index.m3u8");
+  fail_unless (gst_m3u8_client_update (client, _media_playlist (3, 0, 4,
+              FALSE)));
+  known = g_list_last (client->current->files)->data;
+
+  fail_unless (gst_m3u8_client_update (client, _media_playlist (3, 0, 6,
+              FALSE)));
+  _check_files (client, 3, 0, 7);
+  fail_unless (g_list_nth_data (client->current->files, 4) == known);
+  fail_if (client->current->endlist);
+
+  /* The end of the event */
+  fail_unless (gst_m3u8_client_update (client, _media_playlist (3, 0, 6,
+              TRUE)));
+  _check_files (client, 3, 0, 7);
+  fail_unless (client->current->endlist);
+
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_update_no_media_sequence)
+{
+  GstM3U8Client *client;
+
+  /* Without EXT-X-MEDIA-SEQUENCE the first media file is always 0 */
+  client = gst_m3u8_client_new ("http://localhost/live/index.m3u8");
+  fail_unless (gst_m3u8_client_update (client, _media_playlist (-1, 0, 2,
+              FALSE)));
+  _check_files (client, 0, 0, 3);
+  fail_unless (gst_m3u8_client_update (client, _media_playlist (-1, 1, 3,
+              FALSE)));
+  _check_files (client, 0, 1, 3);
+
+  gst_m3u8_client_free (client);
+}
+
+GST_END_TEST;
+
+static void
+_add_entry (GstM3U8Playlist * playlist, guint index, gfloat duration)
+{
+  GList *old_files;
+  gchar *url;
+
+  url = g_strdup_printf ("segment%u.ts", index);
+  old_files = gst_m3u8_playlist_add_entry (playlist, url,
+      g_file_new_for_path (url), "", duration, index, FALSE);
+  g_list_foreach (old_files, (GFunc) g_object_unref, NULL);
+  g_list_free (old_files);
+  g_free (url);
+}
+
+GST_START_TEST (test_playlist_render)
+{
+  GstM3U8Playlist *playlist;
+  gchar *pl;
+
+  playlist = gst_m3u8_playlist_new (3, 2, FALSE);
+  _add_entry (playlist, 0, 5 * GST_SECOND);
+  _add_entry (playlist, 1, 10 * GST_SECOND);
+  _add_entry (playlist, 2, 4 * GST_SECOND);
+
+  pl = gst_m3u8_playlist_render (playlist);
+  fail_unless_equals_string (pl, "#EXTM3U\n#EXT-X-MEDIA-SEQUENCE:1\n"
+      "#EXT-X-TARGETDURATION:10\n\n"
+      "#EXTINF:10,\nsegment1.ts\n#EXTINF:4,\nsegment2.ts\n");
+  g_free (pl);
+
+  /* The longest entry left the playlist */
+  _add_entry (playlist, 3, 3 * GST_SECOND);
+  playlist->end_list = TRUE;
+  pl = gst_m3u8_playlist_render (playlist);
+  fail_unless_equals_string (pl, "#EXTM3U\n#EXT-X-MEDIA-SEQUENCE:2\n"
+      "#EXT-X-TARGETDURATION:4\n\n"
+      "#EXTINF:4,\nsegment2.ts\n#EXTINF:3,\nsegment3.ts\n#EXT-X-ENDLIST");
+  g_free (pl);
+
+  gst_m3u8_playlist_clear (playlist);
+  fail_unless_equals_int (gst_m3u8_playlist_n_entries (playlist), 0);
+  playlist->end_list = FALSE;
+  pl = gst_m3u8_playlist_render (playlist);
+  fail_unless_equals_string (pl, "#EXTM3U\n#EXT-X-MEDIA-SEQUENCE:4\n"
+      "#EXT-X-TARGETDURATION:0\n\n");
+  g_free (pl);
+
+  gst_m3u8_playlist_free (playlist);
+}
+
+GST_END_TEST;
+
+/* Refreshing and writing a live playlist with a window of 10000 entries.
+ * The timings are only reported, run with GST_DEBUG=check:4 to see them */
+GST_START_TEST (test_benchmark_parse)
+{
+  GstM3U8Client *client;
+  GTimer *timer;
+  gdouble full, sliding, appended;
+  guint i;
+
+  timer = g_timer_new ();
+  client = gst_m3u8_client_new ("http://localhost/live/index.m3u8");
+
+  g_timer_start (timer);
+  fail_unless (gst_m3u8_client_update (client, _media_playlist (0, 0,
+              BENCHMARK_ENTRIES - 1, FALSE)));
+  full = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 1; i <= BENCHMARK_ITERATIONS; i++) {
+    fail_unless (gst_m3u8_client_update (client, _media_playlist (i, i,
+                i + BENCHMARK_ENTRIES - 1, FALSE)));
+  }
+  sliding = g_timer_elapsed (timer, NULL) / BENCHMARK_ITERATIONS;
+  _check_files (client, BENCHMARK_ITERATIONS, BENCHMARK_ITERATIONS,
+      BENCHMARK_ENTRIES);
+
+  g_timer_start (timer);
+  for (i = 1; i <= BENCHMARK_ITERATIONS; i++) {
+    fail_unless (gst_m3u8_client_update (client,
+            _media_playlist (BENCHMARK_ITERATIONS, BENCHMARK_ITERATIONS,
+                BENCHMARK_ITERATIONS + BENCHMARK_ENTRIES - 1 + i, FALSE)));
+  }
+  appended = g_timer_elapsed (timer, NULL) / BENCHMARK_ITERATIONS;
+  _check_files (client, BENCHMARK_ITERATIONS, BENCHMARK_ITERATIONS,
+      BENCHMARK_ENTRIES + BENCHMARK_ITERATIONS);
+
+  GST_INFO ("%u entries: full parse %.3f ms, sliding window update %.3f ms, "
+      "appended update %.3f ms (including building the text)",
+      BENCHMARK_ENTRIES, full * 1000, sliding * 1000, appended * 1000);
+
+  gst_m3u8_client_free (client);
+  g_timer_destroy (timer);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_benchmark_render)
+{
+  GstM3U8Playlist *playlist;
+  GString *expected;
+  GTimer *timer;
+  gdouble render;
+  gchar *pl;
+  guint i;
+
+  timer = g_timer_new ();
+  playlist = gst_m3u8_playlist_new (3, BENCHMARK_ENTRIES, FALSE);
+  for (i = 0; i < BENCHMARK_ENTRIES; i++)
+    _add_entry (playlist, i, 10 * GST_SECOND);
+
+  /* hlssink renders the playlist after each new segment */
+  g_timer_start (timer);
+  for (; i < BENCHMARK_ENTRIES + BENCHMARK_ITERATIONS; i++) {
+    _add_entry (playlist, i, 10 * GST_SECOND);
+    pl = gst_m3u8_playlist_render (playlist);
+    g_free (pl);
+  }
+  render = g_timer_elapsed (timer, NULL) / BENCHMARK_ITERATIONS;
+
+  GST_INFO ("%u entries: new segment and render %.3f ms", BENCHMARK_ENTRIES,
+      render * 1000);
+
+  expected = g_string_new ("");
+  g_string_append_printf (expected, "#EXTM3U\n#EXT-X-MEDIA-SEQUENCE:%u\n"
+      "#EXT-X-TARGETDURATION:10\n\n", BENCHMARK_ITERATIONS);
+  for (i = BENCHMARK_ITERATIONS; i < BENCHMARK_ENTRIES + BENCHMARK_ITERATIONS;
+      i++)
+    g_string_append_printf (expected, "#EXTINF:10,\nsegment%u.ts\n", i);
+  pl = gst_m3u8_playlist_render (playlist);
+  fail_unless_equals_string (pl, expected->str);
+  g_free (pl);
+  g_string_free (expected, TRUE);
+
+  gst_m3u8_playlist_free (playlist);
+  g_timer_destroy (timer);
+}
+
+GST_END_TEST;
+
+static Suite *
+hls_m3u8_suite (void)
+{
+  Suite *s = suite_create ("hls_m3u8");
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (fragmented_debug, "fragmented", 0, "HLS");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_parse_media_playlist);
+  tcase_add_test (tc_chain, test_update_sliding_window);
+  tcase_add_test (tc_chain, test_update_appended);
+  tcase_add_test (tc_chain, test_update_no_media_sequence);
+  tcase_add_test (tc_chain, test_playlist_render);
+  tcase_add_test (tc_chain, test_benchmark_parse);
+  tcase_add_test (tc_chain, test_benchmark_render);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hls_m3u8);
@@ -0,0 +1,304 @@
+/* GStreamer
+ *
+ * unit test for the bandwidth estimation of hlsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+
+#include "gsthlsabr.h"
+
+GST_DEBUG_CATEGORY (fragmented_debug);
+
+/* The playback is simulated with 2 seconds fragments, a player that doesn't
+ * buffer more than 8 seconds ahead and the bandwidth available for each
+ * fragment given by a trace */
+#define FRAGMENT_DURATION (2 * GST_SECOND)
+#define MAX_BUFFER_LEVEL (8 * GST_SECOND)
+#define N_VARIANTS 4
+
+static const guint variants[N_VARIANTS] = { 500000, 1000000, 2000000,
+  4000000
+};
+
+static guint
+_pick_variant (guint max_bitrate)
+{
+  guint bitrate = variants[0];
+  gint i;
+
+  for (i = 0; i < N_VARIANTS; i++) {
+    if (variants[i] <= max_bitrate)
+      bitrate = variants[i];
+  }
+
+  return bitrate;
+}
+
+/* Fills @selected with the bitrate of the variant chosen after each fragment
+ * and returns the number of switches */
+static guint
+_simulate (GstHLSAbrPolicy policy, const guint * trace, guint n_fragments,
+    guint * selected)
+{
+  GstHLSAbr *abr;
+  GstClockTime level = FRAGMENT_DURATION * 2;
+  GstClockTime transfer_time;
+  guint64 size;
+  guint current = variants[0], next;
+  guint i, switches = 0;
+
+  abr = gst_hls_abr_new (10);
+  abr->policy = policy;
+  abr->low_level = FRAGMENT_DURATION;
+  abr->high_level = 3 * FRAGMENT_DURATION;
+
+  for (i = 0; i < n_fragments; i++) {
+    size = gst_util_uint64_scale (current, FRAGMENT_DURATION, 8 * GST_SECOND);
+    transfer_time = gst_util_uint64_scale (size * 8, GST_SECOND, trace[i]);
+    level = level > transfer_time ? level - transfer_time : 0;
+    level = MIN (level + FRAGMENT_DURATION, MAX_BUFFER_LEVEL);
+
+    gst_hls_abr_add_sample (abr, size, transfer_time);
+    next = _pick_variant (gst_hls_abr_get_target_bitrate (abr, current,
+            level));
+    if (next != current)
+      switches++;
+    current = selected[i] = next;
+  }
+
+  gst_hls_abr_free (abr);
+
+  return switches;
+}
+
+/* Bandwidth around @bandwidth, varying by up to @percent % */
+static void
+_noisy_trace (guint * trace, guint n_fragments, guint bandwidth, gint percent)
+{
+  guint32 x = 1;
+  guint i;
+
+  for (i = 0; i < n_fragments; i++) {
+    x = (x * 1103515245 + 12345) & 0x7fffffff;
+    trace[i] = bandwidth + (gint) bandwidth / 100 * percent *
+        ((gint) (x % 201) - 100) / 100;
+  }
+}
+
+static void
+_step_trace (guint * trace, guint n_fragments, guint before, guint after,
+    guint step)
+{
+  guint i;
+
+  for (i = 0; i < n_fragments; i++)
+    trace[i] = i < step ? before : after;
+}
+
+static void
+_check_stable (GstHLSAbrPolicy policy)
+{
+  guint trace[60], selected[60];
+  guint i;
+
+  _noisy_trace (trace, 60, 3000000, 20);
+  _simulate (policy, trace, 60, selected);
+
+  /* 80% of 3Mbps, the bitrate has to settle on the 2Mbps variant */
+  for (i = 5; i < 60; i++)
+    fail_unless_equals_int (selected[i], 2000000);
+}
+
+static void
+_check_step_down (GstHLSAbrPolicy policy, guint max_delay)
+{
+  guint trace[40], selected[40];
+  guint i;
+
+  _step_trace (trace, 40, 8000000, 1000000, 20);
+  _simulate (policy, trace, 40, selected);
+
+  fail_unless_equals_int (selected[19], 4000000);
+  for (i = 20 + max_delay; i < 40; i++)
+    fail_unless_equals_int (selected[i], 500000);
+}
+
+static void
+_check_step_up (GstHLSAbrPolicy policy)
+{
+  guint trace[30], selected[30];
+  guint i;
+
+  _step_trace (trace, 30, 1000000, 10000000, 10);
+  _simulate (policy, trace, 30, selected);
+
+  fail_unless_equals_int (selected[9], 500000);
+  for (i = 1; i < 30; i++)
+    fail_unless (selected[i] >= selected[i - 1]);
+  fail_unless_equals_int (selected[29], 4000000);
+}
+
+GST_START_TEST (test_ewma_estimate)
+{
+  GstHLSAbr *abr = gst_hls_abr_new (10);
+
+  fail_unless_equals_int (gst_hls_abr_get_ewma_estimate (abr), 0);
+
+  /* A constant bandwidth is estimated as is from the first sample */
+  gst_hls_abr_add_sample (abr, 125000, GST_SECOND);
+  fail_unless_equals_int (gst_hls_abr_get_last_bandwidth (abr), 1000000);
+  fail_unless_equals_int (gst_hls_abr_get_ewma_estimate (abr), 1000000);
+  gst_hls_abr_add_sample (abr, 250000, 2 * GST_SECOND);
+  fail_unless_equals_int (gst_hls_abr_get_ewma_estimate (abr), 1000000);
+
+  /* A short peak is ignored by the slow average */
+  gst_hls_abr_add_sample (abr, 1250000, GST_SECOND);
+  fail_unless (gst_hls_abr_get_ewma_estimate (abr) < 5000000);
+
+  /* A drop is followed by the fast average */
+  gst_hls_abr_reset (abr);
+  gst_hls_abr_add_sample (abr, 1250000, 4 * GST_SECOND);
+  gst_hls_abr_add_sample (abr, 125000, 4 * GST_SECOND);
+  fail_unless (gst_hls_abr_get_ewma_estimate (abr) < 1000000);
+
+  /* Invalid samples are ignored */
+  gst_hls_abr_add_sample (abr, 0, GST_SECOND);
+  gst_hls_abr_add_sample (abr, 1000, 0);
+  gst_hls_abr_add_sample (abr, 1000, GST_CLOCK_TIME_NONE);
+  fail_unless_equals_int (gst_hls_abr_get_last_bandwidth (abr), 250000);
+
+  gst_hls_abr_free (abr);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_percentile_estimate)
+{
+  GstHLSAbr *abr = gst_hls_abr_new (10);
+  guint i;
+
+  fail_unless_equals_int (gst_hls_abr_get_percentile_estimate (abr), 0);
+
+  for (i = 10; i > 0; i--)
+    gst_hls_abr_add_sample (abr, i * 125000, GST_SECOND);
+  fail_unless_equals_int (gst_hls_abr_get_percentile_estimate (abr), 5000000);
+
+  abr->percentile = 0;
+  fail_unless_equals_int (gst_hls_abr_get_percentile_estimate (abr), 1000000);
+  abr->percentile = 100;
+  fail_unless_equals_int (gst_hls_abr_get_percentile_estimate (abr),
+      10000000);
+
+  /* Only the last fragments are used */
+  for (i = 0; i < 10; i++)
+    gst_hls_abr_add_sample (abr, 250000, GST_SECOND);
+  fail_unless_equals_int (gst_hls_abr_get_percentile_estimate (abr), 2000000);
+
+  gst_hls_abr_free (abr);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_target_bitrate)
+{
+  GstHLSAbr *abr = gst_hls_abr_new (10);
+
+  abr->bitrate_limit = 1.0;
+  abr->low_level = 4 * GST_SECOND;
+  abr->high_level = 10 * GST_SECOND;
+
+  /* Nothing measured yet */
+  fail_unless_equals_int (gst_hls_abr_get_target_bitrate (abr, 1000000,
+          GST_CLOCK_TIME_NONE), 1000000);
+
+  gst_hls_abr_add_sample (abr, 250000, GST_SECOND);
+  fail_unless_equals_int (gst_hls_abr_get_target_bitrate (abr, 0,
+          GST_CLOCK_TIME_NONE), 2000000);
+
+  /* Switching up needs enough data buffered and a bandwidth above the
+   * current bitrate by the hysteresis margin */
+  fail_unless_equals_int (gst_hls_abr_get_target_bitrate (abr, 1000000,
+          GST_CLOCK_TIME_NONE), 2000000);
+  fail_unless_equals_int (gst_hls_abr_get_target_bitrate (abr, 1000000,
+          5 * GST_SECOND), 2000000);
+  fail_unless_equals_int (gst_hls_abr_get_target_bitrate (abr, 1000000,
+          2 * GST_SECOND), 1000000);
+  fail_unless_equals_int (gst_hls_abr_get_target_bitrate (abr, 1900000,
+          5 * GST_SECOND), 1900000);
+
+  /* Switching down is only prevented by a high buffer level */
+  fail_unless_equals_int (gst_hls_abr_get_target_bitrate (abr, 4000000,
+          2 * GST_SECOND), 2000000);
+  fail_unless_equals_int (gst_hls_abr_get_target_bitrate (abr, 4000000,
+          12 * GST_SECOND), 4000000);
+
+  /* The bitrate limit is applied to the estimate */
+  abr->bitrate_limit = 0.5;
+  fail_unless_equals_int (gst_hls_abr_get_target_bitrate (abr, 4000000,
+          2 * GST_SECOND), 1000000);
+
+  gst_hls_abr_free (abr);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_stable_bandwidth)
+{
+  _check_stable (GST_HLS_ABR_POLICY_EWMA);
+  _check_stable (GST_HLS_ABR_POLICY_PERCENTILE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_bandwidth_drop)
+{
+  _check_step_down (GST_HLS_ABR_POLICY_EWMA, 2);
+  /* the median needs half of the window to move */
+  _check_step_down (GST_HLS_ABR_POLICY_PERCENTILE, 5);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_bandwidth_increase)
+{
+  _check_step_up (GST_HLS_ABR_POLICY_EWMA);
+  _check_step_up (GST_HLS_ABR_POLICY_PERCENTILE);
+}
+
+GST_END_TEST;
+
+static Suite *
+hlsabr_suite (void)
+{
+  Suite *s = suite_create ("hlsabr");
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (fragmented_debug, "fragmented", 0, "HLS");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_ewma_estimate);
+  tcase_add_test (tc_chain, test_percentile_estimate);
+  tcase_add_test (tc_chain, test_target_bitrate);
+  tcase_add_test (tc_chain, test_stable_bandwidth);
+  tcase_add_test (tc_chain, test_bandwidth_drop);
+  tcase_add_test (tc_chain, test_bandwidth_increase);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlsabr);
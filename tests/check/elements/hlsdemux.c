@@ -0,0 +1,311 @@
+/* GStreamer
+ *
+ * unit test for hlsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <unistd.h>
+
+#include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
+
+/* The fragments are local files made of MPEG-TS null packets whose payload
+ * is filled with the index of the fragment, so that the data received can be
+ * checked to come in playlist order */
+#define N_FRAGMENTS 6
+#define TS_PACKET_SIZE 188
+#define FRAGMENT_PACKETS 64
+#define FRAGMENT_SIZE (TS_PACKET_SIZE * FRAGMENT_PACKETS)
+
+static GstStaticPadTemplate mysinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstPad *mysinkpad;
+static GMainLoop *loop = NULL;
+static gboolean have_eos = FALSE;
+static guint64 received = 0;
+static gint buffering_percent = -1;
+static gchar *files[N_FRAGMENTS + 1];
+
+static guint8
+_expected_byte (guint64 offset)
+{
+  guint packet_offset = offset % TS_PACKET_SIZE;
+
+  switch (packet_offset) {
+    case 0:
+      return 0x47;
+    case 1:
+      return 0x1f;
+    case 2:
+      return 0xff;
+    case 3:
+      return 0x10;
+    default:
+      return offset / FRAGMENT_SIZE;
+  }
+}
+
+static gchar *
+_write_file (const gchar * tmpl, const gchar * data, gsize size)
+{
+  GError *err = NULL;
+  gchar *filename = NULL;
+  gint fd;
+
+  fd = g_file_open_tmp (tmpl, &filename, &err);
+  fail_unless (fd >= 0, "Could not create temporary file: %s",
+      err ? err->message : "");
+  fail_unless (write (fd, data, size) == size);
+  close (fd);
+
+  return filename;
+}
+
+static void
+_create_stream (void)
+{
+  GString *playlist;
+  guint8 data[FRAGMENT_SIZE];
+  gchar *uri;
+  gint i, j;
+
+  playlist = g_string_new ("#EXTM3U\n#EXT-X-TARGETDURATION:1\n");
+  for (i = 0; i < N_FRAGMENTS; i++) {
+    for (j = 0; j < FRAGMENT_SIZE; j++)
+      data[j] = _expected_byte (i * FRAGMENT_SIZE + j);
+    files[i] = _write_file ("hlsdemux-XXXXXX.ts", (gchar *) data,
+        FRAGMENT_SIZE);
+
+    uri = g_filename_to_uri (files[i], NULL, NULL);
+    fail_unless (uri != NULL);
+    g_string_append_printf (playlist, "#EXTINF:1,\n%s\n", uri);
+    g_free (uri);
+  }
+  g_string_append (playlist, "#EXT-X-ENDLIST\n");
+
+  files[N_FRAGMENTS] = _write_file ("hlsdemux-XXXXXX.m3u8", playlist->str,
+      playlist->len);
+  g_string_free (playlist, TRUE);
+}
+
+static void
+_remove_stream (void)
+{
+  gint i;
+
+  for (i = 0; i <= N_FRAGMENTS; i++) {
+    g_unlink (files[i]);
+    g_free (files[i]);
+    files[i] = NULL;
+  }
+}
+
+static GstFlowReturn
+_sink_chain (GstPad * pad, GstBuffer * buffer)
+{
+  guint i;
+
+  /* Nothing is pushed before the startup cache is filled */
+  fail_unless_equals_int (buffering_percent, 100);
+
+  for (i = 0; i < GST_BUFFER_SIZE (buffer); i++) {
+    fail_unless_equals_int (GST_BUFFER_DATA (buffer)[i],
+        _expected_byte (received + i));
+  }
+  received += GST_BUFFER_SIZE (buffer);
+
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+_sink_event (GstPad * pad, GstEvent * event)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    if (loop) {
+      while (!g_main_loop_is_running (loop));
+    }
+
+    have_eos = TRUE;
+    if (loop)
+      g_main_loop_quit (loop);
+  }
+
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static GstBusSyncReply
+_bus_sync_handler (GstBus * bus, GstMessage * message, gpointer user_data)
+{
+  gint percent;
+
+  if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_BUFFERING) {
+    gst_message_parse_buffering (message, &percent);
+    /* The cache only fills up until playback starts */
+    fail_unless (percent >= buffering_percent);
+    buffering_percent = percent;
+  }
+
+  return GST_BUS_PASS;
+}
+
+static void
+_pad_added (GstElement * element, GstPad * pad, gpointer user_data)
+{
+  GstPad *peer;
+
+  /* hlsdemux replaces its pad when the caps of the fragments change */
+  peer = gst_pad_get_peer (mysinkpad);
+  if (peer) {
+    gst_pad_unlink (peer, mysinkpad);
+    gst_object_unref (peer);
+  }
+
+  fail_unless (gst_pad_link (pad, mysinkpad) == GST_PAD_LINK_OK);
+}
+
+static void
+_run (guint max_downloads, gboolean progressive, guint64 cache_size,
+    GstClockTime cache_duration)
+{
+  GstElement *pipeline, *src, *hlsdemux;
+  GstBus *bus;
+
+  have_eos = FALSE;
+  received = 0;
+  buffering_percent = -1;
+  loop = g_main_loop_new (NULL, FALSE);
+
+  _create_stream ();
+
+  pipeline = gst_pipeline_new ("pipeline");
+  src = gst_element_factory_make ("filesrc", NULL);
+  fail_unless (src != NULL);
+  g_object_set (src, "location", files[N_FRAGMENTS], NULL);
+  hlsdemux = gst_element_factory_make ("hlsdemux", NULL);
+  fail_unless (hlsdemux != NULL);
+  g_object_set (hlsdemux, "max-downloads", max_downloads,
+      "fragments-cache", N_FRAGMENTS / 2, "progressive", progressive,
+      "cache-size", cache_size, "cache-duration", cache_duration, NULL);
+  g_signal_connect (hlsdemux, "pad-added", G_CALLBACK (_pad_added), NULL);
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  gst_bus_set_sync_handler (bus, _bus_sync_handler, NULL);
+  gst_object_unref (bus);
+
+  gst_bin_add_many (GST_BIN (pipeline), src, hlsdemux, NULL);
+  fail_unless (gst_element_link (src, hlsdemux));
+
+  mysinkpad = gst_pad_new_from_static_template (&mysinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, _sink_chain);
+  gst_pad_set_event_function (mysinkpad, _sink_event);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+
+  g_main_loop_run (loop);
+  fail_unless (have_eos == TRUE);
+  fail_unless_equals_int (received, N_FRAGMENTS * FRAGMENT_SIZE);
+  fail_unless_equals_int (buffering_percent, 100);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_object_unref (mysinkpad);
+  gst_object_unref (pipeline);
+  g_main_loop_unref (loop);
+  loop = NULL;
+
+  _remove_stream ();
+}
+
+GST_START_TEST (test_fetch)
+{
+  _run (1, FALSE, 0, 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_fetch_parallel)
+{
+  _run (4, FALSE, 0, 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_fetch_progressive)
+{
+  _run (1, TRUE, 0, 0);
+}
+
+GST_END_TEST;
+
+/* The cache limits are set between two fragment boundaries, so that in
+ * progressive mode playback starts in the middle of a fragment */
+GST_START_TEST (test_fetch_cache_size)
+{
+  _run (1, FALSE, 5 * FRAGMENT_SIZE / 2, 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_fetch_cache_duration)
+{
+  _run (1, FALSE, 0, 5 * GST_SECOND / 2);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_fetch_progressive_cache_size)
+{
+  _run (1, TRUE, 5 * FRAGMENT_SIZE / 2, 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_fetch_progressive_cache_duration)
+{
+  _run (1, TRUE, 0, 5 * GST_SECOND / 2);
+}
+
+GST_END_TEST;
+
+static Suite *
+hlsdemux_suite (void)
+{
+  Suite *s = suite_create ("hlsdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_fetch);
+  tcase_add_test (tc_chain, test_fetch_parallel);
+  tcase_add_test (tc_chain, test_fetch_progressive);
+  tcase_add_test (tc_chain, test_fetch_cache_size);
+  tcase_add_test (tc_chain, test_fetch_cache_duration);
+  tcase_add_test (tc_chain, test_fetch_progressive_cache_size);
+  tcase_add_test (tc_chain, test_fetch_progressive_cache_duration);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlsdemux);
@@ -0,0 +1,243 @@
+/* GStreamer
+ *
+ * unit test for hlssink
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <unistd.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+#include <glib/gstdio.h>
+
+/* The stream is made of one packet every 250ms, with a key unit every 3
+ * packets: with a target duration of 2 seconds, the key unit nearest to the
+ * target is the one at 2.25s, and the segments last 2.25s */
+#define PACKET_SIZE 188
+#define PACKET_DURATION (GST_SECOND / 4)
+#define KEY_UNIT_PACKETS 3
+#define SEGMENT_PACKETS 9
+#define MAX_REQUESTS 8
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstPad *mysrcpad;
+static GstClockTime requests[MAX_REQUESTS];
+static guint n_requests;
+
+static gboolean
+_src_event (GstPad * pad, GstEvent * event)
+{
+  GstClockTime running_time;
+
+  if (gst_video_event_is_force_key_unit (event) &&
+      gst_video_event_parse_upstream_force_key_unit (event, &running_time,
+          NULL, NULL) && n_requests < MAX_REQUESTS)
+    requests[n_requests++] = running_time;
+
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static GstElement *
+_setup_hlssink (guint memory_segments, const gchar * playlist)
+{
+  GstElement *hlssink;
+
+  n_requests = 0;
+
+  hlssink = gst_check_setup_element ("hlssink");
+  g_object_set (hlssink, "target-duration", 2, "write-segments", FALSE,
+      "memory-segments", memory_segments, "playlist-location", playlist,
+      NULL);
+
+  mysrcpad = gst_check_setup_src_pad (hlssink, &srctemplate, NULL);
+  gst_pad_set_event_function (mysrcpad, _src_event);
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  fail_unless (gst_element_set_state (hlssink, GST_STATE_PLAYING) ==
+      GST_STATE_CHANGE_SUCCESS);
+  fail_unless (gst_pad_push_event (mysrcpad,
+          gst_event_new_new_segment (FALSE, 1.0, GST_FORMAT_TIME, 0, -1, 0)));
+
+  return hlssink;
+}
+
+static void
+_cleanup_hlssink (GstElement * hlssink)
+{
+  gst_element_set_state (hlssink, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad (hlssink);
+  gst_check_teardown_element (hlssink);
+}
+
+static void
+_push_packets (guint first, guint n)
+{
+  GstBuffer *buffer;
+  guint i;
+
+  for (i = first; i < first + n; i++) {
+    buffer = gst_buffer_new_and_alloc (PACKET_SIZE);
+    memset (GST_BUFFER_DATA (buffer), i, PACKET_SIZE);
+    GST_BUFFER_TIMESTAMP (buffer) = i * PACKET_DURATION;
+    GST_BUFFER_DURATION (buffer) = PACKET_DURATION;
+    if (i % KEY_UNIT_PACKETS)
+      GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+    fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+  }
+}
+
+static void
+_check_segment (GstElement * hlssink, const gchar * location, guint first,
+    guint n)
+{
+  GstBuffer *buffer = NULL;
+  guint i;
+
+  g_signal_emit_by_name (hlssink, "get-segment", location, &buffer);
+  fail_unless (buffer != NULL);
+  fail_unless_equals_int (GST_BUFFER_SIZE (buffer), n * PACKET_SIZE);
+  for (i = 0; i < n; i++)
+    fail_unless_equals_int (GST_BUFFER_DATA (buffer)[i * PACKET_SIZE],
+        first + i);
+  gst_buffer_unref (buffer);
+}
+
+static void
+_check_no_segment (GstElement * hlssink, const gchar * location)
+{
+  GstBuffer *buffer = NULL;
+
+  g_signal_emit_by_name (hlssink, "get-segment", location, &buffer);
+  fail_unless (buffer == NULL);
+}
+
+GST_START_TEST (test_cut_on_nearest_key_unit)
+{
+  GstElement *hlssink;
+  GError *err = NULL;
+  gchar *filename = NULL, *contents, *playlist;
+  gint fd;
+
+  fd = g_file_open_tmp ("hlssink-XXXXXX.m3u8", &filename, &err);
+  fail_unless (fd >= 0, "Could not create temporary file: %s",
+      err ? err->message : "");
+  close (fd);
+
+  hlssink = _setup_hlssink (2, filename);
+
+  /* up to 6.5s, segments end at 2.25s and 4.5s */
+  _push_packets (0, 2 * SEGMENT_PACKETS + 8);
+
+  _check_segment (hlssink, "segment00000.ts", 0, SEGMENT_PACKETS);
+  _check_segment (hlssink, "segment00001.ts", SEGMENT_PACKETS,
+      SEGMENT_PACKETS);
+  _check_no_segment (hlssink, "segment00002.ts");
+
+  /* a key unit is requested target duration after each cut */
+  fail_unless_equals_int (n_requests, 3);
+  fail_unless_equals_uint64 (requests[0], 2 * GST_SECOND);
+  fail_unless_equals_uint64 (requests[1], 9 * PACKET_DURATION + 2 * GST_SECOND);
+  fail_unless_equals_uint64 (requests[2],
+      18 * PACKET_DURATION + 2 * GST_SECOND);
+
+  fail_unless (g_file_get_contents (filename, &contents, NULL, NULL));
+  g_object_get (hlssink, "playlist", &playlist, NULL);
+  fail_unless_equals_string (contents, playlist);
+  fail_unless (strstr (playlist, "#EXT-X-MEDIA-SEQUENCE:0\n") != NULL);
+  fail_unless (strstr (playlist, "#EXTINF:2,ciao\nsegment00000.ts\n"));
+  fail_unless (strstr (playlist, "#EXTINF:2,ciao\nsegment00001.ts\n"));
+  fail_unless (strstr (playlist, "segment00002.ts") == NULL);
+  g_free (contents);
+  g_free (playlist);
+
+  _cleanup_hlssink (hlssink);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_memory_segments)
+{
+  GstElement *hlssink;
+
+  hlssink = _setup_hlssink (1, NULL);
+
+  _push_packets (0, 2 * SEGMENT_PACKETS + 1);
+
+  /* only the last segment is kept */
+  _check_no_segment (hlssink, "segment00000.ts");
+  _check_segment (hlssink, "segment00001.ts", SEGMENT_PACKETS,
+      SEGMENT_PACKETS);
+
+  g_object_set (hlssink, "memory-segments", 0, NULL);
+  _check_no_segment (hlssink, "segment00001.ts");
+
+  _cleanup_hlssink (hlssink);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_force_key_unit_event)
+{
+  GstElement *hlssink;
+
+  hlssink = _setup_hlssink (3, NULL);
+
+  _push_packets (0, 4);
+
+  /* a key unit forced upstream at 1s ends the segment */
+  fail_unless (gst_pad_push_event (mysrcpad,
+          gst_video_event_new_downstream_force_key_unit (GST_SECOND,
+              GST_SECOND, GST_SECOND, TRUE, 1)));
+  _push_packets (4, 1);
+  _check_segment (hlssink, "segment00000.ts", 0, 4);
+
+  /* but not one too close to the previous cut */
+  gst_pad_push_event (mysrcpad,
+      gst_video_event_new_downstream_force_key_unit (5 * PACKET_DURATION,
+          5 * PACKET_DURATION, 5 * PACKET_DURATION, TRUE, 2));
+  _push_packets (5, 1);
+  _check_no_segment (hlssink, "segment00001.ts");
+
+  _cleanup_hlssink (hlssink);
+}
+
+GST_END_TEST;
+
+static Suite *
+hlssink_suite (void)
+{
+  Suite *s = suite_create ("hlssink");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_cut_on_nearest_key_unit);
+  tcase_add_test (tc_chain, test_memory_segments);
+  tcase_add_test (tc_chain, test_force_key_unit_event);
+
+  return s;
+}
+
+GST_CHECK_MAIN (hlssink);
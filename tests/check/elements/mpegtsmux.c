@@ -591,6 +591,366 @@ GST_START_TEST (test_force_key_unit_event_upstream)
 
 GST_END_TEST;
 
+GST_START_TEST (test_mux_rate)
+{
+  GstElement *mux;
+  GstBuffer *inbuffer;
+  GstCaps *caps;
+  gchar *padname;
+  gint i, packets = 0, null_packets = 0;
+
+  mux = setup_tsmux (&audio_src_template, "sink_%d", &padname);
+  /* 100 packets per second */
+  g_object_set (mux, "mux-rate", (guint64) 188 * 8 * 100, NULL);
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (AUDIO_CAPS_STRING);
+  for (i = 0; i < 2; i++) {
+    inbuffer = gst_buffer_new_and_alloc (1);
+    gst_buffer_set_caps (inbuffer, caps);
+    GST_BUFFER_TIMESTAMP (inbuffer) = i * GST_SECOND;
+    fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+  }
+  gst_caps_unref (caps);
+
+  while (buffers) {
+    GstBuffer *outbuffer = GST_BUFFER (buffers->data);
+    guint8 *data = GST_BUFFER_DATA (outbuffer);
+    gint size = GST_BUFFER_SIZE (outbuffer);
+
+    buffers = g_list_remove (buffers, outbuffer);
+    fail_unless (size % 188 == 0);
+    for (; size; data += 188, size -= 188) {
+      fail_unless (data[0] == 0x47);
+      if ((GST_READ_UINT16_BE (data + 1) & 0x1FFF) == 0x1FFF)
+        null_packets++;
+      packets++;
+    }
+    gst_buffer_unref (outbuffer);
+  }
+
+  /* the second buffer is sent one second, so about 100 packets, after the
+   * first one, with the gap filled up with null and PCR packets */
+  GST_DEBUG ("%d packets, %d null packets", packets, null_packets);
+  fail_unless (packets >= 100 && packets <= 106);
+  fail_unless (null_packets > 50);
+
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
+static gint64
+read_pes_ts (const guint8 * data)
+{
+  return ((gint64) (data[0] & 0x0e) << 29) | (data[1] << 22) |
+      ((data[2] & 0xfe) << 14) | (data[3] << 7) | (data[4] >> 1);
+}
+
+GST_START_TEST (test_video_reordered)
+{
+  /* I P B B in decoding order, with their presentation time */
+  static const GstClockTime pts[] = { 40, 160, 80, 120 };
+  static const guint8 aud[] = { 0x00, 0x00, 0x00, 0x01, 0x09, 0xf0 };
+  GstElement *mux;
+  GstBuffer *inbuffer;
+  GstCaps *caps;
+  gchar *padname;
+  gint64 pes_pts[4], pes_dts[4];
+  gint i, pes = 0;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  caps = gst_caps_from_string (VIDEO_CAPS_STRING);
+  for (i = 0; i < G_N_ELEMENTS (pts); i++) {
+    inbuffer = gst_buffer_new_and_alloc (sizeof (aud));
+    memcpy (GST_BUFFER_DATA (inbuffer), aud, sizeof (aud));
+    gst_buffer_set_caps (inbuffer, caps);
+    GST_BUFFER_TIMESTAMP (inbuffer) = pts[i] * GST_MSECOND;
+    GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+    fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+  }
+  gst_caps_unref (caps);
+
+  while (buffers) {
+    GstBuffer *outbuffer = GST_BUFFER (buffers->data);
+    guint8 *odata = GST_BUFFER_DATA (outbuffer);
+    gint size = GST_BUFFER_SIZE (outbuffer);
+
+    buffers = g_list_remove (buffers, outbuffer);
+    fail_unless (size % 188 == 0);
+    for (; size; odata += 188, size -= 188) {
+      guint8 *data = odata + 4;
+
+      fail_unless (odata[0] == 0x47);
+      /* only check packets with payload_start_indicator == 1 */
+      if (!(odata[1] & 0x40))
+        continue;
+      if (odata[3] & 0x20)
+        data += 1 + data[0];
+      if (GST_READ_UINT32_BE (data) != 0x1e0)
+        continue;
+
+      fail_unless (pes < G_N_ELEMENTS (pts));
+      /* PTS_DTS_flags */
+      fail_unless (data[7] & 0x80);
+      pes_pts[pes] = read_pes_ts (data + 9);
+      if (data[7] & 0x40)
+        pes_dts[pes] = read_pes_ts (data + 14);
+      else
+        pes_dts[pes] = pes_pts[pes];
+      pes++;
+    }
+    gst_buffer_unref (outbuffer);
+  }
+  fail_unless_equals_int (pes, G_N_ELEMENTS (pts));
+
+  /* the PTS are kept as they are, the DTS increase, one picture apart from
+   * one picture before the first PTS, and never come after the PTS */
+  for (i = 0; i < G_N_ELEMENTS (pts); i++) {
+    GST_DEBUG ("PES %d: pts %" G_GINT64_FORMAT " dts %" G_GINT64_FORMAT, i,
+        pes_pts[i], pes_dts[i]);
+    fail_unless_equals_int (pes_pts[i] - pes_pts[0], (pts[i] - pts[0]) * 90);
+    fail_unless_equals_int (pes_dts[i] - pes_pts[0], (i * 40 - 40) * 90);
+    fail_unless (pes_dts[i] <= pes_pts[i]);
+    if (i > 0)
+      fail_unless (pes_dts[i] > pes_dts[i - 1]);
+  }
+
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
+static const guint8 h264_sps[] = { 0x67, 0x4d, 0x40, 0x15, 0xec, 0xa4 };
+static const guint8 h264_pps[] = { 0x68, 0xeb, 0xec, 0xb2 };
+static const guint8 h264_aud[] = { 0x09, 0xf0 };
+static const guint8 h264_idr[] = { 0x65, 0x88, 0x84, 0x00, 0x10, 0xff };
+
+/* avcC with one SPS and one PPS */
+static GstBuffer *
+make_codec_data (guint nal_length_size)
+{
+  GstBuffer *buf;
+  guint8 *data;
+
+  buf = gst_buffer_new_and_alloc (11 + sizeof (h264_sps) + sizeof (h264_pps));
+  data = GST_BUFFER_DATA (buf);
+  data[0] = 0x01;
+  memcpy (data + 1, h264_sps + 1, 3);
+  data[4] = 0xfc | (nal_length_size - 1);
+  data[5] = 0xe1;
+  GST_WRITE_UINT16_BE (data + 6, sizeof (h264_sps));
+  memcpy (data + 8, h264_sps, sizeof (h264_sps));
+  data += 8 + sizeof (h264_sps);
+  data[0] = 0x01;
+  GST_WRITE_UINT16_BE (data + 1, sizeof (h264_pps));
+  memcpy (data + 3, h264_pps, sizeof (h264_pps));
+
+  return buf;
+}
+
+/* Appends @size bytes of @nal to @data, prefixed by its length coded on
+ * @nal_length_size bytes, or by a start code if @nal_length_size is 0 */
+static guint8 *
+append_nal (guint8 * data, const guint8 * nal, guint size,
+    guint nal_length_size)
+{
+  guint i;
+
+  if (nal_length_size == 0) {
+    GST_WRITE_UINT32_BE (data, 0x01);
+    nal_length_size = 4;
+  } else {
+    for (i = 0; i < nal_length_size; i++)
+      data[i] = size >> (8 * (nal_length_size - 1 - i));
+  }
+  memcpy (data + nal_length_size, nal, size);
+
+  return data + nal_length_size + size;
+}
+
+static GstBuffer *
+make_avc_frame (guint nal_length_size)
+{
+  GstBuffer *buf;
+  guint8 *data;
+
+  buf = gst_buffer_new_and_alloc (2 * nal_length_size + sizeof (h264_aud) +
+      sizeof (h264_idr));
+  data = GST_BUFFER_DATA (buf);
+  data = append_nal (data, h264_aud, sizeof (h264_aud), nal_length_size);
+  append_nal (data, h264_idr, sizeof (h264_idr), nal_length_size);
+
+  return buf;
+}
+
+/* Returns the payload of all the video PES packets in the output */
+static GByteArray *
+collect_video_es (void)
+{
+  GByteArray *es = g_byte_array_new ();
+  gint el_pid = -1;
+
+  while (buffers) {
+    GstBuffer *outbuffer = GST_BUFFER (buffers->data);
+    guint8 *odata = GST_BUFFER_DATA (outbuffer);
+    gint size = GST_BUFFER_SIZE (outbuffer);
+
+    buffers = g_list_remove (buffers, outbuffer);
+    fail_unless (size % 188 == 0);
+    for (; size; odata += 188, size -= 188) {
+      guint8 *data = odata + 4;
+      gint pid = GST_READ_UINT16_BE (odata + 1) & 0x1fff;
+
+      fail_unless (odata[0] == 0x47);
+      if (!(odata[3] & 0x10))
+        continue;
+      if (odata[3] & 0x20)
+        data += 1 + data[0];
+      if ((odata[1] & 0x40) && GST_READ_UINT32_BE (data) == 0x1e0) {
+        el_pid = pid;
+        /* skip the PES header */
+        data += 9 + data[8];
+      } else if (pid != el_pid) {
+        continue;
+      }
+      g_byte_array_append (es, data, odata + 188 - data);
+    }
+    gst_buffer_unref (outbuffer);
+  }
+
+  return es;
+}
+
+/* Pushes two frames with NAL lengths coded on @nal_length_size bytes, and
+ * checks that they are muxed as byte-stream with the SPS and PPS of the
+ * codec data in front of the first one */
+static void
+check_codec_data (guint nal_length_size)
+{
+  GstElement *mux;
+  GstBuffer *inbuffer, *shared, *cdata;
+  GstCaps *caps;
+  GByteArray *es;
+  guint8 expected[256], *data;
+  gchar *padname;
+  gint i;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  cdata = make_codec_data (nal_length_size);
+  caps = gst_caps_from_string ("video/x-h264, stream-format = (string) avc, "
+      "alignment = (string) au");
+  gst_caps_set_simple (caps, "codec_data", GST_TYPE_BUFFER, cdata, NULL);
+  gst_buffer_unref (cdata);
+
+  for (i = 0; i < 2; i++) {
+    inbuffer = make_avc_frame (nal_length_size);
+    gst_buffer_set_caps (inbuffer, caps);
+    GST_BUFFER_TIMESTAMP (inbuffer) = i * 40 * GST_MSECOND;
+    GST_BUFFER_DURATION (inbuffer) = 40 * GST_MSECOND;
+
+    /* the first frame is still referenced here, so it must not be
+     * converted in place, and the muxer must drop all its references to the
+     * input and prepared buffers */
+    shared = i == 0 ? gst_buffer_ref (inbuffer) : NULL;
+    fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+    if (shared) {
+      inbuffer = make_avc_frame (nal_length_size);
+      fail_unless (memcmp (GST_BUFFER_DATA (shared),
+              GST_BUFFER_DATA (inbuffer), GST_BUFFER_SIZE (inbuffer)) == 0);
+      gst_buffer_unref (inbuffer);
+      ASSERT_BUFFER_REFCOUNT (shared, "shared", 1);
+      gst_buffer_unref (shared);
+    }
+  }
+  gst_caps_unref (caps);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  data = expected;
+  data = append_nal (data, h264_sps, sizeof (h264_sps), 0);
+  data = append_nal (data, h264_pps, sizeof (h264_pps), 0);
+  for (i = 0; i < 2; i++) {
+    data = append_nal (data, h264_aud, sizeof (h264_aud), 0);
+    data = append_nal (data, h264_idr, sizeof (h264_idr), 0);
+  }
+
+  es = collect_video_es ();
+  fail_unless_equals_int (es->len, data - expected);
+  fail_unless (memcmp (es->data, expected, es->len) == 0);
+  g_byte_array_free (es, TRUE);
+
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_START_TEST (test_video_codec_data)
+{
+  check_codec_data (4);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_video_codec_data_short_lengths)
+{
+  check_codec_data (2);
+}
+
+GST_END_TEST;
+
+/* A buffer whose NAL lengths run past its end is muxed unconverted */
+GST_START_TEST (test_video_codec_data_broken_nal)
+{
+  GstElement *mux;
+  GstBuffer *inbuffer, *cdata, *expected;
+  GstCaps *caps;
+  GByteArray *es;
+  gchar *padname;
+
+  mux = setup_tsmux (&video_src_template, "sink_%d", &padname);
+  fail_unless (gst_element_set_state (mux,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  cdata = make_codec_data (4);
+  caps = gst_caps_from_string ("video/x-h264, stream-format = (string) avc, "
+      "alignment = (string) au");
+  gst_caps_set_simple (caps, "codec_data", GST_TYPE_BUFFER, cdata, NULL);
+  gst_buffer_unref (cdata);
+
+  inbuffer = make_avc_frame (4);
+  GST_WRITE_UINT32_BE (GST_BUFFER_DATA (inbuffer) + 4 + sizeof (h264_aud),
+      sizeof (h264_idr) + 1);
+  expected = gst_buffer_copy (inbuffer);
+  gst_buffer_set_caps (inbuffer, caps);
+  gst_caps_unref (caps);
+  GST_BUFFER_TIMESTAMP (inbuffer) = 0;
+  fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  es = collect_video_es ();
+  fail_unless_equals_int (es->len, GST_BUFFER_SIZE (expected));
+  fail_unless (memcmp (es->data, GST_BUFFER_DATA (expected), es->len) == 0);
+  g_byte_array_free (es, TRUE);
+  gst_buffer_unref (expected);
+
+  cleanup_tsmux (mux, padname);
+  g_free (padname);
+}
+
+GST_END_TEST;
+
 static Suite *
 mpegtsmux_suite (void)
 {
@@ -601,8 +961,13 @@ mpegtsmux_suite (void)
 
   tcase_add_test (tc_chain, test_audio);
   tcase_add_test (tc_chain, test_video);
+  tcase_add_test (tc_chain, test_video_reordered);
+  tcase_add_test (tc_chain, test_video_codec_data);
+  tcase_add_test (tc_chain, test_video_codec_data_short_lengths);
+  tcase_add_test (tc_chain, test_video_codec_data_broken_nal);
   tcase_add_test (tc_chain, test_force_key_unit_event_downstream);
   tcase_add_test (tc_chain, test_force_key_unit_event_upstream);
+  tcase_add_test (tc_chain, test_mux_rate);
 
   return s;
 }
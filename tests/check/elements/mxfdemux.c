@@ -21,14 +21,23 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
 #include <string.h>
+#include <unistd.h>
 #include "mxfdemux.h"
+#include "mxftypes.h"
+
+GST_DEBUG_CATEGORY (mxf_debug);
 
 static GstPad *mysrcpad, *mysinkpad;
 static GMainLoop *loop = NULL;
 static gboolean have_eos = FALSE;
 static gboolean have_data = FALSE;
 
+/* file served by the pull mode source pad */
+static const guint8 *src_data = mxf_file;
+static gsize src_size = sizeof (mxf_file);
+
 static GstStaticPadTemplate mysrctemplate =
 GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
     GST_STATIC_CAPS ("application/mxf"));
@@ -114,18 +123,33 @@ _create_src_pad_push (void)
   return mysrcpad;
 }
 
+/* seek tests: the first pull after the seek started within
+ * [range_start, range_end), or -1 */
+static GMutex *seek_mutex = NULL;
+static GCond *seek_cond = NULL;
+static gboolean seek_flushing;
+static guint64 range_start, range_end, first_range_pull;
+
 static GstFlowReturn
 _src_getrange (GstPad * pad, guint64 offset, guint length, GstBuffer ** buffer)
 {
   GstCaps *caps;
 
-  if (offset + length > sizeof (mxf_file))
+  if (seek_mutex) {
+    g_mutex_lock (seek_mutex);
+    if (seek_flushing && first_range_pull == -1 && offset >= range_start &&
+        offset < range_end)
+      first_range_pull = offset;
+    g_mutex_unlock (seek_mutex);
+  }
+
+  if (offset + length > src_size)
     return GST_FLOW_UNEXPECTED;
 
   caps = gst_caps_new_simple ("application/mxf", NULL);
 
   *buffer = gst_buffer_new ();
-  GST_BUFFER_DATA (*buffer) = (guint8 *) (mxf_file + offset);
+  GST_BUFFER_DATA (*buffer) = (guint8 *) (src_data + offset);
   GST_BUFFER_SIZE (*buffer) = length;
   gst_buffer_set_caps (*buffer, caps);
   gst_caps_unref (caps);
@@ -146,7 +170,7 @@ _src_query (GstPad * pad, GstQuery * query)
   if (fmt != GST_FORMAT_BYTES)
     return FALSE;
 
-  gst_query_set_duration (query, fmt, sizeof (mxf_file));
+  gst_query_set_duration (query, fmt, src_size);
 
   return TRUE;
 }
@@ -161,7 +185,8 @@ _create_src_pad_pull (void)
   return mysrcpad;
 }
 
-GST_START_TEST (test_pull)
+static void
+_run_pull (gboolean sequential_tracks)
 {
   GstElement *mxfdemux;
   GstPad *sinkpad;
@@ -172,6 +197,7 @@ GST_START_TEST (test_pull)
 
   mxfdemux = gst_element_factory_make ("mxfdemux", NULL);
   fail_unless (mxfdemux != NULL);
+  g_object_set (mxfdemux, "sequential-tracks", sequential_tracks, NULL);
   g_signal_connect (mxfdemux, "pad-added", G_CALLBACK (_pad_added), NULL);
   sinkpad = gst_element_get_static_pad (mxfdemux, "sink");
   fail_unless (sinkpad != NULL);
@@ -204,6 +230,722 @@ GST_START_TEST (test_pull)
   loop = NULL;
 }
 
+GST_START_TEST (test_pull)
+{
+  _run_pull (FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pull_sequential_tracks)
+{
+  _run_pull (TRUE);
+}
+
+GST_END_TEST;
+
+/* The multi-track file has N_TRACKS audio tracks of TRACK_SIZE bytes
+ * each, written by mxfmux from a byte counter, so that every pad can check
+ * that its data comes out whole and in order */
+#define N_TRACKS 2
+#define TRACK_RATE 8000
+#define TRACK_BUFFERS 30
+#define TRACK_BUFFER_SIZE (TRACK_RATE / 10)
+#define TRACK_SIZE (TRACK_BUFFERS * TRACK_BUFFER_SIZE)
+
+typedef struct
+{
+  guint8 next;
+  guint64 bytes;
+  GstClockTime last_ts;
+} TrackState;
+
+static TrackState tracks[N_TRACKS];
+static gint n_track_pads;
+static gint n_track_eos;
+
+static gchar *
+_create_multi_track_file (gint n_tracks, gsize * size)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstBus *bus;
+  GString *desc;
+  GError *err = NULL;
+  gchar *filename, *data;
+  gint fd, i;
+
+  fd = g_file_open_tmp ("mxfdemux-XXXXXX.mxf", &filename, &err);
+  fail_unless (fd >= 0, "Could not create temporary file: %s",
+      err ? err->message : "");
+  close (fd);
+
+  desc = g_string_new (NULL);
+  g_string_append_printf (desc, "mxfmux name=mux ! filesink location=\"%s\" ",
+      filename);
+  for (i = 0; i < n_tracks; i++) {
+    g_string_append_printf (desc, "fakesrc num-buffers=%d sizetype=fixed "
+        "sizemax=%d filltype=pattern-span datarate=%d format=time ! "
+        "audio/x-raw-int, rate=(int)%d, channels=(int)1, "
+        "signed=(boolean)false, endianness=(int)1234, width=(int)8, "
+        "depth=(int)8 ! mux. ", TRACK_BUFFERS, TRACK_BUFFER_SIZE, TRACK_RATE,
+        TRACK_RATE);
+  }
+
+  pipeline = gst_parse_launch (desc->str, &err);
+  fail_unless (pipeline != NULL, "Could not create pipeline: %s",
+      err ? err->message : "");
+  g_string_free (desc, TRUE);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  fail_unless (g_file_get_contents (filename, &data, size, NULL));
+  g_unlink (filename);
+  g_free (filename);
+
+  return data;
+}
+
+static GstFlowReturn
+_track_chain (GstPad * pad, GstBuffer * buffer)
+{
+  TrackState *track = gst_pad_get_element_private (pad);
+  guint i;
+
+  fail_unless (GST_BUFFER_TIMESTAMP_IS_VALID (buffer));
+  if (GST_CLOCK_TIME_IS_VALID (track->last_ts))
+    fail_unless (GST_BUFFER_TIMESTAMP (buffer) >= track->last_ts);
+  track->last_ts = GST_BUFFER_TIMESTAMP (buffer);
+
+  for (i = 0; i < GST_BUFFER_SIZE (buffer); i++) {
+    fail_unless_equals_int (GST_BUFFER_DATA (buffer)[i], track->next);
+    track->next++;
+  }
+  track->bytes += GST_BUFFER_SIZE (buffer);
+
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+_track_event (GstPad * pad, GstEvent * event)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_EOS &&
+      g_atomic_int_exchange_and_add (&n_track_eos, 1) == N_TRACKS - 1) {
+    while (!g_main_loop_is_running (loop));
+
+    have_eos = TRUE;
+    g_main_loop_quit (loop);
+  }
+
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static void
+_track_pad_added (GstElement * element, GstPad * pad, gpointer user_data)
+{
+  GstPad *sinkpad;
+  gint i = n_track_pads++;
+
+  fail_unless (i < N_TRACKS);
+
+  sinkpad = gst_pad_new_from_static_template (&mysinktemplate, "sink");
+  gst_pad_set_chain_function (sinkpad, _track_chain);
+  gst_pad_set_event_function (sinkpad, _track_event);
+  gst_pad_set_element_private (sinkpad, &tracks[i]);
+  gst_pad_set_active (sinkpad, TRUE);
+  fail_unless (gst_pad_link (pad, sinkpad) == GST_PAD_LINK_OK);
+
+  /* the link keeps the pad alive */
+  gst_object_unref (sinkpad);
+}
+
+static void
+_run_pull_multi_track (gboolean sequential_tracks)
+{
+  GstElement *mxfdemux;
+  GstPad *sinkpad;
+  gchar *data;
+  gsize size;
+  gint i;
+
+  data = _create_multi_track_file (N_TRACKS, &size);
+  src_data = (const guint8 *) data;
+  src_size = size;
+
+  have_eos = FALSE;
+  n_track_pads = 0;
+  n_track_eos = 0;
+  for (i = 0; i < N_TRACKS; i++) {
+    tracks[i].next = 0;
+    tracks[i].bytes = 0;
+    tracks[i].last_ts = GST_CLOCK_TIME_NONE;
+  }
+  loop = g_main_loop_new (NULL, FALSE);
+
+  mxfdemux = gst_element_factory_make ("mxfdemux", NULL);
+  fail_unless (mxfdemux != NULL);
+  /* less than the duration of a track, so that the tracks are read in
+   * several runs in sequential mode */
+  g_object_set (mxfdemux, "sequential-tracks", sequential_tracks,
+      "max-drift", (guint64) GST_SECOND / 2, NULL);
+  g_signal_connect (mxfdemux, "pad-added", G_CALLBACK (_track_pad_added),
+      NULL);
+  sinkpad = gst_element_get_static_pad (mxfdemux, "sink");
+  fail_unless (sinkpad != NULL);
+
+  mysrcpad = _create_src_pad_pull ();
+  fail_unless (mysrcpad != NULL);
+  fail_unless (gst_pad_link (mysrcpad, sinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  gst_element_set_state (mxfdemux, GST_STATE_PLAYING);
+
+  g_main_loop_run (loop);
+  fail_unless (have_eos == TRUE);
+  fail_unless_equals_int (n_track_pads, N_TRACKS);
+  for (i = 0; i < N_TRACKS; i++)
+    fail_unless_equals_int (tracks[i].bytes, TRACK_SIZE);
+
+  gst_element_set_state (mxfdemux, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+
+  gst_object_unref (mxfdemux);
+  gst_object_unref (mysrcpad);
+  g_main_loop_unref (loop);
+  loop = NULL;
+
+  src_data = mxf_file;
+  src_size = sizeof (mxf_file);
+  g_free (data);
+}
+
+GST_START_TEST (test_pull_multi_track)
+{
+  _run_pull_multi_track (FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pull_sequential_tracks_multi_track)
+{
+  _run_pull_multi_track (TRUE);
+}
+
+GST_END_TEST;
+
+/* The indexed files have a single track written by mxfmux. Its index table
+ * segments are replaced by ones in one of the variants below, and the
+ * partition packs are followed by KLV fill up to the KAG */
+typedef enum
+{
+  /* a single segment with a constant edit unit byte count */
+  INDEX_CBE,
+  /* two segments with an entry per edit unit, and a random access point
+   * every INDEX_KEY_UNITS edit units */
+  INDEX_PER_ENTRY,
+  /* entries and delta entries, a system item precedes the essence element
+   * of each content package */
+  INDEX_DELTA_ENTRIES
+} IndexVariant;
+
+#define INDEX_SID 2
+#define INDEX_KAG 512
+#define INDEX_KEY_UNITS 10
+#define SYSTEM_ITEM_SIZE (16 + 1 + 8)
+
+typedef struct
+{
+  /* file offsets of the essence elements */
+  GArray *element_offsets;
+  /* start of the second content package and of the footer partition */
+  guint64 second_unit;
+  guint64 footer_partition;
+  guint element_size;
+  MXFFraction edit_rate;
+} IndexedFile;
+
+static gboolean seek_done;
+static gboolean have_first_buffer;
+static gboolean have_seek_buffer;
+static GstClockTime seek_buffer_ts;
+static guint seek_buffer_size;
+static guint8 seek_buffer_byte;
+static GstPad *demux_pad;
+
+/* Returns the size of the key and BER length of a KLV packet, 0 if they
+ * don't fit */
+static guint
+_read_klv_header (const guint8 * data, gsize size, MXFUL * key,
+    guint64 * length)
+{
+  guint i, n;
+
+  if (size < 17)
+    return 0;
+
+  memcpy (key, data, 16);
+  if (!(data[16] & 0x80)) {
+    *length = data[16];
+    return 17;
+  }
+
+  n = data[16] & 0x7f;
+  if (n > 8 || size < 17 + n)
+    return 0;
+
+  *length = 0;
+  for (i = 0; i < n; i++)
+    *length = (*length << 8) | data[17 + i];
+
+  return 17 + n;
+}
+
+/* Appends fill up to the next KAG of the partition starting at
+ * @partition */
+static void
+_append_kag_fill (GByteArray * out, guint64 partition)
+{
+  guint8 header[20];
+  guint size = INDEX_KAG - (out->len - partition) % INDEX_KAG;
+  guint len = out->len;
+
+  if (size < sizeof (header))
+    size += INDEX_KAG;
+  size -= sizeof (header);
+
+  memcpy (header, MXF_UL (FILL), 16);
+  header[16] = 0x83;
+  header[17] = (size >> 16) & 0xff;
+  header[18] = (size >> 8) & 0xff;
+  header[19] = size & 0xff;
+  g_byte_array_append (out, header, sizeof (header));
+  g_byte_array_set_size (out, out->len + size);
+  memset (out->data + len + sizeof (header), 0, size);
+}
+
+static void
+_append_system_item (GByteArray * out)
+{
+  static const guint8 system_item[SYSTEM_ITEM_SIZE] = {
+    /* CP-compatible system item */
+    0x06, 0x0e, 0x2b, 0x34, 0x02, 0x05, 0x01, 0x01,
+    0x0d, 0x01, 0x03, 0x01, 0x04, 0x01, 0x01, 0x00,
+    0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00
+  };
+
+  g_byte_array_append (out, system_item, sizeof (system_item));
+}
+
+static void
+_append_buffer (GByteArray * out, GstBuffer * buffer)
+{
+  g_byte_array_append (out, GST_BUFFER_DATA (buffer), GST_BUFFER_SIZE (buffer));
+  gst_buffer_unref (buffer);
+}
+
+/* Overwrites the partition pack at @offset */
+static void
+_write_partition_pack (GByteArray * out, guint64 offset,
+    const MXFPartitionPack * pack)
+{
+  GstBuffer *buffer = mxf_partition_pack_to_buffer (pack);
+
+  fail_unless (offset + GST_BUFFER_SIZE (buffer) <= out->len);
+  memcpy (out->data + offset, GST_BUFFER_DATA (buffer),
+      GST_BUFFER_SIZE (buffer));
+  gst_buffer_unref (buffer);
+}
+
+static void
+_parse_index_edit_rate (const guint8 * data, guint64 size, MXFFraction * rate)
+{
+  while (size >= 4) {
+    guint16 tag = GST_READ_UINT16_BE (data);
+    guint16 tag_size = GST_READ_UINT16_BE (data + 2);
+
+    if (4 + tag_size > size)
+      break;
+    if (tag == 0x3f0b && tag_size == 8) {
+      rate->n = GST_READ_UINT32_BE (data + 4);
+      rate->d = GST_READ_UINT32_BE (data + 8);
+    }
+    data += 4 + tag_size;
+    size -= 4 + tag_size;
+  }
+}
+
+static void
+_append_index_table_segments (GByteArray * out, IndexVariant variant,
+    const IndexedFile * file, guint32 body_sid, GArray * unit_offsets,
+    guint64 essence_offset)
+{
+  MXFIndexTableSegment segment;
+  MXFIndexEntry *entries;
+  MXFDeltaEntry delta_entries[2];
+  guint i, n = unit_offsets->len, half = (n + 1) / 2;
+
+  memset (&segment, 0, sizeof (segment));
+  segment.index_edit_rate = file->edit_rate;
+  segment.index_sid = INDEX_SID;
+  segment.body_sid = body_sid;
+
+  if (variant == INDEX_CBE) {
+    mxf_uuid_init (&segment.instance_id, NULL);
+    segment.index_duration = n;
+    segment.edit_unit_byte_count = g_array_index (unit_offsets, guint64, 1) -
+        g_array_index (unit_offsets, guint64, 0);
+    _append_buffer (out, mxf_index_table_segment_to_buffer (&segment));
+    return;
+  }
+
+  entries = g_new0 (MXFIndexEntry, n);
+  for (i = 0; i < n; i++) {
+    entries[i].stream_offset =
+        g_array_index (unit_offsets, guint64, i) - essence_offset;
+    if (variant == INDEX_DELTA_ENTRIES || i % INDEX_KEY_UNITS == 0)
+      entries[i].flags = 0x80;
+    else
+      entries[i].key_frame_offset = -(gint) (i % INDEX_KEY_UNITS);
+  }
+
+  if (variant == INDEX_DELTA_ENTRIES) {
+    /* the system item, then the essence element */
+    memset (delta_entries, 0, sizeof (delta_entries));
+    delta_entries[1].element_delta = SYSTEM_ITEM_SIZE;
+    segment.n_delta_entries = 2;
+    segment.delta_entries = delta_entries;
+  }
+
+  for (i = 0; i < n; i += half) {
+    mxf_uuid_init (&segment.instance_id, NULL);
+    segment.index_start_position = i;
+    segment.index_duration = MIN (half, n - i);
+    segment.n_index_entries = segment.index_duration;
+    segment.index_entries = entries + i;
+    _append_buffer (out, mxf_index_table_segment_to_buffer (&segment));
+  }
+
+  g_free (entries);
+}
+
+static gchar *
+_create_indexed_file (IndexVariant variant, IndexedFile * file, gsize * size)
+{
+  MXFPartitionPack header, body, footer;
+  MXFRandomIndexPackEntry rip_entry;
+  GArray *unit_offsets, *rip;
+  GByteArray *out;
+  guint64 offset = 0, length, essence_offset = 0, metadata_start = 0;
+  guint64 body_partition = 0, footer_partition = 0, index_start, tmp;
+  gboolean after_partition = FALSE;
+  gsize in_size;
+  gchar *in;
+  guint hlen;
+  MXFUL key;
+
+  memset (&header, 0, sizeof (header));
+  memset (&body, 0, sizeof (body));
+  memset (&footer, 0, sizeof (footer));
+  memset (file, 0, sizeof (IndexedFile));
+  file->element_offsets = g_array_new (FALSE, FALSE, sizeof (guint64));
+  unit_offsets = g_array_new (FALSE, FALSE, sizeof (guint64));
+  out = g_byte_array_new ();
+
+  in = _create_multi_track_file (1, &in_size);
+  while (offset < in_size) {
+    const guint8 *klv = (const guint8 *) in + offset;
+
+    hlen = _read_klv_header (klv, in_size - offset, &key, &length);
+    fail_unless (hlen > 0 && offset + hlen + length <= in_size);
+
+    if (mxf_is_partition_pack (&key)) {
+      MXFPartitionPack pack;
+
+      fail_unless (mxf_partition_pack_parse (&key, &pack, klv + hlen, length));
+      pack.kag_size = INDEX_KAG;
+      if (pack.type == MXF_PARTITION_PACK_HEADER) {
+        fail_unless_equals_int (out->len, 0);
+        header = pack;
+        g_byte_array_append (out, klv, hlen + length);
+        _append_kag_fill (out, 0);
+      } else if (pack.type == MXF_PARTITION_PACK_BODY) {
+        body = pack;
+        body_partition = out->len;
+        g_byte_array_append (out, klv, hlen + length);
+        _append_kag_fill (out, body_partition);
+      } else {
+        footer = pack;
+        footer_partition = out->len;
+        g_byte_array_append (out, klv, hlen + length);
+        _append_kag_fill (out, footer_partition);
+        metadata_start = out->len;
+      }
+    } else if (mxf_is_generic_container_essence_element (&key)) {
+      tmp = out->len;
+      if (essence_offset == 0)
+        essence_offset = tmp;
+      g_array_append_val (unit_offsets, tmp);
+      if (variant == INDEX_DELTA_ENTRIES)
+        _append_system_item (out);
+      tmp = out->len;
+      g_array_append_val (file->element_offsets, tmp);
+      file->element_size = length;
+      g_byte_array_append (out, klv, hlen + length);
+    } else if (mxf_is_index_table_segment (&key)) {
+      /* replaced below */
+      _parse_index_edit_rate (klv + hlen, length, &file->edit_rate);
+    } else if (mxf_is_fill (&key) && after_partition) {
+      /* replaced by the KAG fill */
+    } else if (!mxf_is_random_index_pack (&key)) {
+      /* primer pack, header metadata and fill */
+      g_byte_array_append (out, klv, hlen + length);
+    }
+
+    after_partition = mxf_is_partition_pack (&key) ||
+        (after_partition && mxf_is_fill (&key));
+    offset += hlen + length;
+  }
+  g_free (in);
+
+  fail_unless (footer_partition > body_partition);
+  fail_unless (unit_offsets->len >= 3 * INDEX_KEY_UNITS);
+  fail_unless (file->edit_rate.n > 0 && file->edit_rate.d > 0);
+
+  /* the header metadata of the footer partition ends where the index table
+   * segments start */
+  index_start = out->len;
+  fail_unless_equals_uint64 (index_start - metadata_start,
+      footer.header_byte_count);
+  _append_index_table_segments (out, variant, file, body.body_sid,
+      unit_offsets, essence_offset);
+
+  header.prev_partition = 0;
+  header.footer_partition = footer_partition;
+  _write_partition_pack (out, 0, &header);
+  body.this_partition = body_partition;
+  body.prev_partition = 0;
+  body.footer_partition = footer_partition;
+  _write_partition_pack (out, body_partition, &body);
+  footer.this_partition = footer_partition;
+  footer.prev_partition = body_partition;
+  footer.footer_partition = footer_partition;
+  footer.index_byte_count = out->len - index_start;
+  footer.index_sid = INDEX_SID;
+  _write_partition_pack (out, footer_partition, &footer);
+
+  rip = g_array_new (FALSE, FALSE, sizeof (MXFRandomIndexPackEntry));
+  rip_entry.offset = 0;
+  rip_entry.body_sid = 0;
+  g_array_append_val (rip, rip_entry);
+  rip_entry.offset = body_partition;
+  rip_entry.body_sid = body.body_sid;
+  g_array_append_val (rip, rip_entry);
+  rip_entry.offset = footer_partition;
+  rip_entry.body_sid = 0;
+  g_array_append_val (rip, rip_entry);
+  _append_buffer (out, mxf_random_index_pack_to_buffer (rip));
+  g_array_free (rip, TRUE);
+
+  file->second_unit = g_array_index (unit_offsets, guint64, 1);
+  file->footer_partition = footer_partition;
+
+  mxf_partition_pack_reset (&header);
+  mxf_partition_pack_reset (&body);
+  mxf_partition_pack_reset (&footer);
+  g_array_free (unit_offsets, TRUE);
+
+  *size = out->len;
+  return (gchar *) g_byte_array_free (out, FALSE);
+}
+
+static GstFlowReturn
+_seek_chain (GstPad * pad, GstBuffer * buffer)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  g_mutex_lock (seek_mutex);
+  if (!seek_done) {
+    /* hold the first buffer back until the seek flushes it */
+    have_first_buffer = TRUE;
+    g_cond_broadcast (seek_cond);
+    while (!seek_flushing)
+      g_cond_wait (seek_cond, seek_mutex);
+    ret = GST_FLOW_WRONG_STATE;
+  } else if (!have_seek_buffer) {
+    seek_buffer_ts = GST_BUFFER_TIMESTAMP (buffer);
+    seek_buffer_size = GST_BUFFER_SIZE (buffer);
+    seek_buffer_byte = GST_BUFFER_DATA (buffer)[0];
+    have_seek_buffer = TRUE;
+    g_cond_broadcast (seek_cond);
+  }
+  g_mutex_unlock (seek_mutex);
+
+  gst_buffer_unref (buffer);
+
+  return ret;
+}
+
+static gboolean
+_seek_sink_event (GstPad * pad, GstEvent * event)
+{
+  g_mutex_lock (seek_mutex);
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_START) {
+    seek_flushing = TRUE;
+    g_cond_broadcast (seek_cond);
+  } else if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+    seek_done = TRUE;
+  }
+  g_mutex_unlock (seek_mutex);
+
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static void
+_seek_pad_added (GstElement * element, GstPad * pad, gpointer user_data)
+{
+  fail_unless (gst_pad_link (pad, mysinkpad) == GST_PAD_LINK_OK);
+
+  g_mutex_lock (seek_mutex);
+  demux_pad = gst_object_ref (pad);
+  g_mutex_unlock (seek_mutex);
+}
+
+/* Seeks to an edit unit that wasn't read yet, its essence element must be
+ * pulled from the offset given by the index tables without reading the
+ * ones before it */
+static void
+_run_pull_seek (IndexVariant variant)
+{
+  GstElement *mxfdemux;
+  GstPad *sinkpad;
+  GstEvent *event;
+  GstSeekFlags flags = GST_SEEK_FLAG_FLUSH;
+  IndexedFile file;
+  gint64 target, seek_unit;
+  gchar *data;
+  gsize size;
+
+  data = _create_indexed_file (variant, &file, &size);
+  src_data = (const guint8 *) data;
+  src_size = size;
+
+  /* a key unit seek goes back to the last random access point */
+  target = 2 * INDEX_KEY_UNITS;
+  seek_unit = target;
+  if (variant == INDEX_PER_ENTRY) {
+    flags |= GST_SEEK_FLAG_KEY_UNIT;
+    seek_unit += INDEX_KEY_UNITS / 2;
+  }
+
+  seek_mutex = g_mutex_new ();
+  seek_cond = g_cond_new ();
+  seek_flushing = FALSE;
+  seek_done = FALSE;
+  have_first_buffer = FALSE;
+  have_seek_buffer = FALSE;
+  demux_pad = NULL;
+  range_start = file.second_unit;
+  range_end = file.footer_partition;
+  first_range_pull = -1;
+
+  mxfdemux = gst_element_factory_make ("mxfdemux", NULL);
+  fail_unless (mxfdemux != NULL);
+  g_signal_connect (mxfdemux, "pad-added", G_CALLBACK (_seek_pad_added),
+      NULL);
+  sinkpad = gst_element_get_static_pad (mxfdemux, "sink");
+  fail_unless (sinkpad != NULL);
+
+  mysinkpad = gst_pad_new_from_static_template (&mysinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, _seek_chain);
+  gst_pad_set_event_function (mysinkpad, _seek_sink_event);
+  mysrcpad = _create_src_pad_pull ();
+  fail_unless (gst_pad_link (mysrcpad, sinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+
+  gst_pad_set_active (mysinkpad, TRUE);
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  gst_element_set_state (mxfdemux, GST_STATE_PLAYING);
+
+  g_mutex_lock (seek_mutex);
+  while (!have_first_buffer)
+    g_cond_wait (seek_cond, seek_mutex);
+  g_mutex_unlock (seek_mutex);
+
+  event = gst_event_new_seek (1.0, GST_FORMAT_TIME, flags, GST_SEEK_TYPE_SET,
+      gst_util_uint64_scale (seek_unit, GST_SECOND * file.edit_rate.d,
+          file.edit_rate.n), GST_SEEK_TYPE_NONE, -1);
+  fail_unless (gst_pad_send_event (demux_pad, event));
+
+  g_mutex_lock (seek_mutex);
+  while (!have_seek_buffer)
+    g_cond_wait (seek_cond, seek_mutex);
+  g_mutex_unlock (seek_mutex);
+
+  gst_element_set_state (mxfdemux, GST_STATE_NULL);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_pad_set_active (mysrcpad, FALSE);
+
+  fail_unless_equals_uint64 (first_range_pull,
+      g_array_index (file.element_offsets, guint64, target));
+  fail_unless_equals_uint64 (seek_buffer_ts,
+      gst_util_uint64_scale (target, GST_SECOND * file.edit_rate.d,
+          file.edit_rate.n));
+  fail_unless_equals_int (seek_buffer_size, file.element_size);
+  fail_unless_equals_int (seek_buffer_byte,
+      (target * file.element_size) & 0xff);
+
+  gst_object_unref (demux_pad);
+  gst_object_unref (mxfdemux);
+  gst_object_unref (mysinkpad);
+  gst_object_unref (mysrcpad);
+  g_mutex_free (seek_mutex);
+  g_cond_free (seek_cond);
+  seek_mutex = NULL;
+  seek_cond = NULL;
+
+  src_data = mxf_file;
+  src_size = sizeof (mxf_file);
+  g_array_free (file.element_offsets, TRUE);
+  g_free (data);
+}
+
+GST_START_TEST (test_pull_seek_index_cbe)
+{
+  _run_pull_seek (INDEX_CBE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pull_seek_index_per_entry)
+{
+  _run_pull_seek (INDEX_PER_ENTRY);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_pull_seek_index_delta_entries)
+{
+  _run_pull_seek (INDEX_DELTA_ENTRIES);
+}
+
 GST_END_TEST;
 
 GST_START_TEST (test_push)
@@ -262,9 +1004,17 @@ mxfdemux_suite (void)
   Suite *s = suite_create ("mxfdemux");
   TCase *tc_chain = tcase_create ("general");
 
+  GST_DEBUG_CATEGORY_INIT (mxf_debug, "mxf", 0, "MXF");
+
   suite_add_tcase (s, tc_chain);
   tcase_set_timeout (tc_chain, 180);
   tcase_add_test (tc_chain, test_pull);
+  tcase_add_test (tc_chain, test_pull_sequential_tracks);
+  tcase_add_test (tc_chain, test_pull_multi_track);
+  tcase_add_test (tc_chain, test_pull_sequential_tracks_multi_track);
+  tcase_add_test (tc_chain, test_pull_seek_index_cbe);
+  tcase_add_test (tc_chain, test_pull_seek_index_per_entry);
+  tcase_add_test (tc_chain, test_pull_seek_index_delta_entries);
   tcase_add_test (tc_chain, test_push);
 
   return s;
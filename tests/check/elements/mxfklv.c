@@ -0,0 +1,304 @@
+/* GStreamer
+ *
+ * unit test for the MXF KLV key classification
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+
+#include "mxftypes.h"
+
+GST_DEBUG_CATEGORY (mxf_debug);
+
+#define STREAM_FRAMES 100000
+#define FRAMES_PER_PARTITION 250
+#define BENCHMARK_RUNS 5
+
+/* the predicate chain gst_mxf_demux_handle_klv_packet() used before
+ * mxf_klv_packet_type(), to compare against */
+static MXFKLVPacketType
+chain_klv_packet_type (const MXFUL * key)
+{
+  if (!mxf_is_mxf_packet (key))
+    return MXF_KLV_PACKET_TYPE_NON_MXF;
+  else if (mxf_is_partition_pack (key))
+    return MXF_KLV_PACKET_TYPE_PARTITION_PACK;
+  else if (mxf_is_primer_pack (key))
+    return MXF_KLV_PACKET_TYPE_PRIMER_PACK;
+  else if (mxf_is_metadata (key))
+    return MXF_KLV_PACKET_TYPE_METADATA;
+  else if (mxf_is_descriptive_metadata (key))
+    return MXF_KLV_PACKET_TYPE_DESCRIPTIVE_METADATA;
+  else if (mxf_is_generic_container_system_item (key))
+    return MXF_KLV_PACKET_TYPE_GENERIC_CONTAINER_SYSTEM_ITEM;
+  else if (mxf_is_generic_container_essence_element (key) ||
+      mxf_is_avid_essence_container_essence_element (key))
+    return MXF_KLV_PACKET_TYPE_ESSENCE_ELEMENT;
+  else if (mxf_is_random_index_pack (key))
+    return MXF_KLV_PACKET_TYPE_RANDOM_INDEX_PACK;
+  else if (mxf_is_index_table_segment (key))
+    return MXF_KLV_PACKET_TYPE_INDEX_TABLE_SEGMENT;
+  else if (mxf_is_fill (key))
+    return MXF_KLV_PACKET_TYPE_FILL;
+
+  return MXF_KLV_PACKET_TYPE_UNKNOWN;
+}
+
+static const guint8 partition_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x05, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01, 0x03, 0x04, 0x00
+};
+
+static const guint8 footer_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x05, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01, 0x04, 0x04, 0x00
+};
+
+static const guint8 primer_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x05, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01, 0x05, 0x01, 0x00
+};
+
+static const guint8 metadata_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x53, 0x01, 0x01,
+  0x0d, 0x01, 0x01, 0x01, 0x01, 0x01, 0x2f, 0x00
+};
+
+static const guint8 dm_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x53, 0x01, 0x01,
+  0x0d, 0x01, 0x04, 0x01, 0x01, 0x01, 0x01, 0x00
+};
+
+static const guint8 index_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x53, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01, 0x10, 0x01, 0x00
+};
+
+static const guint8 rip_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x05, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01, 0x11, 0x01, 0x00
+};
+
+static const guint8 fill_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x01, 0x01, 0x01, 0x02,
+  0x03, 0x01, 0x02, 0x10, 0x01, 0x00, 0x00, 0x00
+};
+
+static const guint8 system_item_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x05, 0x01, 0x01,
+  0x0d, 0x01, 0x03, 0x01, 0x04, 0x01, 0x01, 0x00
+};
+
+static const guint8 picture_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x01, 0x02, 0x01, 0x01,
+  0x0d, 0x01, 0x03, 0x01, 0x15, 0x01, 0x05, 0x01
+};
+
+static const guint8 sound_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x01, 0x02, 0x01, 0x01,
+  0x0d, 0x01, 0x03, 0x01, 0x16, 0x04, 0x03, 0x01
+};
+
+static const guint8 avid_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x01, 0x02, 0x01, 0x01,
+  0x0e, 0x04, 0x03, 0x01, 0x15, 0x01, 0x06, 0x01
+};
+
+static const guint8 unknown_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x01, 0x02, 0x01, 0x01,
+  0x0d, 0x01, 0x03, 0x01, 0x42, 0x01, 0x01, 0x01
+};
+
+static const guint8 non_mxf_key[] = {
+  0x47, 0x40, 0x00, 0x10, 0x00, 0x00, 0xb0, 0x0d,
+  0x00, 0x01, 0xc1, 0x00, 0x00, 0x00, 0x01, 0xe1
+};
+
+static const struct
+{
+  const guint8 *key;
+  MXFKLVPacketType type;
+} keys[] = {
+  {
+  partition_key, MXF_KLV_PACKET_TYPE_PARTITION_PACK}, {
+  footer_key, MXF_KLV_PACKET_TYPE_PARTITION_PACK}, {
+  primer_key, MXF_KLV_PACKET_TYPE_PRIMER_PACK}, {
+  metadata_key, MXF_KLV_PACKET_TYPE_METADATA}, {
+  dm_key, MXF_KLV_PACKET_TYPE_DESCRIPTIVE_METADATA}, {
+  index_key, MXF_KLV_PACKET_TYPE_INDEX_TABLE_SEGMENT}, {
+  rip_key, MXF_KLV_PACKET_TYPE_RANDOM_INDEX_PACK}, {
+  fill_key, MXF_KLV_PACKET_TYPE_FILL}, {
+  system_item_key, MXF_KLV_PACKET_TYPE_GENERIC_CONTAINER_SYSTEM_ITEM}, {
+  picture_key, MXF_KLV_PACKET_TYPE_ESSENCE_ELEMENT}, {
+  sound_key, MXF_KLV_PACKET_TYPE_ESSENCE_ELEMENT}, {
+  avid_key, MXF_KLV_PACKET_TYPE_ESSENCE_ELEMENT}, {
+  unknown_key, MXF_KLV_PACKET_TYPE_UNKNOWN}, {
+  non_mxf_key, MXF_KLV_PACKET_TYPE_NON_MXF}
+};
+
+GST_START_TEST (test_klv_packet_type)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (keys); i++) {
+    const MXFUL *key = (const MXFUL *) keys[i].key;
+
+    fail_unless_equals_int (mxf_klv_packet_type (key), keys[i].type);
+    fail_unless_equals_int (chain_klv_packet_type (key), keys[i].type);
+  }
+}
+
+GST_END_TEST;
+
+static guint8 *
+append_klv (guint8 * data, const guint8 * key, guint size)
+{
+  guint8 ber[9];
+  guint ber_size;
+
+  memcpy (data, key, 16);
+  ber_size = mxf_ber_encode_size (size, ber);
+  memcpy (data + 16, ber, ber_size);
+  memset (data + 16 + ber_size, 0, size);
+
+  return data + 16 + ber_size + size;
+}
+
+/* Builds an OP1a-like stream: header metadata, then one system item, one
+ * picture and four sound elements per frame, with a body partition, an
+ * index table segment and some fill every FRAMES_PER_PARTITION frames */
+static guint8 *
+create_klv_stream (gsize * size)
+{
+  guint8 *data, *p;
+  guint i, j;
+
+  data = p = g_malloc (STREAM_FRAMES * 6 * (16 + 9 + 64) + 64 * 1024);
+
+  p = append_klv (p, partition_key, 88);
+  p = append_klv (p, primer_key, 64);
+  for (i = 0; i < 40; i++)
+    p = append_klv (p, metadata_key, 48);
+  p = append_klv (p, dm_key, 48);
+  p = append_klv (p, fill_key, 32);
+
+  for (i = 0; i < STREAM_FRAMES; i++) {
+    if (i % FRAMES_PER_PARTITION == 0) {
+      p = append_klv (p, partition_key, 88);
+      p = append_klv (p, index_key, 64);
+      p = append_klv (p, fill_key, 32);
+    }
+    p = append_klv (p, system_item_key, 57);
+    p = append_klv (p, picture_key, 64);
+    for (j = 0; j < 4; j++)
+      p = append_klv (p, sound_key, 32);
+  }
+
+  p = append_klv (p, footer_key, 88);
+  p = append_klv (p, rip_key, 24);
+
+  *size = p - data;
+  return data;
+}
+
+static guint
+classify_stream (MXFKLVPacketType (*classify) (const MXFUL *),
+    const guint8 * data, gsize size, guint counts[])
+{
+  const guint8 *p = data, *end = data + size;
+  guint n = 0;
+
+  while (p < end) {
+    guint len;
+
+    counts[classify ((const MXFUL *) p)]++;
+    p += 16;
+    if (*p & 0x80) {
+      guint i, ber = *p++ & 0x7f;
+
+      for (len = 0, i = 0; i < ber; i++)
+        len = (len << 8) | *p++;
+    } else {
+      len = *p++;
+    }
+    p += len;
+    n++;
+  }
+
+  return n;
+}
+
+GST_START_TEST (test_klv_packet_type_benchmark)
+{
+  GTimer *timer;
+  guint8 *data;
+  gsize size;
+  guint i, n = 0;
+  guint counts[MXF_KLV_PACKET_TYPE_ESSENCE_ELEMENT + 1];
+  guint counts_ref[MXF_KLV_PACKET_TYPE_ESSENCE_ELEMENT + 1];
+  gdouble switch_time = 0, chain_time = 0;
+
+  data = create_klv_stream (&size);
+  timer = g_timer_new ();
+
+  for (i = 0; i < BENCHMARK_RUNS; i++) {
+    memset (counts, 0, sizeof (counts));
+    memset (counts_ref, 0, sizeof (counts_ref));
+
+    g_timer_start (timer);
+    classify_stream (chain_klv_packet_type, data, size, counts_ref);
+    chain_time += g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    n = classify_stream (mxf_klv_packet_type, data, size, counts);
+    switch_time += g_timer_elapsed (timer, NULL);
+
+    fail_unless (memcmp (counts, counts_ref, sizeof (counts)) == 0);
+  }
+
+  fail_unless_equals_int (counts[MXF_KLV_PACKET_TYPE_ESSENCE_ELEMENT],
+      STREAM_FRAMES * 5);
+  fail_unless_equals_int (counts[MXF_KLV_PACKET_TYPE_UNKNOWN], 0);
+
+  GST_INFO ("%u KLV packets: predicate chain %.1f Mkeys/s, switch "
+      "%.1f Mkeys/s", n, BENCHMARK_RUNS * n / chain_time / 1e6,
+      BENCHMARK_RUNS * n / switch_time / 1e6);
+
+  g_timer_destroy (timer);
+  g_free (data);
+}
+
+GST_END_TEST;
+
+static Suite *
+mxfklv_suite (void)
+{
+  Suite *s = suite_create ("MXF KLV");
+
+  TCase *tc_chain = tcase_create ("general");
+
+  GST_DEBUG_CATEGORY_INIT (mxf_debug, "mxf", 0, "MXF");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_klv_packet_type);
+  tcase_add_test (tc_chain, test_klv_packet_type_benchmark);
+
+  return s;
+}
+
+GST_CHECK_MAIN (mxfklv);
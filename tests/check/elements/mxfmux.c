@@ -21,7 +21,9 @@
  */
 
 #include <gst/check/gstcheck.h>
+#include <glib/gstdio.h>
 #include <string.h>
+#include <unistd.h>
 
 static const gchar *
 get_mpeg2enc_element_name (void)
@@ -239,6 +241,182 @@ GST_START_TEST (test_multiple_av_streams)
 
 GST_END_TEST;
 
+static const guint8 partition_pack_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x05, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01
+};
+
+static const guint8 index_table_segment_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x53, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01, 0x10, 0x01, 0x00
+};
+
+static const guint8 random_index_pack_key[] = {
+  0x06, 0x0e, 0x2b, 0x34, 0x02, 0x05, 0x01, 0x01,
+  0x0d, 0x01, 0x02, 0x01, 0x01, 0x11, 0x01, 0x00
+};
+
+/* Returns the size of the key and length of the KLV packet at @offset and
+ * stores the length of its value in @length */
+static guint
+read_klv (const guint8 * data, gsize size, guint64 offset, guint64 * length)
+{
+  guint i, n;
+
+  fail_unless (offset + 17 <= size);
+  data += offset;
+
+  if (data[16] < 0x80) {
+    *length = data[16];
+    return 17;
+  }
+
+  n = data[16] & 0x7f;
+  fail_unless (n > 0 && n <= 8);
+  fail_unless (offset + 17 + n <= size);
+  *length = 0;
+  for (i = 0; i < n; i++)
+    *length = (*length << 8) | data[17 + i];
+  fail_unless (offset + 17 + n + *length <= size);
+
+  return 17 + n;
+}
+
+static void
+check_partition_pack (const guint8 * data, gsize size, guint64 offset,
+    guint8 type)
+{
+  guint64 length;
+  guint hlen;
+
+  hlen = read_klv (data, size, offset, &length);
+  fail_unless (memcmp (data + offset, partition_pack_key,
+          sizeof (partition_pack_key)) == 0);
+  fail_unless_equals_int (data[offset + 13], type);
+  fail_unless (length >= 88);
+  /* ThisPartition */
+  fail_unless (GST_READ_UINT64_BE (data + offset + hlen + 8) == offset);
+}
+
+GST_START_TEST (test_footer_index_rip)
+{
+  GstElement *pipeline;
+  GstMessage *msg;
+  GstBus *bus;
+  GError *err = NULL;
+  gchar *desc, *filename, *contents;
+  const guint8 *data, *value;
+  gsize size;
+  guint64 rip_offset, footer, offset, length, index_byte_count, index_bytes;
+  guint32 index_sid;
+  guint hlen, n_segments;
+  gint fd;
+
+  fd = g_file_open_tmp ("mxfmux-XXXXXX.mxf", &filename, &err);
+  fail_unless (fd >= 0, "Could not create temporary file: %s",
+      err ? err->message : "");
+  close (fd);
+
+  desc = g_strdup_printf ("fakesrc num-buffers=50 sizetype=fixed "
+      "sizemax=320 filltype=pattern-span datarate=8000 format=time ! "
+      "audio/x-raw-int, rate=(int)8000, channels=(int)1, "
+      "signed=(boolean)false, endianness=(int)1234, width=(int)8, "
+      "depth=(int)8 ! mxfmux ! filesink location=\"%s\"", filename);
+  pipeline = gst_parse_launch (desc, &err);
+  fail_unless (pipeline != NULL, "Could not create pipeline: %s",
+      err ? err->message : "");
+  g_free (desc);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  fail_unless (g_file_get_contents (filename, &contents, &size, NULL));
+  g_unlink (filename);
+  g_free (filename);
+  data = (const guint8 *) contents;
+
+  /* The random index pack ends the file and its last 4 bytes are its size */
+  fail_unless (size > 4);
+  rip_offset = size - GST_READ_UINT32_BE (data + size - 4);
+  fail_unless (rip_offset < size);
+  hlen = read_klv (data, size, rip_offset, &length);
+  fail_unless (memcmp (data + rip_offset, random_index_pack_key, 16) == 0);
+  fail_unless_equals_int (rip_offset + hlen + length, size);
+
+  /* Header, body and footer partition */
+  fail_unless_equals_int (length, 3 * 12 + 4);
+  value = data + rip_offset + hlen;
+  fail_unless (GST_READ_UINT64_BE (value + 4) == 0);
+  check_partition_pack (data, size, 0, 0x02);
+  check_partition_pack (data, size, GST_READ_UINT64_BE (value + 12 + 4),
+      0x03);
+  footer = GST_READ_UINT64_BE (value + 24 + 4);
+  check_partition_pack (data, size, footer, 0x04);
+
+  /* The header partition was rewritten and points at the footer */
+  hlen = read_klv (data, size, 0, &length);
+  fail_unless (GST_READ_UINT64_BE (data + hlen + 24) == footer);
+
+  hlen = read_klv (data, size, footer, &length);
+  index_byte_count = GST_READ_UINT64_BE (data + footer + hlen + 40);
+  index_sid = GST_READ_UINT32_BE (data + footer + hlen + 48);
+  fail_unless (index_byte_count > 0);
+  fail_unless (index_sid != 0);
+
+  /* Skip the footer header metadata up to the first index table segment,
+   * the segments then must fill the index byte count and be directly
+   * followed by the random index pack */
+  offset = footer + hlen + length;
+  while (offset < rip_offset && memcmp (data + offset,
+          index_table_segment_key, 16) != 0) {
+    hlen = read_klv (data, size, offset, &length);
+    offset += hlen + length;
+  }
+
+  index_bytes = 0;
+  n_segments = 0;
+  while (offset < rip_offset && memcmp (data + offset,
+          index_table_segment_key, 16) == 0) {
+    guint64 pos;
+    gboolean have_sid = FALSE;
+
+    hlen = read_klv (data, size, offset, &length);
+    for (pos = 0; pos + 4 <= length;) {
+      guint16 tag = GST_READ_UINT16_BE (data + offset + hlen + pos);
+      guint16 tag_size = GST_READ_UINT16_BE (data + offset + hlen + pos + 2);
+
+      fail_unless (pos + 4 + tag_size <= length);
+      if (tag == 0x3f06) {
+        fail_unless_equals_int (tag_size, 4);
+        fail_unless_equals_int (GST_READ_UINT32_BE (data + offset + hlen +
+                pos + 4), index_sid);
+        have_sid = TRUE;
+      }
+      pos += 4 + tag_size;
+    }
+    fail_unless (have_sid);
+
+    index_bytes += hlen + length;
+    offset += hlen + length;
+    n_segments++;
+  }
+  fail_unless (n_segments > 0);
+  fail_unless_equals_int (index_bytes, index_byte_count);
+  fail_unless_equals_int (offset, rip_offset);
+
+  g_free (contents);
+}
+
+GST_END_TEST;
+
 static Suite *
 mxfmux_suite (void)
 {
@@ -254,6 +432,7 @@ mxfmux_suite (void)
   tcase_add_test (tc_chain, test_jpeg2000_alaw);
   tcase_add_test (tc_chain, test_dnxhd_mp3);
   tcase_add_test (tc_chain, test_multiple_av_streams);
+  tcase_add_test (tc_chain, test_footer_index_rip);
 
   return s;
 }
@@ -0,0 +1,342 @@
+/* GStreamer
+ *
+ * unit test for tsdemux
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/mpeg-crc32-private.h>
+#include <string.h>
+
+static GstStaticPadTemplate mysrctemplate =
+GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/mpegts, systemstream = (boolean) true"));
+
+static GstStaticPadTemplate mysinktemplate =
+GST_STATIC_PAD_TEMPLATE ("sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+#define TS_PACKET_SIZE 188
+#define PMT_PID 0x20
+#define AUDIO_PID 0x100
+
+/* the demuxer pulls 100 packets at a time once the initial scan is done */
+#define STREAMING_PULL_SIZE (100 * TS_PACKET_SIZE)
+
+/* VBR stream: a PCR every 600 ms, with 1, 1, 113 and 179 packets between
+ * them. PCR 3 is only seen during the initial scan before seeking */
+#define N_PACKETS 310
+#define PCR_BASE 90000
+#define PCR_INTERVAL 54000
+static const guint pcr_packets[] = { 2, 4, 6, 120, 300 };
+/* packets without payload repeat the continuity_counter of the previous
+ * PES packet */
+static const guint pcr_cc[] = { 15, 0, 1, 1, 1 };
+
+static GstPad *mysrcpad, *mysinkpad, *demuxsrcpad;
+static guint8 *src_data;
+static GMutex *check_mutex;
+static GCond *check_cond;
+static gint n_streaming_pulls;
+static gboolean flushing;
+static gint64 seek_pull_offset;
+
+static void
+write_packet_header (guint8 * data, guint16 pid, gboolean unit_start,
+    guint8 adaptation_field_control, guint cc)
+{
+  memset (data, 0xff, TS_PACKET_SIZE);
+  data[0] = 0x47;
+  data[1] = (unit_start ? 0x40 : 0x00) | (pid >> 8);
+  data[2] = pid & 0xff;
+  data[3] = (adaptation_field_control << 4) | (cc & 0x0f);
+}
+
+static void
+write_section_packet (guint8 * data, guint16 pid, guint8 * section,
+    guint size)
+{
+  write_packet_header (data, pid, TRUE, 0x1, 0);
+  /* pointer_field */
+  data[4] = 0;
+  GST_WRITE_UINT32_BE (section + size - 4, mpeg_crc32 (section, size - 4));
+  memcpy (data + 5, section, size);
+}
+
+static void
+write_pat_packet (guint8 * data)
+{
+  guint8 section[] = {
+    0x00, 0xb0, 13, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    /* program 1 */
+    0x00, 0x01, 0xe0 | (PMT_PID >> 8), PMT_PID & 0xff,
+    /* CRC */
+    0, 0, 0, 0
+  };
+
+  write_section_packet (data, 0, section, sizeof (section));
+}
+
+static void
+write_pmt_packet (guint8 * data)
+{
+  guint8 section[] = {
+    0x02, 0xb0, 18, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    /* PCR_PID, program_info_length */
+    0xe0 | (AUDIO_PID >> 8), AUDIO_PID & 0xff, 0xf0, 0x00,
+    /* MPEG-1 audio */
+    0x03, 0xe0 | (AUDIO_PID >> 8), AUDIO_PID & 0xff, 0xf0, 0x00,
+    /* CRC */
+    0, 0, 0, 0
+  };
+
+  write_section_packet (data, PMT_PID, section, sizeof (section));
+}
+
+static void
+write_pcr_packet (guint8 * data, guint64 pcr_base, guint cc)
+{
+  /* adaptation field only */
+  write_packet_header (data, AUDIO_PID, FALSE, 0x2, cc);
+  data[4] = 183;
+  /* PCR_flag */
+  data[5] = 0x10;
+  data[6] = pcr_base >> 25;
+  data[7] = pcr_base >> 17;
+  data[8] = pcr_base >> 9;
+  data[9] = pcr_base >> 1;
+  data[10] = ((pcr_base & 1) << 7) | 0x7e;
+  data[11] = 0x00;
+}
+
+static void
+write_pes_packet (guint8 * data, guint64 pts, guint cc)
+{
+  guint8 *pes = data + 4;
+
+  write_packet_header (data, AUDIO_PID, TRUE, 0x1, cc);
+  GST_WRITE_UINT32_BE (pes, 0x1c0);
+  GST_WRITE_UINT16_BE (pes + 4, TS_PACKET_SIZE - 4 - 6);
+  /* PTS only */
+  pes[6] = 0x80;
+  pes[7] = 0x80;
+  pes[8] = 5;
+  pes[9] = 0x21 | ((pts >> 29) & 0x0e);
+  pes[10] = pts >> 22;
+  pes[11] = ((pts >> 14) & 0xfe) | 0x01;
+  pes[12] = pts >> 7;
+  pes[13] = ((pts << 1) & 0xfe) | 0x01;
+}
+
+static guint8 *
+make_vbr_stream (void)
+{
+  guint8 *data = g_malloc (N_PACKETS * TS_PACKET_SIZE);
+  guint i;
+
+  for (i = 0; i < N_PACKETS; i++)
+    write_packet_header (data + i * TS_PACKET_SIZE, 0x1fff, FALSE, 0x1, 0);
+
+  write_pat_packet (data);
+  write_pmt_packet (data + TS_PACKET_SIZE);
+  for (i = 0; i < G_N_ELEMENTS (pcr_packets); i++)
+    write_pcr_packet (data + pcr_packets[i] * TS_PACKET_SIZE,
+        PCR_BASE + i * PCR_INTERVAL, pcr_cc[i]);
+  write_pes_packet (data + 3 * TS_PACKET_SIZE, PCR_BASE + 9000, 0);
+  write_pes_packet (data + 5 * TS_PACKET_SIZE, PCR_BASE + PCR_INTERVAL + 9000,
+      1);
+  write_pes_packet (data + 301 * TS_PACKET_SIZE,
+      PCR_BASE + 4 * PCR_INTERVAL + 9000, 2);
+
+  return data;
+}
+
+static GstFlowReturn
+_src_getrange (GstPad * pad, guint64 offset, guint length, GstBuffer ** buffer)
+{
+  if (length == STREAMING_PULL_SIZE) {
+    g_mutex_lock (check_mutex);
+    n_streaming_pulls++;
+    if (n_streaming_pulls == 2) {
+      /* hold the streaming thread back until the seek, so that it doesn't
+       * see the PCRs after the first pull */
+      while (!flushing)
+        g_cond_wait (check_cond, check_mutex);
+      g_mutex_unlock (check_mutex);
+      return GST_FLOW_WRONG_STATE;
+    } else if (n_streaming_pulls == 3) {
+      seek_pull_offset = offset;
+      g_cond_broadcast (check_cond);
+    }
+    g_mutex_unlock (check_mutex);
+  }
+
+  if (offset >= N_PACKETS * TS_PACKET_SIZE)
+    return GST_FLOW_UNEXPECTED;
+  length = MIN (length, N_PACKETS * TS_PACKET_SIZE - offset);
+
+  *buffer = gst_buffer_new ();
+  GST_BUFFER_DATA (*buffer) = src_data + offset;
+  GST_BUFFER_SIZE (*buffer) = length;
+  GST_BUFFER_OFFSET (*buffer) = offset;
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+_src_query (GstPad * pad, GstQuery * query)
+{
+  GstFormat fmt;
+
+  if (GST_QUERY_TYPE (query) != GST_QUERY_DURATION)
+    return FALSE;
+
+  gst_query_parse_duration (query, &fmt, NULL);
+  if (fmt != GST_FORMAT_BYTES)
+    return FALSE;
+
+  gst_query_set_duration (query, fmt, N_PACKETS * TS_PACKET_SIZE);
+
+  return TRUE;
+}
+
+static gboolean
+_src_event (GstPad * pad, GstEvent * event)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_START) {
+    g_mutex_lock (check_mutex);
+    flushing = TRUE;
+    g_cond_broadcast (check_cond);
+    g_mutex_unlock (check_mutex);
+  }
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static GstFlowReturn
+_sink_chain (GstPad * pad, GstBuffer * buffer)
+{
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+_sink_event (GstPad * pad, GstEvent * event)
+{
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static void
+_pad_added (GstElement * element, GstPad * pad, gpointer user_data)
+{
+  fail_unless (gst_pad_link (pad, mysinkpad) == GST_PAD_LINK_OK);
+
+  g_mutex_lock (check_mutex);
+  demuxsrcpad = gst_object_ref (pad);
+  g_cond_broadcast (check_cond);
+  g_mutex_unlock (check_mutex);
+}
+
+/* The PCRs found by the initial scan must still be used to seek in a VBR
+ * stream, before playback has gone over them */
+GST_START_TEST (test_seek_after_scan)
+{
+  GstElement *tsdemux;
+  GstPad *sinkpad;
+  GstEvent *event;
+
+  src_data = make_vbr_stream ();
+  check_mutex = g_mutex_new ();
+  check_cond = g_cond_new ();
+  n_streaming_pulls = 0;
+  flushing = FALSE;
+  seek_pull_offset = -1;
+  demuxsrcpad = NULL;
+
+  tsdemux = gst_element_factory_make ("tsdemux", NULL);
+  fail_unless (tsdemux != NULL);
+  g_signal_connect (tsdemux, "pad-added", G_CALLBACK (_pad_added), NULL);
+  sinkpad = gst_element_get_static_pad (tsdemux, "sink");
+  fail_unless (sinkpad != NULL);
+
+  mysinkpad = gst_pad_new_from_static_template (&mysinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, _sink_chain);
+  gst_pad_set_event_function (mysinkpad, _sink_event);
+  mysrcpad = gst_pad_new_from_static_template (&mysrctemplate, "src");
+  gst_pad_set_getrange_function (mysrcpad, _src_getrange);
+  gst_pad_set_query_function (mysrcpad, _src_query);
+  gst_pad_set_event_function (mysrcpad, _src_event);
+
+  fail_unless (gst_pad_link (mysrcpad, sinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (sinkpad);
+
+  gst_pad_set_active (mysinkpad, TRUE);
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  gst_element_set_state (tsdemux, GST_STATE_PLAYING);
+
+  g_mutex_lock (check_mutex);
+  while (demuxsrcpad == NULL)
+    g_cond_wait (check_cond, check_mutex);
+  g_mutex_unlock (check_mutex);
+
+  /* tsdemux starts SEEK_TIMESTAMP_OFFSET (500 ms) before the target, that
+   * is PCR 3 */
+  event = gst_event_new_seek (1.0, GST_FORMAT_TIME, GST_SEEK_FLAG_FLUSH,
+      GST_SEEK_TYPE_SET, 2300 * GST_MSECOND, GST_SEEK_TYPE_NONE, -1);
+  fail_unless (gst_pad_send_event (demuxsrcpad, event));
+
+  g_mutex_lock (check_mutex);
+  while (seek_pull_offset == -1)
+    g_cond_wait (check_cond, check_mutex);
+  g_mutex_unlock (check_mutex);
+
+  /* interpolating between the first and last PCR would give packet 225.5 */
+  fail_unless_equals_int (seek_pull_offset, pcr_packets[3] * TS_PACKET_SIZE);
+
+  gst_element_set_state (tsdemux, GST_STATE_NULL);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_pad_set_active (mysrcpad, FALSE);
+
+  gst_object_unref (demuxsrcpad);
+  gst_object_unref (tsdemux);
+  gst_object_unref (mysinkpad);
+  gst_object_unref (mysrcpad);
+  g_mutex_free (check_mutex);
+  g_cond_free (check_cond);
+  g_free (src_data);
+}
+
+GST_END_TEST;
+
+static Suite *
+tsdemux_suite (void)
+{
+  Suite *s = suite_create ("tsdemux");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_seek_after_scan);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tsdemux);
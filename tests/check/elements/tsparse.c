@@ -0,0 +1,164 @@
+/* GStreamer
+ *
+ * unit test for tsparse
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/mpeg-crc32-private.h>
+#include <string.h>
+
+static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/mpegts, systemstream = (boolean) true")
+    );
+
+#define TS_PACKET_SIZE 188
+#define EIT_PID 0x12
+
+/* For ease of programming we use globals to keep refs for our floating
+ * src and sink pads we create; otherwise we always have to do get_pad,
+ * get_peer, and then remove references in every test function */
+static GstPad *mysrcpad;
+
+/* Writes a TS packet with a single EIT section without events and returns
+ * the continuity counter of the next packet */
+static guint
+write_eit_packet (guint8 * data, guint cc, guint8 table_id,
+    guint16 service_id, guint16 transport_stream_id,
+    guint16 original_network_id)
+{
+  guint8 *section;
+  guint32 crc;
+
+  memset (data, 0xff, TS_PACKET_SIZE);
+  data[0] = 0x47;
+  /* payload_unit_start_indicator */
+  data[1] = 0x40 | (EIT_PID >> 8);
+  data[2] = EIT_PID & 0xff;
+  /* payload only */
+  data[3] = 0x10 | (cc & 0x0f);
+  /* pointer_field */
+  data[4] = 0;
+
+  section = data + 5;
+  section[0] = table_id;
+  /* section_syntax_indicator, section_length (header and CRC) */
+  GST_WRITE_UINT16_BE (section + 1, 0xf000 | 15);
+  GST_WRITE_UINT16_BE (section + 3, service_id);
+  /* version 1, current */
+  section[5] = 0xc0 | (1 << 1) | 0x01;
+  /* section_number, last_section_number */
+  section[6] = 0;
+  section[7] = 0;
+  GST_WRITE_UINT16_BE (section + 8, transport_stream_id);
+  GST_WRITE_UINT16_BE (section + 10, original_network_id);
+  /* segment_last_section_number, last_table_id */
+  section[12] = 0;
+  section[13] = table_id;
+  crc = mpeg_crc32 (section, 14);
+  GST_WRITE_UINT32_BE (section + 14, crc);
+
+  return cc + 1;
+}
+
+static void
+write_null_packet (guint8 * data)
+{
+  memset (data, 0xff, TS_PACKET_SIZE);
+  data[0] = 0x47;
+  data[1] = 0x1f;
+  data[2] = 0xff;
+  data[3] = 0x10;
+}
+
+/* EIT sections of the same service in other transport streams only differ
+ * by their transport_stream_id and original_network_id, they must not be
+ * taken as repetitions of each other */
+GST_START_TEST (test_eit_other_ts)
+{
+  GstElement *tsparse;
+  GstBuffer *buffer;
+  GstMessage *msg;
+  GstBus *bus;
+  guint8 *data;
+  guint cc = 0, i, n_eit = 0;
+  guint ts_ids = 0;
+
+  tsparse = gst_check_setup_element ("tsparse");
+  mysrcpad = gst_check_setup_src_pad (tsparse, &src_template, NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+  bus = gst_bus_new ();
+  gst_element_set_bus (tsparse, bus);
+  fail_unless (gst_element_set_state (tsparse,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS);
+
+  /* two transport streams, the first one repeated, and some padding so that
+   * the packet size is detected and the last section is handled */
+  buffer = gst_buffer_new_and_alloc (8 * TS_PACKET_SIZE);
+  data = GST_BUFFER_DATA (buffer);
+  cc = write_eit_packet (data, cc, 0x4f, 0x0101, 1, 0x0233);
+  cc = write_eit_packet (data + TS_PACKET_SIZE, cc, 0x4f, 0x0101, 2, 0x0233);
+  cc = write_eit_packet (data + 2 * TS_PACKET_SIZE, cc, 0x4f, 0x0101, 1,
+      0x0233);
+  for (i = 3; i < 8; i++)
+    write_null_packet (data + i * TS_PACKET_SIZE);
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+
+  while ((msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT))) {
+    const GstStructure *s = gst_message_get_structure (msg);
+    guint ts_id;
+
+    if (gst_structure_has_name (s, "eit")) {
+      fail_unless (gst_structure_get_uint (s, "transport-stream-id", &ts_id));
+      fail_unless (ts_id == 1 || ts_id == 2);
+      ts_ids |= 1 << ts_id;
+      n_eit++;
+    }
+    gst_message_unref (msg);
+  }
+
+  /* the repetition of the first section is skipped */
+  fail_unless_equals_int (n_eit, 2);
+  fail_unless_equals_int (ts_ids, (1 << 1) | (1 << 2));
+
+  gst_element_set_bus (tsparse, NULL);
+  gst_object_unref (bus);
+  fail_unless (gst_element_set_state (tsparse,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad (tsparse);
+  gst_check_teardown_element (tsparse);
+}
+
+GST_END_TEST;
+
+static Suite *
+tsparse_suite (void)
+{
+  Suite *s = suite_create ("tsparse");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_eit_other_ts);
+
+  return s;
+}
+
+GST_CHECK_MAIN (tsparse);
@@ -0,0 +1,177 @@
+/* Gstreamer
+ *
+ * unit test for the codec parsers helpers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include <gst/check/gstcheck.h>
+#include <gst/base/gstbytereader.h>
+#include <gst/codecparsers/gstcodecparserutils.h>
+
+#define STREAM_SIZE (8 * 1024 * 1024)
+#define BENCHMARK_RUNS 5
+
+static guint32 seed;
+
+static guint8
+_random_byte (void)
+{
+  seed = seed * 1103515245 + 12345;
+  return seed >> 16;
+}
+
+static gint
+_masked_scan (const guint8 * data, guint size)
+{
+  GstByteReader br;
+
+  gst_byte_reader_init (&br, data, size);
+  return gst_byte_reader_masked_scan_uint32 (&br, 0xffffff00, 0x00000100,
+      0, size);
+}
+
+/* Returns the number of start codes in @data */
+static guint
+_count_start_codes (gint (*scan) (const guint8 *, guint), const guint8 * data,
+    guint size)
+{
+  guint offset = 0, n = 0;
+  gint off;
+
+  while ((off = scan (data + offset, size - offset)) >= 0) {
+    offset += off + 3;
+    n++;
+  }
+
+  return n;
+}
+
+/* Fills @data like a video elementary stream: NAL units of entropy coded
+ * data, with emulation prevention bytes, separated by start codes */
+static void
+_fill_stream (guint8 * data, guint size)
+{
+  guint i = 0, nal_end = 0, zeros = 0;
+  guint8 b;
+
+  seed = 1;
+  while (i < size) {
+    if (i >= nal_end && i + 5 <= size) {
+      data[i++] = 0x00;
+      data[i++] = 0x00;
+      data[i++] = 0x00;
+      data[i++] = 0x01;
+      data[i++] = 0x41;
+      nal_end = i + 1000 + (_random_byte () << 6);
+      zeros = 0;
+      continue;
+    }
+
+    b = _random_byte ();
+    if (zeros >= 2 && b <= 3) {
+      data[i++] = 0x03;
+      zeros = 0;
+      continue;
+    }
+    zeros = b ? 0 : zeros + 1;
+    data[i++] = b;
+  }
+}
+
+GST_START_TEST (test_scan_start_code)
+{
+  static const guint8 sc[] = { 0x00, 0x00, 0x01, 0x65 };
+  static const guint8 sc4[] = { 0x00, 0x00, 0x00, 0x01, 0x65 };
+  static const guint8 end[] = { 0x12, 0x00, 0x00, 0x01 };
+  static const guint8 none[] = { 0x00, 0x00, 0x02, 0x00, 0x01, 0x00, 0x00 };
+  guint8 data[64];
+  guint i, size;
+
+  fail_unless_equals_int (gst_codec_parser_scan_start_code (sc, 4), 0);
+  fail_unless_equals_int (gst_codec_parser_scan_start_code (sc, 3), -1);
+  fail_unless_equals_int (gst_codec_parser_scan_start_code (sc4, 5), 1);
+  /* a start code has to be followed by a byte */
+  fail_unless_equals_int (gst_codec_parser_scan_start_code (end, 4), -1);
+  fail_unless_equals_int (gst_codec_parser_scan_start_code (none, 7), -1);
+  fail_unless_equals_int (gst_codec_parser_scan_start_code (NULL, 0), -1);
+
+  /* same results as the masked scan on data with lots of 0s and 1s */
+  seed = 1;
+  for (i = 0; i < 100000; i++) {
+    guint j;
+
+    size = 1 + _random_byte () % (sizeof (data) - 1);
+    for (j = 0; j < size; j++) {
+      guint8 b = _random_byte ();
+      data[j] = b < 96 ? 0 : (b < 160 ? 1 : b);
+    }
+    fail_unless_equals_int (gst_codec_parser_scan_start_code (data, size),
+        _masked_scan (data, size));
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_scan_start_code_benchmark)
+{
+  GTimer *timer;
+  guint8 *data;
+  guint i, n, n_ref = 0;
+  gdouble scan_time = 0, ref_time = 0;
+
+  data = g_malloc (STREAM_SIZE);
+  _fill_stream (data, STREAM_SIZE);
+  timer = g_timer_new ();
+
+  for (i = 0; i < BENCHMARK_RUNS; i++) {
+    g_timer_start (timer);
+    n_ref = _count_start_codes (_masked_scan, data, STREAM_SIZE);
+    ref_time += g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    n = _count_start_codes (gst_codec_parser_scan_start_code, data,
+        STREAM_SIZE);
+    scan_time += g_timer_elapsed (timer, NULL);
+
+    fail_unless_equals_int (n, n_ref);
+  }
+  fail_unless (n_ref > 0);
+
+  GST_INFO ("%u start codes in %u MB: masked scan %.1f MB/s, start code "
+      "scan %.1f MB/s", n_ref, STREAM_SIZE >> 20,
+      BENCHMARK_RUNS * (STREAM_SIZE >> 20) / ref_time,
+      BENCHMARK_RUNS * (STREAM_SIZE >> 20) / scan_time);
+
+  g_timer_destroy (timer);
+  g_free (data);
+}
+
+GST_END_TEST;
+
+static Suite *
+codecparserutils_suite (void)
+{
+  Suite *s = suite_create ("codecparserutils");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_scan_start_code);
+  tcase_add_test (tc_chain, test_scan_start_code_benchmark);
+
+  return s;
+}
+
+GST_CHECK_MAIN (codecparserutils);
@@ -132,6 +132,32 @@ static guint8 slice_dpa[] = {
   0x63, 0x72, 0x6f, 0x6e, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02
 };
 
+/* 1920x1080 main profile stream, with 12 bits frame_num and 16 bits
+ * pic_order_cnt_lsb so that the P slice header has an emulation prevention
+ * byte */
+static guint8 h264_sps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x67, 0x4d, 0x00, 0x28, 0x89, 0x8d, 0x60, 0x3c,
+  0x01, 0x13, 0xf2, 0xa0
+};
+
+static guint8 h264_pps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x68, 0xea, 0x8f, 0x20
+};
+
+static guint8 h264_idr_slice[] = {
+  0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x80, 0x04, 0x00, 0x00, 0x2d, 0x33,
+  0x20, 0x05, 0xef, 0x83, 0x76, 0x61, 0xef, 0xf2, 0xca, 0x4c, 0x75, 0x4c,
+  0xc6, 0x06, 0x1f, 0x50, 0x14, 0x99, 0x0e, 0x88, 0xf1, 0xc5, 0xd9, 0xc9
+};
+
+static guint8 h264_p_slice[] = {
+  0x00, 0x00, 0x00, 0x01, 0x41, 0xe0, 0x00, 0x00, 0x03, 0x00, 0x35, 0x43,
+  0xba, 0x30, 0x11, 0x44, 0xfc, 0x6e, 0x83, 0xde, 0x99, 0xd6, 0xc4, 0xb2,
+  0xcf, 0x75, 0xab, 0x0d, 0x8e, 0x52, 0xa6, 0x34, 0x6b, 0x87, 0x90
+};
+
+#define BENCHMARK_RUNS 200000
+
 GST_START_TEST (test_h264_parse_slice_dpa)
 {
   GstH264ParserResult res;
@@ -150,6 +176,299 @@ GST_START_TEST (test_h264_parse_slice_dpa)
 
 GST_END_TEST;
 
+static void
+identify_nalu (GstH264NalParser * parser, const guint8 * data, guint size,
+    GstH264NalUnit * nalu)
+{
+  assert_equals_int (gst_h264_parser_identify_nalu_unchecked (parser, data, 0,
+          size, nalu), GST_H264_PARSER_OK);
+}
+
+GST_START_TEST (test_h264_parse_slice_hdr)
+{
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+  GstH264NalUnit nalu;
+  GstH264SPS sps;
+  GstH264PPS pps;
+  GstH264SliceHdr slice;
+
+  identify_nalu (parser, h264_sps, sizeof (h264_sps), &nalu);
+  assert_equals_int (gst_h264_parser_parse_sps (parser, &nalu, &sps, TRUE),
+      GST_H264_PARSER_OK);
+  assert_equals_int (sps.profile_idc, 77);
+  assert_equals_int (sps.level_idc, 40);
+  assert_equals_int (sps.log2_max_frame_num_minus4, 8);
+  assert_equals_int (sps.log2_max_pic_order_cnt_lsb_minus4, 12);
+  assert_equals_int (sps.num_ref_frames, 2);
+  assert_equals_int (sps.width, 1920);
+  assert_equals_int (sps.height, 1080);
+
+  identify_nalu (parser, h264_pps, sizeof (h264_pps), &nalu);
+  assert_equals_int (gst_h264_parser_parse_pps (parser, &nalu, &pps),
+      GST_H264_PARSER_OK);
+  assert_equals_int (pps.entropy_coding_mode_flag, 1);
+  assert_equals_int (pps.num_ref_idx_l0_active_minus1, 1);
+  assert_equals_int (pps.deblocking_filter_control_present_flag, 1);
+  assert_equals_int (pps.transform_8x8_mode_flag, 0);
+
+  identify_nalu (parser, h264_idr_slice, sizeof (h264_idr_slice), &nalu);
+  assert_equals_int (gst_h264_parser_parse_slice_hdr (parser, &nalu, &slice,
+          TRUE, TRUE), GST_H264_PARSER_OK);
+  assert_equals_int (slice.type, GST_H264_I_SLICE + 5);
+  assert_equals_int (slice.slice_qp_delta, -2);
+  assert_equals_int (slice.slice_alpha_c0_offset_div2, 1);
+  assert_equals_int (slice.slice_beta_offset_div2, -1);
+  assert_equals_int (slice.header_size, 52);
+  assert_equals_int (slice.n_emulation_prevention_bytes, 0);
+
+  /* the emulation prevention byte is in the header, and counted in its
+   * size */
+  identify_nalu (parser, h264_p_slice, sizeof (h264_p_slice), &nalu);
+  assert_equals_int (gst_h264_parser_parse_slice_hdr (parser, &nalu, &slice,
+          TRUE, TRUE), GST_H264_PARSER_OK);
+  assert_equals_int (slice.type, GST_H264_P_SLICE);
+  assert_equals_int (slice.frame_num, 0);
+  assert_equals_int (slice.pic_order_cnt_lsb, 0);
+  assert_equals_int (slice.disable_deblocking_filter_idc, 1);
+  assert_equals_int (slice.header_size, 47);
+  assert_equals_int (slice.n_emulation_prevention_bytes, 1);
+
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
+static void
+setup_poc_test (GstH264SPS * sps, GstH264PPS * pps, GstH264SliceHdr * slice,
+    guint8 pic_order_cnt_type)
+{
+  memset (sps, 0, sizeof (*sps));
+  sps->pic_order_cnt_type = pic_order_cnt_type;
+  /* MaxPicOrderCntLsb and MaxFrameNum are 16 */
+  sps->log2_max_pic_order_cnt_lsb_minus4 = 0;
+  sps->log2_max_frame_num_minus4 = 0;
+  sps->max_frame_num = 16;
+  sps->frame_mbs_only_flag = 1;
+
+  memset (pps, 0, sizeof (*pps));
+  pps->sequence = sps;
+
+  memset (slice, 0, sizeof (*slice));
+  slice->pps = pps;
+}
+
+static gint32
+compute_poc (GstH264POCState * state, GstH264SliceHdr * slice, guint ref_idc,
+    guint16 frame_num, guint16 pic_order_cnt_lsb)
+{
+  GstH264NalUnit nalu;
+  gint32 poc;
+
+  memset (&nalu, 0, sizeof (nalu));
+  nalu.ref_idc = ref_idc;
+  nalu.idr_pic_flag = (frame_num == 0 && pic_order_cnt_lsb == 0 &&
+      ref_idc == 3);
+  nalu.type = nalu.idr_pic_flag ? GST_H264_NAL_SLICE_IDR : GST_H264_NAL_SLICE;
+  slice->frame_num = frame_num;
+  slice->pic_order_cnt_lsb = pic_order_cnt_lsb;
+
+  assert_equals_int (gst_h264_poc_state_compute (state, &nalu, slice, &poc),
+      GST_H264_PARSER_OK);
+
+  return poc;
+}
+
+GST_START_TEST (test_h264_poc_type_0)
+{
+  GstH264SPS sps;
+  GstH264PPS pps;
+  GstH264SliceHdr slice;
+  GstH264POCState state;
+
+  setup_poc_test (&sps, &pps, &slice, 0);
+  gst_h264_poc_state_init (&state);
+
+  /* IDR, then P B B pictures in decoding order */
+  assert_equals_int (compute_poc (&state, &slice, 3, 0, 0), 0);
+  assert_equals_int (compute_poc (&state, &slice, 2, 1, 6), 6);
+  assert_equals_int (compute_poc (&state, &slice, 0, 2, 2), 2);
+  assert_equals_int (compute_poc (&state, &slice, 0, 2, 4), 4);
+  assert_equals_int (compute_poc (&state, &slice, 2, 2, 12), 12);
+  /* pic_order_cnt_lsb wraps around after a reference picture */
+  assert_equals_int (compute_poc (&state, &slice, 2, 3, 2), 18);
+  /* a non reference picture does not update the msb */
+  assert_equals_int (compute_poc (&state, &slice, 0, 4, 14), 14);
+  assert_equals_int (compute_poc (&state, &slice, 0, 4, 0), 16);
+  assert_equals_int (compute_poc (&state, &slice, 2, 4, 8), 24);
+
+  /* the bottom field order count follows the top one */
+  slice.delta_pic_order_cnt_bottom = -1;
+  assert_equals_int (compute_poc (&state, &slice, 2, 5, 12), 27);
+  slice.delta_pic_order_cnt_bottom = 0;
+
+  /* memory_management_control_operation 5 resets the counts */
+  slice.dec_ref_pic_marking.adaptive_ref_pic_marking_mode_flag = 1;
+  slice.dec_ref_pic_marking.n_ref_pic_marking = 1;
+  slice.dec_ref_pic_marking.ref_pic_marking[0].
+      memory_management_control_operation = 5;
+  assert_equals_int (compute_poc (&state, &slice, 2, 6, 14), 0);
+  fail_unless (state.mmco5);
+  slice.dec_ref_pic_marking.adaptive_ref_pic_marking_mode_flag = 0;
+  assert_equals_int (compute_poc (&state, &slice, 2, 1, 4), 4);
+  fail_unless (!state.mmco5);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h264_poc_type_1)
+{
+  GstH264SPS sps;
+  GstH264PPS pps;
+  GstH264SliceHdr slice;
+  GstH264POCState state;
+
+  setup_poc_test (&sps, &pps, &slice, 1);
+  sps.num_ref_frames_in_pic_order_cnt_cycle = 1;
+  sps.offset_for_ref_frame[0] = 2;
+  sps.offset_for_non_ref_pic = -1;
+  gst_h264_poc_state_init (&state);
+
+  assert_equals_int (compute_poc (&state, &slice, 3, 0, 0), 0);
+  assert_equals_int (compute_poc (&state, &slice, 2, 1, 0), 2);
+  assert_equals_int (compute_poc (&state, &slice, 0, 2, 0), 1);
+  assert_equals_int (compute_poc (&state, &slice, 2, 2, 0), 4);
+  slice.delta_pic_order_cnt[0] = 1;
+  assert_equals_int (compute_poc (&state, &slice, 2, 3, 0), 7);
+  slice.delta_pic_order_cnt[0] = 0;
+  /* frame_num wraps around */
+  assert_equals_int (compute_poc (&state, &slice, 2, 0, 0), 32);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h264_poc_type_2)
+{
+  GstH264SPS sps;
+  GstH264PPS pps;
+  GstH264SliceHdr slice;
+  GstH264POCState state;
+
+  setup_poc_test (&sps, &pps, &slice, 2);
+  gst_h264_poc_state_init (&state);
+
+  assert_equals_int (compute_poc (&state, &slice, 3, 0, 0), 0);
+  assert_equals_int (compute_poc (&state, &slice, 2, 1, 0), 2);
+  assert_equals_int (compute_poc (&state, &slice, 0, 2, 0), 3);
+  assert_equals_int (compute_poc (&state, &slice, 2, 2, 0), 4);
+  assert_equals_int (compute_poc (&state, &slice, 2, 15, 0), 30);
+  assert_equals_int (compute_poc (&state, &slice, 2, 0, 0), 32);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h264_dpb_model)
+{
+  static const gint32 decode_order[] = { 0, 6, 2, 4, 12, 8, 10 };
+  GstH264SPS sps;
+  GstH264PPS pps;
+  GstH264SliceHdr slice;
+  GstH264DpbModel dpb;
+  gint32 poc, expected = 0;
+  guint i;
+
+  setup_poc_test (&sps, &pps, &slice, 0);
+
+  /* inferred from MaxDpbFrames for 1920x1088 at level 4 */
+  sps.profile_idc = 77;
+  sps.level_idc = 40;
+  sps.pic_width_in_mbs_minus1 = 119;
+  sps.pic_height_in_map_units_minus1 = 67;
+  gst_h264_dpb_model_init (&dpb, &sps);
+  assert_equals_int (gst_h264_dpb_model_get_max_num_reorder_frames (&dpb), 4);
+
+  /* the output order is the decoding order with pic_order_cnt_type 2 */
+  sps.pic_order_cnt_type = 2;
+  gst_h264_dpb_model_init (&dpb, &sps);
+  assert_equals_int (gst_h264_dpb_model_get_max_num_reorder_frames (&dpb), 0);
+
+  sps.pic_order_cnt_type = 0;
+  sps.vui_parameters_present_flag = 1;
+  sps.vui_parameters.bitstream_restriction_flag = 1;
+  sps.vui_parameters.num_reorder_frames = 2;
+  gst_h264_dpb_model_init (&dpb, &sps);
+  assert_equals_int (gst_h264_dpb_model_get_max_num_reorder_frames (&dpb), 2);
+
+  /* pictures come out in display order */
+  for (i = 0; i < G_N_ELEMENTS (decode_order); i++) {
+    fail_unless (gst_h264_dpb_model_add (&dpb, decode_order[i], i == 0));
+    while (gst_h264_dpb_model_bump (&dpb, FALSE, &poc)) {
+      assert_equals_int (poc, expected);
+      expected += 2;
+    }
+  }
+  assert_equals_int (expected, 10);
+  while (gst_h264_dpb_model_bump (&dpb, TRUE, &poc)) {
+    assert_equals_int (poc, expected);
+    expected += 2;
+  }
+  assert_equals_int (expected, 14);
+
+  /* a late picture makes the model hold more pictures */
+  sps.vui_parameters.num_reorder_frames = 0;
+  gst_h264_dpb_model_init (&dpb, &sps);
+  fail_unless (gst_h264_dpb_model_add (&dpb, 0, TRUE));
+  fail_unless (gst_h264_dpb_model_bump (&dpb, FALSE, &poc));
+  fail_unless (gst_h264_dpb_model_add (&dpb, 4, FALSE));
+  fail_unless (gst_h264_dpb_model_bump (&dpb, FALSE, &poc));
+  fail_if (gst_h264_dpb_model_add (&dpb, 2, FALSE));
+  assert_equals_int (gst_h264_dpb_model_get_max_num_reorder_frames (&dpb), 1);
+  fail_if (gst_h264_dpb_model_bump (&dpb, FALSE, &poc));
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h264_parse_headers_benchmark)
+{
+  GstH264NalParser *parser = gst_h264_nal_parser_new ();
+  GstH264NalUnit sps_nalu, pps_nalu, idr_nalu, p_nalu;
+  GstH264SPS sps;
+  GstH264PPS pps;
+  GstH264SliceHdr slice;
+  GTimer *timer;
+  gdouble param_time, slice_time;
+  guint i;
+
+  identify_nalu (parser, h264_sps, sizeof (h264_sps), &sps_nalu);
+  identify_nalu (parser, h264_pps, sizeof (h264_pps), &pps_nalu);
+  identify_nalu (parser, h264_idr_slice, sizeof (h264_idr_slice), &idr_nalu);
+  identify_nalu (parser, h264_p_slice, sizeof (h264_p_slice), &p_nalu);
+
+  timer = g_timer_new ();
+
+  for (i = 0; i < BENCHMARK_RUNS; i++) {
+    gst_h264_parser_parse_sps (parser, &sps_nalu, &sps, TRUE);
+    gst_h264_parser_parse_pps (parser, &pps_nalu, &pps);
+  }
+  param_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < BENCHMARK_RUNS; i++) {
+    gst_h264_parser_parse_slice_hdr (parser, &idr_nalu, &slice, TRUE, TRUE);
+    gst_h264_parser_parse_slice_hdr (parser, &p_nalu, &slice, TRUE, TRUE);
+  }
+  slice_time = g_timer_elapsed (timer, NULL);
+
+  assert_equals_int (slice.header_size, 47);
+
+  GST_INFO ("SPS/PPS: %.0f parameter sets/s, slice headers: %.0f headers/s",
+      2 * BENCHMARK_RUNS / param_time, 2 * BENCHMARK_RUNS / slice_time);
+
+  g_timer_destroy (timer);
+  gst_h264_nal_parser_free (parser);
+}
+
+GST_END_TEST;
+
 static Suite *
 h264parser_suite (void)
 {
@@ -159,6 +478,12 @@ h264parser_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_h264_parse_slice_dpa);
+  tcase_add_test (tc_chain, test_h264_parse_slice_hdr);
+  tcase_add_test (tc_chain, test_h264_poc_type_0);
+  tcase_add_test (tc_chain, test_h264_poc_type_1);
+  tcase_add_test (tc_chain, test_h264_poc_type_2);
+  tcase_add_test (tc_chain, test_h264_dpb_model);
+  tcase_add_test (tc_chain, test_h264_parse_headers_benchmark);
 
   return s;
 }
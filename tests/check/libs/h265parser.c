@@ -0,0 +1,481 @@
+/* Gstreamer
+ *
+ * unit test for the h265 parser library
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include <gst/check/gstcheck.h>
+#include <gst/codecparsers/gsth265parser.h>
+
+/* 1920x1080 main profile stream with 64x64 CTBs and 2 tile columns. The
+ * SPS has scaling lists, an inter predicted short term reference picture
+ * set and VUI with HRD parameters. The P slice header has an extension made
+ * of zeros, so that it has an emulation prevention byte */
+static guint8 h265_vps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+  0x00, 0x00, 0x03, 0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00,
+  0x5d, 0x95, 0x98, 0x09
+};
+
+static guint8 h265_sps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01, 0x60, 0x00, 0x00, 0x03,
+  0x00, 0x90, 0x00, 0x00, 0x03, 0x00, 0x00, 0x03, 0x00, 0x78, 0xa0, 0x03,
+  0xc0, 0x80, 0x11, 0x07, 0xcb, 0x96, 0x56, 0x69, 0x24, 0x4b, 0x55, 0x55,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0x92, 0xab, 0x27, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xfe, 0x6d, 0x7a, 0x79, 0xbc, 0x05, 0xa8, 0x08, 0x08,
+  0x08, 0x20, 0x00, 0x00, 0x03, 0x00, 0x20, 0x00, 0x00, 0x03, 0x03, 0x2c,
+  0x00, 0xbd, 0xef, 0xc0, 0x01, 0x38, 0x80, 0x00, 0x1d, 0x4c, 0x04
+};
+
+static guint8 h265_pps[] = {
+  0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc1, 0xa8, 0x92, 0x8a, 0x60, 0x97,
+  0xe2, 0x33, 0x40
+};
+
+static guint8 h265_sei[] = {
+  0x00, 0x00, 0x00, 0x01, 0x4e, 0x01, 0x06, 0x01, 0x3d
+};
+
+static guint8 h265_idr_slice[] = {
+  0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x3c, 0x8a, 0xe0, 0x81, 0xb6,
+  0x0d, 0xed, 0x7e, 0x19, 0x4f, 0x38, 0xbd, 0xef, 0x7d, 0xc1, 0x33, 0x7e,
+  0x05, 0x6d, 0xcf, 0x8e, 0x5c, 0xc6, 0x50, 0x23, 0x46, 0xe2, 0x3f, 0x42,
+  0x00, 0x01, 0x6a, 0x6d, 0x53, 0x54
+};
+
+static guint8 h265_p_slice[] = {
+  0x00, 0x00, 0x00, 0x01, 0x02, 0x01, 0x40, 0x68, 0x02, 0x9b, 0x25, 0x00,
+  0x00, 0x03, 0x00, 0x00, 0x80, 0x93, 0x9f, 0x64, 0x67, 0x5c, 0x63, 0xc3,
+  0x97, 0x0a, 0xb7, 0xd3, 0x53, 0x49, 0x86, 0x20, 0xa8, 0x99, 0x00, 0xac,
+  0x20, 0x9d, 0xb4, 0x9b, 0xf5, 0xa0, 0x5d, 0xf5, 0xf0, 0x59, 0x1c, 0x82,
+  0x0a
+};
+
+#define FUZZ_RUNS 20000
+#define BENCHMARK_RUNS 200000
+
+static const guint8 *h265_nals[] = {
+  h265_vps, h265_sps, h265_pps, h265_sei, h265_idr_slice, h265_p_slice
+};
+
+static const guint h265_nal_sizes[] = {
+  sizeof (h265_vps), sizeof (h265_sps), sizeof (h265_pps), sizeof (h265_sei),
+  sizeof (h265_idr_slice), sizeof (h265_p_slice)
+};
+
+static guint32 seed;
+
+static guint8
+_random_byte (void)
+{
+  seed = seed * 1103515245 + 12345;
+  return seed >> 16;
+}
+
+static void
+identify_nalu (GstH265Parser * parser, const guint8 * data, guint size,
+    GstH265NalUnit * nalu)
+{
+  assert_equals_int (gst_h265_parser_identify_nalu_unchecked (parser, data, 0,
+          size, nalu), GST_H265_PARSER_OK);
+}
+
+static void
+parse_headers (GstH265Parser * parser)
+{
+  GstH265NalUnit nalu;
+  GstH265VPS vps;
+  GstH265SPS sps;
+  GstH265PPS pps;
+
+  identify_nalu (parser, h265_vps, sizeof (h265_vps), &nalu);
+  assert_equals_int (gst_h265_parser_parse_vps (parser, &nalu, &vps),
+      GST_H265_PARSER_OK);
+  identify_nalu (parser, h265_sps, sizeof (h265_sps), &nalu);
+  assert_equals_int (gst_h265_parser_parse_sps (parser, &nalu, &sps, TRUE),
+      GST_H265_PARSER_OK);
+  identify_nalu (parser, h265_pps, sizeof (h265_pps), &nalu);
+  assert_equals_int (gst_h265_parser_parse_pps (parser, &nalu, &pps),
+      GST_H265_PARSER_OK);
+}
+
+/* Parses @nalu whatever its type is, the result does not matter */
+static void
+parse_any_nalu (GstH265Parser * parser, GstH265NalUnit * nalu)
+{
+  GstH265SliceHdr slice;
+  GstH265SEIMessage sei;
+  GstH265VPS vps;
+  GstH265SPS sps;
+  GstH265PPS pps;
+
+  if (GST_H265_IS_NAL_TYPE_VCL (nalu->type)) {
+    gst_h265_parser_parse_slice_hdr (parser, nalu, &slice);
+  } else if (nalu->type == GST_H265_NAL_PREFIX_SEI ||
+      nalu->type == GST_H265_NAL_SUFFIX_SEI) {
+    gst_h265_parser_parse_sei (parser, nalu, &sei);
+  } else if (nalu->type == GST_H265_NAL_VPS) {
+    gst_h265_parse_vps (nalu, &vps);
+  } else if (nalu->type == GST_H265_NAL_SPS) {
+    gst_h265_parse_sps (parser, nalu, &sps, TRUE);
+  } else if (nalu->type == GST_H265_NAL_PPS) {
+    gst_h265_parse_pps (parser, nalu, &pps);
+  }
+}
+
+GST_START_TEST (test_h265_parse_parameter_sets)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  GstH265NalUnit nalu;
+  GstH265VPS vps;
+  GstH265SPS sps;
+  GstH265PPS pps;
+  GstH265ShortTermRefPicSet *rps;
+
+  identify_nalu (parser, h265_vps, sizeof (h265_vps), &nalu);
+  assert_equals_int (nalu.type, GST_H265_NAL_VPS);
+  assert_equals_int (nalu.layer_id, 0);
+  assert_equals_int (nalu.temporal_id_plus1, 1);
+  assert_equals_int (gst_h265_parser_parse_vps (parser, &nalu, &vps),
+      GST_H265_PARSER_OK);
+  assert_equals_int (vps.id, 0);
+  assert_equals_int (vps.max_sub_layers_minus1, 0);
+  assert_equals_int (vps.profile_tier_level.profile_idc, 1);
+  assert_equals_int (vps.profile_tier_level.level_idc, 93);
+  assert_equals_int (vps.max_dec_pic_buffering_minus1[0], 4);
+  assert_equals_int (vps.max_num_reorder_pics[0], 2);
+  assert_equals_int (vps.max_latency_increase_plus1[0], 5);
+
+  identify_nalu (parser, h265_sps, sizeof (h265_sps), &nalu);
+  assert_equals_int (nalu.type, GST_H265_NAL_SPS);
+  assert_equals_int (gst_h265_parser_parse_sps (parser, &nalu, &sps, TRUE),
+      GST_H265_PARSER_OK);
+  fail_unless (sps.vps == parser->last_vps);
+  assert_equals_int (sps.profile_tier_level.level_idc, 120);
+  assert_equals_int (sps.chroma_format_idc, 1);
+  assert_equals_int (sps.width, 1920);
+  assert_equals_int (sps.height, 1088);
+  assert_equals_int (sps.crop_rect_width, 1920);
+  assert_equals_int (sps.crop_rect_height, 1080);
+  assert_equals_int (sps.log2_max_pic_order_cnt_lsb_minus4, 4);
+  assert_equals_int (sps.max_num_reorder_pics[0], 2);
+  assert_equals_int (sps.fps_num, 25);
+  assert_equals_int (sps.fps_den, 1);
+
+  /* default, explicit, copied and DC coded scaling lists */
+  assert_equals_int (sps.scaling_list.scaling_lists_4x4[0][15], 16);
+  assert_equals_int (sps.scaling_list.scaling_lists_8x8[0][63], 115);
+  assert_equals_int (sps.scaling_list.scaling_lists_8x8[3][63], 91);
+  assert_equals_int (sps.scaling_list.scaling_lists_8x8[2][0], 9);
+  assert_equals_int (sps.scaling_list.scaling_lists_8x8[2][63], 40);
+  assert_equals_int (sps.scaling_list.scaling_lists_16x16[1][63], 115);
+  assert_equals_int (sps.scaling_list.scaling_list_dc_coef_minus8_16x16[1],
+      8);
+  assert_equals_int (sps.scaling_list.scaling_lists_32x32[1][63], 10);
+  assert_equals_int (sps.scaling_list.scaling_list_dc_coef_minus8_32x32[1],
+      2);
+
+  assert_equals_int (sps.num_short_term_ref_pic_sets, 2);
+  rps = &sps.short_term_ref_pic_set[0];
+  assert_equals_int (rps->NumNegativePics, 2);
+  assert_equals_int (rps->NumPositivePics, 1);
+  assert_equals_int (rps->DeltaPocS0[0], -1);
+  assert_equals_int (rps->DeltaPocS0[1], -2);
+  assert_equals_int (rps->DeltaPocS1[0], 2);
+  assert_equals_int (rps->UsedByCurrPicS1[0], 0);
+
+  /* predicted from the first set with a delta of -1 */
+  rps = &sps.short_term_ref_pic_set[1];
+  assert_equals_int (rps->inter_ref_pic_set_prediction_flag, 1);
+  assert_equals_int (rps->NumDeltaPocs, 3);
+  assert_equals_int (rps->NumNegativePics, 2);
+  assert_equals_int (rps->DeltaPocS0[0], -1);
+  assert_equals_int (rps->DeltaPocS0[1], -2);
+  assert_equals_int (rps->NumPositivePics, 1);
+  assert_equals_int (rps->DeltaPocS1[0], 1);
+  assert_equals_int (rps->UsedByCurrPicS1[0], 1);
+
+  assert_equals_int (sps.vui_params.hrd_parameters_present_flag, 1);
+  assert_equals_int (sps.vui_params.hrd_params.
+      sublayer_hrd_params[0].bit_rate_value_minus1[0], 9999);
+  assert_equals_int (sps.vui_params.hrd_params.
+      sublayer_hrd_params[0].cpb_size_value_minus1[0], 29999);
+
+  identify_nalu (parser, h265_pps, sizeof (h265_pps), &nalu);
+  assert_equals_int (nalu.type, GST_H265_NAL_PPS);
+  assert_equals_int (gst_h265_parser_parse_pps (parser, &nalu, &pps),
+      GST_H265_PARSER_OK);
+  fail_unless (pps.sps == parser->last_sps);
+  assert_equals_int (pps.num_ref_idx_l0_default_active_minus1, 1);
+  assert_equals_int (pps.init_qp_minus26, -4);
+  assert_equals_int (pps.diff_cu_qp_delta_depth, 1);
+  assert_equals_int (pps.cb_qp_offset, -2);
+  assert_equals_int (pps.cr_qp_offset, 3);
+  assert_equals_int (pps.PicWidthInCtbsY, 30);
+  assert_equals_int (pps.PicHeightInCtbsY, 17);
+  assert_equals_int (pps.num_tile_columns_minus1, 1);
+  assert_equals_int (pps.num_tile_rows_minus1, 0);
+  assert_equals_int (pps.column_width_minus1[0], 14);
+  assert_equals_int (pps.beta_offset_div2, 2);
+  assert_equals_int (pps.tc_offset_div2, -1);
+  assert_equals_int (pps.scaling_list.scaling_lists_8x8[2][63], 40);
+
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h265_parse_slice_hdr)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  GstH265NalUnit nalu;
+  GstH265SliceHdr slice;
+
+  parse_headers (parser);
+
+  identify_nalu (parser, h265_idr_slice, sizeof (h265_idr_slice), &nalu);
+  assert_equals_int (nalu.type, GST_H265_NAL_SLICE_IDR_W_RADL);
+  assert_equals_int (gst_h265_parser_parse_slice_hdr (parser, &nalu, &slice),
+      GST_H265_PARSER_OK);
+  fail_unless (GST_H265_IS_I_SLICE (&slice));
+  assert_equals_int (slice.first_slice_segment_in_pic_flag, 1);
+  assert_equals_int (slice.sao_luma_flag, 1);
+  assert_equals_int (slice.sao_chroma_flag, 1);
+  assert_equals_int (slice.qp_delta, -3);
+  assert_equals_int (slice.deblocking_filter_override_flag, 1);
+  assert_equals_int (slice.beta_offset_div2, 1);
+  assert_equals_int (slice.tc_offset_div2, -2);
+  assert_equals_int (slice.header_size, 32);
+  assert_equals_int (slice.n_emulation_prevention_bytes, 0);
+
+  /* the emulation prevention byte is in the header, and counted in its
+   * size */
+  identify_nalu (parser, h265_p_slice, sizeof (h265_p_slice), &nalu);
+  assert_equals_int (nalu.type, GST_H265_NAL_SLICE_TRAIL_R);
+  assert_equals_int (gst_h265_parser_parse_slice_hdr (parser, &nalu, &slice),
+      GST_H265_PARSER_OK);
+  fail_unless (GST_H265_IS_P_SLICE (&slice));
+  assert_equals_int (slice.first_slice_segment_in_pic_flag, 0);
+  assert_equals_int (slice.segment_address, 3);
+  assert_equals_int (slice.pic_order_cnt_lsb, 0);
+  assert_equals_int (slice.short_term_ref_pic_set_sps_flag, 1);
+  assert_equals_int (slice.short_term_ref_pic_set_idx, 0);
+  assert_equals_int (slice.NumPicTotalCurr, 2);
+  assert_equals_int (slice.temporal_mvp_enabled_flag, 1);
+  assert_equals_int (slice.num_ref_idx_l0_active_minus1, 0);
+  assert_equals_int (slice.header_size, 88);
+  assert_equals_int (slice.n_emulation_prevention_bytes, 1);
+
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h265_parse_sei)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  GstH265NalUnit nalu;
+  GstH265SEIMessage sei;
+
+  identify_nalu (parser, h265_sei, sizeof (h265_sei), &nalu);
+  assert_equals_int (nalu.type, GST_H265_NAL_PREFIX_SEI);
+  assert_equals_int (gst_h265_parser_parse_sei (parser, &nalu, &sei),
+      GST_H265_PARSER_OK);
+  assert_equals_int (sei.payloadType, GST_H265_SEI_RECOVERY_POINT);
+  assert_equals_int (sei.recovery_point.recovery_poc_cnt, -3);
+  assert_equals_int (sei.recovery_point.exact_match_flag, 1);
+  assert_equals_int (sei.recovery_point.broken_link_flag, 0);
+
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h265_identify_nalu)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  GstH265NalUnit nalu;
+  guint8 *data;
+  gsize size = 0, offset = 0;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (h265_nals); i++)
+    size += h265_nal_sizes[i];
+  /* and an end of sequence nal unit */
+  data = g_malloc (size + 6);
+
+  /* byte-stream */
+  for (i = 0; i < G_N_ELEMENTS (h265_nals); i++) {
+    memcpy (data + offset, h265_nals[i], h265_nal_sizes[i]);
+    offset += h265_nal_sizes[i];
+  }
+  GST_WRITE_UINT32_BE (data + offset, 0x00000001);
+  data[offset + 4] = GST_H265_NAL_EOS << 1;
+  data[offset + 5] = 0x01;
+
+  offset = 0;
+  for (i = 0; i < G_N_ELEMENTS (h265_nals); i++) {
+    assert_equals_int (gst_h265_parser_identify_nalu (parser, data, offset,
+            size + 6, &nalu), GST_H265_PARSER_OK);
+    assert_equals_int (nalu.sc_offset, offset);
+    assert_equals_int (nalu.offset, offset + 4);
+    assert_equals_int (nalu.size, h265_nal_sizes[i] - 4);
+    offset += h265_nal_sizes[i];
+  }
+
+  /* the end of sequence does not need a following start code */
+  assert_equals_int (gst_h265_parser_identify_nalu (parser, data, offset,
+          size + 6, &nalu), GST_H265_PARSER_OK);
+  assert_equals_int (nalu.type, GST_H265_NAL_EOS);
+  assert_equals_int (nalu.size, 2);
+
+  /* without it, the end of the last slice is unknown */
+  assert_equals_int (gst_h265_parser_identify_nalu (parser, data,
+          offset - sizeof (h265_p_slice), size, &nalu),
+      GST_H265_PARSER_NO_NAL_END);
+
+  /* hvcC, with 4 bytes nal lengths */
+  offset = 0;
+  for (i = 0; i < G_N_ELEMENTS (h265_nals); i++) {
+    GST_WRITE_UINT32_BE (data + offset, h265_nal_sizes[i] - 4);
+    offset += h265_nal_sizes[i];
+  }
+
+  offset = 0;
+  for (i = 0; i < G_N_ELEMENTS (h265_nals); i++) {
+    assert_equals_int (gst_h265_parser_identify_nalu_hevc (parser, data,
+            offset, size, 4, &nalu), GST_H265_PARSER_OK);
+    assert_equals_int (nalu.offset, offset + 4);
+    assert_equals_int (nalu.size, h265_nal_sizes[i] - 4);
+    offset += h265_nal_sizes[i];
+  }
+
+  assert_equals_int (gst_h265_parser_identify_nalu_hevc (parser, data,
+          offset - sizeof (h265_p_slice), size - 1, 4, &nalu),
+      GST_H265_PARSER_NO_NAL_END);
+
+  g_free (data);
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
+/* Corrupts and truncates the nal units, the parser must not crash nor read
+ * out of the nal units */
+GST_START_TEST (test_h265_parse_fuzz)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  GstH265NalUnit nalu;
+  guint8 *data;
+  guint i, j, n, size;
+
+  seed = 1;
+  for (i = 0; i < FUZZ_RUNS; i++) {
+    n = i % G_N_ELEMENTS (h265_nals);
+    if (n == 0)
+      parse_headers (parser);
+
+    /* the data is copied to a buffer of the exact size, so that reads out of
+     * the nal unit can be caught by valgrind */
+    size = h265_nal_sizes[n];
+    if (_random_byte () & 1)
+      size = 6 + _random_byte () % (size - 5);
+    data = g_memdup (h265_nals[n], size);
+
+    for (j = _random_byte () % 8; j > 0; j--)
+      data[4 + _random_byte () % (size - 4)] ^= 1 << (_random_byte () % 8);
+
+    if (gst_h265_parser_identify_nalu_unchecked (parser, data, 0, size,
+            &nalu) == GST_H265_PARSER_OK) {
+      parse_any_nalu (parser, &nalu);
+      /* the corrupted parameter sets are also stored */
+      gst_h265_parser_parse_nal (parser, &nalu);
+    }
+
+    g_free (data);
+  }
+
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_h265_parse_headers_benchmark)
+{
+  GstH265Parser *parser = gst_h265_parser_new ();
+  GstH265NalUnit vps_nalu, sps_nalu, pps_nalu, idr_nalu, p_nalu;
+  GstH265VPS vps;
+  GstH265SPS sps;
+  GstH265PPS pps;
+  GstH265SliceHdr slice;
+  GTimer *timer;
+  gdouble param_time, slice_time;
+  guint i;
+
+  identify_nalu (parser, h265_vps, sizeof (h265_vps), &vps_nalu);
+  identify_nalu (parser, h265_sps, sizeof (h265_sps), &sps_nalu);
+  identify_nalu (parser, h265_pps, sizeof (h265_pps), &pps_nalu);
+  identify_nalu (parser, h265_idr_slice, sizeof (h265_idr_slice), &idr_nalu);
+  identify_nalu (parser, h265_p_slice, sizeof (h265_p_slice), &p_nalu);
+
+  timer = g_timer_new ();
+
+  for (i = 0; i < BENCHMARK_RUNS; i++) {
+    gst_h265_parser_parse_vps (parser, &vps_nalu, &vps);
+    gst_h265_parser_parse_sps (parser, &sps_nalu, &sps, TRUE);
+    gst_h265_parser_parse_pps (parser, &pps_nalu, &pps);
+  }
+  param_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  for (i = 0; i < BENCHMARK_RUNS; i++) {
+    gst_h265_parser_parse_slice_hdr (parser, &idr_nalu, &slice);
+    gst_h265_parser_parse_slice_hdr (parser, &p_nalu, &slice);
+  }
+  slice_time = g_timer_elapsed (timer, NULL);
+
+  assert_equals_int (slice.header_size, 88);
+
+  GST_INFO ("VPS/SPS/PPS: %.0f parameter sets/s, slice headers: %.0f "
+      "headers/s", 3 * BENCHMARK_RUNS / param_time,
+      2 * BENCHMARK_RUNS / slice_time);
+
+  g_timer_destroy (timer);
+  gst_h265_parser_free (parser);
+}
+
+GST_END_TEST;
+
+static Suite *
+h265parser_suite (void)
+{
+  Suite *s = suite_create ("H265 Parser library");
+
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_h265_parse_parameter_sets);
+  tcase_add_test (tc_chain, test_h265_parse_slice_hdr);
+  tcase_add_test (tc_chain, test_h265_parse_sei);
+  tcase_add_test (tc_chain, test_h265_identify_nalu);
+  tcase_add_test (tc_chain, test_h265_parse_fuzz);
+  tcase_add_test (tc_chain, test_h265_parse_headers_benchmark);
+
+  return s;
+}
+
+GST_CHECK_MAIN (h265parser);
@@ -0,0 +1,202 @@
+/* GStreamer
+ *
+ * unit test for the MPEG-2 systems CRC-32
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+#include <gst/mpeg-crc32-private.h>
+
+#define SECTION_SIZE 1024
+#define STREAM_SIZE (8 * 1024 * 1024)
+#define BENCHMARK_RUNS 5
+
+/* plain bit-at-a-time implementation to compare against */
+static guint32
+reference_crc32 (const guint8 * data, guint length)
+{
+  guint32 crc = 0xffffffff;
+  guint i, j;
+
+  for (i = 0; i < length; i++) {
+    crc ^= ((guint32) data[i]) << 24;
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ MPEG_CRC32_POLYNOMIAL :
+          (crc << 1);
+  }
+
+  return crc;
+}
+
+/* the byte-at-a-time table implementation the demuxers used to carry */
+static guint32 crc_tab[256];
+
+static void
+init_crc_tab (void)
+{
+  guint i, j;
+
+  for (i = 0; i < 256; i++) {
+    guint32 crc = i << 24;
+
+    for (j = 0; j < 8; j++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ MPEG_CRC32_POLYNOMIAL :
+          (crc << 1);
+    crc_tab[i] = crc;
+  }
+}
+
+static guint32
+table_crc32 (const guint8 * data, guint length)
+{
+  guint32 crc = 0xffffffff;
+  guint i;
+
+  for (i = 0; i < length; i++)
+    crc = (crc << 8) ^ crc_tab[((crc >> 24) ^ data[i]) & 0xff];
+
+  return crc;
+}
+
+/* Returns the xor of the CRCs of the SECTION_SIZE sections of @data, so
+ * that the computation can not be optimized away */
+static guint32
+_crc_sections (guint32 (*crc32) (const guint8 *, guint), const guint8 * data,
+    guint size)
+{
+  guint32 res = 0;
+  guint offset;
+
+  for (offset = 0; offset + SECTION_SIZE <= size; offset += SECTION_SIZE)
+    res ^= crc32 (data + offset, SECTION_SIZE);
+
+  return res;
+}
+
+GST_START_TEST (test_mpeg_crc32_check_value)
+{
+  const gchar *check = "123456789";
+
+  fail_unless (mpeg_crc32 ((const guint8 *) check, 9) == 0x0376e6e7);
+  fail_unless (mpeg_crc32 (NULL, 0) == 0xffffffff);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_mpeg_crc32_lengths)
+{
+  guint8 data[1024 + 8];
+  guint offset, length;
+  GRand *rand;
+
+  rand = g_rand_new_with_seed (1234);
+  for (length = 0; length < G_N_ELEMENTS (data); length++)
+    data[length] = g_rand_int_range (rand, 0, 256);
+  g_rand_free (rand);
+
+  /* every length up to a full section, at every alignment */
+  for (offset = 0; offset < 8; offset++) {
+    for (length = 0; length <= 1024; length++) {
+      fail_unless (mpeg_crc32 (data + offset, length) ==
+          reference_crc32 (data + offset, length),
+          "CRC mismatch for %u bytes at offset %u", length, offset);
+    }
+  }
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_mpeg_crc32_section)
+{
+  /* a PAT section with one program, the CRC_32 field makes the CRC over the
+   * whole section 0 */
+  static const guint8 pat[] = {
+    0x00, 0xb0, 0x0d, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0x00, 0x01, 0xe0, 0x20, 0x00, 0x00, 0x00, 0x00
+  };
+  guint8 section[sizeof (pat)];
+  guint32 crc;
+
+  memcpy (section, pat, sizeof (pat));
+  crc = mpeg_crc32 (section, sizeof (section) - 4);
+  GST_WRITE_UINT32_BE (section + sizeof (section) - 4, crc);
+
+  fail_unless (mpeg_crc32 (section, sizeof (section)) == 0);
+
+  section[5] ^= 0x02;
+  fail_if (mpeg_crc32 (section, sizeof (section)) == 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_mpeg_crc32_benchmark)
+{
+  GTimer *timer;
+  guint8 *data;
+  GRand *rand;
+  guint i, res, res_ref = 0;
+  gdouble crc_time = 0, ref_time = 0;
+
+  data = g_malloc (STREAM_SIZE);
+  rand = g_rand_new_with_seed (1234);
+  for (i = 0; i < STREAM_SIZE; i++)
+    data[i] = g_rand_int_range (rand, 0, 256);
+  g_rand_free (rand);
+  init_crc_tab ();
+  timer = g_timer_new ();
+
+  for (i = 0; i < BENCHMARK_RUNS; i++) {
+    g_timer_start (timer);
+    res_ref = _crc_sections (table_crc32, data, STREAM_SIZE);
+    ref_time += g_timer_elapsed (timer, NULL);
+
+    g_timer_start (timer);
+    res = _crc_sections (mpeg_crc32, data, STREAM_SIZE);
+    crc_time += g_timer_elapsed (timer, NULL);
+
+    fail_unless_equals_int (res, res_ref);
+  }
+
+  GST_INFO ("%u MB in %u byte sections: byte table %.1f MB/s, slice-by-8 "
+      "%.1f MB/s", STREAM_SIZE >> 20, SECTION_SIZE,
+      BENCHMARK_RUNS * (STREAM_SIZE >> 20) / ref_time,
+      BENCHMARK_RUNS * (STREAM_SIZE >> 20) / crc_time);
+
+  g_timer_destroy (timer);
+  g_free (data);
+}
+
+GST_END_TEST;
+
+static Suite *
+mpegcrc32_suite (void)
+{
+  Suite *s = suite_create ("MPEG CRC-32");
+
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_mpeg_crc32_check_value);
+  tcase_add_test (tc_chain, test_mpeg_crc32_lengths);
+  tcase_add_test (tc_chain, test_mpeg_crc32_section);
+  tcase_add_test (tc_chain, test_mpeg_crc32_benchmark);
+
+  return s;
+}
+
+GST_CHECK_MAIN (mpegcrc32);